@@ -0,0 +1,279 @@
+/*
+ * SUMMARY:      MakeMetBin.c - Convert met station files to a binary met file
+ * USAGE:        MakeMetBin <binary met file> <station file 1> [<station file 2> ...]
+ *
+ * DESCRIPTION:  Reads the text met files of a set of stations and writes
+ *               their records to a single binary met file, which DHSVM
+ *               reads instead of the station files when
+ *               "Station Binary File" is set in the [METEOROLOGY] section.
+ *               The station files must be given in the order of the station
+ *               numbers in the input file (all stations, including those
+ *               outside the basin).
+ * DESCRIP-END.
+ * FUNCTIONS:    main()
+ * COMMENTS:
+ *   The binary file starts with a header of 4-byte ints in native byte
+ *   order: "DHSVMMET" (8 characters), the version (1), the number of
+ *   stations, the number of records, the time step in seconds, the year,
+ *   month, day, hour, minute and second of the first record, and the number
+ *   of variables of each station.  It is followed by the records, each with
+ *   the 4-byte floats of all stations in station order.
+ *
+ *   The number of variables of a station is the number of values on the
+ *   first line of its file.  The records start at the first date that is in
+ *   all files and end with the last such date.  The time step has to be
+ *   constant and the same in all files.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXLINE       8192	/* Longest first line of a station file */
+#define MAXMETVARS    21	/* Most variables of a station, as in DHSVM */
+#define METBINVERSION 1
+
+const char *usage =
+  "MakeMetBin <binary met file> <station file 1> [<station file 2> ...]\n";
+
+typedef struct {
+  char *FileName;
+  FILE *FilePtr;
+  int NVars;			/* Number of variables */
+  int Date[6];			/* Pending date: month, day, year, hour, min, sec */
+  long long Time;		/* Pending date in seconds */
+  int AtEnd;			/* No pending date */
+} STATIONFILE;
+
+/*****************************************************************************
+  DaysFromCivil()
+
+  Days since 1970-01-01 of a date in the Gregorian calendar
+*****************************************************************************/
+static long long DaysFromCivil(int y, int m, int d)
+{
+  long long era;
+  int yoe, doy, doe;
+
+  y -= (m <= 2);
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = (int) (y - era * 400);
+  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/*****************************************************************************
+  NextDate()
+
+  Read the next date of a station file, in the form DHSVM reads it
+  (MM/DD/YYYY-HH[:MM[:SS]], any non-digit separators)
+*****************************************************************************/
+static void NextDate(STATIONFILE *Stat)
+{
+  char Str[MAXLINE];
+  char *p;
+  int n;
+
+  if (fscanf(Stat->FilePtr, "%s", Str) != 1) {
+    Stat->AtEnd = 1;
+    return;
+  }
+
+  for (n = 0; n < 6; n++)
+    Stat->Date[n] = 0;
+  for (p = Str, n = 0; *p != '\0' && n < 6; n++) {
+    Stat->Date[n] = atoi(p);
+    while (isdigit((int) *p))
+      p++;
+    while (*p != '\0' && !isdigit((int) *p))
+      p++;
+  }
+  if (n < 3 || Stat->Date[0] < 1 || Stat->Date[0] > 12 ||
+      Stat->Date[1] < 1 || Stat->Date[1] > 31) {
+    fprintf(stderr, "Invalid date %s in %s\n", Str, Stat->FileName);
+    exit(EXIT_FAILURE);
+  }
+
+  Stat->Time = DaysFromCivil(Stat->Date[2], Stat->Date[0], Stat->Date[1]) *
+    86400 + Stat->Date[3] * 3600 + Stat->Date[4] * 60 + Stat->Date[5];
+}
+
+/*****************************************************************************
+  ReadValues()
+*****************************************************************************/
+static void ReadValues(STATIONFILE *Stat, float *Values)
+{
+  int i;
+
+  for (i = 0; i < Stat->NVars; i++) {
+    if (fscanf(Stat->FilePtr, "%f", &Values[i]) != 1) {
+      fprintf(stderr, "Error reading values in %s\n", Stat->FileName);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  STATIONFILE *Stat;
+  FILE *OutFile;
+  char Line[MAXLINE];
+  char *Token;
+  float *Record;
+  long long Start;		/* First date in all files */
+  long long Dt;			/* Time step */
+  int Header[10];
+  int NStats;
+  int RecordSize;
+  int NRecords;
+  int i;
+
+  if (argc < 3) {
+    fprintf(stderr, "%s", usage);
+    exit(EXIT_FAILURE);
+  }
+
+  NStats = argc - 2;
+  if (!(Stat = (STATIONFILE *) calloc(NStats, sizeof(STATIONFILE)))) {
+    fprintf(stderr, "Cannot allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* open the station files and count the values on their first line */
+
+  for (i = 0, RecordSize = 0; i < NStats; i++) {
+    Stat[i].FileName = argv[i + 2];
+    if (!(Stat[i].FilePtr = fopen(Stat[i].FileName, "r"))) {
+      fprintf(stderr, "Cannot open file: %s\n", Stat[i].FileName);
+      exit(EXIT_FAILURE);
+    }
+    if (!fgets(Line, MAXLINE, Stat[i].FilePtr)) {
+      fprintf(stderr, "Error reading file: %s\n", Stat[i].FileName);
+      exit(EXIT_FAILURE);
+    }
+    Stat[i].NVars = -1;
+    for (Token = strtok(Line, " \t\r\n"); Token != NULL;
+         Token = strtok(NULL, " \t\r\n"))
+      Stat[i].NVars++;
+    if (Stat[i].NVars < 5 || Stat[i].NVars > MAXMETVARS) {
+      fprintf(stderr, "Invalid number of values (%d) in %s\n",
+              Stat[i].NVars, Stat[i].FileName);
+      exit(EXIT_FAILURE);
+    }
+    rewind(Stat[i].FilePtr);
+    RecordSize += Stat[i].NVars;
+
+    NextDate(&Stat[i]);
+    if (Stat[i].AtEnd) {
+      fprintf(stderr, "No records in %s\n", Stat[i].FileName);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!(Record = (float *) calloc(RecordSize, sizeof(float)))) {
+    fprintf(stderr, "Cannot allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* skip the records before the first date that is in all files */
+
+  for (i = 0, Start = Stat[0].Time; i < NStats; i++)
+    if (Stat[i].Time > Start)
+      Start = Stat[i].Time;
+  for (i = 0; i < NStats; i++) {
+    while (!Stat[i].AtEnd && Stat[i].Time < Start) {
+      ReadValues(&Stat[i], Record);
+      NextDate(&Stat[i]);
+    }
+    if (Stat[i].AtEnd || Stat[i].Time != Start) {
+      fprintf(stderr, "%s has no record at the start date of the other files\n",
+              Stat[i].FileName);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* write the header; the number of records and the time step are filled
+     in at the end */
+
+  if (!(OutFile = fopen(argv[1], "wb"))) {
+    fprintf(stderr, "Cannot open file: %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  Header[0] = METBINVERSION;
+  Header[1] = NStats;
+  Header[2] = 0;
+  Header[3] = 0;
+  Header[4] = Stat[0].Date[2];
+  Header[5] = Stat[0].Date[0];
+  Header[6] = Stat[0].Date[1];
+  Header[7] = Stat[0].Date[3];
+  Header[8] = Stat[0].Date[4];
+  Header[9] = Stat[0].Date[5];
+  fwrite("DHSVMMET", sizeof(char), 8, OutFile);
+  fwrite(Header, sizeof(int), 10, OutFile);
+  for (i = 0; i < NStats; i++)
+    fwrite(&(Stat[i].NVars), sizeof(int), 1, OutFile);
+
+  /* copy the records until one of the files ends */
+
+  NRecords = 0;
+  Dt = 0;
+  for (;;) {
+    for (i = 0, RecordSize = 0; i < NStats; i++) {
+      if (Stat[i].Time != Start + NRecords * Dt) {
+        fprintf(stderr, "Date of record %d in %s does not match the time step\n",
+                NRecords + 1, Stat[i].FileName);
+        exit(EXIT_FAILURE);
+      }
+      ReadValues(&Stat[i], &Record[RecordSize]);
+      RecordSize += Stat[i].NVars;
+    }
+    if (fwrite(Record, sizeof(float), RecordSize, OutFile) !=
+        (size_t) RecordSize) {
+      fprintf(stderr, "Error writing to file: %s\n", argv[1]);
+      exit(EXIT_FAILURE);
+    }
+    NRecords++;
+
+    for (i = 0; i < NStats; i++)
+      NextDate(&Stat[i]);
+    for (i = 0; i < NStats; i++)
+      if (Stat[i].AtEnd)
+        break;
+    if (i < NStats)
+      break;
+
+    if (NRecords == 1) {
+      Dt = Stat[0].Time - Start;
+      if (Dt <= 0) {
+        fprintf(stderr, "Dates in %s are not increasing\n", Stat[0].FileName);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  if (Dt == 0)
+    Dt = 3600;
+  Header[2] = NRecords;
+  Header[3] = (int) Dt;
+  if (fseek(OutFile, 8L, SEEK_SET) != 0 ||
+      fwrite(Header, sizeof(int), 10, OutFile) != 10) {
+    fprintf(stderr, "Error writing to file: %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  fclose(OutFile);
+
+  printf("%d stations, %d records of %d values, time step %d s, starting "
+         "%02d/%02d/%04d-%02d:%02d:%02d\n", NStats, NRecords, RecordSize,
+         (int) Dt, Header[5], Header[6], Header[4], Header[7], Header[8],
+         Header[9]);
+
+  for (i = 0; i < NStats; i++)
+    fclose(Stat[i].FilePtr);
+  free(Stat);
+  free(Record);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1032 @@
+/*
+ * SUMMARY:      MakeSyntheticBasin.c - Write a complete synthetic DHSVM setup
+ * USAGE:        MakeSyntheticBasin [options] <directory>
+ *
+ * DESCRIPTION:  Writes the input files and the configuration file for a
+ *               synthetic basin of any size, so that DHSVM can be run and
+ *               timed on model areas of different sizes without a real
+ *               basin setup.  The basin is an ellipse that fills the grid.
+ *               The terrain is a valley that runs north to south through
+ *               the middle of the grid and drains to the south, with a
+ *               small undulation that does not create sinks.  The stream
+ *               network has a main stem down the valley and tributaries
+ *               that enter it from both sides.  The directory gets the
+ *               same layout as the DHSVM directory:
+ *
+ *                 config/Input.synthetic  configuration file
+ *                 input/                  maps, stream (and road) network
+ *                                         files, initial model state
+ *                 met/                    station files, or met/grid/ with
+ *                                         the gridded forcing
+ *                 output/                 output directory of the run
+ *
+ *               DHSVM is run from the config directory:
+ *
+ *                 cd <directory>/config && DHSVM Input.synthetic
+ *
+ * DESCRIP-END.
+ * FUNCTIONS:    main()
+ * COMMENTS:
+ *   Options (defaults in brackets):
+ *     -nx <columns> [64]      -ny <rows> [64]       -dx <grid spacing, m> [90]
+ *     -stations <n> [1]       number of met stations, or of met grid cells
+ *                             with -grid
+ *     -segments <n> [8]       number of stream segments
+ *     -days <n> [30]          length of the run, starting 10/01/2007
+ *     -dt <hours> [1]         model time step
+ *     -grid                   gridded met data instead of stations
+ *     -snow                   cold forcing that builds a snow pack, and
+ *                             snow sliding
+ *     -gap                    canopy gaps in part of the forest
+ *     -roads                  a road network that drains to the streams
+ *     -shading                terrain shading, with shadow and skyview maps
+ *     -watertable             flow gradient from the water table instead
+ *                             of the terrain
+ *
+ *   The maps are written in the binary format of the machine (Format =
+ *   BIN).  The forcing is made up of a seasonal and daily cycle with a
+ *   storm every few days, and is the same for every run with the same
+ *   options, so that timings of different builds can be compared.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+#define START_YEAR  2007
+#define START_MONTH 10
+#define START_DAY   1
+#define CENTER_LAT  46.854444	/* center of the area, as for Lawler */
+#define CENTER_LON  -116.723333
+#define TZ_MERIDIAN -105.0
+#define UTM_ZONE    11
+#define NSOILLAYERS 3
+
+const char *usage =
+  "MakeSyntheticBasin [-nx <columns>] [-ny <rows>] [-dx <m>] [-stations <n>]\n"
+  "                   [-segments <n>] [-days <n>] [-dt <hours>] [-grid]\n"
+  "                   [-snow] [-gap] [-roads] [-shading] [-watertable]\n"
+  "                   <directory>\n";
+
+/* Options of the synthetic basin */
+typedef struct {
+  int NX;
+  int NY;
+  float DX;
+  int NStations;
+  int NSegments;
+  int NDays;
+  float Dt;			/* hours */
+  int Grid;
+  int Snow;
+  int Gap;
+  int Roads;
+  int Shading;
+  int WaterTable;
+} BASINOPTIONS;
+
+/* Stream segment: a run of cells along a row or a column */
+typedef struct {
+  int ID;
+  int Order;
+  int Class;
+  int Outlet;
+  int x0, y0;			/* first cell */
+  int dx, dy;			/* step from one cell to the next */
+  int NCells;
+  float Azimuth;		/* direction of flow, degrees from north */
+} SEGMENT;
+
+/* Met station or grid cell */
+typedef struct {
+  char Name[64];
+  int x, y;
+  float North, East;
+  float Elev;
+} STATION;
+
+static char Dir[1024];
+static BASINOPTIONS Opt;
+static float ExtremeNorth;
+static float ExtremeWest;
+static unsigned char *Mask;
+static float *Dem;
+
+void deg2utm(float la, float lo, float *x, float *y, int zone);
+
+/*****************************************************************************
+  Helpers
+*****************************************************************************/
+static void Fail(const char *Message, const char *Name)
+{
+  fprintf(stderr, "MakeSyntheticBasin: %s: %s\n", Message, Name);
+  exit(EXIT_FAILURE);
+}
+
+static FILE *Open(const char *Name, const char *Mode)
+{
+  char Path[2048];
+  FILE *f;
+
+  sprintf(Path, "%s/%s", Dir, Name);
+  if (!(f = fopen(Path, Mode)))
+    Fail("Cannot open file", Path);
+  return f;
+}
+
+static void MakeDir(const char *Name)
+{
+  char Path[2048];
+  struct stat Info;
+
+  sprintf(Path, "%s/%s", Dir, Name);
+  if (stat(Path, &Info) == 0 && S_ISDIR(Info.st_mode))
+    return;
+  if (mkdir(Path, 0755) != 0)
+    Fail("Cannot make directory", Path);
+}
+
+static void *Alloc(size_t N, size_t Size)
+{
+  void *p;
+
+  if (!(p = calloc(N, Size)))
+    Fail("Cannot allocate memory", "");
+  return p;
+}
+
+static void WriteMap(const char *Name, void *Data, size_t Size, int NMaps)
+{
+  FILE *f;
+
+  f = Open(Name, "wb");
+  if (fwrite(Data, Size, (size_t) Opt.NX * Opt.NY * NMaps, f) !=
+      (size_t) Opt.NX * Opt.NY * NMaps)
+    Fail("Cannot write", Name);
+  fclose(f);
+}
+
+static int InBasin(int y, int x)
+{
+  double ry, rx;
+
+  if (y < 0 || y >= Opt.NY || x < 0 || x >= Opt.NX)
+    return 0;
+  ry = (y - Opt.NY / 2.0 + 0.5) / (Opt.NY / 2.0 - 0.5);
+  rx = (x - Opt.NX / 2.0 + 0.5) / (Opt.NX / 2.0 - 0.5);
+  return ry * ry + rx * rx < 1.0;
+}
+
+static int IsLeapYear(int Year)
+{
+  return (Year % 4 == 0 && Year % 100 != 0) || Year % 400 == 0;
+}
+
+static int DaysInMonth(int Year, int Month)
+{
+  static const int Days[12] =
+    { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+  return Days[Month - 1] + (Month == 2 && IsLeapYear(Year));
+}
+
+/* Date Day days after the start of the run */
+static void DayToDate(int Day, int *Year, int *Month, int *MDay, int *JDay)
+{
+  int i;
+
+  *Year = START_YEAR;
+  *Month = START_MONTH;
+  *MDay = START_DAY;
+  for (i = 0; i < Day; i++) {
+    if (++(*MDay) > DaysInMonth(*Year, *Month)) {
+      *MDay = 1;
+      if (++(*Month) > 12) {
+	*Month = 1;
+	(*Year)++;
+      }
+    }
+  }
+  *JDay = *MDay;
+  for (i = 1; i < *Month; i++)
+    *JDay += DaysInMonth(*Year, i);
+}
+
+/* Sine of the solar altitude and the solar azimuth (radians from north)
+   at the given local standard time */
+static double SunPosition(int JDay, double Hour, double *Azimuth)
+{
+  double Decl, HourAngle, Lat, SinAlt, CosAz;
+
+  Lat = CENTER_LAT * PI / 180.;
+  Decl = 23.45 * PI / 180. * sin(2. * PI * (284. + JDay) / 365.);
+  HourAngle = (Hour + (CENTER_LON - TZ_MERIDIAN) / 15. - 12.) * 15. * PI / 180.;
+  SinAlt = sin(Lat) * sin(Decl) + cos(Lat) * cos(Decl) * cos(HourAngle);
+  if (Azimuth != NULL) {
+    CosAz = (sin(Decl) - SinAlt * sin(Lat)) /
+      (sqrt(1. - SinAlt * SinAlt) * cos(Lat) + 1.e-12);
+    CosAz = CosAz > 1. ? 1. : (CosAz < -1. ? -1. : CosAz);
+    *Azimuth = acos(CosAz);
+    if (HourAngle > 0.)
+      *Azimuth = 2. * PI - *Azimuth;
+  }
+  return SinAlt;
+}
+
+/*****************************************************************************
+  Terrain: mask, DEM, soil and vegetation maps
+*****************************************************************************/
+static void MakeTerrain(void)
+{
+  float *Depth, *Gap, *SkyView;
+  unsigned char *Soil, *Veg;
+  double Slope, gE, gN, Valley, Hill, Wiggle;
+  int x, y, cx;
+
+  cx = Opt.NX / 2;
+  Valley = 0.02 * Opt.DX;	/* drop from one row to the next */
+  Hill = 0.08 * Opt.DX;		/* rise from one column to the next */
+  Wiggle = 0.2 * Valley;	/* less than any drop, so there are no sinks */
+
+  Mask = Alloc(Opt.NX * Opt.NY, 1);
+  Dem = Alloc(Opt.NX * Opt.NY, sizeof(float));
+  Soil = Alloc(Opt.NX * Opt.NY, 1);
+  Veg = Alloc(Opt.NX * Opt.NY, 1);
+  Depth = Alloc(Opt.NX * Opt.NY, sizeof(float));
+  for (y = 0; y < Opt.NY; y++) {
+    for (x = 0; x < Opt.NX; x++) {
+      Mask[y * Opt.NX + x] = InBasin(y, x);
+      Dem[y * Opt.NX + x] = 1000. + Valley * (Opt.NY - 1 - y) +
+	Hill * abs(x - cx) + Wiggle * sin(0.7 * x) * cos(0.5 * y);
+      /* loam in the valley bottom, sandy loam on the slopes */
+      Soil[y * Opt.NX + x] = abs(x - cx) <= Opt.NX / 8 ? 2 : 1;
+      Depth[y * Opt.NX + x] =
+	1.0 + 1.5 * (1. - (double) abs(x - cx) / (Opt.NX / 2 + 1));
+      /* forest, with clearings of 8 by 8 cells */
+      Veg[y * Opt.NX + x] = ((x / 8) + 2 * (y / 8)) % 5 == 0 ? 2 : 1;
+    }
+  }
+  WriteMap("input/mask.bin", Mask, 1, 1);
+  WriteMap("input/dem.bin", Dem, sizeof(float), 1);
+  WriteMap("input/soil.bin", Soil, 1, 1);
+  WriteMap("input/soild.bin", Depth, sizeof(float), 1);
+  WriteMap("input/veg.bin", Veg, 1, 1);
+
+  if (Opt.Gap) {
+    Gap = Alloc(Opt.NX * Opt.NY, sizeof(float));
+    for (y = 0; y < Opt.NY; y++)
+      for (x = 0; x < Opt.NX; x++)
+	if (Veg[y * Opt.NX + x] == 1 && (x + 2 * y) % 3 == 0)
+	  Gap[y * Opt.NX + x] = 20.;
+    WriteMap("input/gap.bin", Gap, sizeof(float), 1);
+    free(Gap);
+  }
+
+  if (Opt.Shading) {
+    /* sky view from the slope of each cell */
+    SkyView = Alloc(Opt.NX * Opt.NY, sizeof(float));
+    for (y = 0; y < Opt.NY; y++) {
+      for (x = 0; x < Opt.NX; x++) {
+	gE = (Dem[y * Opt.NX + (x < Opt.NX - 1 ? x + 1 : x)] -
+	      Dem[y * Opt.NX + (x > 0 ? x - 1 : x)]) / (2 * Opt.DX);
+	gN = (Dem[(y > 0 ? y - 1 : y) * Opt.NX + x] -
+	      Dem[(y < Opt.NY - 1 ? y + 1 : y) * Opt.NX + x]) / (2 * Opt.DX);
+	Slope = atan(sqrt(gE * gE + gN * gN));
+	SkyView[y * Opt.NX + x] = (1. + cos(Slope)) / 2.;
+      }
+    }
+    WriteMap("input/skyview.bin", SkyView, sizeof(float), 1);
+    free(SkyView);
+  }
+
+  free(Soil);
+  free(Veg);
+  free(Depth);
+}
+
+/*****************************************************************************
+  Shadow maps: one file per month in the run, with the shade factor for
+  each time of day, as written by make_shade_maps
+*****************************************************************************/
+static void MakeShadowMaps(void)
+{
+  unsigned char *Shade;
+  char Name[256];
+  double SinAlt, Azimuth, Slope, Aspect, gE, gN, CosI, Hour;
+  int NDaySteps, NMaps, Month, Year, MDay, JDay, Day, i, x, y, Done[13];
+
+  NDaySteps = (int) (24. / Opt.Dt + 0.5);
+  NMaps = NDaySteps > 24 ? 24 : NDaySteps;
+  Shade = Alloc((size_t) Opt.NX * Opt.NY * NMaps, 1);
+  memset(Done, 0, sizeof(Done));
+
+  for (Day = 0; Day <= Opt.NDays; Day++) {
+    DayToDate(Day, &Year, &Month, &MDay, &JDay);
+    if (Done[Month])
+      continue;
+    Done[Month] = 1;
+    JDay += 15 - MDay;		/* middle of the month */
+    for (i = 0; i < NMaps; i++) {
+      Hour = (i + 0.5) * 24. / NMaps;
+      SinAlt = SunPosition(JDay, Hour, &Azimuth);
+      for (y = 0; y < Opt.NY; y++) {
+	for (x = 0; x < Opt.NX; x++) {
+	  Shade[((size_t) i * Opt.NY + y) * Opt.NX + x] = 0;
+	  if (SinAlt <= 0.)
+	    continue;
+	  gE = (Dem[y * Opt.NX + (x < Opt.NX - 1 ? x + 1 : x)] -
+		Dem[y * Opt.NX + (x > 0 ? x - 1 : x)]) / (2 * Opt.DX);
+	  gN = (Dem[(y > 0 ? y - 1 : y) * Opt.NX + x] -
+		Dem[(y < Opt.NY - 1 ? y + 1 : y) * Opt.NX + x]) / (2 * Opt.DX);
+	  Slope = atan(sqrt(gE * gE + gN * gN));
+	  Aspect = atan2(-gE, -gN);
+	  CosI = SinAlt * cos(Slope) +
+	    sqrt(1. - SinAlt * SinAlt) * sin(Slope) * cos(Azimuth - Aspect);
+	  if (CosI <= 0.)
+	    continue;
+	  /* hillshade / 255 / sin(altitude), scaled so that 255 is 11.47 */
+	  CosI = 255. * CosI / SinAlt / 11.47;
+	  Shade[((size_t) i * Opt.NY + y) * Opt.NX + x] =
+	    CosI > 255. ? 255 : (unsigned char) CosI;
+	}
+      }
+    }
+    sprintf(Name, "input/shadow.%02d.bin", Month);
+    WriteMap(Name, Shade, 1, NMaps);
+  }
+  free(Shade);
+}
+
+/*****************************************************************************
+  Stream network: a main stem down the middle column, split in segments,
+  and tributaries along rows that enter it alternately from the west and
+  the east.  Returns the number of segments.
+*****************************************************************************/
+static int MakeStreams(SEGMENT **Segments, int **RoadRows, int *NRoads)
+{
+  SEGMENT *Seg;
+  FILE *f;
+  int cx, ytop, ybot, L, NMain, NTrib, N, i, j, k, x, y, yj, West, xa, xb;
+  int *Junction;
+  double z0, z1, Slope;
+
+  cx = Opt.NX / 2;
+  for (ytop = 0; ytop < Opt.NY && !InBasin(ytop, cx); ytop++);
+  for (ybot = Opt.NY - 1; ybot >= 0 && !InBasin(ybot, cx); ybot--);
+  ytop++;			/* start one cell in from the edge */
+  L = ybot - ytop + 1;
+  if (L < 1)
+    Fail("Grid too small for a stream network", "");
+
+  NTrib = Opt.NSegments / 2;
+  NMain = Opt.NSegments - NTrib;
+  if (NMain > L)
+    NMain = L;
+  Seg = Alloc(NMain + NTrib, sizeof(SEGMENT));
+  Junction = Alloc(NTrib + 1, sizeof(int));
+
+  /* main stem, numbered from the top; the order increases downstream */
+  for (i = 0; i < NMain; i++) {
+    Seg[i].ID = i + 1;
+    Seg[i].Order = i + 2;
+    Seg[i].Class = 2;
+    Seg[i].Outlet = i + 1 < NMain ? i + 2 : 0;
+    Seg[i].x0 = cx;
+    Seg[i].y0 = ytop + i * L / NMain;
+    Seg[i].dx = 0;
+    Seg[i].dy = 1;
+    Seg[i].NCells = ytop + (i + 1) * L / NMain - Seg[i].y0;
+    Seg[i].Azimuth = 180.;
+  }
+
+  /* tributaries */
+  N = NMain;
+  for (j = 0; j < NTrib; j++) {
+    yj = ytop + (j + 1) * L / (NTrib + 1);
+    West = (j % 2 == 0);
+    if (West) {
+      for (xa = 0; xa < cx && !InBasin(yj, xa); xa++);
+      xa++;
+      xb = cx - 1;
+    }
+    else {
+      for (xb = Opt.NX - 1; xb > cx && !InBasin(yj, xb); xb--);
+      xb--;
+      xa = cx + 1;
+    }
+    if (xb < xa)
+      continue;
+    Junction[j] = yj;
+    Seg[N].ID = N + 1;
+    Seg[N].Order = 1;
+    Seg[N].Class = 1;
+    for (k = 0; k < NMain; k++)
+      if (yj >= Seg[k].y0 && yj < Seg[k].y0 + Seg[k].NCells)
+	Seg[N].Outlet = Seg[k].ID;
+    Seg[N].x0 = West ? xa : xb;
+    Seg[N].y0 = yj;
+    Seg[N].dx = West ? 1 : -1;
+    Seg[N].dy = 0;
+    Seg[N].NCells = xb - xa + 1;
+    Seg[N].Azimuth = West ? 90. : 270.;
+    N++;
+  }
+
+  f = Open("input/stream.map.dat", "w");
+  fprintf(f, "# column row segment length(m) depth(m) width(m) azimuth\n");
+  for (i = 0; i < N; i++)
+    for (k = 0; k < Seg[i].NCells; k++)
+      fprintf(f, "%6d %6d %5d %10.3f %6.2f %6.2f %6.1f\n",
+	      Seg[i].x0 + k * Seg[i].dx, Seg[i].y0 + k * Seg[i].dy, Seg[i].ID,
+	      Opt.DX, Seg[i].Class == 2 ? 1.0 : 0.5,
+	      Seg[i].Class == 2 ? 2.0 : 1.0, Seg[i].Azimuth);
+  fclose(f);
+
+  f = Open("input/stream.network.dat", "w");
+  fprintf(f, "# segment order slope length(m) class outlet\n");
+  for (i = 0; i < N; i++) {
+    x = Seg[i].x0 + (Seg[i].NCells - 1) * Seg[i].dx;
+    y = Seg[i].y0 + (Seg[i].NCells - 1) * Seg[i].dy;
+    z0 = Dem[Seg[i].y0 * Opt.NX + Seg[i].x0];
+    z1 = Dem[y * Opt.NX + x];
+    Slope = Seg[i].NCells > 1 ? (z0 - z1) / ((Seg[i].NCells - 1) * Opt.DX) : 0.;
+    if (Slope < 0.001)
+      Slope = 0.001;
+    fprintf(f, "%5d %5d %8.4f %10.2f %5d %5d", Seg[i].ID, Seg[i].Order, Slope,
+	    Seg[i].NCells * Opt.DX, Seg[i].Class, Seg[i].Outlet);
+    if (Seg[i].Outlet == 0)
+      fprintf(f, "  SAVE \"OUTLET\"");
+    fprintf(f, "\n");
+  }
+  fclose(f);
+
+  f = Open("input/stream.class.dat", "w");
+  fprintf(f, "# class width(m) bank height(m) Manning's n\n");
+  fprintf(f, "1  1.0  0.5  0.05\n");
+  fprintf(f, "2  3.0  1.0  0.04\n");
+  fclose(f);
+
+  /* rows for the roads: halfway between the tributaries */
+  *NRoads = 0;
+  *RoadRows = Alloc(NTrib + 1, sizeof(int));
+  for (j = 0; j <= NTrib; j++) {
+    y = ytop + (2 * j + 1) * L / (2 * (NTrib + 1));
+    if (y > ytop && y < ybot)
+      (*RoadRows)[(*NRoads)++] = y;
+  }
+
+  free(Junction);
+  *Segments = Seg;
+  return N;
+}
+
+/*****************************************************************************
+  Road network: a road along each road row on the west side of the valley,
+  draining through a culvert next to the main stem
+*****************************************************************************/
+static int MakeRoads(int *RoadRows, int NRoads)
+{
+  FILE *Map, *Net, *Class;
+  int cx, i, x, xa, N;
+
+  cx = Opt.NX / 2;
+  Map = Open("input/road.map.dat", "w");
+  Net = Open("input/road.network.dat", "w");
+  fprintf(Map, "# column row segment length(m) cut height(m) cut width(m) "
+	  "azimuth sink\n");
+  fprintf(Net, "# segment order slope length(m) class outlet\n");
+  N = 0;
+  for (i = 0; i < NRoads; i++) {
+    for (xa = 0; xa < cx && !InBasin(RoadRows[i], xa); xa++);
+    xa++;
+    if (cx - 1 - xa < 1)
+      continue;
+    N++;
+    for (x = xa; x < cx; x++)
+      fprintf(Map, "%6d %6d %5d %10.3f %6.2f %6.2f %6.1f%s\n", x,
+	      RoadRows[i], N, Opt.DX, 0.5, 3.0, 90.,
+	      x == cx - 1 ? " SINK" : "");
+    fprintf(Net, "%5d %5d %8.4f %10.2f %5d %5d\n", N, 1, 0.02,
+	    (cx - xa) * Opt.DX, 1, 0);
+  }
+  fclose(Map);
+  fclose(Net);
+
+  Class = Open("input/road.class.dat", "w");
+  fprintf(Class, "# class width(m) cut height(m) Manning's n "
+	  "infiltration(m/s) crown\n");
+  fprintf(Class, "1  5.0  0.5  0.02  0.0  OUTSLOPED\n");
+  fclose(Class);
+  return N;
+}
+
+/*****************************************************************************
+  Initial model state at the start of the run
+*****************************************************************************/
+static void MakeState(int NSegments)
+{
+  float *Map;
+  char Name[256], Date[64];
+  FILE *f;
+  int i, n, NMaps;
+
+  n = Opt.NX * Opt.NY;
+  sprintf(Date, "%02d.%02d.%04d.00.00.00", START_MONTH, START_DAY, START_YEAR);
+  Map = Alloc((size_t) n * 10, sizeof(float));
+
+  /* interception: rain and snow on the overstory, temporary storage */
+  sprintf(Name, "input/modelstate/Interception.State.%s.bin", Date);
+  WriteMap(Name, Map, sizeof(float), 3);
+
+  /* snow: HasSnow, LastSnow, Swq, PackWater, TPack, SurfWater, TSurf,
+     ColdContent; no snow at the start */
+  sprintf(Name, "input/modelstate/Snow.State.%s.bin", Date);
+  WriteMap(Name, Map, sizeof(float), 8);
+
+  /* soil: moisture of the root zone layers and below, surface
+     temperature, layer temperatures, ground heat storage and surface
+     water */
+  for (i = 0; i < n * NSOILLAYERS; i++)
+    Map[i] = 0.25;
+  NMaps = NSOILLAYERS;
+  for (i = 0; i < n; i++)
+    Map[NMaps * n + i] = 0.30;
+  NMaps++;
+  for (i = 0; i < n * (1 + NSOILLAYERS); i++)
+    Map[NMaps * n + i] = 8.0;
+  NMaps += 1 + NSOILLAYERS;
+  for (i = 0; i < n * 2; i++)
+    Map[NMaps * n + i] = 0.0;
+  NMaps += 2;
+  sprintf(Name, "input/modelstate/Soil.State.%s.bin", Date);
+  WriteMap(Name, Map, sizeof(float), NMaps);
+
+  sprintf(Name, "input/modelstate/Channel.State.%s", Date);
+  f = Open(Name, "w");
+  for (i = 1; i <= NSegments; i++)
+    fprintf(f, "%d 0.5\n", i);
+  fclose(f);
+
+  free(Map);
+}
+
+/*****************************************************************************
+  Meteorological stations, or cells of a met grid inside the basin
+*****************************************************************************/
+static int MakeStations(STATION **Stations)
+{
+  STATION *Stat;
+  char Name[64];
+  float Lat, Lon, East, North;
+  double dLat, dLon;
+  int k, r, c, x, y, N, Max;
+
+  k = (int) ceil(sqrt((double) Opt.NStations));
+  Max = Opt.Grid ? k * k : Opt.NStations;
+  Stat = Alloc(Max, sizeof(STATION));
+  N = 0;
+
+  if (!Opt.Grid) {
+    /* stations spread over the basin, moved to the center until they are
+       inside it */
+    for (r = 0; r < k && N < Opt.NStations; r++) {
+      for (c = 0; c < k && N < Opt.NStations; c++) {
+	y = (int) ((r + 0.5) * Opt.NY / k);
+	x = (int) ((c + 0.5) * Opt.NX / k);
+	while (!InBasin(y, x)) {
+	  y += (y < Opt.NY / 2) ? 1 : -1;
+	  x += (x < Opt.NX / 2) ? 1 : (x > Opt.NX / 2 ? -1 : 0);
+	}
+	sprintf(Stat[N].Name, "Station%d", N + 1);
+	Stat[N].x = x;
+	Stat[N].y = y;
+	Stat[N].North = ExtremeNorth - (y + 0.5) * Opt.DX;
+	Stat[N].East = ExtremeWest + (x + 0.5) * Opt.DX;
+	Stat[N].Elev = Dem[y * Opt.NX + x];
+	N++;
+      }
+    }
+  }
+  else {
+    /* a k by k grid of latitudes and longitudes over the area; the file
+       name gives the location, which is read back the way DHSVM reads it */
+    dLat = Opt.NY * Opt.DX / (k * 111320.);
+    dLon = Opt.NX * Opt.DX / (k * 111320. * cos(CENTER_LAT * PI / 180.));
+    for (r = 0; r < k; r++) {
+      for (c = 0; c < k; c++) {
+	sprintf(Name, "data_%.5f_%.5f", CENTER_LAT + ((k - 1) / 2. - r) * dLat,
+		CENTER_LON + (c - (k - 1) / 2.) * dLon);
+	sscanf(Name, "data_%f_%f", &Lat, &Lon);
+	deg2utm(Lat, Lon, &East, &North, UTM_ZONE);
+	y = (int) floor((ExtremeNorth - North) / Opt.DX);
+	x = (int) floor((East - ExtremeWest) / Opt.DX);
+	if (!InBasin(y, x))
+	  continue;
+	strcpy(Stat[N].Name, Name);
+	Stat[N].x = x;
+	Stat[N].y = y;
+	Stat[N].North = North;
+	Stat[N].East = East;
+	Stat[N].Elev = Dem[y * Opt.NX + x];
+	N++;
+      }
+    }
+    if (N == 0)
+      Fail("No met grid cell inside the basin", "use more -stations");
+  }
+  *Stations = Stat;
+  return N;
+}
+
+/*****************************************************************************
+  Forcing for each station: air temperature (C), wind speed (m/s),
+  relative humidity (%), incoming shortwave and longwave (W/m2) and
+  precipitation (m per time step)
+*****************************************************************************/
+static void MakeForcing(STATION *Stat, int NStations)
+{
+  FILE *f;
+  char Name[256];
+  double Hour, Season, Tair, Wind, RH, Sin, Lin, Precip, SinAlt;
+  int s, Step, NSteps, StepsPerDay, Day, Year, Month, MDay, JDay, Storm;
+
+  StepsPerDay = (int) (24. / Opt.Dt + 0.5);
+  NSteps = Opt.NDays * StepsPerDay;
+  for (s = 0; s < NStations; s++) {
+    if (Opt.Grid)
+      sprintf(Name, "met/grid/%s", Stat[s].Name);
+    else
+      sprintf(Name, "met/%s", Stat[s].Name);
+    f = Open(Name, "w");
+    for (Step = 0; Step <= NSteps; Step++) {
+      Day = Step / StepsPerDay;
+      Hour = (Step % StepsPerDay) * Opt.Dt;
+      DayToDate(Day, &Year, &Month, &MDay, &JDay);
+
+      Season = cos(2. * PI * (JDay - 200) / 365.);
+      Tair = (Opt.Snow ? -8. : 8.) + 10. * Season +
+	5. * cos(2. * PI * (Hour - 15.) / 24.) + 0.3 * s;
+      Storm = ((Day + s) % 4 == 0) && Hour >= 6. && Hour < 18.;
+      Precip = Storm ?
+	1.5e-3 * Opt.Dt * (1. + 0.2 * sin(2. * PI * Hour / 12.)) : 0.;
+      RH = 70. + (Storm ? 25. : 0.) - 10. * cos(2. * PI * (Hour - 15.) / 24.);
+      RH = RH > 100. ? 100. : RH;
+      Wind = 2. + 1.5 * sin(2. * PI * Step * Opt.Dt / (24. * 3.7)) +
+	0.5 * s / NStations;
+      SinAlt = SunPosition(JDay, Hour + Opt.Dt / 2., NULL);
+      Sin = SinAlt > 0. ? 1360. * 0.75 * SinAlt * (Storm ? 0.4 : 1.) : 0.;
+      Lin = (Storm ? 0.95 : 0.75) * 5.67e-8 * pow(Tair + 273.15, 4.);
+
+      fprintf(f, "%02d/%02d/%04d-%02d:%02d\t%.4f\t%.2f\t%.4f\t%.4f\t%.4f\t%.9g\n",
+	      Month, MDay, Year, (int) Hour,
+	      (int) ((Hour - (int) Hour) * 60. + 0.5), Tair, Wind, RH, Sin,
+	      Lin, Precip);
+    }
+    fclose(f);
+  }
+}
+
+/*****************************************************************************
+  Configuration file
+*****************************************************************************/
+static void MakeConfig(STATION *Stat, int NStations, int NRoads)
+{
+  FILE *f;
+  int Year, Month, MDay, JDay, i;
+
+  DayToDate(Opt.NDays, &Year, &Month, &MDay, &JDay);
+  f = Open("config/Input.synthetic", "w");
+
+  fprintf(f, "# Synthetic basin of %d rows by %d columns, written by "
+	  "MakeSyntheticBasin\n\n", Opt.NY, Opt.NX);
+  fprintf(f, "[OPTIONS]\n");
+  fprintf(f, "Format               = BIN\n");
+  fprintf(f, "Extent               = BASIN\n");
+  fprintf(f, "Gradient             = %s\n",
+	  Opt.WaterTable ? "WATERTABLE" : "TOPOGRAPHY");
+  fprintf(f, "Flow Routing         = NETWORK\n");
+  fprintf(f, "Sensible Heat Flux   = FALSE\n");
+  fprintf(f, "Infiltration         = STATIC\n");
+  fprintf(f, "Interpolation        = INVDIST\n");
+  fprintf(f, "MM5                  = FALSE\n");
+  fprintf(f, "QPF                  = FALSE\n");
+  fprintf(f, "PRISM                = FALSE\n");
+  fprintf(f, "Gridded Met data     = %s\n", Opt.Grid ? "TRUE" : "FALSE");
+  fprintf(f, "Canopy radiation attenuation mode = FIXED\n");
+  fprintf(f, "Shading              = %s\n", Opt.Shading ? "TRUE" : "FALSE");
+  fprintf(f, "Shading data path    = %s\n", Opt.Shading ? "../input/shadow" : "");
+  fprintf(f, "Shading data extension = %s\n", Opt.Shading ? "bin" : "");
+  fprintf(f, "Skyview data path    = %s\n",
+	  Opt.Shading ? "../input/skyview.bin" : "");
+  fprintf(f, "Snotel               = FALSE\n");
+  fprintf(f, "Outside              = FALSE\n");
+  fprintf(f, "Rhoverride           = FALSE\n");
+  fprintf(f, "Precipitation Source = STATION\n");
+  fprintf(f, "Wind Source          = STATION\n");
+  fprintf(f, "Temperature lapse rate   = CONSTANT\n");
+  fprintf(f, "Precipitation lapse rate = CONSTANT\n");
+  fprintf(f, "Stream Temperature   = FALSE\n");
+  fprintf(f, "Riparian Shading     = FALSE\n");
+  fprintf(f, "Variable Light Transmittance = TRUE\n");
+  fprintf(f, "Canopy Gapping       = %s\n", Opt.Gap ? "TRUE" : "FALSE");
+  fprintf(f, "Snow Sliding         = %s\n", Opt.Snow ? "TRUE" : "FALSE");
+  fprintf(f, "Precipitation Separation = FALSE\n");
+  fprintf(f, "Snow Statistics      = FALSE\n\n");
+
+  fprintf(f, "[AREA]\n");
+  fprintf(f, "Coordinate System    = UTM\n");
+  fprintf(f, "Extreme North        = %.1f\n", ExtremeNorth);
+  fprintf(f, "Extreme West         = %.1f\n", ExtremeWest);
+  fprintf(f, "Center Latitude      = %f\n", CENTER_LAT);
+  fprintf(f, "Center Longitude     = %f\n", CENTER_LON);
+  fprintf(f, "Time Zone Meridian   = %.1f\n", TZ_MERIDIAN);
+  fprintf(f, "Number of Rows       = %d\n", Opt.NY);
+  fprintf(f, "Number of Columns    = %d\n", Opt.NX);
+  fprintf(f, "Grid spacing         = %g\n", Opt.DX);
+  fprintf(f, "Point North          =\n");
+  fprintf(f, "Point East           =\n\n");
+
+  fprintf(f, "[TIME]\n");
+  fprintf(f, "Time Step            = %g\n", Opt.Dt);
+  fprintf(f, "Model Start          = %02d/%02d/%04d-00:00\n", START_MONTH,
+	  START_DAY, START_YEAR);
+  fprintf(f, "Model End            = %02d/%02d/%04d-00:00\n\n", Month, MDay,
+	  Year);
+
+  fprintf(f, "[CONSTANTS]\n");
+  fprintf(f, "Ground Roughness     = 0.02\n");
+  fprintf(f, "Snow Roughness       = 0.01\n");
+  fprintf(f, "Snow Water Capacity  = 0.01\n");
+  fprintf(f, "Reference Height     = 70.0\n");
+  fprintf(f, "Rain LAI Multiplier  = 0.0001\n");
+  fprintf(f, "Snow LAI Multiplier  = 0.0002\n");
+  fprintf(f, "Min Intercepted Snow = 0.001\n");
+  fprintf(f, "Outside Basin Value  = 0\n");
+  fprintf(f, "Temperature Lapse Rate   = -0.0065\n");
+  fprintf(f, "Precipitation Lapse Rate = 0.000\n");
+  fprintf(f, "Max Surface Snow Layer Depth = 0.125\n");
+  fprintf(f, "Gap Wind Adj Factor  = 0.9\n");
+  fprintf(f, "Snowslide Parameter1 = 700\n");
+  fprintf(f, "Snowslide Parameter2 = 0.12\n");
+  fprintf(f, "Precipitation Multiplier Map =\n");
+  fprintf(f, "Rain Threshold       = 0.0\n");
+  fprintf(f, "Snow Threshold       = 2.0\n");
+  fprintf(f, "Fresh Snow Albedo    = 0.85\n");
+  fprintf(f, "Albedo Accumulation Lambda = 0.9\n");
+  fprintf(f, "Albedo Melting Lambda = 0.6\n");
+  fprintf(f, "Albedo Accumulation Min = 0.7\n");
+  fprintf(f, "Albedo Melting Min   = 0.55\n\n");
+
+  fprintf(f, "[TERRAIN]\n");
+  fprintf(f, "DEM File             = ../input/dem.bin\n");
+  fprintf(f, "Basin Mask File      = ../input/mask.bin\n\n");
+
+  fprintf(f, "[ROUTING]\n");
+  fprintf(f, "Stream Map File      = ../input/stream.map.dat\n");
+  fprintf(f, "Stream Network File  = ../input/stream.network.dat\n");
+  fprintf(f, "Stream Class File    = ../input/stream.class.dat\n");
+  fprintf(f, "Riparian Veg File    = NA\n");
+  if (NRoads > 0) {
+    fprintf(f, "Road Map File        = ../input/road.map.dat\n");
+    fprintf(f, "Road Network File    = ../input/road.network.dat\n");
+    fprintf(f, "Road Class File      = ../input/road.class.dat\n");
+  }
+  fprintf(f, "\n");
+
+  fprintf(f, "[METEOROLOGY]\n");
+  if (Opt.Grid) {
+    fprintf(f, "Number of Grids      = %d\n", NStations);
+    fprintf(f, "GRID_DECIMAL         = 5\n");
+    fprintf(f, "Met File Path        = ../met/grid/\n");
+    fprintf(f, "File Prefix          = data\n");
+    fprintf(f, "UTM Zone             = %d\n", UTM_ZONE);
+  }
+  else {
+    fprintf(f, "Number of Stations   = %d\n", NStations);
+    for (i = 0; i < NStations; i++) {
+      fprintf(f, "Station Name     %d = %s\n", i + 1, Stat[i].Name);
+      fprintf(f, "North Coordinate %d = %.1f\n", i + 1, Stat[i].North);
+      fprintf(f, "East Coordinate  %d = %.1f\n", i + 1, Stat[i].East);
+      fprintf(f, "Elevation        %d = %.2f\n", i + 1, Stat[i].Elev);
+      fprintf(f, "Station File     %d = ../met/%s\n", i + 1, Stat[i].Name);
+    }
+  }
+  fprintf(f, "\n");
+
+  fprintf(f, "[SOILS]\n");
+  fprintf(f, "Soil Map File        = ../input/soil.bin\n");
+  fprintf(f, "Soil Depth File      = ../input/soild.bin\n");
+  fprintf(f, "Number of Soil Types = 2\n");
+  fprintf(f, "Soil Description       1 = Sandy Loam\n");
+  fprintf(f, "Lateral Conductivity   1 = 5e-5\n");
+  fprintf(f, "Exponential Decrease   1 = 0.03\n");
+  fprintf(f, "Depth Threshold        1 = 1.5\n");
+  fprintf(f, "Maximum Infiltration   1 = 1e-5\n");
+  fprintf(f, "Capillary Drive        1 = 0.05\n");
+  fprintf(f, "Surface Albedo         1 = 0.1\n");
+  fprintf(f, "Number of Soil Layers  1 = %d\n", NSOILLAYERS);
+  fprintf(f, "Porosity               1 = 0.42 0.40 0.35\n");
+  fprintf(f, "Pore Size Distribution 1 = 0.38 0.38 0.38\n");
+  fprintf(f, "Bubbling Pressure      1 = .146 .146 .146\n");
+  fprintf(f, "Field Capacity         1 = .207 .207 .207\n");
+  fprintf(f, "Wilting Point          1 = .095 .095 .095\n");
+  fprintf(f, "Bulk Density           1 = 1540 1590 1740\n");
+  fprintf(f, "Vertical Conductivity  1 = 1e-5 1e-5 1e-5\n");
+  fprintf(f, "Thermal Conductivity   1 = 7.70 7.49 7.46\n");
+  fprintf(f, "Thermal Capacity       1 = 1.4e6 1.4e6 1.4e6\n");
+  fprintf(f, "Residual Water Content 1 = 0. 0. 0.\n");
+  fprintf(f, "Soil Description       2 = Loam\n");
+  fprintf(f, "Lateral Conductivity   2 = 2e-5\n");
+  fprintf(f, "Exponential Decrease   2 = 0.02\n");
+  fprintf(f, "Depth Threshold        2 = 2.0\n");
+  fprintf(f, "Maximum Infiltration   2 = 5e-6\n");
+  fprintf(f, "Capillary Drive        2 = 0.08\n");
+  fprintf(f, "Surface Albedo         2 = 0.1\n");
+  fprintf(f, "Number of Soil Layers  2 = %d\n", NSOILLAYERS);
+  fprintf(f, "Porosity               2 = 0.43 0.42 0.40\n");
+  fprintf(f, "Pore Size Distribution 2 = 0.25 0.25 0.25\n");
+  fprintf(f, "Bubbling Pressure      2 = .111 .111 .111\n");
+  fprintf(f, "Field Capacity         2 = .270 .270 .270\n");
+  fprintf(f, "Wilting Point          2 = .117 .117 .117\n");
+  fprintf(f, "Bulk Density           2 = 1490 1520 1600\n");
+  fprintf(f, "Vertical Conductivity  2 = 5e-6 5e-6 5e-6\n");
+  fprintf(f, "Thermal Conductivity   2 = 7.00 7.00 7.00\n");
+  fprintf(f, "Thermal Capacity       2 = 1.4e6 1.4e6 1.4e6\n");
+  fprintf(f, "Residual Water Content 2 = 0. 0. 0.\n\n");
+
+  fprintf(f, "[VEGETATION]\n");
+  fprintf(f, "Vegetation Map File  = ../input/veg.bin\n");
+  if (Opt.Gap)
+    fprintf(f, "Canopy Gap Map File  = ../input/gap.bin\n");
+  fprintf(f, "Number of Vegetation Types = 2\n");
+  fprintf(f, "Vegetation Description   1 = Evergreen Forest\n");
+  fprintf(f, "Impervious Fraction      1 = 0.0\n");
+  fprintf(f, "Detention Fraction       1 = 0\n");
+  fprintf(f, "Detention Decay          1 = 0\n");
+  fprintf(f, "Overstory Present        1 = TRUE\n");
+  fprintf(f, "Understory Present       1 = FALSE\n");
+  fprintf(f, "Fractional Coverage      1 = 0.9\n");
+  fprintf(f, "Trunk Space              1 = 0.5\n");
+  fprintf(f, "Aerodynamic Attenuation  1 = 2.5\n");
+  fprintf(f, "Radiation Attenuation    1 = 0.2\n");
+  fprintf(f, "Diffuse Radiation Attenuation 1 = 0.215\n");
+  fprintf(f, "Max Snow Int Capacity    1 = 0.03\n");
+  fprintf(f, "Snow Interception Eff    1 = 0.6\n");
+  fprintf(f, "Mass Release Drip Ratio  1 = 0.4\n");
+  fprintf(f, "Height                   1 = 25\n");
+  fprintf(f, "Overstory Monthly LAI    1 = 5.0 5.0 5.0 5.0 8.0 10.0 10.0 8.0 5.0 5.0 5.0 5.0\n");
+  fprintf(f, "Maximum Resistance       1 = 4000\n");
+  fprintf(f, "Minimum Resistance       1 = 460\n");
+  fprintf(f, "Moisture Threshold       1 = 0.33\n");
+  fprintf(f, "Vapor Pressure Deficit   1 = 4000\n");
+  fprintf(f, "Rpc                      1 = .108\n");
+  fprintf(f, "Overstory Monthly Alb    1 = 0.14 0.14 0.14 0.13 0.13 0.12 0.11 0.11 0.12 0.13 0.14 0.14\n");
+  fprintf(f, "Number of Root Zones     1 = 3\n");
+  fprintf(f, "Root Zone Depths         1 = 0.10 0.15 0.2\n");
+  fprintf(f, "Overstory Root Fraction  1 = 0.20 0.40 0.40\n");
+  fprintf(f, "Monthly Light Extinction 1 = 0.065 0.065 0.065 0.065 0.065 0.065 0.065 0.065 0.065 0.065 0.065 0.065\n");
+  fprintf(f, "Canopy View Adj Factor   1 = 1.0\n");
+  fprintf(f, "Vegetation Description   2 = Clearing\n");
+  fprintf(f, "Impervious Fraction      2 = 0.0\n");
+  fprintf(f, "Detention Fraction       2 = 0\n");
+  fprintf(f, "Detention Decay          2 = 0\n");
+  fprintf(f, "Overstory Present        2 = FALSE\n");
+  fprintf(f, "Understory Present       2 = FALSE\n");
+  fprintf(f, "Trunk Space              2 = 0.5\n");
+  fprintf(f, "Aerodynamic Attenuation  2 = 2.5\n");
+  fprintf(f, "Radiation Attenuation    2 = 0.2\n");
+  fprintf(f, "Diffuse Radiation Attenuation 2 = 0.215\n");
+  fprintf(f, "Max Snow Int Capacity    2 = 0.03\n");
+  fprintf(f, "Snow Interception Eff    2 = 0.6\n");
+  fprintf(f, "Mass Release Drip Ratio  2 = 0.4\n");
+  fprintf(f, "Maximum Resistance       2 = 4000\n");
+  fprintf(f, "Minimum Resistance       2 = 460\n");
+  fprintf(f, "Moisture Threshold       2 = 0.33\n");
+  fprintf(f, "Vapor Pressure Deficit   2 = 4000\n");
+  fprintf(f, "Rpc                      2 = .108\n");
+  fprintf(f, "Number of Root Zones     2 = 3\n");
+  fprintf(f, "Root Zone Depths         2 = 0.10 0.15 0.2\n");
+  fprintf(f, "Canopy View Adj Factor   2 = 1.0\n\n");
+
+  fprintf(f, "[OUTPUT]\n");
+  fprintf(f, "Output Directory     = ../output/\n");
+  fprintf(f, "Initial State Directory = ../input/modelstate/\n");
+  fprintf(f, "Number of Output Pixels = 0\n");
+  fprintf(f, "Number of Model States = 0\n");
+  fprintf(f, "Number of Map Variables = 0\n");
+  fprintf(f, "Number of Image Variables = 0\n");
+  fprintf(f, "Number of Graphics   = 0\n\n");
+  fprintf(f, "[End]\n");
+  fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+  SEGMENT *Segments;
+  STATION *Stations;
+  float East, North;
+  int *RoadRows;
+  int NSegments, NStations, NRoads, NCells, i;
+
+  Opt.NX = 64;
+  Opt.NY = 64;
+  Opt.DX = 90.;
+  Opt.NStations = 1;
+  Opt.NSegments = 8;
+  Opt.NDays = 30;
+  Opt.Dt = 1.;
+  Opt.Grid = 0;
+  Opt.Snow = 0;
+  Opt.Gap = 0;
+  Opt.Roads = 0;
+  Opt.Shading = 0;
+  Opt.WaterTable = 0;
+  Dir[0] = '\0';
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-nx") && i + 1 < argc)
+      Opt.NX = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-ny") && i + 1 < argc)
+      Opt.NY = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-dx") && i + 1 < argc)
+      Opt.DX = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-stations") && i + 1 < argc)
+      Opt.NStations = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-segments") && i + 1 < argc)
+      Opt.NSegments = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-days") && i + 1 < argc)
+      Opt.NDays = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-dt") && i + 1 < argc)
+      Opt.Dt = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-grid"))
+      Opt.Grid = 1;
+    else if (!strcmp(argv[i], "-snow"))
+      Opt.Snow = 1;
+    else if (!strcmp(argv[i], "-gap"))
+      Opt.Gap = 1;
+    else if (!strcmp(argv[i], "-roads"))
+      Opt.Roads = 1;
+    else if (!strcmp(argv[i], "-shading"))
+      Opt.Shading = 1;
+    else if (!strcmp(argv[i], "-watertable"))
+      Opt.WaterTable = 1;
+    else if (argv[i][0] != '-' && Dir[0] == '\0')
+      strncpy(Dir, argv[i], sizeof(Dir) - 1);
+    else {
+      fprintf(stderr, "%s", usage);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (Dir[0] == '\0' || Opt.NX < 8 || Opt.NY < 8 || Opt.DX <= 0. ||
+      Opt.NStations < 1 || Opt.NSegments < 1 || Opt.NDays < 1 ||
+      Opt.Dt <= 0. || Opt.Dt > 24.) {
+    fprintf(stderr, "%s", usage);
+    exit(EXIT_FAILURE);
+  }
+
+  /* the grid is centered on the center latitude and longitude */
+  deg2utm(CENTER_LAT, CENTER_LON, &East, &North, UTM_ZONE);
+  ExtremeNorth = floor(North + Opt.NY * Opt.DX / 2.);
+  ExtremeWest = floor(East - Opt.NX * Opt.DX / 2.);
+
+  MakeDir("");
+  MakeDir("config");
+  MakeDir("input");
+  MakeDir("input/modelstate");
+  MakeDir("met");
+  if (Opt.Grid)
+    MakeDir("met/grid");
+  MakeDir("output");
+
+  MakeTerrain();
+  if (Opt.Shading)
+    MakeShadowMaps();
+  NSegments = MakeStreams(&Segments, &RoadRows, &NRoads);
+  NRoads = Opt.Roads ? MakeRoads(RoadRows, NRoads) : 0;
+  MakeState(NSegments);
+  NStations = MakeStations(&Stations);
+  MakeForcing(Stations, NStations);
+  MakeConfig(Stations, NStations, NRoads);
+
+  NCells = 0;
+  for (i = 0; i < Opt.NX * Opt.NY; i++)
+    NCells += Mask[i];
+  printf("%s: %d rows, %d columns, %d basin cells, %d stream segments, "
+	 "%d roads, %d %s, %d days of %g hour time steps\n", Dir, Opt.NY,
+	 Opt.NX, NCells, NSegments, NRoads, NStations,
+	 Opt.Grid ? "met grid cells" : "stations", Opt.NDays, Opt.Dt);
+
+  free(Segments);
+  free(Stations);
+  free(RoadRows);
+  free(Mask);
+  free(Dem);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*
+ * SUMMARY:      PixBinToText.c - Convert a binary pixel dump to text
+ * USAGE:        PixBinToText <binary pixel dump> [<text file>]
+ *
+ * DESCRIPTION:  Reads a pixel dump (Pixel.* or Aggregated.Values) written
+ *               with "Pixel Dump Format = BINARY" in the [OUTPUT] section
+ *               and writes it in the text layout DHSVM writes by default.
+ *               The text is written to standard output if no text file is
+ *               given.
+ * DESCRIP-END.
+ * FUNCTIONS:    main()
+ * COMMENTS:
+ *   The binary file starts with "DHSVMPIX" (8 characters), the version (1)
+ *   and the number of values per record as 4-byte ints, the text header
+ *   line, and for each value its name and the format in which it is
+ *   printed in the text output.  Each string is written as its length (a
+ *   4-byte int) followed by its characters.  Each record has the year,
+ *   month, day, hour, minute and second as 4-byte ints, followed by the
+ *   values as 4-byte floats.  All numbers are in the native byte order of
+ *   the machine that wrote the file.
+ *
+ *   Formats with an integer conversion (%d) are printed with the value
+ *   converted to int, as DHSVM does for the snow flags.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIXBINVERSION 1
+
+const char *usage = "PixBinToText <binary pixel dump> [<text file>]\n";
+
+/*****************************************************************************
+  ReadString()
+
+  Read a string written as its length followed by its characters
+*****************************************************************************/
+static char *ReadString(FILE *InFile, const char *FileName)
+{
+  char *Str;
+  int Length;
+
+  if (fread(&Length, sizeof(int), 1, InFile) != 1 || Length < 0) {
+    fprintf(stderr, "Error reading header of %s\n", FileName);
+    exit(EXIT_FAILURE);
+  }
+  if (!(Str = malloc(Length + 1))) {
+    fprintf(stderr, "Cannot allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  if (fread(Str, 1, Length, InFile) != (size_t) Length) {
+    fprintf(stderr, "Error reading header of %s\n", FileName);
+    exit(EXIT_FAILURE);
+  }
+  Str[Length] = '\0';
+  return Str;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *InFile;
+  FILE *OutFile;
+  char Magic[8];
+  char *Header;
+  char **Name;
+  char **Format;
+  float *Value;
+  int Date[6];
+  int Info[2];			/* version, number of values */
+  int NCols;
+  int i;
+
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "%s", usage);
+    exit(EXIT_FAILURE);
+  }
+
+  if (!(InFile = fopen(argv[1], "rb"))) {
+    fprintf(stderr, "Cannot open file: %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fread(Magic, 1, 8, InFile) != 8 || strncmp(Magic, "DHSVMPIX", 8) != 0 ||
+      fread(Info, sizeof(int), 2, InFile) != 2) {
+    fprintf(stderr, "Not a binary pixel dump: %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  if (Info[0] != PIXBINVERSION || Info[1] <= 0) {
+    fprintf(stderr, "Unsupported version (%d) or number of values (%d) in %s\n",
+	    Info[0], Info[1], argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  NCols = Info[1];
+
+  Header = ReadString(InFile, argv[1]);
+  if (!(Name = calloc(NCols, sizeof(char *))) ||
+      !(Format = calloc(NCols, sizeof(char *))) ||
+      !(Value = calloc(NCols, sizeof(float)))) {
+    fprintf(stderr, "Cannot allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < NCols; i++) {
+    Name[i] = ReadString(InFile, argv[1]);
+    Format[i] = ReadString(InFile, argv[1]);
+  }
+
+  if (argc == 3) {
+    if (!(OutFile = fopen(argv[2], "w"))) {
+      fprintf(stderr, "Cannot open file: %s\n", argv[2]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  else
+    OutFile = stdout;
+
+  fprintf(OutFile, "%s", Header);
+  while (fread(Date, sizeof(int), 6, InFile) == 6) {
+    if (fread(Value, sizeof(float), NCols, InFile) != (size_t) NCols) {
+      fprintf(stderr, "Incomplete record at the end of %s\n", argv[1]);
+      exit(EXIT_FAILURE);
+    }
+    fprintf(OutFile, "%02d/%02d/%4d-%02d:%02d:%02d", Date[1], Date[2], Date[0],
+	    Date[3], Date[4], Date[5]);
+    for (i = 0; i < NCols; i++) {
+      if (strchr(Format[i], 'd') != NULL)
+	fprintf(OutFile, Format[i], (int) Value[i]);
+      else
+	fprintf(OutFile, Format[i], Value[i]);
+    }
+    fprintf(OutFile, "\n");
+  }
+
+  if (OutFile != stdout && fclose(OutFile) != 0) {
+    fprintf(stderr, "Error writing to file: %s\n", argv[2]);
+    exit(EXIT_FAILURE);
+  }
+  fclose(InFile);
+  for (i = 0; i < NCols; i++) {
+    free(Name[i]);
+    free(Format[i]);
+  }
+  free(Name);
+  free(Format);
+  free(Value);
+  free(Header);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+# -------------------------------------------------------------
+# SUMMARY:      benchmark.sh - Time DHSVM on synthetic basins
+# USAGE:        benchmark.sh <MakeSyntheticBasin> <DHSVM> <work directory>
+#                            <days> <size> [<size> ...]
+#
+# DESCRIPTION:  For each size, writes a synthetic basin of size by size
+#               cells with MakeSyntheticBasin, runs DHSVM on it for the
+#               given number of days and prints the timing table of the
+#               run.  A summary of the time per time step and the number
+#               of cells times time steps per second of each size is
+#               printed at the end, so that the scaling of a build with
+#               the size of the model area can be seen.  This is what the
+#               "benchmark" make target runs.
+# DESCRIP-END.
+# COMMENTS:
+#   Options for MakeSyntheticBasin (-snow, -roads, -stations 4, ...) can
+#   be given in the environment variable DHSVM_BENCHMARK_OPTIONS.  The
+#   number of threads is set with OMP_NUM_THREADS as usual.
+# -------------------------------------------------------------
+
+if [ $# -lt 5 ]; then
+    echo "usage: $0 <MakeSyntheticBasin> <DHSVM> <work directory> <days> <size> [<size> ...]" >&2
+    exit 2
+fi
+
+generator="$1"
+dhsvm="$2"
+work="$3"
+days="$4"
+shift 4
+
+mkdir -p "$work" || exit 1
+summary="$work/summary.txt"
+printf "%8s %10s %12s %16s\n" "Size" "Cells" "ms/step" "cell steps/s" > "$summary"
+
+for size in "$@"; do
+    basin="$work/basin$size"
+    "$generator" -nx "$size" -ny "$size" -days "$days" \
+        $DHSVM_BENCHMARK_OPTIONS "$basin" || exit 1
+    log="$basin/output/DHSVM.log"
+    ( cd "$basin/config" && "$dhsvm" Input.synthetic ) > "$log" 2>&1
+    if [ $? -ne 0 ]; then
+        echo "DHSVM failed on the $size by $size basin, see $log" >&2
+        tail -5 "$log" >&2
+        exit 1
+    fi
+    echo "$size by $size basin:"
+    sed -n '/^Phase /,/ time steps, /p' "$log"
+    echo
+    sed -n 's/^\([0-9]*\) time steps, \([0-9.]*\) ms per time step, \([0-9]*\) cells, \([0-9.e+]*\) cell steps\/s$/\3 \2 \4/p' "$log" |
+        while read cells ms rate; do
+            printf "%8s %10s %12s %16s\n" "$size" "$cells" "$ms" "$rate"
+        done >> "$summary"
+done
+
+cat "$summary"
@@ -9,7 +9,10 @@
  * DESCRIPTION:  Calculate the average values for the different fluxes and
  *               state variables over the basin.
  * DESCRIP-END.
- * FUNCTIONS:    Aggregate()
+ * FUNCTIONS:    AggregatedLayers()
+ *               AggregatedFields()
+ *               AggregateCell()
+ *               Aggregate()
  * COMMENTS:
  * $Id: Aggregate.c,v 1.17 2018/02/18 ning Exp $
  */
@@ -17,6 +20,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "settings.h"
 #include "data.h"
@@ -24,160 +28,372 @@
 #include "functions.h"
 #include "constants.h"
 
+/* Place of the first of the totals by layer in the sums of a row.  The
+   layers of a total take consecutive places */
+typedef struct {
+  int EPot;			/* MaxVegLayers + 1 places */
+  int EAct;			/* MaxVegLayers + 1 places */
+  int EInt;			/* MaxVegLayers places */
+  int ESoil;			/* MaxVegLayers * MaxSoilLayers places */
+  int IntRain;			/* MaxVegLayers places */
+  int IntSnow;			/* MaxVegLayers places */
+  int Moist;			/* MaxSoilLayers + 1 places */
+  int Perc;			/* MaxSoilLayers places */
+  int Temp;			/* MaxSoilLayers places */
+  int N;			/* Number of sums of a row */
+} AGGREGATEDLAYERS;
+
+/*****************************************************************************
+  AggregatedLayers()
+
+  Set the places of the totals by layer, after the AGG_NSCALARS totals that
+  do not depend on the layers.
+*****************************************************************************/
+static void AggregatedLayers(LAYER *Soil, LAYER *Veg, AGGREGATEDLAYERS *Layer)
+{
+  Layer->EPot = AGG_NSCALARS;
+  Layer->EAct = Layer->EPot + Veg->MaxLayers + 1;
+  Layer->EInt = Layer->EAct + Veg->MaxLayers + 1;
+  Layer->ESoil = Layer->EInt + Veg->MaxLayers;
+  Layer->IntRain = Layer->ESoil + Veg->MaxLayers * Soil->MaxLayers;
+  Layer->IntSnow = Layer->IntRain + Veg->MaxLayers;
+  Layer->Moist = Layer->IntSnow + Veg->MaxLayers;
+  Layer->Perc = Layer->Moist + Soil->MaxLayers + 1;
+  Layer->Temp = Layer->Perc + Soil->MaxLayers;
+  Layer->N = Layer->Temp + Soil->MaxLayers;
+}
+
+/*****************************************************************************
+  AggregatedFields()
+
+  Set Field to the address in Total of each of the sums of a row, or to
+  NULL for the sums that are not basin totals in this run.
+*****************************************************************************/
+static void AggregatedFields(OPTIONSTRUCT *Options, LAYER *Soil, LAYER *Veg,
+			     AGGREGATEDLAYERS *Layer, AGGREGATED *Total,
+			     float **Field)
+{
+  int i;
+  int j;
+
+  for (i = 0; i < Layer->N; i++)
+    Field[i] = NULL;
+
+  Field[AGG_ETOT] = &(Total->Evap.ETot);
+  Field[AGG_EVAPSOIL] = &(Total->Evap.EvapSoil);
+  for (i = 0; i < Veg->MaxLayers + 1; i++) {
+    Field[Layer->EPot + i] = &(Total->Evap.EPot[i]);
+    Field[Layer->EAct + i] = &(Total->Evap.EAct[i]);
+  }
+  for (i = 0; i < Veg->MaxLayers; i++) {
+    Field[Layer->EInt + i] = &(Total->Evap.EInt[i]);
+    for (j = 0; j < Soil->MaxLayers; j++)
+      Field[Layer->ESoil + i * Soil->MaxLayers + j] =
+	&(Total->Evap.ESoil[i][j]);
+  }
+
+  Field[AGG_PRECIP] = &(Total->Precip.Precip);
+  Field[AGG_SNOWFALL] = &(Total->Precip.SnowFall);
+  for (i = 0; i < Veg->MaxLayers; i++) {
+    Field[Layer->IntRain + i] = &(Total->Precip.IntRain[i]);
+    Field[Layer->IntSnow + i] = &(Total->Precip.IntSnow[i]);
+  }
+  Field[AGG_CANOPYWATER] = &(Total->CanopyWater);
+
+  Field[AGG_TAIR] = &(Total->Rad.Tair);
+  Field[AGG_OBSSHORTIN] = &(Total->Rad.ObsShortIn);
+  if (Options->MM5 != TRUE) {
+    Field[AGG_BEAMIN] = &(Total->Rad.BeamIn);
+    Field[AGG_DIFFUSEIN] = &(Total->Rad.DiffuseIn);
+  }
+  Field[AGG_PIXELNETSHORT] = &(Total->Rad.PixelNetShort);
+  for (i = 0; i < 2; i++) {
+    Field[AGG_NETSHORT + i] = &(Total->Rad.NetShort[i]);
+    Field[AGG_LONGIN + i] = &(Total->Rad.LongIn[i]);
+    Field[AGG_LONGOUT + i] = &(Total->Rad.LongOut[i]);
+  }
+  Field[AGG_PIXELLONGIN] = &(Total->Rad.PixelLongIn);
+  Field[AGG_PIXELLONGOUT] = &(Total->Rad.PixelLongOut);
+  Field[AGG_NETRAD] = &(Total->NetRad);
+
+  Field[AGG_SWQ] = &(Total->Snow.Swq);
+  Field[AGG_GLACIER] = &(Total->Snow.Glacier);
+  Field[AGG_MELT] = &(Total->Snow.Melt);
+  Field[AGG_PACKWATER] = &(Total->Snow.PackWater);
+  Field[AGG_TPACK] = &(Total->Snow.TPack);
+  Field[AGG_SURFWATER] = &(Total->Snow.SurfWater);
+  Field[AGG_SNOWTSURF] = &(Total->Snow.TSurf);
+  Field[AGG_COLDCONTENT] = &(Total->Snow.ColdContent);
+  Field[AGG_ALBEDO] = &(Total->Snow.Albedo);
+  Field[AGG_DEPTH] = &(Total->Snow.Depth);
+  Field[AGG_SNOWQE] = &(Total->Snow.Qe);
+  Field[AGG_SNOWQS] = &(Total->Snow.Qs);
+  Field[AGG_SNOWQSW] = &(Total->Snow.Qsw);
+  Field[AGG_SNOWQLW] = &(Total->Snow.Qlw);
+  Field[AGG_SNOWQP] = &(Total->Snow.Qp);
+  Field[AGG_MELTENERGY] = &(Total->Snow.MeltEnergy);
+  Field[AGG_VAPORMASSFLUX] = &(Total->Snow.VaporMassFlux);
+  Field[AGG_CANOPYVAPORMASSFLUX] = &(Total->Snow.CanopyVaporMassFlux);
+
+  if (Options->CanopyGapping && TotNumGap > 0) {
+    Field[AGG_GAPQSW] = &(Total->Veg.Type[Opening].Qsw);
+    Field[AGG_GAPQLIN] = &(Total->Veg.Type[Opening].Qlin);
+    Field[AGG_GAPQLW] = &(Total->Veg.Type[Opening].Qlw);
+    Field[AGG_GAPQE] = &(Total->Veg.Type[Opening].Qe);
+    Field[AGG_GAPQS] = &(Total->Veg.Type[Opening].Qs);
+    Field[AGG_GAPQP] = &(Total->Veg.Type[Opening].Qp);
+    Field[AGG_GAPSWQ] = &(Total->Veg.Type[Opening].Swq);
+    Field[AGG_GAPMELTENERGY] = &(Total->Veg.Type[Opening].MeltEnergy);
+  }
+
+  Field[AGG_SOILDEPTH] = &(Total->SoilDepth);
+  for (i = 0; i < Soil->MaxLayers + 1; i++)
+    Field[Layer->Moist + i] = &(Total->Soil.Moist[i]);
+  for (i = 0; i < Soil->MaxLayers; i++) {
+    Field[Layer->Perc + i] = &(Total->Soil.Perc[i]);
+    Field[Layer->Temp + i] = &(Total->Soil.Temp[i]);
+  }
+  Field[AGG_TABLEDEPTH] = &(Total->TableDepth);
+  Field[AGG_WATERLEVEL] = &(Total->Soil.WaterLevel);
+  Field[AGG_SATFLOW] = &(Total->SatFlow);
+  Field[AGG_SOILTSURF] = &(Total->Soil.TSurf);
+  Field[AGG_QNET] = &(Total->Soil.Qnet);
+  Field[AGG_SOILQS] = &(Total->Soil.Qs);
+  Field[AGG_SOILQE] = &(Total->Soil.Qe);
+  Field[AGG_QG] = &(Total->Soil.Qg);
+  Field[AGG_QST] = &(Total->Soil.Qst);
+  Field[AGG_IEXCESS] = &(Total->IExcess);
+  Field[AGG_DETENTIONSTORAGE] = &(Total->Soil.DetentionStorage);
+  if (Options->Infiltration == DYNAMIC)
+    Field[AGG_INFILTACC] = &(Total->Soil.InfiltAcc);
+  Field[AGG_RUNOFF] = &(Total->Runoff);
+
+  Field[AGG_SOILWATER] = &(Total->SoilWater);
+  Field[AGG_CHANNELINT] = &(Total->ChannelInt);
+  Field[AGG_ROADINT] = &(Total->RoadInt);
+  Field[AGG_CULVERTRETURNFLOW] = &(Total->CulvertReturnFlow);
+  Field[AGG_CULVERTTOCHANNEL] = &(Total->CulvertToChannel);
+}
+
+/*****************************************************************************
+  AggregateCell()
+
+  Add the values of a single cell to the double sums Sum of its row.  The
+  channel, road and culvert flows of the cell are reset, now that they have
+  been counted.
+*****************************************************************************/
+static void AggregateCell(MAPSIZE *Map, OPTIONSTRUCT *Options, LAYER *Soil,
+			  LAYER *Veg, VEGPIX **VegMap, EVAPPIX **Evap,
+			  PRECIPPIX **Precip, PIXRAD **RadMap, SNOWPIX **Snow,
+			  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+			  VEGTABLE *VType, ROADSTRUCT **Network, int y, int x,
+			  AGGREGATEDLAYERS *Layer, double *Sum)
+{
+  int NSoilL;			/* Number of soil layers for current pixel */
+  int NVegL;			/* Number of vegetation layers for current pixel */
+  int i;			/* counter */
+  int j;			/* counter */
+  int Index;			/* index of the pixel in SoilFlow */
+  float DeepDepth;		/* depth to bottom of lowest rooting zone */
+
+  Index = y * Map->NX + x;
+  NSoilL = Soil->NLayers[SoilMap[y][x].Soil - 1];
+  NVegL = Veg->NLayers[VegMap[y][x].Veg - 1];
+
+  Sum[AGG_CELLS] += 1.0;
+
+  /* aggregate the evaporation data */
+  Sum[AGG_ETOT] += Evap[y][x].ETot;
+  for (i = 0; i < NVegL; i++) {
+    Sum[Layer->EPot + i] += Evap[y][x].EPot[i];
+    Sum[Layer->EAct + i] += Evap[y][x].EAct[i];
+    Sum[Layer->EInt + i] += Evap[y][x].EInt[i];
+  }
+  Sum[Layer->EPot + Veg->MaxLayers] += Evap[y][x].EPot[NVegL];
+  Sum[Layer->EAct + Veg->MaxLayers] += Evap[y][x].EAct[NVegL];
+
+  for (i = 0; i < NVegL; i++) {
+    for (j = 0; j < NSoilL; j++) {
+      Sum[Layer->ESoil + i * Soil->MaxLayers + j] += Evap[y][x].ESoil[i][j];
+    }
+  }
+  Sum[AGG_EVAPSOIL] += Evap[y][x].EvapSoil;
+
+  /* aggregate precipitation data */
+  Sum[AGG_PRECIP] += Precip[y][x].Precip;
+  Sum[AGG_SNOWFALL] += Precip[y][x].SnowFall;
+  for (i = 0; i < NVegL; i++) {
+    Sum[Layer->IntRain + i] += Precip[y][x].IntRain[i];
+    Sum[Layer->IntSnow + i] += Precip[y][x].IntSnow[i];
+    Sum[AGG_CANOPYWATER] += Precip[y][x].IntRain[i] +
+      Precip[y][x].IntSnow[i];
+  }
+
+  /* aggregate radiation data */
+  AggregateRadiation(Veg->MaxLayers, VType[VegMap[y][x].Veg - 1].NVegLayers,
+		     &(RadMap[y][x]), Sum);
+  if (Options->MM5 != TRUE) {
+    Sum[AGG_TAIR] += RadMap[y][x].Tair;
+    Sum[AGG_OBSSHORTIN] += RadMap[y][x].ObsShortIn;
+    Sum[AGG_BEAMIN] += RadMap[y][x].BeamIn;
+    Sum[AGG_DIFFUSEIN] += RadMap[y][x].DiffuseIn;
+    Sum[AGG_PIXELNETSHORT] += RadMap[y][x].PixelNetShort;
+    Sum[AGG_NETRAD] += RadMap[y][x].NetRadiation[0] +
+      RadMap[y][x].NetRadiation[1];
+  }
+
+  /* aggregate snow data */
+  if (Snow[y][x].HasSnow)
+    Sum[AGG_HASSNOW] += 1.0;
+  Sum[AGG_SWQ] += Snow[y][x].Swq;
+  Sum[AGG_GLACIER] += Snow[y][x].Glacier;
+  /* Sum[AGG_MELT] += Snow[y][x].Melt; */
+  Sum[AGG_MELT] += Snow[y][x].Outflow;
+  Sum[AGG_PACKWATER] += Snow[y][x].PackWater;
+  Sum[AGG_TPACK] += Snow[y][x].TPack;
+  Sum[AGG_SURFWATER] += Snow[y][x].SurfWater;
+  Sum[AGG_SNOWTSURF] += Snow[y][x].TSurf;
+  Sum[AGG_COLDCONTENT] += Snow[y][x].ColdContent;
+  Sum[AGG_ALBEDO] += Snow[y][x].Albedo;
+  Sum[AGG_DEPTH] += Snow[y][x].Depth;
+  Sum[AGG_SNOWQE] += Snow[y][x].Qe;
+  Sum[AGG_SNOWQS] += Snow[y][x].Qs;
+  Sum[AGG_SNOWQSW] += Snow[y][x].Qsw;
+  Sum[AGG_SNOWQLW] += Snow[y][x].Qlw;
+  Sum[AGG_SNOWQP] += Snow[y][x].Qp;
+  Sum[AGG_MELTENERGY] += Snow[y][x].MeltEnergy;
+  Sum[AGG_VAPORMASSFLUX] += Snow[y][x].VaporMassFlux;
+  Sum[AGG_CANOPYVAPORMASSFLUX] += Snow[y][x].CanopyVaporMassFlux;
+
+  if (VegMap[y][x].Gapping > 0.0 ) {
+    Sum[AGG_GAPQSW] += VegMap[y][x].Type[Opening].Qsw;
+    Sum[AGG_GAPQLIN] += VegMap[y][x].Type[Opening].Qlin;
+    Sum[AGG_GAPQLW] += VegMap[y][x].Type[Opening].Qlw;
+    Sum[AGG_GAPQE] += VegMap[y][x].Type[Opening].Qe;
+    Sum[AGG_GAPQS] += VegMap[y][x].Type[Opening].Qs;
+    Sum[AGG_GAPQP] += VegMap[y][x].Type[Opening].Qp;
+    Sum[AGG_GAPSWQ] += VegMap[y][x].Type[Opening].Swq;
+    Sum[AGG_GAPMELTENERGY] += VegMap[y][x].Type[Opening].MeltEnergy;
+  }
+  /* aggregate soil moisture data */
+  Sum[AGG_SOILDEPTH] += SoilFlow->Depth[Index];
+  DeepDepth = 0.0;
+
+  for (i = 0; i < NSoilL; i++) {
+    Sum[Layer->Moist + i] += SoilMap[y][x].Moist[i];
+    assert(SoilMap[y][x].Moist[i] >= 0.0);
+    Sum[Layer->Perc + i] += SoilMap[y][x].Perc[i];
+    Sum[Layer->Temp + i] += SoilMap[y][x].Temp[i];
+    Sum[AGG_SOILWATER] += SoilMap[y][x].Moist[i] * VType[VegMap[y][x].Veg - 1].RootDepth[i] * Network[y][x].Adjust[i]; 
+    DeepDepth += VType[VegMap[y][x].Veg - 1].RootDepth[i];
+  }
+
+  Sum[Layer->Moist + Soil->MaxLayers] += SoilMap[y][x].Moist[NSoilL];
+  Sum[AGG_SOILWATER] += SoilMap[y][x].Moist[NSoilL] * (SoilFlow->Depth[Index] - DeepDepth) * Network[y][x].Adjust[NSoilL];
+  Sum[AGG_TABLEDEPTH] += SoilFlow->TableDepth[Index];
+
+  if (SoilFlow->TableDepth[Index] <= 0)
+    Sum[AGG_SATURATED] += 1.0;
+
+  Sum[AGG_WATERLEVEL] += SoilMap[y][x].WaterLevel;
+  Sum[AGG_SATFLOW] += SoilFlow->SatFlow[Index];
+  Sum[AGG_SOILTSURF] += SoilMap[y][x].TSurf;
+  Sum[AGG_QNET] += SoilMap[y][x].Qnet;
+  Sum[AGG_SOILQS] += SoilMap[y][x].Qs;
+  Sum[AGG_SOILQE] += SoilMap[y][x].Qe;
+  Sum[AGG_QG] += SoilMap[y][x].Qg;
+  Sum[AGG_QST] += SoilMap[y][x].Qst;
+  Sum[AGG_IEXCESS] += SoilFlow->IExcess[Index];
+  Sum[AGG_DETENTIONSTORAGE] += SoilMap[y][x].DetentionStorage;
+
+  if (Options->Infiltration == DYNAMIC)
+    Sum[AGG_INFILTACC] += SoilMap[y][x].InfiltAcc;
+
+  Sum[AGG_RUNOFF] += SoilFlow->Runoff[Index];
+  Sum[AGG_CHANNELINT] += SoilMap[y][x].ChannelInt;
+  SoilMap[y][x].ChannelInt = 0.0;
+  Sum[AGG_ROADINT] += SoilMap[y][x].RoadInt;
+  SoilMap[y][x].RoadInt = 0.0;
+  Sum[AGG_CULVERTRETURNFLOW] += SoilMap[y][x].CulvertReturnFlow;
+  SoilMap[y][x].CulvertReturnFlow = 0.0;
+  Sum[AGG_CULVERTTOCHANNEL] += SoilMap[y][x].CulvertToChannel;
+  SoilMap[y][x].CulvertToChannel = 0.0;
+}
+
 /*****************************************************************************
   Aggregate()
   
   Calculate the average values for the different fluxes and state variables
   over the basin.  
-  In the current implementation the local radiation
-  elements are not stored for the entire area.  Therefore these components
-  are aggregated in AggregateRadiation() inside MassEnergyBalance().
+  The components of the radiation balance of each cell are added by
+  AggregateRadiation().
   
   The aggregated values are set to zero in the function RestAggregate,
   which is executed at the beginning of each time step.
+
+  The cells of each row of the band are summed in double precision, in
+  row-major order, by the thread that is handed the row.  The sums of the
+  rows are then added up with SumRows(), in an order that only depends on
+  the rows of the whole grid, so that the totals are the same for any
+  number of threads and of MPI processes.
 *****************************************************************************/
 void Aggregate(MAPSIZE *Map, OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
 	       LAYER *Soil, LAYER *Veg, VEGPIX **VegMap, EVAPPIX **Evap,
 	       PRECIPPIX **Precip, PIXRAD **RadMap, SNOWPIX **Snow,
-	       SOILPIX **SoilMap, AGGREGATED *Total, VEGTABLE *VType,
-	       ROADSTRUCT **Network, CHANNEL *ChannelData, float *roadarea,
-         int Dt)
+	       SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, AGGREGATED *Total,
+	       VEGTABLE *VType, ROADSTRUCT **Network, CHANNEL *ChannelData,
+	       float *roadarea, int Dt)
 {
   int NPixels;			/* Number of pixels in the basin */
-  int NSoilL;			/* Number of soil layers for current pixel */
-  int NVegL;			/* Number of vegetation layers for current pixel */
   int i;				/* counter */
   int j;				/* counter */
   int x;
   int y;
-  float DeepDepth;		/* depth to bottom of lowest rooting zone */
+  int run;
+  AGGREGATEDLAYERS Layer;	/* places of the totals by layer */
+  float **Field;		/* basin total of each sum */
+  double *Partial;		/* sums of each row of the band */
+  double *Sum;
 
-  NPixels = 0;
   *roadarea = 0.;
 
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
-		  NPixels++;
-		  NSoilL = Soil->NLayers[SoilMap[y][x].Soil - 1];
-		  NVegL = Veg->NLayers[VegMap[y][x].Veg - 1];
-		  
-		  /* aggregate the evaporation data */
-		  Total->Evap.ETot += Evap[y][x].ETot;
-		  for (i = 0; i < NVegL; i++) {
-			  Total->Evap.EPot[i] += Evap[y][x].EPot[i];
-			  Total->Evap.EAct[i] += Evap[y][x].EAct[i];
-			  Total->Evap.EInt[i] += Evap[y][x].EInt[i];
-		  }
-		  Total->Evap.EPot[Veg->MaxLayers] += Evap[y][x].EPot[NVegL];
-		  Total->Evap.EAct[Veg->MaxLayers] += Evap[y][x].EAct[NVegL];
-		  
-		  for (i = 0; i < NVegL; i++) {
-			  for (j = 0; j < NSoilL; j++) {
-				  Total->Evap.ESoil[i][j] += Evap[y][x].ESoil[i][j];
-			  }
-		  }
-		  Total->Evap.EvapSoil += Evap[y][x].EvapSoil;
-		  
-		  /* aggregate precipitation data */
-		  Total->Precip.Precip += Precip[y][x].Precip;
-          Total->Precip.SnowFall += Precip[y][x].SnowFall;
-		  for (i = 0; i < NVegL; i++) {
-			  Total->Precip.IntRain[i] += Precip[y][x].IntRain[i];
-			  Total->Precip.IntSnow[i] += Precip[y][x].IntSnow[i];
-			  Total->CanopyWater += Precip[y][x].IntRain[i] +
-			  Precip[y][x].IntSnow[i];
-		  }
-
-	/* aggregate radiation data */
-	if (Options->MM5 == TRUE) {
-	  Total->Rad.BeamIn = NOT_APPLICABLE;
-	  Total->Rad.DiffuseIn = NOT_APPLICABLE;
-	}
-	else {
-      Total->Rad.Tair += RadMap[y][x].Tair;
-      Total->Rad.ObsShortIn += RadMap[y][x].ObsShortIn;
-	  Total->Rad.BeamIn += RadMap[y][x].BeamIn;
-	  Total->Rad.DiffuseIn += RadMap[y][x].DiffuseIn;
-      Total->Rad.PixelNetShort += RadMap[y][x].PixelNetShort;
-      Total->NetRad += RadMap[y][x].NetRadiation[0] + RadMap[y][x].NetRadiation[1];
-	}
-
-	/* aggregate snow data */
-	if (Snow[y][x].HasSnow)
-		Total->Snow.HasSnow = TRUE;
-		Total->Snow.Swq += Snow[y][x].Swq;
-		Total->Snow.Glacier += Snow[y][x].Glacier;
-		/* Total->Snow.Melt += Snow[y][x].Melt; */
-		Total->Snow.Melt += Snow[y][x].Outflow;
-		Total->Snow.PackWater += Snow[y][x].PackWater;
-		Total->Snow.TPack += Snow[y][x].TPack;
-		Total->Snow.SurfWater += Snow[y][x].SurfWater;
-		Total->Snow.TSurf += Snow[y][x].TSurf;
-		Total->Snow.ColdContent += Snow[y][x].ColdContent;
-		Total->Snow.Albedo += Snow[y][x].Albedo;
-		Total->Snow.Depth += Snow[y][x].Depth;
-		Total->Snow.Qe += Snow[y][x].Qe;
-		Total->Snow.Qs += Snow[y][x].Qs;
-		Total->Snow.Qsw += Snow[y][x].Qsw;
-		Total->Snow.Qlw += Snow[y][x].Qlw;
-		Total->Snow.Qp += Snow[y][x].Qp;
-		Total->Snow.MeltEnergy += Snow[y][x].MeltEnergy;
-		Total->Snow.VaporMassFlux += Snow[y][x].VaporMassFlux;
-		Total->Snow.CanopyVaporMassFlux += Snow[y][x].CanopyVaporMassFlux;
-
-		if (VegMap[y][x].Gapping > 0.0 ) {
-		  Total->Veg.Type[Opening].Qsw += VegMap[y][x].Type[Opening].Qsw;
-		  Total->Veg.Type[Opening].Qlin += VegMap[y][x].Type[Opening].Qlin;
-		  Total->Veg.Type[Opening].Qlw += VegMap[y][x].Type[Opening].Qlw;
-		  Total->Veg.Type[Opening].Qe += VegMap[y][x].Type[Opening].Qe;
-		  Total->Veg.Type[Opening].Qs += VegMap[y][x].Type[Opening].Qs;
-		  Total->Veg.Type[Opening].Qp += VegMap[y][x].Type[Opening].Qp;
-		  Total->Veg.Type[Opening].Swq += VegMap[y][x].Type[Opening].Swq;
-		  Total->Veg.Type[Opening].MeltEnergy += VegMap[y][x].Type[Opening].MeltEnergy;
-		}
-		/* aggregate soil moisture data */
-		Total->Soil.Depth += SoilMap[y][x].Depth;
-		DeepDepth = 0.0;
-
-		for (i = 0; i < NSoilL; i++) {
-			Total->Soil.Moist[i] += SoilMap[y][x].Moist[i];
-			assert(SoilMap[y][x].Moist[i] >= 0.0);
-			Total->Soil.Perc[i] += SoilMap[y][x].Perc[i];
-			Total->Soil.Temp[i] += SoilMap[y][x].Temp[i];
-			Total->SoilWater += SoilMap[y][x].Moist[i] * VType[VegMap[y][x].Veg - 1].RootDepth[i] * Network[y][x].Adjust[i]; 
-			DeepDepth += VType[VegMap[y][x].Veg - 1].RootDepth[i];
-		}
-
-		Total->Soil.Moist[Soil->MaxLayers] += SoilMap[y][x].Moist[NSoilL];
-		Total->SoilWater += SoilMap[y][x].Moist[NSoilL] * (SoilMap[y][x].Depth - DeepDepth) * Network[y][x].Adjust[NSoilL];
-		Total->Soil.TableDepth += SoilMap[y][x].TableDepth;
-
-		if (SoilMap[y][x].TableDepth <= 0)
-			(Total->Saturated)++;
-		
-		Total->Soil.WaterLevel += SoilMap[y][x].WaterLevel;
-		Total->Soil.SatFlow += SoilMap[y][x].SatFlow;
-		Total->Soil.TSurf += SoilMap[y][x].TSurf;
-		Total->Soil.Qnet += SoilMap[y][x].Qnet;
-		Total->Soil.Qs += SoilMap[y][x].Qs;
-		Total->Soil.Qe += SoilMap[y][x].Qe;
-		Total->Soil.Qg += SoilMap[y][x].Qg;
-		Total->Soil.Qst += SoilMap[y][x].Qst;
-		Total->Soil.IExcess += SoilMap[y][x].IExcess;
-		Total->Soil.DetentionStorage += SoilMap[y][x].DetentionStorage;
-		
-		if (Options->Infiltration == DYNAMIC)
-			Total->Soil.InfiltAcc += SoilMap[y][x].InfiltAcc;
-		
-		Total->Soil.Runoff += SoilMap[y][x].Runoff;
-		Total->ChannelInt += SoilMap[y][x].ChannelInt;
-		SoilMap[y][x].ChannelInt = 0.0;
-		Total->RoadInt += SoilMap[y][x].RoadInt;
-		SoilMap[y][x].RoadInt = 0.0;
-      }
+  AggregatedLayers(Soil, Veg, &Layer);
+  if (!(Field = (float **) calloc(Layer.N, sizeof(float *))))
+    ReportError("Aggregate", 1);
+  if (!(Partial = (double *) calloc((size_t) (Map->NRows > 0 ? Map->NRows : 1) *
+				    Layer.N, sizeof(double))))
+    ReportError("Aggregate", 1);
+  AggregatedFields(Options, Soil, Veg, &Layer, Total, Field);
+
+#pragma omp parallel for schedule(dynamic, TILEROWS) private(Sum, run, x)
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++) {
+    Sum = Partial + (size_t) (y - Map->FirstRow) * Layer.N;
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++)
+	AggregateCell(Map, Options, Soil, Veg, VegMap, Evap, Precip, RadMap,
+		      Snow, SoilMap, SoilFlow, VType, Network, y, x, &Layer,
+		      Sum);
     }
   }
+
+  /* some totals, such as the outgoing longwave radiation, are not reset
+     by ResetAggregate() and carry over from the last time step */
+  SumRows(Partial, Map, Layer.N);
+  for (i = 0; i < Layer.N; i++) {
+    if (Field[i] != NULL)
+      *(Field[i]) += Partial[i];
+  }
+  NPixels = (int) Partial[AGG_CELLS];
+  Total->Saturated += (unsigned long) Partial[AGG_SATURATED];
+  if (Partial[AGG_HASSNOW] > 0)
+    Total->Snow.HasSnow = TRUE;
+  if (Options->MM5 == TRUE) {
+    Total->Rad.BeamIn = NOT_APPLICABLE;
+    Total->Rad.DiffuseIn = NOT_APPLICABLE;
+  }
+  free(Field);
+  free(Partial);
+
   /* divide road area by pixel area so it can be used to calculate depths
      over the road surface in FinalMassBalancs */
   *roadarea /= Map->DX * Map->DY * NPixels;
@@ -252,23 +468,23 @@ void Aggregate(MAPSIZE *Map, OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
 	Total->Veg.Type[Opening].MeltEnergy /= TotNumGap;
   }
   /* average soil moisture data */
-  Total->Soil.Depth /= NPixels;
+  Total->SoilDepth /= NPixels;
   for (i = 0; i < Soil->MaxLayers; i++) {
     Total->Soil.Moist[i] /= NPixels;
     Total->Soil.Perc[i] /= NPixels;
     Total->Soil.Temp[i] /= NPixels;
   }
   Total->Soil.Moist[Soil->MaxLayers] /= NPixels;
-  Total->Soil.TableDepth /= NPixels;
+  Total->TableDepth /= NPixels;
   Total->Soil.WaterLevel /= NPixels;
-  Total->Soil.SatFlow /= NPixels;
+  Total->SatFlow /= NPixels;
   Total->Soil.TSurf /= NPixels;
   Total->Soil.Qnet /= NPixels;
   Total->Soil.Qs /= NPixels;
   Total->Soil.Qe /= NPixels;
   Total->Soil.Qg /= NPixels;
   Total->Soil.Qst /= NPixels;
-  Total->Soil.IExcess /= NPixels;
+  Total->IExcess /= NPixels;
   Total->Soil.DetentionStorage /= NPixels;
   Total->Road.IExcess /= NPixels;
   
@@ -276,7 +492,7 @@ void Aggregate(MAPSIZE *Map, OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
     Total->Soil.InfiltAcc /= NPixels;
 
   Total->SoilWater /= NPixels;
-  Total->Soil.Runoff /= NPixels;
+  Total->Runoff /= NPixels;
   Total->ChannelInt /= NPixels;
   Total->RoadInt /= NPixels;
   Total->CulvertReturnFlow /= NPixels;
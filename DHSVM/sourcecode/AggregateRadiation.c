@@ -17,30 +17,31 @@
 #include <stdlib.h>
 #include "settings.h"
 #include "data.h"
+#include "functions.h"
 #include "massenergy.h"
 
 /*****************************************************************************
   AggregateRadiation()
   
-  In the current implementation the local radiation elements are not stored 
-  for the entire area.  Therefore these components are aggregated here.  They
-  are averaged over the basin in Aggregate()
+  Add the components of the radiation balance of a pixel to the double sums
+  Sum of its row.  This is done for each pixel by Aggregate(), which also
+  averages them over the basin
 *****************************************************************************/
-void AggregateRadiation(int MaxVegLayers, int NVegL, PIXRAD *Rad, PIXRAD *TotalRad)
+void AggregateRadiation(int MaxVegLayers, int NVegL, PIXRAD *Rad, double *Sum)
 {
   int i;			/* counter */
 
   /* aggregate radiation data */
   for (i = 0; i < NVegL; i++) {
-    TotalRad->NetShort[i] += Rad->NetShort[i];
-    TotalRad->LongIn[i] += Rad->LongIn[i];
-    TotalRad->LongOut[i] += Rad->LongOut[i];
+    Sum[AGG_NETSHORT + i] += Rad->NetShort[i];
+    Sum[AGG_LONGIN + i] += Rad->LongIn[i];
+    Sum[AGG_LONGOUT + i] += Rad->LongOut[i];
   }
-  TotalRad->NetShort[MaxVegLayers] += Rad->NetShort[NVegL];
-  TotalRad->LongIn[MaxVegLayers] += Rad->LongIn[NVegL];
-  TotalRad->LongOut[MaxVegLayers] += Rad->LongOut[NVegL];
-  TotalRad->PixelNetShort += Rad->PixelNetShort;
-  TotalRad->PixelLongIn += Rad->PixelLongIn;
-  TotalRad->PixelLongOut += Rad->PixelLongOut;
+  Sum[AGG_NETSHORT + MaxVegLayers] += Rad->NetShort[NVegL];
+  Sum[AGG_LONGIN + MaxVegLayers] += Rad->LongIn[NVegL];
+  Sum[AGG_LONGOUT + MaxVegLayers] += Rad->LongOut[NVegL];
+  Sum[AGG_PIXELNETSHORT] += Rad->PixelNetShort;
+  Sum[AGG_PIXELLONGIN] += Rad->PixelLongIn;
+  Sum[AGG_PIXELLONGOUT] += Rad->PixelLongOut;
 
 }
@@ -13,6 +13,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "settings.h"
 #include "data.h"
 #include "DHSVMerror.h"
@@ -42,66 +43,44 @@
    Transfer Cold Content of Snowpack with Mass.
  *****************************************************************************/
 void Avalanche(MAPSIZE *Map, TOPOPIX **TopoMap, TIMESTRUCT *Time, OPTIONSTRUCT *Options,
-  SNOWPIX **Snow)
+  SNOWPIX **Snow, FLOWDIRMAP *SnowFlowDir)
 {
 
   float Shd;                     /*Snow Holding Depth of a cell(m) as a function slope*/
-  unsigned char ***SubDir;       /* Fraction of flux moving in each direction*/
-  unsigned int **SubTotalDir;    /* Sum of Dir array */
-  float **slope_deg;             /* Surface Slope in Degrees */
-  float **SubSnowGrad;           /* Snow Surface Slope*/
-  const char *Routine = "Avalanche";
+  unsigned char *SubDir;         /* Fraction of flux moving in each direction*/
+  unsigned int SubTotalDir;      /* Sum of Dir array */
+  float slope_deg;               /* Surface Slope in Degrees */
   int x;                         /* counter */
   int y;                         /* counter */
-  int i, j, k;
+  int run;                       /* run of basin cells */
+  int i, k;
   float Snowout;
 
-  /*****************************************************************************
-     Allocate memory
-    ****************************************************************************/
-  if (!(SubSnowGrad = (float **)calloc(Map->NY, sizeof(float *))))
-    ReportError((char *)Routine, 1);
-  for (i = 0; i < Map->NY; i++) {
-    if (!(SubSnowGrad[i] = (float *)calloc(Map->NX, sizeof(float))))
-      ReportError((char *)Routine, 1);
-  }
-  if (!(slope_deg = (float **)calloc(Map->NY, sizeof(float *))))
-    ReportError((char *)Routine, 1);
-  for (i = 0; i < Map->NY; i++) {
-    if (!(slope_deg[i] = (float *)calloc(Map->NX, sizeof(float))))
-      ReportError((char *)Routine, 1);
-  }
-  if (!((SubDir) = (unsigned char ***)calloc(Map->NY, sizeof(unsigned char **))))
-    ReportError((char *)Routine, 1);
-  for (i = 0; i < Map->NY; i++) {
-    if (!((SubDir)[i] = (unsigned char **)calloc(Map->NX, sizeof(unsigned char*))))
-      ReportError((char *)Routine, 1);
-    for (j = 0; j < Map->NX; j++) {
-      if (!(SubDir[i][j] = (unsigned char *)calloc(NDIRS, sizeof(unsigned char))))
-        ReportError((char *)Routine, 1);
-    }
-  }
-  if (!(SubTotalDir = (unsigned int **)calloc(Map->NY, sizeof(unsigned int *))))
-    ReportError((char *)Routine, 1);
-  for (i = 0; i < Map->NY; i++) {
-    if (!(SubTotalDir[i] = (unsigned int *)calloc(Map->NX, sizeof(unsigned int))))
-      ReportError((char *)Routine, 1);
-  }
-
   /* calculate snow surface slope in the same approach as subflow direction */
-  SnowSlopeAspect(Map, TopoMap, Snow, SubSnowGrad, SubDir, SubTotalDir);
+  ExchangeMapHalo(Map, (void **)Snow, sizeof(SNOWPIX), offsetof(SNOWPIX, Swq),
+    sizeof(float));
+  SnowSlopeAspect(Map, TopoMap, Snow, SnowFlowDir);
+
+  /* snow moves on to cells that are visited later, so with MPI the bands
+     take turns, in row order */
+  BeginOrderedSweep(Map, (void **)Snow, sizeof(SNOWPIX),
+    offsetof(SNOWPIX, Swq), sizeof(float));
 
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+        i = y * Map->NX + x;
+        SubDir = &(SnowFlowDir->Dir[i * MAXDIRS]);
+        SubTotalDir = SnowFlowDir->TotalDir[i];
+
         /* convert slope from radian to degree */
-        slope_deg[y][x] = atan(SubSnowGrad[y][x])*(180 / PI);
+        slope_deg = atan(SnowFlowDir->FlowGrad[i])*(180 / PI);
 
         /* snow holding depth as a function of slope and slide parameters */
-        Shd = SNOWSLIDE1*exp(-slope_deg[y][x] * SNOWSLIDE2);
+        Shd = SNOWSLIDE1*exp(-slope_deg * SNOWSLIDE2);
 
         /* only redistribute snow if Swq is above holding capacity */
-        if (slope_deg[y][x] > 30. && Snow[y][x].Swq > Shd) {
+        if (slope_deg > 30. && Snow[y][x].Swq > Shd) {
 
           /*If avalanche occurs on glacier surface, Leave a 10mm of snow behind so that glacier 
           surface is not prematurely exposed */
@@ -120,8 +99,8 @@ void Avalanche(MAPSIZE *Map, TOPOPIX **TopoMap, TIMESTRUCT *Time, OPTIONSTRUCT *
           Snow[y][x].SurfWater = 0.0;
           
           /* Assign the avalanched snow to appropriate surrounding pixels */
-          if (SubTotalDir[y][x] > 0) {
-            Snowout /= (float)SubTotalDir[y][x];
+          if (SubTotalDir > 0) {
+            Snowout /= (float)SubTotalDir;
 
           }
           else {
@@ -132,23 +111,13 @@ void Avalanche(MAPSIZE *Map, TOPOPIX **TopoMap, TIMESTRUCT *Time, OPTIONSTRUCT *
             int nx = xdirection[k] + x;
             int ny = ydirection[k] + y;
             if (valid_cell(Map, nx, ny)) {
-              Snow[ny][nx].Swq += Snowout * SubDir[y][x][k];
+              Snow[ny][nx].Swq += Snowout * SubDir[k];
             }
           }
         }
       }
     }
   }
-  for (i = 0; i < Map->NY; i++) {
-    free(SubTotalDir[i]);
-    free(slope_deg[i]);
-    free(SubSnowGrad[i]);
-    for (j = 0; j < Map->NX; j++)
-      free(SubDir[i][j]);
-    free(SubDir[i]);
-  }
-  free(SubDir);
-  free(SubTotalDir);
-  free(slope_deg);
-  free(SubSnowGrad);
+  EndOrderedSweep(Map, (void **)Snow, sizeof(SNOWPIX),
+    offsetof(SNOWPIX, Swq), sizeof(float));
 }
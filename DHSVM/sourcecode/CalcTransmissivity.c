@@ -58,29 +58,21 @@
 
     The hydraulic conductivity is assumed exponentially with depth, based on
     material in Beven [1982].
+
+    When the water table is deeper than DepthThresh (a smaller value of
+    WaterTable indicates a higher actual water table), the transmissivity
+    decreases linearly from its value at DepthThresh to zero at SoilDepth.
+
+    The calculation is done by CalcTransmissivityRun() for a run of one
+    cell, see CellKernels.c
 *****************************************************************************/
 float CalcTransmissivity(float SoilDepth, float WaterTable, float LateralKs,
 			 float KsExponent, float DepthThresh)
 {
   float Transmissivity;		/* Transmissivity (m^2/s) */
-  float TransThresh;
 
-  if (fequal(KsExponent, 0.0))
-    Transmissivity = LateralKs * (SoilDepth - WaterTable);
-  else {
-	/* a smaller value of WaterTable variables indicates a higher actual water table depth */
-	if (WaterTable < DepthThresh) {
-	  Transmissivity = (LateralKs / KsExponent) * (exp(-KsExponent * WaterTable) - exp(-KsExponent * SoilDepth));
-	}
-    else  {
-	  TransThresh = (LateralKs / KsExponent) * (exp(-KsExponent * DepthThresh) - exp(-KsExponent * SoilDepth));
-	  if(SoilDepth < DepthThresh) {
-		printf("Warning: Soil DepthThreshold (%.2f) > the soil depth (%.2f)!\n", DepthThresh, SoilDepth);
-		printf("Transmissivity is set to zero!");
-	  }
-	  Transmissivity = (SoilDepth-WaterTable)/(SoilDepth-DepthThresh)*TransThresh;
-	}
-  }
+  CalcTransmissivityRun(1, &SoilDepth, &WaterTable, &LateralKs, &KsExponent,
+			&DepthThresh, &Transmissivity);
 
   return Transmissivity;
 }
@@ -11,6 +11,7 @@
  *               stations is variable.
  * DESCRIP-END.
  * FUNCTIONS:    CalcWeights()
+ *               StoreWeights()
  * COMMENTS:
  * $Id: CalcWeights.c,v 1.5 2003/10/28 20:02:41 colleen Exp $
  */
@@ -25,6 +26,70 @@
 #include "DHSVMerror.h"
 #include "functions.h"
 
+ /* Weights of one row of pixels, collected by the thread that handles the row
+    and copied into the sparse table once all rows are done */
+typedef struct {
+  int N;			/* Number of entries */
+  int Capacity;			/* Number of entries allocated */
+  int *Station;			/* Station index of each entry */
+  float *Weight;		/* Weight of each entry */
+} WEIGHTROW;
+
+ /*****************************************************************************
+   Function name: StoreWeights()
+
+   Purpose      : Append the non-zero weights of a cell to the weights of
+                  its row
+
+   Required     :
+     int NCell            - Number of stations with a non-zero weight
+     int *CellStation     - These stations, by increasing index
+     uchar *CellWeights   - Their quantised weights
+     int Cell             - Cell index, y * NX + x
+     METWEIGHTS *Weights  - Sparse weight table
+     WEIGHTROW *Row       - Weights of the row of the cell
+
+   Returns      :  void
+
+   Modifies     :
+     Row, and Weights->Start[Cell + 1], which is set to the number of 
+     entries in the row up to and including this cell
+
+   Comments     :
+     The stored weight is the quantised weight divided by the sum of the
+     quantised weights of the cell, computed exactly as MakeLocalMetData()
+     used to do it for every time step (the stations with a zero weight
+     did not change that sum)
+ *****************************************************************************/
+static void StoreWeights(int NCell, int *CellStation, uchar *CellWeights,
+  int Cell, METWEIGHTS *Weights, WEIGHTROW *Row)
+{
+  float WeightSum;
+  int i;
+
+  WeightSum = 0.0;
+  for (i = 0; i < NCell; i++)
+    WeightSum += (float) CellWeights[i];
+
+  if (Row->N + NCell > Row->Capacity) {
+    while (Row->N + NCell > Row->Capacity)
+      Row->Capacity = (Row->Capacity > 0) ? 2 * Row->Capacity : 16;
+    if (!(Row->Station = (int *) realloc(Row->Station,
+                                         Row->Capacity * sizeof(int))))
+      ReportError("CalcWeights()", 1);
+    if (!(Row->Weight = (float *) realloc(Row->Weight,
+                                          Row->Capacity * sizeof(float))))
+      ReportError("CalcWeights()", 1);
+  }
+
+  for (i = 0; i < NCell; i++) {
+    Row->Station[Row->N] = CellStation[i];
+    Row->Weight[Row->N] = ((float) CellWeights[i]) / WeightSum;
+    Row->N++;
+  }
+  Weights->Start[Cell + 1] = Row->N;
+}
+
  /*****************************************************************************
    Function name: CalcWeights()
 
@@ -38,92 +103,129 @@
      int NX               - Number of pixels in East - West direction
      int NY               - Number of pixels in North - South direction
      uchar ** BasinMask   - BasinMask
-     uchar ***WeightArray - 3D array with interpolation weights
+     METWEIGHTS *Weights  - Sparse table with interpolation weights
 
    Returns      :  void
 
    Modifies     :
-     The values stored at the addresses pointed to by WeightArray (i.e. it
+     The values stored at the addresses pointed to by Weights (i.e. it
      calculates the weights and stores them)
 
    Comments     :
+     The weights are quantised to uchar as before, so that the sum of the
+     weights of a pixel is about MAXUCHAR, but only the stations with a
+     non-zero weight are stored.
+
+     The stations are sorted into a bucket grid (see StationGrid.c) first.
+     The nearest station and the variable radius Cressman schemes only look
+     at the stations found by NearestStations(), and IsStationLocation()
+     only checks the stations in the bucket of the pixel.  The inverse
+     distance scheme still visits every station, since all of them are part
+     of the weight of each pixel.  In the Cressman scheme, stations at the
+     same distance are now ranked by station index; the exchange sort used
+     before ordered them by their position in the station list in a way
+     that depended on all the other distances.
+
+     The rows are divided over the threads, each of which collects the
+     weights of its rows separately; the rows are copied into the sparse
+     table in order afterwards, so the table does not depend on the number
+     of threads.
  *****************************************************************************/
 void CalcWeights(METLOCATION * Station, int NStats, int NX, int NY,
-  uchar ** BasinMask, uchar **** WeightArray,
+  uchar ** BasinMask, METWEIGHTS * Weights,
   OPTIONSTRUCT * Options)
 {
-  double *Weights;		/* Array with weights for all stations */
-  double *Distance;		/* Array with distances to all stations */
+  STATIONGRID Grid;		/* Bucket grid of the station locations */
+  WEIGHTROW *Rows;		/* Weights of each row */
+  uchar *CellWeights;		/* Non-zero quantised weights of the current
+				   pixel */
+  int *CellStation;		/* Stations with these weights */
+  int NCell;			/* Number of stations with a non-zero weight */
+  double *Distance;		/* Array with distances to the stations */
   double *InvDist2;		/* Array with inverse distance squared */
   double Denominator;		/* Sum of 1/Distance^2 */
-  double mindistance;
-  double avgdistance;
-  double tempdistance;
-  double cr, crt;
+  double crt;
+  uchar w;
   int totalweight;
   int y;			/* Counter for rows */
   int x;			/* Counter for columns */
   int i, j;			/* Counter for stations */
+  int n;
   int CurrentStation;		/* Station at current location (if any) */
   int *stationid;		/* index array for sorted list of station distances */
   int *stat;
   int tempid;
-  int closest;
   int crstat;
+  int Offset;			/* Entries in the rows before the current one */
   COORD Loc;			/* Location of current point */
 
-  /* Allocate memory for a 3 dimensional array */
-
   if (DEBUG)
     printf("Calculating interpolation weights for %d stations\n", NStats);
 
-  if (!((*WeightArray) = (uchar ***)calloc(NY, sizeof(uchar **))))
-    ReportError("CalcWeights()", 1);
-
-  for (y = 0; y < NY; y++)
-    if (!((*WeightArray)[y] = (uchar **)calloc(NX, sizeof(uchar *))))
-      ReportError("CalcWeights()", 1);
-
-  for (y = 0; y < NY; y++)
-    for (x = 0; x < NX; x++)
-      if (!((*WeightArray)[y][x] = (uchar *)calloc(NStats, sizeof(uchar))))
-        ReportError("CalcWeights()", 1);
-
-  /* Allocate memory for the array that will contain weights, and the array for
-     the distances to each of the towers, and the inverse distance squared */
+  crstat = 0;
+  if (Options->Interpolation == VARCRESS) {
+    if (Options->CressRadius < 2)
+      ReportError("CalcWeights.c", 42);
+    crstat = Options->CressStations;
+    if (crstat < 2)
+      ReportError("CalcWeights.c", 42);
+  }
+  if (Options->Interpolation == NEAREST)
+    printf("Number of stations is %d \n", NStats);
 
-  if (!(Weights = (double *) calloc(NStats, sizeof(double))))
-    ReportError("CalcWeights()", 1);
+  printf("\nChecking interpolation weights\n");
+  printf("Sum should be 255 for all pixels \n");
+  printf("Some error is expected due to roundoff \n");
+  printf("Errors greater than +/- 2 Percent are: \n");
 
-  if (!(Distance = (double *)calloc(NStats, sizeof(double))))
-    ReportError("CalcWeights()", 1);
+  InitStationGrid(Station, NStats, &Grid);
 
-  if (!(InvDist2 = (double *)calloc(NStats, sizeof(double))))
+  if (!(Weights->Start = (int *) calloc(NX * NY + 1, sizeof(int))))
     ReportError("CalcWeights()", 1);
-
-  if (!(stationid = (int *)calloc(NStats, sizeof(int))))
+  if (!(Rows = (WEIGHTROW *) calloc(NY > 0 ? NY : 1, sizeof(WEIGHTROW))))
     ReportError("CalcWeights()", 1);
-
   if (!(stat = (int *)calloc(NStats + 1, sizeof(int))))
     ReportError("CalcWeights()", 1);
 
   /* Calculate the weights for each location that is inside the basin mask */
   /* note stations themselves can be outside the mask */
-  /* this first scheme is an inverse distance squared scheme */
 
-  if (Options->Interpolation == INVDIST) {
+#pragma omp parallel private(CellWeights, CellStation, NCell, Distance, \
+  InvDist2, Denominator, crt, w, totalweight, y, x, i, j, n, CurrentStation, \
+  stationid, tempid, Loc)
+  {
+    /* Allocate memory for the weights of a pixel, the distances to the
+       stations, and the inverse distance squared */
+
+    if (!(CellWeights = (uchar *) calloc(NStats + 1, sizeof(uchar))))
+      ReportError("CalcWeights()", 1);
+    if (!(CellStation = (int *) calloc(NStats + 1, sizeof(int))))
+      ReportError("CalcWeights()", 1);
+    if (!(Distance = (double *)calloc(NStats + 1, sizeof(double))))
+      ReportError("CalcWeights()", 1);
+    if (!(InvDist2 = (double *)calloc(NStats + 1, sizeof(double))))
+      ReportError("CalcWeights()", 1);
+    if (!(stationid = (int *)calloc(NStats + 1, sizeof(int))))
+      ReportError("CalcWeights()", 1);
+
+#pragma omp for schedule(dynamic)
     for (y = 0; y < NY; y++) {
       Loc.N = y;
       for (x = 0; x < NX; x++) {
         Loc.E = x;
-        if (INBASIN(BasinMask[y][x])) {
-          if (IsStationLocation(&Loc, NStats, Station, &CurrentStation)) {
-            for (i = 0; i < NStats; i++) {
-              if (i == CurrentStation)
-                (*WeightArray)[y][x][i] = MAXUCHAR;
-              else
-                (*WeightArray)[y][x][i] = 0;
-            }
+        NCell = 0;
+
+        if (!INBASIN(BasinMask[y][x])) {
+          StoreWeights(NCell, CellStation, CellWeights, y * NX + x, Weights,
+                       &Rows[y]);
+          continue;
+        }
+
+        /* this first scheme is an inverse distance squared scheme */
+        if (Options->Interpolation == INVDIST) {
+          if (IsStationLocation(&Loc, &Grid, Station, &CurrentStation)) {
+            CellStation[NCell] = CurrentStation;
+            CellWeights[NCell++] = MAXUCHAR;
           }
           else {
             for (i = 0, Denominator = 0; i < NStats; i++) {
@@ -132,100 +234,39 @@ void CalcWeights(METLOCATION * Station, int NStats, int NX, int NY,
               Denominator += InvDist2[i];
             }
             for (i = 0; i < NStats; i++) {
-              (*WeightArray)[y][x][i] =
-                (uchar)Round(InvDist2[i] / Denominator * MAXUCHAR);
+              w = (uchar)Round(InvDist2[i] / Denominator * MAXUCHAR);
+              if (w > 0) {
+                CellStation[NCell] = i;
+                CellWeights[NCell++] = w;
+              }
             }
           }
         }
-        else {
-          for (i = 0; i < NStats; i++)
-            (*WeightArray)[y][x][i] = 0;
-        }
-      }
-    }
-  }
-  if (Options->Interpolation == NEAREST) {
 
-    /* this next scheme is a nearest station */
-    printf("Number of stations is %d \n", NStats);
-
-    for (y = 0; y < NY; y++) {
-      Loc.N = y;
-      for (x = 0; x < NX; x++) {
-        Loc.E = x;
-        if (INBASIN(BasinMask[y][x])) {	/*we are inside the basin mask */
-          /* find the distance to nearest station */
-          mindistance = DHSVM_HUGE;
-          avgdistance = 0.0;
-          for (i = 0; i < NStats; i++) {
-            Distance[i] = CalcDistance(&(Station[i].Loc), &Loc);
-            avgdistance += Distance[i] / ((double)NStats);
-            if (Distance[i] < mindistance) {
-              mindistance = Distance[i];
-              closest = i;
-            }
+        /* this next scheme is a nearest station */
+        if (Options->Interpolation == NEAREST) {
+          /* find the nearest station; the first one in case of a tie */
+          if (NearestStations(&Grid, Station, &Loc, 1, stationid, Distance) > 0) {
+            CellStation[NCell] = stationid[0];
+            CellWeights[NCell++] = MAXUCHAR;
           }
-          /* got closest station */
-
-          for (i = 0; i < NStats; i++) {
-            if (i == closest)
-              (*WeightArray)[y][x][i] = MAXUCHAR;
-            else
-              (*WeightArray)[y][x][i] = 0;
-          }
-
-        }			/* done in basin mask */
-        else {
-          for (i = 0; i < NStats; i++)
-            (*WeightArray)[y][x][i] = 0;
         }
-      }
-    }
-  }
-
-  if (Options->Interpolation == VARCRESS) {
 
-    /* this next scheme is a variable radius cressman */
-    /* find the distance to the nearest station */
-    /* make a decision based on the maximum allowable radius, cr */
-    /* and the distance to the closest station */
-    /* while limiting the number of interpolation stations to three */
-    cr = (double)Options->CressRadius;
-    if (cr < 2)
-      ReportError("CalcWeights.c", 42);
-    crstat = Options->CressStations;
-    if (crstat < 2)
-      ReportError("CalcWeights.c", 42);
-    for (y = 0; y < NY; y++) {
-      Loc.N = y;
-      for (x = 0; x < NX; x++) {
-        Loc.E = x;
-        if (INBASIN(BasinMask[y][x])) {	/*we are inside the basin mask */
-          /* find the distance to nearest station */
-          for (i = 0; i < NStats; i++) {
-            Distance[i] = CalcDistance(&(Station[i].Loc), &Loc);
-            stationid[i] = i;
-          }
-          /* got distances for each station */
-          /* now sort the list by distance */
-          for (i = 0; i < NStats; i++) {
-            for (j = 0; j < NStats; j++) {
-              if (Distance[j] > Distance[i]) {
-                tempdistance = Distance[i];
-                tempid = stationid[i];
-                Distance[i] = Distance[j];
-                stationid[i] = stationid[j];
-                Distance[j] = tempdistance;
-                stationid[j] = tempid;
-              }
-            }
-          }
+        /* this next scheme is a variable radius cressman */
+        /* find the distance to the nearest station */
+        /* make a decision based on the maximum allowable radius, cr */
+        /* and the distance to the closest station */
+        /* while limiting the number of interpolation stations to crstat */
+        if (Options->Interpolation == VARCRESS) {
+          /* get the crstat nearest stations, sorted by distance */
+          n = NearestStations(&Grid, Station, &Loc, crstat, stationid,
+                              Distance);
 
           crt = Distance[0] * 2.0;
           if (crt < 1.0)
             crt = 1.0;
-          for (i = 0, Denominator = 0; i < NStats; i++) {
-            if (i < crstat && Distance[i] < crt) {
+          for (i = 0, Denominator = 0; i < n; i++) {
+            if (Distance[i] < crt) {
               InvDist2[i] =
                 (crt * crt - Distance[i] * Distance[i]) /
                 (crt * crt + Distance[i] * Distance[i]);
@@ -235,67 +276,81 @@ void CalcWeights(METLOCATION * Station, int NStats, int NX, int NY,
               InvDist2[i] = 0.0;
           }
 
-          for (i = 0; i < NStats; i++)
-            (*WeightArray)[y][x][stationid[i]] =
-            (uchar)Round(InvDist2[i] / Denominator * MAXUCHAR);
+          /* keep the non-zero weights, ordered by station index */
+          for (i = 0; i < n; i++) {
+            w = (uchar)Round(InvDist2[i] / Denominator * MAXUCHAR);
+            if (w == 0)
+              continue;
+            for (j = NCell; j > 0 && CellStation[j - 1] > stationid[i]; j--) {
+              CellStation[j] = CellStation[j - 1];
+              CellWeights[j] = CellWeights[j - 1];
+            }
+            CellStation[j] = stationid[i];
+            CellWeights[j] = w;
+            NCell++;
+          }
 
           /*at this point all weights have been assigned to one or more stations */
-
         }
-      }
-    }
-  }
 
-  /*check that all weights add up to MAXUCHAR */
-  /* and output some stats on the interpolation field */
-
-  for (i = 0; i <= NStats; i++)
-    stat[i] = 0;
-  for (i = 0; i < NStats; i++)
-    stationid[i] = 0;
-
-  printf("\nChecking interpolation weights\n");
-  printf("Sum should be 255 for all pixels \n");
-  printf("Some error is expected due to roundoff \n");
-  printf("Errors greater than +/- 2 Percent are: \n");
-
-  for (y = 0; y < NY; y++) {
-    for (x = 0; x < NX; x++) {
-      if (INBASIN(BasinMask[y][x])) {	/*we are inside the basin mask */
-        tempid = 0;
+        /*check that all weights add up to MAXUCHAR */
+        /* and output some stats on the interpolation field */
+        tempid = NCell;
         totalweight = 0;
+        for (i = 0; i < NCell; i++)
+          totalweight += (int)CellWeights[i];
 
-        for (i = 0; i < NStats; i++) {
-          totalweight += (int)(*WeightArray)[y][x][i];
-          if ((*WeightArray)[y][x][i] > 0) {
-            tempid += 1;
-            stationid[i] = 1;
-          }
-        }
-
-        if (totalweight < 250 || totalweight > 260)
+        if (totalweight < 250 || totalweight > 260) {
           /*printf("error in interpolation weight at pixel y %d x %d : %d \n", y,
             x, totalweight); */
-        stat[tempid] += 1;
+#pragma omp atomic
+          stat[tempid] += 1;
+        }
+
+        StoreWeights(NCell, CellStation, CellWeights, y * NX + x, Weights,
+                     &Rows[y]);
       }
+    }
+
+    free(CellWeights);
+    free(CellStation);
+    free(Distance);
+    free(InvDist2);
+    free(stationid);
+  }
+
+  /* Join the rows into the sparse table */
 
+  for (y = 0, Offset = 0; y < NY; y++) {
+    for (x = 0; x < NX; x++)
+      Weights->Start[y * NX + x + 1] += Offset;
+    Offset += Rows[y].N;
+  }
+  if (!(Weights->Station = (int *) calloc(Offset > 0 ? Offset : 1, 
+                                          sizeof(int))))
+    ReportError("CalcWeights()", 1);
+  if (!(Weights->Weight = (float *) calloc(Offset > 0 ? Offset : 1, 
+                                           sizeof(float))))
+    ReportError("CalcWeights()", 1);
+  for (y = 0; y < NY; y++) {
+    if (Rows[y].N > 0) {
+      memcpy(&(Weights->Station[Weights->Start[y * NX]]), Rows[y].Station,
+             Rows[y].N * sizeof(int));
+      memcpy(&(Weights->Weight[Weights->Start[y * NX]]), Rows[y].Weight,
+             Rows[y].N * sizeof(float));
     }
+    free(Rows[y].Station);
+    free(Rows[y].Weight);
   }
+
   for (i = 0; i <= NStats; i++)
     if (stat[i] > 0)
       printf("%d pixels are linked to %d met stations \n", stat[i],
         i);
-  /* debug */
-  /*
-  for (i = 0; i < NStats; i++)
-    if (stationid[i] > 0)
-      printf("%s station used in interpolation \n", Station[i].Name);
-  */
+
   /* Free memory */
 
-  free(Weights);
-  free(Distance);
-  free(InvDist2);
-  free(stationid);
+  free(Rows);
   free(stat);
+  FreeStationGrid(&Grid);
 }
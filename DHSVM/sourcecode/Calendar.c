@@ -16,6 +16,8 @@
  *               NextDate() 
  *               CopyDate() 
  *               PrintDate() 
+ *               PrintRBMStartDate()
+ *               SPrintRBMStartDate()
  *               IsNewMonth()
  *               IsNewDay()
  *               Before() 
@@ -226,20 +228,29 @@ void PrintDate(DATE * Day, FILE * OutFile)
   PrintRBMStartDate()
 *****************************************************************************/
 void PrintRBMStartDate(int Dt, DATE *Day, FILE * OutFile)
+{
+  char buffer[BUFSIZE + 1];
+
+  SPrintRBMStartDate(Dt, Day, buffer);
+  fprintf(OutFile, "%s", buffer);
+}
+
+/*****************************************************************************
+  SPrintRBMStartDate()
+*****************************************************************************/
+void SPrintRBMStartDate(int Dt, DATE *Day, char *buffer)
 {
   double rbmday;
   double sec;
-  DATE *RBM_DAY;
-
-  RBM_DAY = (DATE *) calloc(1, sizeof(DATE));
+  DATE RBM_DAY;
 
   rbmday = Day->Julian + 1;
-  JulianDayToGregorian(rbmday, &(RBM_DAY->Year), &(RBM_DAY->Month), &(RBM_DAY->Day),
-		       &(RBM_DAY->Hour), &(RBM_DAY->Min), &sec);
-  RBM_DAY->Sec = (int)sec;
+  JulianDayToGregorian(rbmday, &(RBM_DAY.Year), &(RBM_DAY.Month), &(RBM_DAY.Day),
+		       &(RBM_DAY.Hour), &(RBM_DAY.Min), &sec);
+  RBM_DAY.Sec = (int)sec;
 
-  fprintf(OutFile, "%02d/%02d/%4d-00:%02d:%02d", RBM_DAY->Month, RBM_DAY->Day,
-	  RBM_DAY->Year, RBM_DAY->Min, RBM_DAY->Sec);
+  sprintf(buffer, "%02d/%02d/%4d-00:%02d:%02d", RBM_DAY.Month, RBM_DAY.Day,
+	  RBM_DAY.Year, RBM_DAY.Min, RBM_DAY.Sec);
 }
 /* -------------------------------------------------------------
    SPrintDate
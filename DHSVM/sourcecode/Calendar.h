@@ -73,6 +73,7 @@ int NumberOfSteps(DATE *Start, DATE *End, int Interval);
 void PrintDate(DATE *Day, FILE *OutFile);
 void PrintRBMStartDate(int Dt, DATE *Day, FILE *OutFile);
 void SPrintDate(DATE *Day, char *buffer);
+void SPrintRBMStartDate(int Dt, DATE *Day, char *buffer);
 int ScanDate(FILE *InFile, DATE *Day);
 int SScanDate(char *Str, DATE *Day);
 int SScanMonthDay(char *Str, DATE *Day);
@@ -0,0 +1,437 @@
+/*
+ * SUMMARY:      CellKernels.c - Per-cell physics over a run of cells
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Versions of CalcTransmissivity(), LapseT(), LapsePrecip()
+ *               and AirPressure() that work on arrays holding the values
+ *               of a run of cells, rather than on one cell at a time.  The
+ *               loops have no branches or calls to the math library, so
+ *               that the compiler can turn them into SIMD instructions.
+ *               The exponential and logarithm are evaluated with the inline
+ *               functions VecExp() and VecLog() for that reason.  The
+ *               scalar functions call these with a run of one cell, so that
+ *               both give the same results.
+ * DESCRIP-END.
+ * FUNCTIONS:    VecExp()
+ *               VecLog()
+ *               CalcTransmissivityRun()
+ *               LapseTRun()
+ *               LapsePrecipRun()
+ *               AirPressureRun()
+ * COMMENTS:
+ *   VecExp() and VecLog() are accurate to a few units in the last place of
+ *   a double, and the kernels round their result to a float, so that the
+ *   results agree with those of the math library to within one unit in
+ *   the last place of a float.  The test program (TEST_CELLKERNELS) checks
+ *   this against the formulas evaluated with exp() and pow().
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "functions.h"
+#include "constants.h"
+
+#define EXPMIN  -708.0		/* Smallest argument of VecExp() */
+#define EXPMAX   709.0		/* Largest argument of VecExp() */
+#define ROUNDER  6755399441055744.0	/* 1.5 * 2^52, rounds to an integer */
+
+static inline double VecExp(double x);
+static inline double VecLog(double x);
+
+/*****************************************************************************
+  Function name: VecExp()
+
+  Purpose      : Exponential function that can be used in a SIMD loop
+
+  Required     :
+    double x - Argument, clamped to [EXPMIN, EXPMAX]
+
+  Returns      : double - exp(x)
+
+  Comments     : x = k ln(2) + r, with k an integer and |r| <= ln(2)/2.
+                 exp(r) is evaluated with its Taylor series to the 13th
+                 power, which is exact to double precision on that interval,
+                 and multiplied by 2^k, which is built from its bits
+*****************************************************************************/
+static inline double VecExp(double x)
+{
+  double k;
+  double r;
+  double p;
+  double t;
+  long long Bits;
+
+  x = (x < EXPMIN) ? EXPMIN : x;
+  x = (x > EXPMAX) ? EXPMAX : x;
+
+  /* k is rounded to the nearest integer by adding and subtracting 1.5 2^52,
+     which leaves k in the lower bits of t */
+  t = x * 1.4426950408889634 + ROUNDER;
+  k = t - ROUNDER;
+  r = x - k * 6.93147180369123816490e-01;
+  r = r - k * 1.90821492927058770002e-10;
+
+  p = 1.0 / 6227020800.0;
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  memcpy(&Bits, &t, sizeof(double));
+  Bits = (Bits - 0x4338000000000000LL + 1023) << 52;
+  memcpy(&t, &Bits, sizeof(double));
+
+  return p * t;
+}
+
+/*****************************************************************************
+  Function name: VecLog()
+
+  Purpose      : Natural logarithm that can be used in a SIMD loop
+
+  Required     :
+    double x - Argument, a positive normal number
+
+  Returns      : double - log(x)
+
+  Comments     : x = m 2^e, with sqrt(1/2) <= m < sqrt(2).  log(m) is
+                 evaluated as 2 atanh(s), with s = (m - 1)/(m + 1), from its
+                 series to the 23rd power of s, which is exact to double
+                 precision for |s| <= 0.172
+*****************************************************************************/
+static inline double VecLog(double x)
+{
+  double m;
+  double e;
+  double s;
+  double s2;
+  double p;
+  unsigned long long Bits;
+  int Exponent;
+
+  memcpy(&Bits, &x, sizeof(double));
+  Exponent = (int) (Bits >> 52) - 1023;
+  Bits = (Bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+  memcpy(&m, &Bits, sizeof(double));
+  e = (double) Exponent;
+  e += (m > 1.4142135623730951) ? 1.0 : 0.0;
+  m *= (m > 1.4142135623730951) ? 0.5 : 1.0;
+
+  s = (m - 1.0) / (m + 1.0);
+  s2 = s * s;
+  p = 1.0 / 23.0;
+  p = p * s2 + 1.0 / 21.0;
+  p = p * s2 + 1.0 / 19.0;
+  p = p * s2 + 1.0 / 17.0;
+  p = p * s2 + 1.0 / 15.0;
+  p = p * s2 + 1.0 / 13.0;
+  p = p * s2 + 1.0 / 11.0;
+  p = p * s2 + 1.0 / 9.0;
+  p = p * s2 + 1.0 / 7.0;
+  p = p * s2 + 1.0 / 5.0;
+  p = p * s2 + 1.0 / 3.0;
+  p = p * s2 + 1.0;
+
+  return e * 6.93147180369123816490e-01 + (2.0 * s * p +
+					   e * 1.90821492927058770002e-10);
+}
+
+/*****************************************************************************
+  Function name: CalcTransmissivityRun()
+
+  Purpose      : Calculates the transmissivity through the saturated part of
+                 the soil profile for a run of cells
+
+  Required     :
+    int N               - Number of cells
+    float *SoilDepth    - Total soil depth in m
+    float *WaterTable   - Depth of the water table below the soil surface
+                          in m
+    float *LateralKs    - Lateral hydraulic conductivity in m/s
+    float *KsExponent   - Exponent that describes exponential decay of
+                          LateralKs with depth below the soil surface
+    float *DepthThresh  - Depth below which the transmissivity decreases
+                          linearly (m)
+
+  Returns      : void
+
+  Modifies     :
+    float *Transmissivity - Transmissivity in m2/s
+
+  Comments     : See CalcTransmissivity().  Both branches of the exponential
+                 profile are folded into one evaluation at
+                 MIN(WaterTable, DepthThresh).  The warning for a threshold
+                 below the soil depth is given after the loop.
+*****************************************************************************/
+void CalcTransmissivityRun(int N, float *SoilDepth, float *WaterTable,
+			   float *LateralKs, float *KsExponent,
+			   float *DepthThresh, float *Transmissivity)
+{
+  int i;
+
+#pragma omp simd
+  for (i = 0; i < N; i++) {
+    float Exponent = KsExponent[i];
+    float Top;			/* Top of the exponential profile */
+    float Linear;		/* Transmissivity without decay */
+    float Decay;		/* Transmissivity with exponential decay */
+    float Ratio;
+    float Scale;
+
+    Linear = LateralKs[i] * (SoilDepth[i] - WaterTable[i]);
+    Top = (WaterTable[i] < DepthThresh[i]) ? WaterTable[i] : DepthThresh[i];
+    Decay = (LateralKs[i] / Exponent) *
+      (VecExp(-Exponent * Top) - VecExp(-Exponent * SoilDepth[i]));
+    /* below the threshold the decay is scaled linearly; the factor is
+       selected rather than the multiplication, so that the loop has no
+       branches */
+    Ratio = (SoilDepth[i] - WaterTable[i]) / (SoilDepth[i] - DepthThresh[i]);
+    Scale = (WaterTable[i] >= DepthThresh[i]) ? Ratio : 1.0f;
+    Decay = Scale * Decay;
+    Transmissivity[i] = (Exponent == 0.0f) ? Linear : Decay;
+  }
+
+  for (i = 0; i < N; i++) {
+    if (KsExponent[i] != 0.0 && WaterTable[i] >= DepthThresh[i] &&
+	SoilDepth[i] < DepthThresh[i]) {
+      printf("Warning: Soil DepthThreshold (%.2f) > the soil depth (%.2f)!\n",
+	     DepthThresh[i], SoilDepth[i]);
+      printf("Transmissivity is set to zero!");
+    }
+  }
+}
+
+/*****************************************************************************
+  Function name: LapseTRun()
+
+  Purpose      : Lapse temperature with elevation for a run of cells
+
+  Required     :
+    int N            - Number of cells
+    float Temp       - Air temperature at FromElev elevation (C)
+    float FromElev   - Elevation to lapse from (m)
+    float *ToElev    - Elevations to lapse to (m)
+    float LapseRate  - Lapse rate in (m/m)
+
+  Returns      : void
+
+  Modifies     :
+    float *LapsedTemp - Air temperature at ToElev elevation (C)
+
+  Comments     : See LapseT()
+*****************************************************************************/
+void LapseTRun(int N, float Temp, float FromElev, float *ToElev,
+	       float LapseRate, float *LapsedTemp)
+{
+  int i;
+
+#pragma omp simd
+  for (i = 0; i < N; i++)
+    LapsedTemp[i] = Temp + (ToElev[i] - FromElev) * LapseRate;
+}
+
+/*****************************************************************************
+  Function name: LapsePrecipRun()
+
+  Purpose      : Lapse precipitation with elevation for a run of cells
+
+  Required     :
+    int N                   - Number of cells
+    float Precip            - Precipitation at FromElev (m/timestep)
+    float FromElev          - Elevation to lapse from (m)
+    float *ToElev           - Elevations to lapse to (m)
+    float PrecipLapse       - Precipitation lapse rate (1/m)
+    float *precipMultiplier - Precipitation multiplier of each cell
+
+  Returns      : void
+
+  Modifies     :
+    float *LapsedPrecip - Precipitation at ToElev (m/timestep)
+
+  Comments     : See LapsePrecip()
+*****************************************************************************/
+void LapsePrecipRun(int N, float Precip, float FromElev, float *ToElev,
+		    float PrecipLapse, float *precipMultiplier,
+		    float *LapsedPrecip)
+{
+  int i;
+
+#pragma omp simd
+  for (i = 0; i < N; i++) {
+    float Lapsed = Precip * (1.0 + PrecipLapse * (ToElev[i] - FromElev))
+      * (1 + precipMultiplier[i] * (ToElev[i] - MINELEV));
+    LapsedPrecip[i] = (Lapsed < 0.0) ? 0.0 : Lapsed;
+  }
+}
+
+/*****************************************************************************
+  Function name: AirPressureRun()
+
+  Purpose      : Air pressure at the elevation of a run of cells
+
+  Required     :
+    int N               - Number of cells
+    float *LapseRate    - Temperature lapse rate (C/m)
+    float *Elev         - Elevation (m)
+
+  Returns      : void
+
+  Modifies     :
+    float *Press - Air pressure (Pa)
+
+  Comments     : See AirPressure()
+*****************************************************************************/
+void AirPressureRun(int N, float *LapseRate, float *Elev, float *Press)
+{
+  int i;
+
+#pragma omp simd
+  for (i = 0; i < N; i++) {
+    /* a rate of 0.0 gives an infinite exponent, and a result that is not
+       used */
+    float Exponent = 9.8067 / (LapseRate[i] * 287.0);
+    double Ratio = (288.0 - LapseRate[i] * Elev[i]) / 288.0;
+    float Lapsed = 101300. * VecExp(Exponent * VecLog(Ratio));
+
+    Press[i] = (LapseRate[i] != 0.0f) ? Lapsed : 101300.f;
+  }
+}
+
+#ifdef TEST_CELLKERNELS
+/*****************************************************************************
+  Test program for the kernels.  Compares the kernels with the formulas of
+  the original scalar functions, evaluated with exp() and pow(), over a
+  range of inputs, and reports the largest difference in units in the last
+  place of a float.  Build with
+
+  gcc -O2 -DTEST_CELLKERNELS -o test_cellkernels CellKernels.c -lm
+*****************************************************************************/
+
+#define NTEST 100000		/* Number of test values */
+#define MAXULP 1		/* Largest difference allowed */
+
+float MINELEV = 0.0;		/* Defined in globals.c in DHSVM */
+
+/* Difference between two floats in units in the last place */
+static long Ulps(float a, float b)
+{
+  int ia;
+  int ib;
+
+  if (a == b)
+    return 0;
+  memcpy(&ia, &a, sizeof(float));
+  memcpy(&ib, &b, sizeof(float));
+  if (ia < 0)
+    ia = (int) 0x80000000 - ia;
+  if (ib < 0)
+    ib = (int) 0x80000000 - ib;
+  return labs((long) ia - (long) ib);
+}
+
+/* Uniform random number in [Min, Max) */
+static float Uniform(float Min, float Max)
+{
+  return Min + (Max - Min) * (float) rand() / ((float) RAND_MAX + 1.0f);
+}
+
+int main(void)
+{
+  static float SoilDepth[NTEST];
+  static float WaterTable[NTEST];
+  static float LateralKs[NTEST];
+  static float KsExponent[NTEST];
+  static float DepthThresh[NTEST];
+  static float LapseRate[NTEST];
+  static float Elev[NTEST];
+  static float Result[NTEST];
+  long Ulp;
+  long MaxTrans = 0;
+  long MaxPress = 0;
+  long MaxExp = 0;
+  int i;
+
+  srand(1);
+  for (i = 0; i < NTEST; i++) {
+    SoilDepth[i] = Uniform(0.5, 5.0);
+    WaterTable[i] = Uniform(0.0, SoilDepth[i]);
+    LateralKs[i] = Uniform(1.e-5, 1.e-2);
+    KsExponent[i] = (i % 10 == 0) ? 0.0 : Uniform(0.1, 10.0);
+    DepthThresh[i] = Uniform(0.5, SoilDepth[i]);
+    LapseRate[i] = (i % 100 == 0) ? 0.0 : Uniform(-0.01, 0.01);
+    Elev[i] = Uniform(-100., 4500.);
+  }
+
+  CalcTransmissivityRun(NTEST, SoilDepth, WaterTable, LateralKs, KsExponent,
+			DepthThresh, Result);
+  for (i = 0; i < NTEST; i++) {
+    float Expected;
+    float TransThresh;
+
+    if (KsExponent[i] == 0.0)
+      Expected = LateralKs[i] * (SoilDepth[i] - WaterTable[i]);
+    else if (WaterTable[i] < DepthThresh[i])
+      Expected = (LateralKs[i] / KsExponent[i]) *
+	(exp(-KsExponent[i] * WaterTable[i]) -
+	 exp(-KsExponent[i] * SoilDepth[i]));
+    else {
+      TransThresh = (LateralKs[i] / KsExponent[i]) *
+	(exp(-KsExponent[i] * DepthThresh[i]) -
+	 exp(-KsExponent[i] * SoilDepth[i]));
+      Expected = (SoilDepth[i] - WaterTable[i]) /
+	(SoilDepth[i] - DepthThresh[i]) * TransThresh;
+    }
+    Ulp = Ulps(Result[i], Expected);
+    if (Ulp > MaxTrans)
+      MaxTrans = Ulp;
+  }
+
+  AirPressureRun(NTEST, LapseRate, Elev, Result);
+  for (i = 0; i < NTEST; i++) {
+    float Expected;
+    float Exponent;
+
+    if (LapseRate[i] != 0.0) {
+      Exponent = 9.8067 / (LapseRate[i] * 287.0);
+      Expected = 101300. *
+	pow(((288.0 - LapseRate[i] * Elev[i]) / 288.0), Exponent);
+    }
+    else
+      Expected = 101300.;
+    Ulp = Ulps(Result[i], Expected);
+    if (Ulp > MaxPress)
+      MaxPress = Ulp;
+  }
+
+  for (i = 0; i < NTEST; i++) {
+    double x = Uniform(-700., 700.);
+    Ulp = Ulps((float) (VecExp(x) / exp(x)), 1.0f);
+    if (Ulp > MaxExp)
+      MaxExp = Ulp;
+  }
+
+  printf("CalcTransmissivityRun: largest difference %ld ulp\n", MaxTrans);
+  printf("AirPressureRun: largest difference %ld ulp\n", MaxPress);
+  printf("VecExp: largest relative difference %ld float ulp\n", MaxExp);
+
+  if (MaxTrans > MAXULP || MaxPress > MAXULP || MaxExp > 0) {
+    printf("FAILED\n");
+    return EXIT_FAILURE;
+  }
+  printf("PASSED\n");
+  return EXIT_SUCCESS;
+}
+#endif
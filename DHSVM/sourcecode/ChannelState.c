@@ -33,22 +33,17 @@
 #include "sizeofnt.h"
 #include "channel.h"
 
-typedef struct _RECORDSTRUCT {
-  SegmentID id;
-  float storage;
-} RECORDSTRUCT;
-
-int CompareRecord(const void *record1, const void *record2);
-int CompareRecordID(const void *key, const void *record);
-
 /*****************************************************************************
   ReadChannelState()
 
   Read the state of the channel from a previous run.  Currently just read an
   ASCII file, with the unique channel IDs in the first column and the amount
-  of storage in the second column (m3)
+  of storage in the second column (m3).  Records are matched to segments
+  through the segment index of the network.  With Checkpoint not NULL the
+  IDs and storages are taken from that checkpoint instead.
 *****************************************************************************/
-void ReadChannelState(char *Path, DATE *Now, Channel *Head)
+void ReadChannelState(char *Path, DATE *Now, Channel *Head, ChannelIndex *Index,
+                      CHECKPOINT *Checkpoint)
 {
   char InFileName[BUFSIZ + 1] = "";
   char Str[BUFSIZ + 1] = "";
@@ -56,60 +51,110 @@ void ReadChannelState(char *Path, DATE *Now, Channel *Head)
   FILE *InFile = NULL;
   int i = 0;
   int NLines = 0;
-  int max_seg = 0;
-  RECORDSTRUCT *Match = NULL;
-  RECORDSTRUCT *Record = NULL;
+  SegmentID id;
+  float storage;
+  uchar *Found = NULL;
+  int *CkpID = NULL;
+  float *CkpStorage = NULL;
+
+  if (Checkpoint != NULL) {
+    NLines = GetCheckpointCount(Checkpoint, CKP_CHANNEL_ID, 0);
+    CkpID = (int *) calloc(NLines + 1, sizeof(int));
+    CkpStorage = (float *) calloc(NLines + 1, sizeof(float));
+    if (CkpID == NULL || CkpStorage == NULL)
+      ReportError("ReadChannelState", 1);
+    GetCheckpointField(Checkpoint, CKP_CHANNEL_ID, 0, CkpID, NLines);
+    GetCheckpointField(Checkpoint, CKP_CHANNEL_STORAGE, 0, CkpStorage, NLines);
+  }
+  else {
+    /* Re-create the storage file name and open it */
+    sprintf(Str, "%02d.%02d.%04d.%02d.%02d.%02d", Now->Month, Now->Day,
+	    Now->Year, Now->Hour, Now->Min, Now->Sec);
+    sprintf(InFileName, "%sChannel.State.%s", Path, Str);
+    OpenFile(&InFile, InFileName, "r", TRUE);
+    NLines = CountLines(InFile);
+    rewind(InFile);
+  }
 
-  /* Re-create the storage file name and open it */
-  sprintf(Str, "%02d.%02d.%04d.%02d.%02d.%02d", Now->Month, Now->Day,
-	  Now->Year, Now->Hour, Now->Min, Now->Sec);
-  sprintf(InFileName, "%sChannel.State.%s", Path, Str);
-  OpenFile(&InFile, InFileName, "r", TRUE);
-  NLines = CountLines(InFile);
-  rewind(InFile);
-
-  /* Allocate memory and read the file */
-  Record = (RECORDSTRUCT *) calloc(NLines, sizeof(RECORDSTRUCT));
-  if (Record == NULL)
+  /* Keep track of the segments that have a record */
+  Found = (uchar *) calloc(Index->maxid + 1, sizeof(uchar));
+  if (Found == NULL)
     ReportError("ReadChannelState", 1);
-  for (i = 0; i < NLines; i++)
-    fscanf(InFile, "%hu %f", &(Record[i].id), &(Record[i].storage));
-  qsort(Record, NLines, sizeof(RECORDSTRUCT), CompareRecord);
 
-  /* Assign the storages to the correct IDs */
+  /* Read the file and assign the storages to the correct IDs */
+  for (i = 0; i < NLines; i++) {
+    if (Checkpoint != NULL) {
+      id = (SegmentID) CkpID[i];
+      storage = CkpStorage[i];
+    }
+    else
+      fscanf(InFile, "%hu %f", &id, &storage);
+    if ((int) id <= Index->maxid && Index->seg[id] != NULL) {
+      Index->seg[id]->storage = storage;
+      Found[id] = TRUE;
+    }
+  }
+
   Current = Head;
   while (Current) {
-    Match = bsearch(&(Current->id), Record, NLines, sizeof(RECORDSTRUCT),
-		    CompareRecordID);
-    if (Current->id > max_seg)
-      max_seg = Current->id;
-    if (Match == NULL)
+    if (!Found[Current->id])
       ReportError("ReadChannelState", 55);
-    Current->storage = Match->storage;
     Current = Current->next;
   }
 
   /* Clean up */
-  if (Record)
-    free(Record);
-  fclose(InFile);
+  free(Found);
+  free(CkpID);
+  free(CkpStorage);
+  if (InFile != NULL)
+    fclose(InFile);
 }
 
 /*****************************************************************************
   StoreChannelState()
 
   Store the current state of the channel, i.e. the storage in each channel 
-  segment.
-
+  segment.  With Checkpoint not NULL the IDs and storages are added to that
+  checkpoint instead.
 *****************************************************************************/
-void StoreChannelState(char *Path, DATE * Now, Channel * Head)
+void StoreChannelState(char *Path, DATE * Now, Channel * Head,
+                       CHECKPOINT * Checkpoint)
 {
   char OutFileName[BUFSIZ + 1] = "";
   char Str[BUFSIZ + 1] = "";
   Channel *Current = NULL;
   FILE *OutFile = NULL;
+  int *CkpID = NULL;
+  float *CkpStorage = NULL;
+  int NSegments = 0;
 
   printf("storing channel state \n");
+
+  if (Checkpoint != NULL) {
+    for (Current = Head; Current; Current = Current->next)
+      NSegments++;
+    CkpID = (int *) calloc(NSegments + 1, sizeof(int));
+    CkpStorage = (float *) calloc(NSegments + 1, sizeof(float));
+    if (CkpID == NULL || CkpStorage == NULL)
+      ReportError("StoreChannelState", 1);
+    NSegments = 0;
+    for (Current = Head; Current; Current = Current->next) {
+      CkpID[NSegments] = Current->id;
+      CkpStorage[NSegments] = Current->storage;
+      NSegments++;
+    }
+    PutCheckpointField(Checkpoint, CKP_CHANNEL_ID, 0, CkpID, NSegments);
+    PutCheckpointField(Checkpoint, CKP_CHANNEL_STORAGE, 0, CkpStorage,
+                       NSegments);
+    free(CkpID);
+    free(CkpStorage);
+    return;
+  }
+
+  /* the first MPI process holds the storage of all segments */
+  if (ParallelRank() != 0)
+    return;
+
   /* Create storage file */
   sprintf(Str, "%02d.%02d.%04d.%02d.%02d.%02d", Now->Month, Now->Day,
 	  Now->Year, Now->Hour, Now->Min, Now->Sec);
@@ -127,36 +172,3 @@ void StoreChannelState(char *Path, DATE * Now, Channel * Head)
   /* Close file */
   fclose(OutFile);
 }
-
-/*****************************************************************************
-  CompareRecord()
-
-  Compare two RECORDSTRUCT elements for qsort
-*****************************************************************************/
-int CompareRecord(const void *record1, const void *record2)
-{
-  RECORDSTRUCT *x = NULL;
-  RECORDSTRUCT *y = NULL;
-
-  x = (RECORDSTRUCT *) record1;
-  y = (RECORDSTRUCT *) record2;
-
-  return (int) x->id - y->id;
-}
-
-/*****************************************************************************
-  CompareRecordID()
-
-  Compare RECORDSTRUCT element with an ID to see if the RECORDSTRUCT has the
-  right ID for bsearch
-*****************************************************************************/
-int CompareRecordID(const void *key, const void *record)
-{
-  SegmentID *x = NULL;
-  RECORDSTRUCT *y = NULL;
-
-  x = (SegmentID *) key;
-  y = (RECORDSTRUCT *) record;
-
-  return (int) (*x - y->id);
-}
@@ -24,11 +24,13 @@
 #include "constants.h"
 
 void CheckOut(OPTIONSTRUCT *Options, LAYER Veg, LAYER Soil, VEGTABLE *VType, SOILTABLE *SType,
-  MAPSIZE *Map, TOPOPIX **TopoMap, VEGPIX **VegMap, SOILPIX **SoilMap)
+  MAPSIZE *Map, TOPOPIX **TopoMap, VEGPIX **VegMap, SOILPIX **SoilMap,
+  SOILFLOWMAP *SoilFlow)
 
 {
   int y, x, i, j, k;
   int *count = NULL, *scount = NULL;
+  double *Counts = NULL;
   float a, b, l, Taud, Taub20, Taub40, Taub60, Taub80;
 
   int npixels;
@@ -39,8 +41,13 @@ void CheckOut(OPTIONSTRUCT *Options, LAYER Veg, LAYER Soil, VEGTABLE *VType, SOI
   if (!(scount = calloc(Soil.NTypes, sizeof(int)))) {
     ReportError("Checkout", 1);
   }
+  if (!(Counts = calloc(Veg.NTypes + Soil.NTypes + 1, sizeof(double)))) {
+    ReportError("Checkout", 1);
+  }
 
-  for (y = 0; y < Map->NY; y++) {
+  /* the cells are counted in the band of this process, and summed over
+     the processes */
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         if (VegMap[y][x].Veg < 1 || VegMap[y][x].Veg > Veg.NTypes) {
@@ -61,13 +68,27 @@ void CheckOut(OPTIONSTRUCT *Options, LAYER Veg, LAYER Soil, VEGTABLE *VType, SOI
   }
 
   i = 0;
-  for (y = 0; y < Map->NY; y++) {
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         i = i + 1;
       }
     }
   }
+
+  for (j = 0; j < Veg.NTypes; j++)
+    Counts[j] = count[j];
+  for (j = 0; j < Soil.NTypes; j++)
+    Counts[Veg.NTypes + j] = scount[j];
+  Counts[Veg.NTypes + Soil.NTypes] = i;
+  ParallelSum(Counts, Veg.NTypes + Soil.NTypes + 1);
+  for (j = 0; j < Veg.NTypes; j++)
+    count[j] = (int) Counts[j];
+  for (j = 0; j < Soil.NTypes; j++)
+    scount[j] = (int) Counts[Veg.NTypes + j];
+  i = (int) Counts[Veg.NTypes + Soil.NTypes];
+  free(Counts);
+
   printf("\nBasin has %d active pixels \n", i);
   npixels = i;
 
@@ -136,10 +157,12 @@ void CheckOut(OPTIONSTRUCT *Options, LAYER Veg, LAYER Soil, VEGTABLE *VType, SOI
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
-        if (SoilMap[y][x].Depth <= VType[VegMap[y][x].Veg - 1].TotalDepth) {
+        if (SoilFlow->Depth[y * Map->NX + x] <= VType[VegMap[y][x].Veg - 1].TotalDepth) {
           printf("Error for class %d of Type %s  \n", VegMap[y][x].Veg,
             VType[VegMap[y][x].Veg - 1].Desc);
-          printf("%d %d Soil depth is %f, Root depth is %f \n", y, x, SoilMap[y][x].Depth,
+          printf("%d %d Soil depth is %f, Root depth is %f \n",
+            y + Map->GlobalY0, x,
+            SoilFlow->Depth[y * Map->NX + x],
             VType[VegMap[y][x].Veg - 1].TotalDepth);
           exit(-1);
         }
@@ -0,0 +1,529 @@
+/*
+ * SUMMARY:      Checkpoint.c - Store and read the model state in one file
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  A checkpoint holds the model state that is otherwise
+ *               stored in the Interception, Snow, Soil and Met state map
+ *               files, the channel storage and the unit hydrograph, in a
+ *               single file.  Each field (a state map, or a list of values)
+ *               is found through a table of offsets, so that on restart
+ *               the file can be mapped into memory and each field copied
+ *               with one memcpy().  Fields can be run-length encoded, which
+ *               is worthwhile for the maps, most of which hold NA outside
+ *               the basin and constant values inside it.
+ * DESCRIP-END.
+ * FUNCTIONS:    CreateCheckpoint()
+ *               PutCheckpointField()
+ *               PutCheckpointMap()
+ *               OpenCheckpoint()
+ *               GetCheckpointCount()
+ *               GetCheckpointField()
+ *               GetCheckpointMap()
+ *               CloseCheckpoint()
+ * COMMENTS:
+ *   The file starts with a header: "DHSVMCKP" (8 characters), the version,
+ *   the number of fields, the number of rows and columns of the maps and
+ *   the year, month, day, hour, minute and second of the state as 4-byte
+ *   ints, followed by the offset of the field table as an 8-byte int.  The
+ *   fields follow, each starting at a multiple of CKPALIGN bytes.  The table
+ *   is at the end of the file and has for each field its ID, layer,
+ *   encoding and number of values as 4-byte ints, and its offset and size
+ *   in bytes as 8-byte ints.  All numbers are in native byte order.
+ *
+ *   State maps use their variable ID (see varid.h) and layer; the other
+ *   fields use the CKP_ IDs in fileio.h.  All values are 4 bytes.
+ *
+ *   An encoded field is a series of runs, each starting with a 4-byte int
+ *   n.  A run with n > 0 is followed by n values, a run with n < 0 by one
+ *   value that is repeated -n times.  A field is only encoded if that
+ *   makes it smaller.
+ *
+ *   With MPI the maps of the whole grid are collected and written by the
+ *   first process; each process reads the rows that it holds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "functions.h"
+
+#define CKPVERSION 1
+#define CKPALIGN   64		/* Alignment of the fields in the file */
+#define CKPRAW     0		/* Field encodings */
+#define CKPRUNS    1
+
+typedef struct {
+  char Magic[8];		/* "DHSVMCKP" */
+  int Version;
+  int NFields;
+  int NY;
+  int NX;
+  int Date[6];			/* Year, month, day, hour, minute, second */
+  long long TableOffset;
+} CKPHEADER;
+
+typedef struct {
+  int ID;
+  int Layer;
+  int Encoding;			/* CKPRAW or CKPRUNS */
+  int Count;			/* Number of values */
+  long long Offset;		/* Offset of the field in the file */
+  long long Size;		/* Bytes of the field in the file */
+} CKPFIELD;
+
+struct CHECKPOINT {
+  char FileName[BUFSIZE + 1];
+  char TempName[BUFSIZE + 5];	/* FileName with .tmp, while being written */
+  FILE *File;			/* File being written, NULL when reading, or on
+				   the MPI processes that do not write */
+  int Compress;			/* Encode the fields when writing */
+  CKPHEADER Header;
+  CKPFIELD *Field;
+  int MaxFields;
+  unsigned char *Data;		/* Contents of the file being read */
+  size_t Size;			/* Bytes of the file being read */
+  int Mapped;			/* Data is mapped rather than read */
+};
+
+/*****************************************************************************
+  CheckpointName()
+*****************************************************************************/
+static void CheckpointName(char *FileName, char *Path, DATE *Now)
+{
+  sprintf(FileName, "%sCheckpoint.%02d.%02d.%04d.%02d.%02d.%02d", Path,
+          Now->Month, Now->Day, Now->Year, Now->Hour, Now->Min, Now->Sec);
+}
+
+/*****************************************************************************
+  EncodeRuns()
+
+  Run-length encode Count 4-byte values into Out, which has room for at most
+  Count ints.  Returns the number of ints in Out, or -1 if the encoded field
+  would not be smaller.
+*****************************************************************************/
+static int EncodeRuns(const unsigned int *In, int Count, unsigned int *Out)
+{
+  int i;
+  int j;
+  int n = 0;
+  int Start;
+
+  i = 0;
+  while (i < Count) {
+    for (j = i + 1; j < Count && In[j] == In[i]; j++)
+      ;
+    if (j - i >= 3) {
+      if (n + 2 >= Count)
+        return -1;
+      Out[n++] = (unsigned int) (i - j);
+      Out[n++] = In[i];
+      i = j;
+    }
+    else {
+      /* copy values up to the next run of three */
+      Start = i;
+      while (i < Count && !(i + 2 < Count && In[i] == In[i + 1] &&
+                            In[i] == In[i + 2]))
+        i++;
+      if (n + 1 + (i - Start) >= Count)
+        return -1;
+      Out[n++] = (unsigned int) (i - Start);
+      memcpy(&Out[n], &In[Start], (i - Start) * sizeof(unsigned int));
+      n += i - Start;
+    }
+  }
+  return n;
+}
+
+/*****************************************************************************
+  DecodeRuns()
+
+  Decode values First to First + Count - 1 of a run-length encoded field of
+  Size bytes and Total values.  The runs after the last of these values are
+  not read.  Returns FALSE if the field is not valid.
+*****************************************************************************/
+static int DecodeRuns(const unsigned int *In, size_t Size, unsigned int *Out,
+                      int First, int Count, int Total)
+{
+  size_t NIn = Size / sizeof(unsigned int);
+  size_t i = 0;
+  int n = 0;
+  int Run;
+  int Start;			/* Part of the run that is in Out */
+  int End;
+  int j;
+
+  while (i < NIn && n < First + Count) {
+    Run = (int) In[i++];
+    if (Run > 0) {
+      if (i + Run > NIn || n + Run > Total)
+        return FALSE;
+    }
+    else if (Run < 0) {
+      if (i >= NIn || n - Run > Total)
+        return FALSE;
+    }
+    else
+      return FALSE;
+    Start = MAX(n, First);
+    End = MIN(n + abs(Run), First + Count);
+    if (Run > 0) {
+      if (Start < End)
+        memcpy(&Out[Start - First], &In[i + Start - n],
+               (End - Start) * sizeof(unsigned int));
+      i += Run;
+    }
+    else {
+      for (j = Start; j < End; j++)
+        Out[j - First] = In[i];
+      i++;
+    }
+    n += abs(Run);
+  }
+  if (First + Count < Total)
+    return (n >= First + Count);
+  return (i == NIn && n == Total);
+}
+
+/*****************************************************************************
+  CreateCheckpoint()
+
+  Create the checkpoint file for the state at Now.  The fields are added
+  with PutCheckpointField() and PutCheckpointMap() and the file is finished
+  by CloseCheckpoint().  With MPI the checkpoint is created on all processes,
+  but only the first one writes the file.
+*****************************************************************************/
+CHECKPOINT *CreateCheckpoint(char *Path, DATE *Now, MAPSIZE *Map,
+                             int Compress)
+{
+  CHECKPOINT *Ckp;
+
+  if (!(Ckp = (CHECKPOINT *) calloc(1, sizeof(CHECKPOINT))))
+    ReportError("CreateCheckpoint", 1);
+
+  CheckpointName(Ckp->FileName, Path, Now);
+  sprintf(Ckp->TempName, "%s.tmp", Ckp->FileName);
+  Ckp->Compress = Compress;
+  if (WholeMap(Map) == NULL)
+    return Ckp;
+  OpenFile(&(Ckp->File), Ckp->TempName, "wb", TRUE);
+
+  memcpy(Ckp->Header.Magic, "DHSVMCKP", 8);
+  Ckp->Header.Version = CKPVERSION;
+  Ckp->Header.NY = Map->GlobalNY;
+  Ckp->Header.NX = Map->NX;
+  Ckp->Header.Date[0] = Now->Year;
+  Ckp->Header.Date[1] = Now->Month;
+  Ckp->Header.Date[2] = Now->Day;
+  Ckp->Header.Date[3] = Now->Hour;
+  Ckp->Header.Date[4] = Now->Min;
+  Ckp->Header.Date[5] = Now->Sec;
+
+  /* the header is written again once the table is known */
+  if (fwrite(&(Ckp->Header), sizeof(CKPHEADER), 1, Ckp->File) != 1)
+    ReportError(Ckp->TempName, 41);
+
+  return Ckp;
+}
+
+/*****************************************************************************
+  PutCheckpointField()
+
+  Add a field of Count 4-byte values to a checkpoint that is being written.
+  Does nothing on the MPI processes that do not write the file.
+*****************************************************************************/
+void PutCheckpointField(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                        int Count)
+{
+  static const char Zero[CKPALIGN] = { 0 };
+  CKPFIELD *Field;
+  unsigned int *Runs = NULL;
+  long Offset;
+  int NRuns = -1;
+
+  if (Ckp->File == NULL)
+    return;
+
+  if (Ckp->Header.NFields == Ckp->MaxFields) {
+    Ckp->MaxFields = (Ckp->MaxFields > 0) ? 2 * Ckp->MaxFields : 32;
+    if (!(Ckp->Field = (CKPFIELD *) realloc(Ckp->Field,
+                                          Ckp->MaxFields * sizeof(CKPFIELD))))
+      ReportError("PutCheckpointField", 1);
+  }
+  Field = &(Ckp->Field[Ckp->Header.NFields++]);
+
+  /* start the field on an aligned offset */
+  Offset = ftell(Ckp->File);
+  if (Offset % CKPALIGN != 0) {
+    if (fwrite(Zero, 1, CKPALIGN - Offset % CKPALIGN, Ckp->File) !=
+        (size_t) (CKPALIGN - Offset % CKPALIGN))
+      ReportError(Ckp->TempName, 41);
+    Offset += CKPALIGN - Offset % CKPALIGN;
+  }
+
+  if (Ckp->Compress && Count > 0) {
+    if (!(Runs = (unsigned int *) malloc(Count * sizeof(unsigned int))))
+      ReportError("PutCheckpointField", 1);
+    NRuns = EncodeRuns((unsigned int *) Values, Count, Runs);
+  }
+
+  Field->ID = ID;
+  Field->Layer = Layer;
+  Field->Count = Count;
+  Field->Offset = Offset;
+  if (NRuns > 0) {
+    Field->Encoding = CKPRUNS;
+    Field->Size = (long long) NRuns * sizeof(unsigned int);
+    if (fwrite(Runs, sizeof(unsigned int), NRuns, Ckp->File) != (size_t) NRuns)
+      ReportError(Ckp->TempName, 41);
+  }
+  else {
+    Field->Encoding = CKPRAW;
+    Field->Size = (long long) Count * sizeof(unsigned int);
+    if (fwrite(Values, sizeof(unsigned int), Count, Ckp->File) != (size_t) Count)
+      ReportError(Ckp->TempName, 41);
+  }
+
+  free(Runs);
+}
+
+/*****************************************************************************
+  PutCheckpointMap()
+
+  Add a map of 4-byte values to a checkpoint that is being written.  Map is
+  the model area of this process; with MPI the bands of all processes are
+  collected into the map of the whole grid, so all processes have to call
+  it.
+*****************************************************************************/
+void PutCheckpointMap(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                      MAPSIZE *Map)
+{
+  MAPSIZE *Whole;
+  void *WholeValues;
+
+  Whole = WholeMap(Map);
+  if (Whole == Map) {
+    PutCheckpointField(Ckp, ID, Layer, Values, Map->NY * Map->NX);
+    return;
+  }
+
+  WholeValues = NULL;
+  if (Whole != NULL &&
+      !(WholeValues = malloc((size_t) Whole->NY * Whole->NX *
+                             sizeof(unsigned int))))
+    ReportError("PutCheckpointMap", 1);
+  GatherMap(Values, WholeValues, sizeof(unsigned int), Map);
+  if (Whole != NULL)
+    PutCheckpointField(Ckp, ID, Layer, WholeValues, Whole->NY * Whole->NX);
+  free(WholeValues);
+}
+
+/*****************************************************************************
+  OpenCheckpoint()
+
+  Open the checkpoint file for the state at Now and map it into memory (or
+  read it, where mmap() is not available).  Returns NULL if there is no
+  checkpoint for that time.
+*****************************************************************************/
+CHECKPOINT *OpenCheckpoint(char *Path, DATE *Now, MAPSIZE *Map)
+{
+  CHECKPOINT *Ckp;
+  FILE *InFile;
+  int i;
+#ifdef HAVE_MMAP
+  struct stat Stat;
+  int fd;
+#endif
+
+  if (!(Ckp = (CHECKPOINT *) calloc(1, sizeof(CHECKPOINT))))
+    ReportError("OpenCheckpoint", 1);
+  CheckpointName(Ckp->FileName, Path, Now);
+
+  if (!(InFile = fopen(Ckp->FileName, "rb"))) {
+    free(Ckp);
+    return NULL;
+  }
+
+#ifdef HAVE_MMAP
+  if ((fd = fileno(InFile)) != -1 && fstat(fd, &Stat) == 0 &&
+      Stat.st_size > 0) {
+    Ckp->Size = (size_t) Stat.st_size;
+    Ckp->Data = (unsigned char *) mmap(NULL, Ckp->Size, PROT_READ,
+                                       MAP_PRIVATE, fd, 0);
+    if (Ckp->Data == (unsigned char *) MAP_FAILED)
+      Ckp->Data = NULL;
+    else
+      Ckp->Mapped = TRUE;
+  }
+#endif
+
+  if (Ckp->Data == NULL) {
+    fseek(InFile, 0, SEEK_END);
+    Ckp->Size = (size_t) ftell(InFile);
+    rewind(InFile);
+    if (!(Ckp->Data = (unsigned char *) malloc(Ckp->Size + 1)))
+      ReportError("OpenCheckpoint", 1);
+    if (fread(Ckp->Data, 1, Ckp->Size, InFile) != Ckp->Size)
+      ReportError(Ckp->FileName, 73);
+  }
+  fclose(InFile);
+
+  if (Ckp->Size < sizeof(CKPHEADER))
+    ReportError(Ckp->FileName, 73);
+  memcpy(&(Ckp->Header), Ckp->Data, sizeof(CKPHEADER));
+  if (strncmp(Ckp->Header.Magic, "DHSVMCKP", 8) != 0 ||
+      Ckp->Header.Version != CKPVERSION || Ckp->Header.NFields < 0 ||
+      Ckp->Header.TableOffset < (long long) sizeof(CKPHEADER) ||
+      Ckp->Header.TableOffset + (long long) Ckp->Header.NFields *
+      (long long) sizeof(CKPFIELD) > (long long) Ckp->Size)
+    ReportError(Ckp->FileName, 73);
+  if (Ckp->Header.NY != Map->GlobalNY || Ckp->Header.NX != Map->NX)
+    ReportError(Ckp->FileName, 73);
+
+  if (!(Ckp->Field = (CKPFIELD *) malloc((Ckp->Header.NFields + 1) *
+                                         sizeof(CKPFIELD))))
+    ReportError("OpenCheckpoint", 1);
+  memcpy(Ckp->Field, Ckp->Data + Ckp->Header.TableOffset,
+         Ckp->Header.NFields * sizeof(CKPFIELD));
+  for (i = 0; i < Ckp->Header.NFields; i++)
+    if (Ckp->Field[i].Offset < 0 || Ckp->Field[i].Size < 0 ||
+        Ckp->Field[i].Offset + Ckp->Field[i].Size > Ckp->Header.TableOffset)
+      ReportError(Ckp->FileName, 73);
+
+  return Ckp;
+}
+
+/*****************************************************************************
+  FindField()
+*****************************************************************************/
+static CKPFIELD *FindField(CHECKPOINT *Ckp, int ID, int Layer)
+{
+  char Str[BUFSIZE + 64];
+  int i;
+
+  for (i = 0; i < Ckp->Header.NFields; i++)
+    if (Ckp->Field[i].ID == ID && Ckp->Field[i].Layer == Layer)
+      return &(Ckp->Field[i]);
+
+  snprintf(Str, sizeof(Str), "%s (ID %d, layer %d)", Ckp->FileName, ID,
+           Layer);
+  ReportError(Str, 74);
+  return NULL;
+}
+
+/*****************************************************************************
+  GetCheckpointCount()
+
+  Number of values of a field in a checkpoint that is being read
+*****************************************************************************/
+int GetCheckpointCount(CHECKPOINT *Ckp, int ID, int Layer)
+{
+  return FindField(Ckp, ID, Layer)->Count;
+}
+
+/*****************************************************************************
+  GetCheckpointField()
+
+  Copy a field of Count 4-byte values from a checkpoint that is being read
+*****************************************************************************/
+void GetCheckpointField(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                        int Count)
+{
+  CKPFIELD *Field;
+
+  Field = FindField(Ckp, ID, Layer);
+  if (Field->Count != Count)
+    ReportError(Ckp->FileName, 73);
+
+  if (Field->Encoding == CKPRAW) {
+    if (Field->Size != (long long) (Count * sizeof(unsigned int)))
+      ReportError(Ckp->FileName, 73);
+    memcpy(Values, Ckp->Data + Field->Offset, Field->Size);
+  }
+  else if (Field->Encoding != CKPRUNS ||
+           Field->Offset % sizeof(unsigned int) != 0 ||
+           !DecodeRuns((unsigned int *) (Ckp->Data + Field->Offset),
+                       (size_t) Field->Size, (unsigned int *) Values, 0,
+                       Count, Count))
+    ReportError(Ckp->FileName, 73);
+}
+
+/*****************************************************************************
+  GetCheckpointMap()
+
+  Copy the rows of a map of 4-byte values that this process holds from a
+  checkpoint that is being read.  Map is the model area of this process.
+*****************************************************************************/
+void GetCheckpointMap(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                      MAPSIZE *Map)
+{
+  CKPFIELD *Field;
+  int First = Map->GlobalY0 * Map->NX;
+  int Count = Map->NY * Map->NX;
+
+  Field = FindField(Ckp, ID, Layer);
+  if (Field->Count != Map->GlobalNY * Map->NX)
+    ReportError(Ckp->FileName, 73);
+
+  if (Field->Encoding == CKPRAW) {
+    if (Field->Size != (long long) (Field->Count * sizeof(unsigned int)))
+      ReportError(Ckp->FileName, 73);
+    memcpy(Values, Ckp->Data + Field->Offset + First * sizeof(unsigned int),
+           Count * sizeof(unsigned int));
+  }
+  else if (Field->Encoding != CKPRUNS ||
+           Field->Offset % sizeof(unsigned int) != 0 ||
+           !DecodeRuns((unsigned int *) (Ckp->Data + Field->Offset),
+                       (size_t) Field->Size, (unsigned int *) Values, First,
+                       Count, Field->Count))
+    ReportError(Ckp->FileName, 73);
+}
+
+/*****************************************************************************
+  CloseCheckpoint()
+
+  Finish a checkpoint that is being written, by adding the table of fields
+  and the header, or release one that has been read.  Does nothing for a
+  NULL checkpoint.
+
+  A checkpoint is written under a temporary name and only gets its own
+  name once it is complete, so that a run that stops while writing it
+  does not leave a truncated checkpoint to restart from.
+*****************************************************************************/
+void CloseCheckpoint(CHECKPOINT *Ckp)
+{
+  if (Ckp == NULL)
+    return;
+
+  if (Ckp->File != NULL) {
+    fseek(Ckp->File, 0, SEEK_END);
+    Ckp->Header.TableOffset = ftell(Ckp->File);
+    if (fwrite(Ckp->Field, sizeof(CKPFIELD), Ckp->Header.NFields, Ckp->File) !=
+        (size_t) Ckp->Header.NFields)
+      ReportError(Ckp->TempName, 41);
+    rewind(Ckp->File);
+    if (fwrite(&(Ckp->Header), sizeof(CKPHEADER), 1, Ckp->File) != 1)
+      ReportError(Ckp->TempName, 41);
+    if (fclose(Ckp->File) != 0)
+      ReportError(Ckp->TempName, 41);
+    if (rename(Ckp->TempName, Ckp->FileName) != 0)
+      ReportError(Ckp->TempName, 41);
+  }
+#ifdef HAVE_MMAP
+  else if (Ckp->Mapped)
+    munmap(Ckp->Data, Ckp->Size);
+#endif
+  else
+    free(Ckp->Data);
+
+  free(Ckp->Field);
+  free(Ckp);
+}
@@ -28,7 +28,7 @@
    -------------------------------------------------------------------------- */
 void
 InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
-	    SOILPIX ** SoilMap, int *MaxStreamID, int *MaxRoadID, OPTIONSTRUCT *Options)
+	    SOILFLOWMAP *SoilFlow, int *MaxStreamID, int *MaxRoadID, OPTIONSTRUCT *Options)
 {
   int i;
   STRINIENTRY StrEnv[] = {
@@ -64,11 +64,15 @@ InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
   channel->road_class = NULL;
   channel->streams = NULL;
   channel->roads = NULL;
+  channel->stream_index = NULL;
+  channel->road_index = NULL;
+  channel->stream_schedule = NULL;
+  channel->road_schedule = NULL;
   channel->stream_map = NULL;
   channel->road_map = NULL;
 
   channel_init();
-  channel_grid_init(Map->NX, Map->NY);
+  channel_grid_init(Map->NX, Map->NY, Map->GlobalY0, Map->GlobalNY);
 
   if (strncmp(StrEnv[stream_class].VarStr, "none", 4)) {
 
@@ -83,20 +87,28 @@ InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
 			      channel->stream_class, MaxStreamID)) == NULL) {
       ReportError(StrEnv[stream_network].VarStr, 5);
     }
+    if ((channel->stream_index =
+	 channel_index_network(channel->streams)) == NULL) {
+      ReportError(StrEnv[stream_network].VarStr, 5);
+    }
     if ((channel->stream_map =
-	 channel_grid_read_map(channel->streams,
-			       StrEnv[stream_map].VarStr, SoilMap)) == NULL) {
+	 channel_grid_read_map(channel->stream_index,
+			       StrEnv[stream_map].VarStr, SoilFlow->Depth)) == NULL) {
       ReportError(StrEnv[stream_map].VarStr, 5);
     }
     error_handler(ERRHDL_STATUS,
 		  "InitChannel: computing stream network routing coefficients");
     channel_routing_parameters(channel->streams, (double) deltat);
+    if ((channel->stream_schedule =
+	 channel_schedule_network(channel->streams)) == NULL) {
+      ReportError(StrEnv[stream_network].VarStr, 5);
+    }
   }
 
   if (Options->StreamTemp) {
 	if (strncmp(StrEnv[riparian_veg].VarStr, "none", 4)) {
 	  printf("\tReading channel riparian vegetation params\n");
-	  channel_read_rveg_param(channel->streams, StrEnv[riparian_veg].VarStr, MaxStreamID);
+	  channel_read_rveg_param(channel->stream_index, StrEnv[riparian_veg].VarStr, MaxStreamID);
 	}
   }
 
@@ -105,7 +117,7 @@ InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
     printf("\tReading Road data\n");
 
     if ((channel->road_class =
-	 channel_read_classes(StrEnv[road_class].VarStr, road_class) == NULL)) {
+	 channel_read_classes(StrEnv[road_class].VarStr, road_class)) == NULL) {
       ReportError(StrEnv[road_class].VarStr, 5);
     }
     if ((channel->roads =
@@ -113,14 +125,22 @@ InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
 			      channel->road_class, MaxRoadID)) == NULL) {
       ReportError(StrEnv[road_network].VarStr, 5);
     }
+    if ((channel->road_index =
+	 channel_index_network(channel->roads)) == NULL) {
+      ReportError(StrEnv[road_network].VarStr, 5);
+    }
     if ((channel->road_map =
-	 channel_grid_read_map(channel->roads,
-			       StrEnv[road_map].VarStr, SoilMap)) == NULL) {
+	 channel_grid_read_map(channel->road_index,
+			       StrEnv[road_map].VarStr, SoilFlow->Depth)) == NULL) {
       ReportError(StrEnv[road_map].VarStr, 5);
     }
     error_handler(ERRHDL_STATUS,
 		  "InitChannel: computing road network routing coefficients");
     channel_routing_parameters(channel->roads, (double) deltat);
+    if ((channel->road_schedule =
+	 channel_schedule_network(channel->roads)) == NULL) {
+      ReportError(StrEnv[road_network].VarStr, 5);
+    }
   }
 }
 
@@ -132,6 +152,10 @@ void InitChannelDump(OPTIONSTRUCT *Options, CHANNEL * channel,
 {
   char buffer[NAMESIZE];
 
+  /* only the first MPI process writes the channel output */
+  if (ParallelRank() != 0)
+    return;
+
   if (channel->streams != NULL) {
     sprintf(buffer, "%sStream.Flow", DumpPath);
     OpenFile(&(channel->streamout), buffer, "w", TRUE);
@@ -195,71 +219,78 @@ double ChannelCulvertFlow(int y, int x, CHANNEL * ChannelData)
    ------------------------------------------------------------- */
 void
 RouteChannel(CHANNEL *ChannelData, TIMESTRUCT *Time, MAPSIZE *Map,
-	    TOPOPIX **TopoMap, SOILPIX **SoilMap, AGGREGATED *Total, 
-	     OPTIONSTRUCT *Options, ROADSTRUCT **Network, SOILTABLE *SType, 
-		 PRECIPPIX **PrecipMap, float Tair, float Rh, SNOWPIX **SnowMap)
+	    TOPOPIX **TopoMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+	     AGGREGATED *Total, OPTIONSTRUCT *Options, ROADSTRUCT **Network, SOILTABLE *SType, 
+		 PRECIPPIX **PrecipMap, SNOWPIX **SnowMap)
 {
-  int x, y;
+  int x, y, run;
   int flag;
   char buffer[32];
   float CulvertFlow;
   float temp;
+  float *IExcess;
 
   /* give any surface water to roads w/o sinks */
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
         if (channel_grid_has_channel(ChannelData->road_map, x, y) && 
           !channel_grid_has_sink(ChannelData->road_map, x, y)) {	/* road w/o sink */
-            SoilMap[y][x].RoadInt += SoilMap[y][x].IExcess; 
-          channel_grid_inc_inflow(ChannelData->road_map, x, y, SoilMap[y][x].IExcess * Map->DX * Map->DY);
-          SoilMap[y][x].IExcess = 0.0f;
+          IExcess = &(SoilFlow->IExcess[y * Map->NX + x]);
+          SoilMap[y][x].RoadInt += *IExcess;
+          channel_grid_inc_inflow(ChannelData->road_map, x, y, *IExcess * Map->DX * Map->DY);
+          *IExcess = 0.0f;
         }
       }
     }
   }
 
+  ForwardChannelIncrements(ChannelData);
+
   /* route the road network and save results */
   SPrintDate(&(Time->Current), buffer);
   flag = IsEqualTime(&(Time->Current), &(Time->Start));
   if (ChannelData->roads != NULL) {
-    channel_route_network(ChannelData->roads, Time->Dt);
+    RouteChannelNetwork(ChannelData->road_schedule, Time->Dt, TRUE);
     channel_save_outflow_text(buffer, ChannelData->roads,
 			      ChannelData->roadout, ChannelData->roadflowout, flag);
   }
   
-  /* add culvert outflow to surface water */
-  Total->CulvertReturnFlow = 0.0;
+  /* add culvert outflow to surface water.  The culvert flows of each cell
+     are added to the basin totals by Aggregate() */
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
 		CulvertFlow = ChannelCulvertFlow(y, x, ChannelData);
 		CulvertFlow /= Map->DX * Map->DY;
+		IExcess = &(SoilFlow->IExcess[y * Map->NX + x]);
 		
 		/* CulvertFlow = (CulvertFlow > 0.0) ? CulvertFlow : 0.0; */
 		if (channel_grid_has_channel(ChannelData->stream_map, x, y)) {
 		  channel_grid_inc_inflow(ChannelData->stream_map, x, y,
-				  (SoilMap[y][x].IExcess + CulvertFlow) * Map->DX * Map->DY);
+				  (*IExcess + CulvertFlow) * Map->DX * Map->DY);
 
-		  if (SnowMap[y][x].Outflow > SoilMap[y][x].IExcess)
-        temp = SoilMap[y][x].IExcess;
+		  if (SnowMap[y][x].Outflow > *IExcess)
+        temp = *IExcess;
 		  else
         temp = SnowMap[y][x].Outflow;
 		  channel_grid_inc_melt(ChannelData->stream_map, x, y, temp * Map->DX * Map->DY);                                                                                  
-		  SoilMap[y][x].ChannelInt += SoilMap[y][x].IExcess;
-		  Total->CulvertToChannel += CulvertFlow;
-		  SoilMap[y][x].IExcess = 0.0f;
+		  SoilMap[y][x].ChannelInt += *IExcess;
+		  SoilMap[y][x].CulvertToChannel += CulvertFlow;
+		  *IExcess = 0.0f;
 		}
 		else {
-		  SoilMap[y][x].IExcess += CulvertFlow;
-		  Total->CulvertReturnFlow += CulvertFlow;
+		  *IExcess += CulvertFlow;
+		  SoilMap[y][x].CulvertReturnFlow += CulvertFlow;
 		}
       }
     }
   }
+  ForwardChannelIncrements(ChannelData);
+
   /* route stream channels */
   if (ChannelData->streams != NULL) {
-    channel_route_network(ChannelData->streams, Time->Dt);
+    RouteChannelNetwork(ChannelData->stream_schedule, Time->Dt, FALSE);
     channel_save_outflow_text(buffer, ChannelData->streams,
 			      ChannelData->streamout,
 			      ChannelData->streamflowout, flag);
@@ -27,6 +27,10 @@ typedef struct {
   ChannelClass *road_class;
   Channel *streams;
   Channel *roads;
+  ChannelIndex *stream_index;
+  ChannelIndex *road_index;
+  ChannelSchedule *stream_schedule;
+  ChannelSchedule *road_schedule;
   ChannelMapPtr **stream_map;
   ChannelMapPtr **road_map;
   FILE *streamout;
@@ -44,17 +48,35 @@ typedef struct {
   FILE *streamMelt;
 } CHANNEL;
 
+/* -------------------------------------------------------------
+   struct ENSEMBLEMEMBER
+   What is kept for each member of an ensemble run: its model state,
+   its output files and its basin totals.  The channel network
+   itself is shared, but each member writes its own channel output
+   files, so each member has a copy of CHANNEL.
+   ------------------------------------------------------------- */
+typedef struct {
+  float PrecipFactor;		/* factor by which the precipitation is scaled */
+  char OutputPath[BUFSIZE + 1];	/* output directory, empty for the first
+				   member */
+  DUMPSTRUCT Dump;		/* output files */
+  CHANNEL ChannelData;		/* channel network and output files */
+  AGGREGATED Total;		/* basin totals */
+  SNAPSHOT *State;		/* model state between time steps, NULL if
+				   there is only one member */
+} ENSEMBLEMEMBER;
+
 /* -------------------------------------------------------------
    available functions
    ------------------------------------------------------------- */
 void InitChannel(LISTPTR Input, MAPSIZE *Map, int deltat, CHANNEL *channel,
-		 SOILPIX **SoilMap, int *MaxStreamID, int *MaxRoadID, OPTIONSTRUCT *Options);
+		 SOILFLOWMAP *SoilFlow, int *MaxStreamID, int *MaxRoadID, OPTIONSTRUCT *Options);
 void InitChannelDump(OPTIONSTRUCT *Options, CHANNEL *channel, char *DumpPath);
 double ChannelCulvertFlow(int y, int x, CHANNEL *ChannelData);
 void RouteChannel(CHANNEL *ChannelData, TIMESTRUCT *Time, MAPSIZE *Map,
-		  TOPOPIX **TopoMap, SOILPIX **SoilMap, AGGREGATED *Total, 
-		  OPTIONSTRUCT *Options, ROADSTRUCT **Network, SOILTABLE *SType, 
-		  PRECIPPIX **PrecipMap, float Tair, float Rh, SNOWPIX **SnowMap);
+		  TOPOPIX **TopoMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+		  AGGREGATED *Total, OPTIONSTRUCT *Options, ROADSTRUCT **Network, SOILTABLE *SType, 
+		  PRECIPPIX **PrecipMap, SNOWPIX **SnowMap);
 void ChannelCut(int y, int x, CHANNEL *ChannelData, ROADSTRUCT *Network);
 uchar ChannelFraction(TOPOPIX *topo, ChannelMapRec *rds);
 
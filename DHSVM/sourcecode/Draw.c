@@ -40,7 +40,8 @@ extern int e, ndx;
 
 void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
           int *which_graphics, VEGTABLE *VType, SOILTABLE *SType, SNOWPIX **SnowMap, 
-          SOILPIX **SoilMap, VEGPIX **VegMap, TOPOPIX **TopoMap, PRECIPPIX **PrecipMap, 
+          SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap,
+          TOPOPIX **TopoMap, PRECIPPIX **PrecipMap, 
           float **PrismMap, float **SkyViewMap, unsigned char ***ShadowMap, 
           EVAPPIX **EvapMap, PIXRAD **RadMap, MET_MAP_PIX **MetMap, 
           ROADSTRUCT **Network, OPTIONSTRUCT *Options)
@@ -136,7 +137,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
             for (i = 0; i < Map->NX; i++) {
               for (j = 0; j < Map->NY; j++) {
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].TableDepth * 1000.0;
+                  temp = SoilFlow->TableDepth[j * Map->NX + i] * 1000.0;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -204,7 +205,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
             for (i = 0; i < Map->NX; i++) {
               for (j = 0; j < Map->NY; j++) {
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].Depth * 1000.;
+                  temp = SoilFlow->Depth[j * Map->NX + i] * 1000.;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -360,7 +361,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
             for (i = 0; i < Map->NX; i++) {
               for (j = 0; j < Map->NY; j++) {
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].SatFlow * 1000.0;;
+                  temp = SoilFlow->SatFlow[j * Map->NX + i] * 1000.0;;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -379,7 +380,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
             for (i = 0; i < Map->NX; i++) {
               for (j = 0; j < Map->NY; j++) {
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].Runoff * 1000.0;
+                  temp = SoilFlow->Runoff[j * Map->NX + i] * 1000.0;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -618,7 +619,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
               for (j = 0; j < Map->NY; j++) {
 
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].IExcess * 1000.0;
+                  temp = SoilFlow->IExcess[j * Map->NX + i] * 1000.0;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -636,7 +637,7 @@ void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
               for (j = 0; j < Map->NY; j++) {
 
                 if (INBASIN(TopoMap[j][i].Mask)) {
-                  temp = SoilMap[j][i].TableDepth * 1000.0;
+                  temp = SoilFlow->TableDepth[j * Map->NX + i] * 1000.0;
                   if (temp > max)
                     max = temp;
                   if (temp < min)
@@ -0,0 +1,206 @@
+/*
+ * SUMMARY:      Ensemble.c - Run several ensemble members in one process
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  An ensemble run advances a number of members from the same
+ *               initial state, with the same forcing, in one process.  The
+ *               members share everything that does not change during the
+ *               run (the terrain, soil and vegetation maps and tables, the
+ *               shadow and sky view maps, the interpolation weights and the
+ *               channel network), as well as the forcing that is read and
+ *               interpolated at each time step.  Each member keeps its own
+ *               model state, output files and basin totals.  The members
+ *               differ in the factor by which the precipitation is scaled.
+ * DESCRIP-END.
+ * FUNCTIONS:    ReadEnsemble()
+ *               InitEnsemble()
+ *               LoadMember()
+ *               SaveMember()
+ * COMMENTS:
+ *   The model works on one state at a time.  At each time step the state of
+ *   each member in turn is loaded, advanced and saved again, using the
+ *   snapshots of Snapshot.c.  With a single member nothing is copied.
+ *
+ *   The ensemble keys are in the [OPTIONS] section:
+ *     Ensemble Members = <number of members>
+ *     Ensemble Precipitation Factor <n> = <factor for member n>
+ *     Ensemble Output Directory <n> = <output directory of member n>
+ *   The first member writes to the output directory in the [OUTPUT] section,
+ *   every other member needs its own output directory.  The precipitation
+ *   factor is 1 if it is not given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "DHSVMChannel.h"
+#include "functions.h"
+#include "getinit.h"
+
+/*****************************************************************************
+  ReadEnsemble()
+
+  Read the precipitation factor and output directory of each ensemble
+  member from the input file.  This is done before any output file is
+  opened, so that an error in the keys of a member does not leave the
+  output files of the other members truncated.
+*****************************************************************************/
+void ReadEnsemble(LISTPTR Input, OPTIONSTRUCT *Options,
+  ENSEMBLEMEMBER **Members)
+{
+  const char *Routine = "ReadEnsemble";
+  char KeyName[BUFSIZE + 1];
+  char VarStr[BUFSIZE + 1];
+  ENSEMBLEMEMBER *Member;
+  int i;
+
+  if (!((*Members) = (ENSEMBLEMEMBER *) calloc(Options->EnsembleMembers,
+					       sizeof(ENSEMBLEMEMBER))))
+    ReportError((char *) Routine, 1);
+
+  for (i = 0; i < Options->EnsembleMembers; i++) {
+    Member = &((*Members)[i]);
+
+    sprintf(KeyName, "ENSEMBLE PRECIPITATION FACTOR %d", i + 1);
+    GetInitString("OPTIONS", KeyName, "1.0", VarStr, (unsigned long) BUFSIZE,
+		  Input);
+    if (!CopyFloat(&(Member->PrecipFactor), VarStr, 1) ||
+	Member->PrecipFactor < 0.0)
+      ReportError(KeyName, 51);
+
+    if (i > 0) {
+      sprintf(KeyName, "ENSEMBLE OUTPUT DIRECTORY %d", i + 1);
+      GetInitString("OPTIONS", KeyName, "", Member->OutputPath,
+		    (unsigned long) BUFSIZE, Input);
+      if (IsEmptyStr(Member->OutputPath))
+	ReportError(KeyName, 51);
+    }
+  }
+}
+
+/*****************************************************************************
+  InitEnsemble()
+
+  Open the output files of all ensemble members but the first, which uses
+  Dump and ChannelData.  This has to be done after the output of the first
+  member is initialized, and after the members are read by ReadEnsemble().
+*****************************************************************************/
+void InitEnsemble(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+  int MaxSoilLayers, int MaxVegLayers, int Dt, TOPOPIX **TopoMap,
+  DUMPSTRUCT *Dump, CHANNEL *ChannelData, AGGREGATED *Total,
+  ENSEMBLEMEMBER *Members)
+{
+  ENSEMBLEMEMBER *Member;
+  int NGraphics;		/* graphics are only drawn for the first member */
+  int *which_graphics = NULL;
+  int i;
+
+  if (Options->EnsembleMembers > 1)
+    printf("Running %d ensemble members\n", Options->EnsembleMembers);
+
+  for (i = 0; i < Options->EnsembleMembers; i++) {
+    Member = &(Members[i]);
+
+    if (i == 0) {
+      Member->Dump = *Dump;
+      Member->ChannelData = *ChannelData;
+      Member->Total = *Total;
+    }
+    else {
+      InitDump(Input, Options, Map, MaxSoilLayers, MaxVegLayers, Dt, TopoMap,
+	       &(Member->Dump), &NGraphics, &which_graphics,
+	       Member->OutputPath);
+
+      /* the network is shared, the output files are not */
+      Member->ChannelData = *ChannelData;
+      Member->ChannelData.streamout = NULL;
+      Member->ChannelData.roadout = NULL;
+      Member->ChannelData.streamflowout = NULL;
+      Member->ChannelData.roadflowout = NULL;
+      Member->ChannelData.streaminflow = NULL;
+      Member->ChannelData.streamoutflow = NULL;
+      Member->ChannelData.streamNSW = NULL;
+      Member->ChannelData.streamNLW = NULL;
+      Member->ChannelData.streamVP = NULL;
+      Member->ChannelData.streamWND = NULL;
+      Member->ChannelData.streamATP = NULL;
+      Member->ChannelData.streamMelt = NULL;
+#ifndef SNOW_ONLY
+      if (Options->HasNetwork == TRUE)
+	InitChannelDump(Options, &(Member->ChannelData), Member->Dump.Path);
+#endif
+
+      /* the totals start from those of the first member, in arrays of
+	 their own */
+      Member->Total = *Total;
+      InitAggregated(Options, MaxVegLayers, MaxSoilLayers, &(Member->Total));
+    }
+    Member->State = NULL;
+
+    if (Options->EnsembleMembers > 1)
+      printf("Member %d: precipitation factor %g, output to %s\n", i + 1,
+	     Member->PrecipFactor, Member->Dump.Path);
+  }
+}
+
+/*****************************************************************************
+  LoadMember()
+
+  Make the output files, basin totals and model state of an ensemble member
+  the current ones
+*****************************************************************************/
+void LoadMember(ENSEMBLEMEMBER *Member, DUMPSTRUCT *Dump, AGGREGATED *Total,
+  MAPSIZE *Map, OPTIONSTRUCT *Options, TIMESTRUCT *Time, LAYER *Soil,
+  LAYER *Veg, EVAPPIX **EvapMap, PIXRAD **RadMap, PRECIPPIX **PrecipMap,
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  *Dump = Member->Dump;
+  *ChannelData = Member->ChannelData;
+  *Total = Member->Total;
+
+  if (Member->State != NULL)
+    RestoreSnapshot(Member->State, Map, Options, Time, Soil, Veg, EvapMap,
+		    RadMap, PrecipMap, SnowMap, SoilMap, SoilFlow,
+		    VegMap, Network, ChannelData,
+		    HydrographInfo, Hydrograph, Mass);
+}
+
+/*****************************************************************************
+  SaveMember()
+
+  Keep the current output files, basin totals and model state for an
+  ensemble member.  The model state is only kept if there is more than one
+  member.
+*****************************************************************************/
+void SaveMember(ENSEMBLEMEMBER *Member, DUMPSTRUCT *Dump, AGGREGATED *Total,
+  MAPSIZE *Map, OPTIONSTRUCT *Options, TIMESTRUCT *Time, LAYER *Soil,
+  LAYER *Veg, EVAPPIX **EvapMap, PIXRAD **RadMap, PRECIPPIX **PrecipMap,
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  Member->Dump = *Dump;
+  Member->ChannelData = *ChannelData;
+  Member->Total = *Total;
+
+  if (Options->EnsembleMembers == 1)
+    return;
+
+  if (Member->State == NULL)
+    Member->State = TakeSnapshot(Map, Options, Time, Soil, Veg, EvapMap,
+				 RadMap, PrecipMap, SnowMap, SoilMap, SoilFlow,
+				 VegMap, Network, ChannelData,
+				 HydrographInfo, Hydrograph, Mass);
+  else
+    UpdateSnapshot(Member->State, Map, Options, Time, Soil, Veg, EvapMap,
+		   RadMap, PrecipMap, SnowMap, SoilMap, SoilFlow,
+		   VegMap, Network, ChannelData,
+		   HydrographInfo, Hydrograph, Mass);
+}
@@ -11,10 +11,12 @@
 * FUNCTIONS:    ExecDump()
 *               DumpMap()
 *               DumpPix()
-* COMMENTS:
+* COMMENTS:     The maps and the text are written through the output queue
+*               (see Output.c)
 * $Id: ExecDump.c, v 4.0  2018/1/25   Ning Exp $
 */
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,6 +29,20 @@
 #include "constants.h"
 #include "varid.h"
 
+#define MAXPIXCOLUMNS 256	/* Most values in a pixel dump record */
+#define PIXBINVERSION 1		/* Version of the binary pixel dump format */
+
+/* Values of a pixel dump record, with the format in which each is printed
+   in the text output */
+typedef struct {
+  int N;			/* Number of values */
+  int First;			/* TRUE for the first record of the file */
+  const char *Format[MAXPIXCOLUMNS];
+  float Value[MAXPIXCOLUMNS];
+  char Name[MAXPIXCOLUMNS][MAXSTRING + 1];	/* Only for the first record */
+  char Header[MAXPIXCOLUMNS * 32];	/* Only for the first record */
+} PIXROW;
+
 /*****************************************************************************
 ExecDump()
 *****************************************************************************/
@@ -34,7 +50,7 @@ void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
   DUMPSTRUCT *Dump, TOPOPIX **TopoMap, EVAPPIX **EvapMap,
   PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
   MET_MAP_PIX **MetMap, VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap,
-  ROADSTRUCT **Network, CHANNEL *ChannelData, LAYER *Soil,
+  SOILFLOWMAP *SoilFlow, ROADSTRUCT **Network, CHANNEL *ChannelData, LAYER *Soil,
   AGGREGATED *Total, UNITHYDRINFO *HydrographInfo,
   float *Hydrograph)
 {
@@ -43,36 +59,53 @@ void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
   int x;
   int y;
   int flag;
+  CHECKPOINT *Checkpoint;	/* Single file for the model state, if used */
+
+  /* with MPI all processes go through the dumps: the state and the maps
+     are collected and written by the first process, the aggregated values
+     are only written there, and each dumped pixel is written by the
+     process that computes it (see InitPixDump()) */
 
   /* dump the aggregated basin values for this timestep */
 
   flag = 1;
   DumpPix(Current, IsEqualTime(Current, Start), &(Dump->Aggregate),
     &(Total->Evap), &(Total->Precip), &(Total->Rad), &(Total->Snow),
-    &(Total->Soil), &(Total->Veg), Soil->MaxLayers, Veg->MaxLayers,
-    Options, flag);
-
-  fprintf(Dump->Aggregate.FilePtr, "\n");
+    &(Total->Soil), Total->IExcess, Total->TableDepth, Total->SatFlow,
+    &(Total->Veg), Soil->MaxLayers, Veg->MaxLayers,
+    Options, flag, Dump->PixFormat);
 
   if (Options->Extent != POINT) {
     /* check whether the model state needs to be dumped at this timestep, and
     dump state if needed */
     if (Dump->NStates < 0) {
+      Checkpoint = NULL;
+      if (Options->StateFormat == CHECKPOINT_STATE)
+        Checkpoint = CreateCheckpoint(Dump->Path, Current, Map,
+          Options->StateCompression);
       StoreModelState(Dump->Path, Current, Map, Options, TopoMap, PrecipMap,
-        SnowMap, MetMap, VegMap, Veg, SoilMap, Soil,
-        Network, HydrographInfo, Hydrograph, ChannelData);
+        SnowMap, MetMap, VegMap, Veg, SoilMap, SoilFlow, Soil,
+        Network, HydrographInfo, Hydrograph, ChannelData, Checkpoint);
       if (Options->HasNetwork)
-        StoreChannelState(Dump->Path, Current, ChannelData->streams);
+        StoreChannelState(Dump->Path, Current, ChannelData->streams,
+          Checkpoint);
+      CloseCheckpoint(Checkpoint);
     }
     else {
       for (i = 0; i < Dump->NStates; i++) {
         if (IsEqualTime(Current, &(Dump->DState[i]))) {
+          Checkpoint = NULL;
+          if (Options->StateFormat == CHECKPOINT_STATE)
+            Checkpoint = CreateCheckpoint(Dump->Path, Current, Map,
+              Options->StateCompression);
           StoreModelState(Dump->Path, Current, Map, Options, TopoMap,
             PrecipMap, SnowMap, MetMap, VegMap, Veg,
-            SoilMap, Soil, Network, HydrographInfo, Hydrograph,
-            ChannelData);
+            SoilMap, SoilFlow, Soil, Network, HydrographInfo, Hydrograph,
+            ChannelData, Checkpoint);
           if (Options->HasNetwork)
-            StoreChannelState(Dump->Path, Current, ChannelData->streams);
+            StoreChannelState(Dump->Path, Current, ChannelData->streams,
+              Checkpoint);
+          CloseCheckpoint(Checkpoint);
         }
       }
     }
@@ -91,9 +124,11 @@ void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
       flag = 2;
       DumpPix(Current, IsEqualTime(Current, Start), &(Dump->Pix[i].OutFile),
         &(EvapMap[y][x]), &(PrecipMap[y][x]), &(RadMap[y][x]), &(SnowMap[y][x]),
-        &(SoilMap[y][x]), &(VegMap[y][x]), Soil->NLayers[(SoilMap[y][x].Soil - 1)],
-        Veg->NLayers[(VegMap[y][x].Veg - 1)], Options, flag);
-      fprintf(Dump->Pix[i].OutFile.FilePtr, "\n");
+        &(SoilMap[y][x]), SoilFlow->IExcess[y * Map->NX + x],
+        SoilFlow->TableDepth[y * Map->NX + x],
+        SoilFlow->SatFlow[y * Map->NX + x],
+        &(VegMap[y][x]), Soil->NLayers[(SoilMap[y][x].Soil - 1)],
+        Veg->NLayers[(VegMap[y][x].Veg - 1)], Options, flag, Dump->PixFormat);
     }
 
     /* check which maps need to be dumped at this timestep, and dump maps if needed */
@@ -104,12 +139,15 @@ void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
           PrintDate(Current, stdout);
           fprintf(stdout, "\n");
           DumpMap(Map, Current, &(Dump->DMap[i]), TopoMap, EvapMap,
-            PrecipMap, RadMap, SnowMap, SoilMap, Soil, VegMap,
+            PrecipMap, RadMap, SnowMap, SoilMap, SoilFlow, Soil, VegMap,
             Veg, Network, Options);
         }
       }
     }
   }
+
+  /* hand the text output of this timestep to the writer */
+  FlushOutput();
 }
 
 /*****************************************************************************
@@ -117,7 +155,7 @@ DumpMap()
 *****************************************************************************/
 void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
   EVAPPIX **EvapMap, PRECIPPIX **PrecipMap, PIXRAD **RadMap,
-  SNOWPIX **SnowMap, SOILPIX **SoilMap, LAYER *Soil,
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, LAYER *Soil,
   VEGPIX **VegMap, LAYER *Veg, ROADSTRUCT **Network,
   OPTIONSTRUCT *Options)
 {
@@ -151,29 +189,12 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
 
   switch (DMap->NumberType) {
   case NC_BYTE:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_BYTE))))
-      ReportError((char *)Routine, 1);
-    break;
   case NC_CHAR:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_CHAR))))
-      ReportError((char *)Routine, 1);
-    break;
   case NC_SHORT:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_SHORT))))
-      ReportError((char *)Routine, 1);
-    break;
   case NC_INT:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_INT))))
-      ReportError((char *)Routine, 1);
-    break;
-
   case NC_FLOAT:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_FLOAT))))
-      ReportError((char *)Routine, 1);
-    break;
   case NC_DOUBLE:
-    if (!(Array = calloc(numPoints, SizeOfNumberType(NC_DOUBLE))))
-      ReportError((char *)Routine, 1);
+    Array = GetMapBuffer(numPoints * SizeOfNumberType(DMap->NumberType));
     break;
   default:
     Array = NULL;
@@ -191,7 +212,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = EvapMap[y][x].ETot;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -199,7 +220,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((EvapMap[y][x].ETot - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap,
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap,
         Index);
     }
     else
@@ -227,7 +248,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -250,7 +271,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -274,7 +295,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++) {
@@ -296,7 +317,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -320,7 +341,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
               ((float *)Array)[y * Map->NX + x] = NA;
           }
         }
-        Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+        WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
       }
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -340,7 +361,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
               ((unsigned char *)Array)[y * Map->NX + x] = 0;
           }
         }
-        Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+        WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
       }
     }
     else
@@ -365,7 +386,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -388,7 +409,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -402,7 +423,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].Precip;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -411,7 +432,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((PrecipMap[y][x].Precip - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -432,7 +453,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -451,7 +472,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -473,7 +494,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -492,7 +513,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -506,7 +527,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = PrecipMap[y][x].SumPrecip;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -515,7 +536,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((PrecipMap[y][x].Precip - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -529,14 +550,14 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].ObsShortIn;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((RadMap[y][x].ObsShortIn - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
     }
     else
       ReportError(VarIDStr, 66);
@@ -548,7 +569,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].PixelNetShort;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -557,7 +578,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((RadMap[y][x].PixelNetShort - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -571,7 +592,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = RadMap[y][x].NetRadiation[0] + RadMap[y][x].NetRadiation[1];
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -579,7 +600,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((RadMap[y][x].NetRadiation[0] + RadMap[y][x].NetRadiation[1] - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -591,14 +612,14 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] = SnowMap[y][x].HasSnow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] = SnowMap[y][x].HasSnow;
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -611,7 +632,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           SnowMap[y][x].SnowCoverOver;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -619,7 +640,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           SnowMap[y][x].SnowCoverOver;
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -631,7 +652,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned short *)Array)[y * Map->NX + x] = SnowMap[y][x].LastSnow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -640,7 +661,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)(((float)SnowMap[y][x].LastSnow - Offset) / Range
             * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -652,7 +673,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Swq;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -660,7 +681,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].Swq - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -672,7 +693,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Melt;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -680,7 +701,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].Melt - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -692,7 +713,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].PackWater;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -701,7 +722,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].PackWater - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -713,7 +734,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].TPack;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -721,7 +742,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].TPack - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap,
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap,
         Index);
     }
     else
@@ -733,7 +754,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].SurfWater;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -742,7 +763,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].SurfWater - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -754,7 +775,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].TSurf;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -762,7 +783,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].TSurf - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -774,7 +795,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].ColdContent;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -783,7 +804,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].ColdContent - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -795,7 +816,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].Albedo;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -804,7 +825,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].Albedo - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -816,7 +837,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SnowMap[y][x].MaxSwe;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -825,7 +846,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].MaxSwe - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -837,7 +858,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned int *)Array)[y * Map->NX + x] = SnowMap[y][x].MaxSweDate;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -846,7 +867,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].MaxSweDate - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -858,7 +879,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned int *)Array)[y * Map->NX + x] = SnowMap[y][x].MeltOutDate;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map,
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map,
         DMap, Index);
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -867,7 +888,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SnowMap[y][x].MeltOutDate - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -890,7 +911,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -909,7 +930,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -932,7 +953,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((float *)Array)[y * Map->NX + x] = NA;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -951,7 +972,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
             ((unsigned char *)Array)[y * Map->NX + x] = 0;
         }
       }
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -962,17 +983,17 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
     if (DMap->Resolution == MAP_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
-          ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].TableDepth;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+          ((float *)Array)[y * Map->NX + x] = SoilFlow->TableDepth[y * Map->NX + x];
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
-          (unsigned char)((SoilMap[y][x].TableDepth - Offset) /
+          (unsigned char)((SoilFlow->TableDepth[y * Map->NX + x] - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -983,17 +1004,17 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
     if (DMap->Resolution == MAP_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
-          ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].SatFlow;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+          ((float *)Array)[y * Map->NX + x] = SoilFlow->SatFlow[y * Map->NX + x];
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
-          (unsigned char)((SoilMap[y][x].SatFlow - Offset) /
+          (unsigned char)((SoilFlow->SatFlow[y * Map->NX + x] - Offset) /
             Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1005,7 +1026,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].TSurf;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1013,7 +1034,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].TSurf - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1025,7 +1046,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qnet;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1033,7 +1054,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].Qnet - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1045,7 +1066,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qs;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1053,7 +1074,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].Qs - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1065,7 +1086,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qe;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1073,7 +1094,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].Qe - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1085,7 +1106,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qg;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1093,7 +1114,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].Qg - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1105,7 +1126,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].Qst;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1113,7 +1134,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].Qst - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap,
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap,
         Index);
     }
     else
@@ -1124,16 +1145,16 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
     if (DMap->Resolution == MAP_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
-          ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].IExcess;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+          ((float *)Array)[y * Map->NX + x] = SoilFlow->IExcess[y * Map->NX + x];
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
-          (unsigned char)((SoilMap[y][x].IExcess - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+          (unsigned char)((SoilFlow->IExcess[y * Map->NX + x] - Offset) / Range * MAXUCHAR);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1148,7 +1169,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
       for (y = 0; y < Map->NY; y++)
         for (x = 0; x < Map->NX; x++)
           ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].InfiltAcc;
-      Write2DMatrix(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, DMap->NumberType, Map, DMap, Index);
 
     }
     else if (DMap->Resolution == IMAGE_OUTPUT) {
@@ -1156,7 +1177,7 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
         for (x = 0; x < Map->NX; x++)
           ((unsigned char *)Array)[y * Map->NX + x] =
           (unsigned char)((SoilMap[y][x].InfiltAcc - Offset) / Range * MAXUCHAR);
-      Write2DMatrix(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
+      WriteMapOutput(DMap->FileName, Array, NC_BYTE, Map, DMap, Index);
 
     }
     else
@@ -1165,13 +1186,124 @@ void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
   }
 }
 
+/*****************************************************************************
+AddHeader()
+
+Add to the header line of a pixel dump
+*****************************************************************************/
+static void AddHeader(PIXROW *Row, const char *Format, ...)
+{
+  va_list ap;
+  size_t Length;
+
+  Length = strlen(Row->Header);
+  va_start(ap, Format);
+  vsnprintf(Row->Header + Length, sizeof(Row->Header) - Length, Format, ap);
+  va_end(ap);
+}
+
+/*****************************************************************************
+AddColumn()
+
+Add a value to a pixel dump record, with the format in which it is printed
+in the text output.  The name (a format string with its arguments) is only
+stored for the first record.
+*****************************************************************************/
+static void AddColumn(PIXROW *Row, const char *Format, float Value,
+  const char *Name, ...)
+{
+  va_list ap;
+
+  if (Row->N == MAXPIXCOLUMNS)
+    ReportError("DumpPix", 72);
+
+  Row->Format[Row->N] = Format;
+  Row->Value[Row->N] = Value;
+  if (Row->First) {
+    va_start(ap, Name);
+    vsnprintf(Row->Name[Row->N], sizeof(Row->Name[Row->N]), Name, ap);
+    va_end(ap);
+  }
+  Row->N++;
+}
+
+/*****************************************************************************
+WritePixRow()
+
+Write a pixel dump record, and before the first one the header, as text or
+in the binary format described in DumpPix()
+*****************************************************************************/
+static void WritePixRow(DATE *Current, FILE *OutFile, PIXROW *Row, int Format)
+{
+  int Date[6];
+  int Length;
+  int i;
+
+  if (Format == TEXT_PIXDUMP) {
+    if (Row->First)
+      OutPrintf(OutFile, "%s", Row->Header);
+    OutPrintDate(Current, OutFile);
+    for (i = 0; i < Row->N; i++) {
+      if (strchr(Row->Format[i], 'd') != NULL)
+        OutPrintf(OutFile, Row->Format[i], (int) Row->Value[i]);
+      else
+        OutPrintf(OutFile, Row->Format[i], Row->Value[i]);
+    }
+    OutPrintf(OutFile, "\n");
+    return;
+  }
+
+  if (Row->First) {
+    OutWrite("DHSVMPIX", 8, OutFile);
+    Date[0] = PIXBINVERSION;
+    Date[1] = Row->N;
+    OutWrite(Date, 2 * sizeof(int), OutFile);
+    Length = strlen(Row->Header);
+    OutWrite(&Length, sizeof(int), OutFile);
+    OutWrite(Row->Header, Length, OutFile);
+    for (i = 0; i < Row->N; i++) {
+      Length = strlen(Row->Name[i]);
+      OutWrite(&Length, sizeof(int), OutFile);
+      OutWrite(Row->Name[i], Length, OutFile);
+      Length = strlen(Row->Format[i]);
+      OutWrite(&Length, sizeof(int), OutFile);
+      OutWrite(Row->Format[i], Length, OutFile);
+    }
+  }
+
+  Date[0] = Current->Year;
+  Date[1] = Current->Month;
+  Date[2] = Current->Day;
+  Date[3] = Current->Hour;
+  Date[4] = Current->Min;
+  Date[5] = Current->Sec;
+  OutWrite(Date, 6 * sizeof(int), OutFile);
+  OutWrite(Row->Value, Row->N * sizeof(float), OutFile);
+}
+
 /*****************************************************************************
 DumpPix()
+
+Write the values of a pixel, or the basin aggregate, for this timestep.
+IExcess, TableDepth and SatFlow are those of the pixel in the SOILFLOWMAP,
+or their basin averages.
+
+In the binary format (PIXEL DUMP FORMAT = BINARY) the file starts with
+"DHSVMPIX", the version and the number of values per record as 4-byte
+ints, the text header line (its length as a 4-byte int, then the
+characters), and for each value its name and the format in which it is
+printed in the text output (each as length and characters).  Each record
+has the year, month, day, hour, minute and second as 4-byte ints, followed
+by the values as 4-byte floats, all in native byte order.  PixBinToText
+(in program/) converts a binary file to the text output.
 *****************************************************************************/
 void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
   PRECIPPIX *Precip, PIXRAD *Rad, SNOWPIX *Snow, SOILPIX *Soil,
-  VEGPIX *Veg, int NSoil, int NCanopyStory, OPTIONSTRUCT *Options, int flag)
+  float IExcess, float TableDepth, float SatFlow,
+  VEGPIX *Veg, int NSoil, int NCanopyStory, OPTIONSTRUCT *Options, int flag,
+  int Format)
 {
+  static PIXROW Row;
   int i, j;			/* counter */
   float W;      /* available water for runoff - used in NG-IDF */
   float deltaSWE; /* delta SWE over delta t */
@@ -1186,145 +1318,170 @@ void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
   if (W <= 1.e-9)
     W = 0.;
 
+  Row.N = 0;
+  Row.First = (first == 1);
+  Row.Header[0] = '\0';
+
   if (first == 1) {
 
     // Main Aggregate Values File
-    fprintf(OutFile->FilePtr, "Date ");
-    fprintf(OutFile->FilePtr, "W(mm) ");
-    fprintf(OutFile->FilePtr, "Precip(m) ");
-    fprintf(OutFile->FilePtr, "Snow(m) ");
-    fprintf(OutFile->FilePtr, "IExcess(m) ");
-    fprintf(OutFile->FilePtr, "HasSnow SnowCover LastSnow Swq Melt   ");
-    fprintf(OutFile->FilePtr, "PackWater TPack ");
-
-    fprintf(OutFile->FilePtr, " TotalET ");   /*total evapotranspiration*/
+    AddHeader(&Row, "Date ");
+    AddHeader(&Row, "W(mm) ");
+    AddHeader(&Row, "Precip(m) ");
+    AddHeader(&Row, "Snow(m) ");
+    AddHeader(&Row, "IExcess(m) ");
+    AddHeader(&Row, "HasSnow SnowCover LastSnow Swq Melt   ");
+    AddHeader(&Row, "PackWater TPack ");
+
+    AddHeader(&Row, " TotalET ");   /*total evapotranspiration*/
     for (i = 0; i < NCanopyStory + 1; i++)
-      fprintf(OutFile->FilePtr, " PotTransp.Story%d ", i); /* potential transpiration */
+      AddHeader(&Row, " PotTransp.Story%d ", i); /* potential transpiration */
     for (i = 0; i < NCanopyStory + 1; i++)
-      fprintf(OutFile->FilePtr, " ActTransp.Story%d ", i); /* Actual transpiration */
+      AddHeader(&Row, " ActTransp.Story%d ", i); /* Actual transpiration */
     for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, "  EvapCanopyInt.Story%d ", i);
+      AddHeader(&Row, "  EvapCanopyInt.Story%d ", i);
     for (i = 0; i < NCanopyStory; i++)
       for (j = 0; j < NSoil; j++)
-        fprintf(OutFile->FilePtr, " ActTransp.Story%d.Soil%d ", i, j);
-    fprintf(OutFile->FilePtr, " SoilEvap ");
+        AddHeader(&Row, " ActTransp.Story%d.Soil%d ", i, j);
+    AddHeader(&Row, " SoilEvap ");
 
     for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " IntRain.Story%d ", i);
+      AddHeader(&Row, " IntRain.Story%d ", i);
     for (i = 0; i < NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " IntSnow.Story%d ", i);
+      AddHeader(&Row, " IntSnow.Story%d ", i);
 
     for (i = 0; i <= NSoil; i++)
-      fprintf(OutFile->FilePtr, " SoilMoist%d ", (i + 1));
+      AddHeader(&Row, " SoilMoist%d ", (i + 1));
     for (i = 0; i < NSoil; i++)
-      fprintf(OutFile->FilePtr, " Perc%d ", (i + 1));
-    fprintf(OutFile->FilePtr, " TableDepth SatFlow DetentionStorage ");
+      AddHeader(&Row, " Perc%d ", (i + 1));
+    AddHeader(&Row, " TableDepth SatFlow DetentionStorage ");
 
     /* print radiation associated variables */
     for (i = 0; i <= NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " NetShort.Story%d ", (i + 1));
+      AddHeader(&Row, " NetShort.Story%d ", (i + 1));
     for (i = 0; i <= NCanopyStory; i++)
-      fprintf(OutFile->FilePtr, " LongIn.Story%d ", (i + 1));
-    fprintf(OutFile->FilePtr, " PixelNetShort ");
+      AddHeader(&Row, " LongIn.Story%d ", (i + 1));
+    AddHeader(&Row, " PixelNetShort ");
 
     if (Options->HeatFlux)
-      fprintf(OutFile->FilePtr, " TSurf ");
+      AddHeader(&Row, " TSurf ");
 
-    fprintf(OutFile->FilePtr, " Soil.Qnet Soil.Qs Soil.Qe Soil.Qg Soil.Qst Ra ");
-    fprintf(OutFile->FilePtr, " Snow.Qsw Snow.Qlw Snow.Qs Snow.Qe Snow.Qp Snow.MeltEnergy ");
+    AddHeader(&Row, " Soil.Qnet Soil.Qs Soil.Qe Soil.Qg Soil.Qst Ra ");
+    AddHeader(&Row, " Snow.Qsw Snow.Qlw Snow.Qs Snow.Qe Snow.Qp Snow.MeltEnergy ");
 
     if (TotNumGap > 0)
-      fprintf(OutFile->FilePtr, " Gap.SWE Gap.Qsw Gap.Qlin Gap.Qlw Gap.Qs Gap.Qe Gap.Qp Gap.MeltEnergy ");
-    fprintf(OutFile->FilePtr, " Tair ");
+      AddHeader(&Row, " Gap.SWE Gap.Qsw Gap.Qlin Gap.Qlw Gap.Qs Gap.Qe Gap.Qp Gap.MeltEnergy ");
+    AddHeader(&Row, " Tair ");
     if (Options->Infiltration == DYNAMIC)
-      fprintf(OutFile->FilePtr, " InfiltAcc");
+      AddHeader(&Row, " InfiltAcc");
 
     if (flag == 2)
       if (Veg->Gapping > 0.0 )
-        fprintf(OutFile->FilePtr, "Gap_SW GAP_LW");
+        AddHeader(&Row, "Gap_SW GAP_LW");
 
-    fprintf(OutFile->FilePtr, "\n");
+    AddHeader(&Row, "\n");
 
   }
 
   /* All variables are dumped in the case of a pixel dump */
   // Main Aggregate Values File
 
-  // Date
-  PrintDate(Current, OutFile->FilePtr);
-  fprintf(OutFile->FilePtr, " %g ", W*1000);
-  fprintf(OutFile->FilePtr, " %g ", Precip->Precip);
-  fprintf(OutFile->FilePtr, " %g ", Precip->SnowFall);
-  fprintf(OutFile->FilePtr, " %g ", Soil->IExcess);
+  AddColumn(&Row, " %g ", W*1000, "W(mm)");
+  AddColumn(&Row, " %g ", Precip->Precip, "Precip(m)");
+  AddColumn(&Row, " %g ", Precip->SnowFall, "Snow(m)");
+  AddColumn(&Row, " %g ", IExcess, "IExcess(m)");
 
   /* Snow */
-  fprintf(OutFile->FilePtr, " %1d %1d %4d %g %g %g %g ",
-    Snow->HasSnow, Snow->SnowCoverOver, Snow->LastSnow, Snow->Swq,
-    Snow->Melt, Snow->PackWater, Snow->TPack);
+  AddColumn(&Row, " %1d", Snow->HasSnow, "HasSnow");
+  AddColumn(&Row, " %1d", Snow->SnowCoverOver, "SnowCover");
+  AddColumn(&Row, " %4d", Snow->LastSnow, "LastSnow");
+  AddColumn(&Row, " %g", Snow->Swq, "Swq");
+  AddColumn(&Row, " %g", Snow->Melt, "Melt");
+  AddColumn(&Row, " %g", Snow->PackWater, "PackWater");
+  AddColumn(&Row, " %g ", Snow->TPack, "TPack");
 
-  fprintf(OutFile->FilePtr, " %g", Evap->ETot);
+  AddColumn(&Row, " %g", Evap->ETot, "TotalET");
 
   /* Potential transpiration */
   for (i = 0; i < NCanopyStory + 1; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EPot[i]);
+    AddColumn(&Row, " %g", Evap->EPot[i], "PotTransp.Story%d", i);
   /* Actual transpiration */
   for (i = 0; i < NCanopyStory + 1; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EAct[i]);
+    AddColumn(&Row, " %g", Evap->EAct[i], "ActTransp.Story%d", i);
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Evap->EInt[i]);
+    AddColumn(&Row, " %g", Evap->EInt[i], "EvapCanopyInt.Story%d", i);
   /* transpiration from each veg layer from each soil layer */
   for (i = 0; i < NCanopyStory; i++)
     for (j = 0; j < NSoil; j++)
-      fprintf(OutFile->FilePtr, " %g", Evap->ESoil[i][j]);
+      AddColumn(&Row, " %g", Evap->ESoil[i][j], "ActTransp.Story%d.Soil%d",
+        i, j);
   /* evaporation from uppper soil */
-  fprintf(OutFile->FilePtr, " %g", Evap->EvapSoil);
+  AddColumn(&Row, " %g", Evap->EvapSoil, "SoilEvap");
 
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Precip->IntRain[i]);
+    AddColumn(&Row, " %g", Precip->IntRain[i], "IntRain.Story%d", i);
   for (i = 0; i < NCanopyStory; i++)
-    fprintf(OutFile->FilePtr, " %g", Precip->IntSnow[i]);
+    AddColumn(&Row, " %g", Precip->IntSnow[i], "IntSnow.Story%d", i);
 
   for (i = 0; i <= NSoil; i++)
-    fprintf(OutFile->FilePtr, " %g ", Soil->Moist[i]);
+    AddColumn(&Row, " %g ", Soil->Moist[i], "SoilMoist%d", i + 1);
   for (i = 0; i < NSoil; i++)
-    fprintf(OutFile->FilePtr, " %g ", Soil->Perc[i]);
+    AddColumn(&Row, " %g ", Soil->Perc[i], "Perc%d", i + 1);
 
-  fprintf(OutFile->FilePtr, " %g %g %g ", Soil->TableDepth,
-    Soil->SatFlow, Soil->DetentionStorage);
+  AddColumn(&Row, " %g", TableDepth, "TableDepth");
+  AddColumn(&Row, " %g", SatFlow, "SatFlow");
+  AddColumn(&Row, " %g ", Soil->DetentionStorage, "DetentionStorage");
 
   for (i = 0; i <= NCanopyStory; i++) {
-    fprintf(OutFile->FilePtr, " %g ", Rad->NetShort[i]);
+    AddColumn(&Row, " %g ", Rad->NetShort[i], "NetShort.Story%d", i + 1);
   }
 
   for (i = 0; i <= NCanopyStory; i++) {
-    fprintf(OutFile->FilePtr, " %g ", Rad->LongIn[i]);
+    AddColumn(&Row, " %g ", Rad->LongIn[i], "LongIn.Story%d", i + 1);
   }
 
-  fprintf(OutFile->FilePtr, " %g ", Rad->PixelNetShort);
+  AddColumn(&Row, " %g ", Rad->PixelNetShort, "PixelNetShort");
 
   if (Options->HeatFlux)
-    fprintf(OutFile->FilePtr, " %g ", Soil->TSurf);
-
-  fprintf(OutFile->FilePtr, " %g %g %g %g %g %g ",
-    Soil->Qnet, Soil->Qs, Soil->Qe, Soil->Qg, Soil->Qst, Soil->Ra);
-  fprintf(OutFile->FilePtr, " %g %g %g %g %g %g ",
-    Snow->Qsw, Snow->Qlw, Snow->Qs, Snow->Qe, Snow->Qp, Snow->MeltEnergy);
-
-  if (TotNumGap > 0)
-    fprintf(OutFile->FilePtr, " %g %g %g %g %g %g %g %g ", Veg->Type[Opening].Swq,
-      Veg->Type[Opening].Qsw, Veg->Type[Opening].Qlin, Veg->Type[Opening].Qlw, Veg->Type[Opening].Qs,
-      Veg->Type[Opening].Qe, Veg->Type[Opening].Qp, Veg->Type[Opening].MeltEnergy);
+    AddColumn(&Row, " %g ", Soil->TSurf, "TSurf");
+
+  AddColumn(&Row, " %g", Soil->Qnet, "Soil.Qnet");
+  AddColumn(&Row, " %g", Soil->Qs, "Soil.Qs");
+  AddColumn(&Row, " %g", Soil->Qe, "Soil.Qe");
+  AddColumn(&Row, " %g", Soil->Qg, "Soil.Qg");
+  AddColumn(&Row, " %g", Soil->Qst, "Soil.Qst");
+  AddColumn(&Row, " %g ", Soil->Ra, "Ra");
+  AddColumn(&Row, " %g", Snow->Qsw, "Snow.Qsw");
+  AddColumn(&Row, " %g", Snow->Qlw, "Snow.Qlw");
+  AddColumn(&Row, " %g", Snow->Qs, "Snow.Qs");
+  AddColumn(&Row, " %g", Snow->Qe, "Snow.Qe");
+  AddColumn(&Row, " %g", Snow->Qp, "Snow.Qp");
+  AddColumn(&Row, " %g ", Snow->MeltEnergy, "Snow.MeltEnergy");
+
+  if (TotNumGap > 0) {
+    AddColumn(&Row, " %g", Veg->Type[Opening].Swq, "Gap.SWE");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qsw, "Gap.Qsw");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qlin, "Gap.Qlin");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qlw, "Gap.Qlw");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qs, "Gap.Qs");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qe, "Gap.Qe");
+    AddColumn(&Row, " %g", Veg->Type[Opening].Qp, "Gap.Qp");
+    AddColumn(&Row, " %g ", Veg->Type[Opening].MeltEnergy, "Gap.MeltEnergy");
+  }
 
-  fprintf(OutFile->FilePtr, " %g ", Rad->Tair);
+  AddColumn(&Row, " %g ", Rad->Tair, "Tair");
 
   if (Options->Infiltration == DYNAMIC)
-    fprintf(OutFile->FilePtr, " %g", Soil->InfiltAcc);
+    AddColumn(&Row, " %g", Soil->InfiltAcc, "InfiltAcc");
 
   /* Only report the gap radiations values when dumping pixels instead of basin average */
   if (flag == 2)
-    if (Veg->Gapping > 0.0)
-      fprintf(OutFile->FilePtr, " %g %g",
-        Veg->Type[Opening].NetShort[1], Veg->Type[Opening].LongIn[1]);
+    if (Veg->Gapping > 0.0) {
+      AddColumn(&Row, " %g", Veg->Type[Opening].NetShort[1], "Gap_SW");
+      AddColumn(&Row, " %g", Veg->Type[Opening].LongIn[1], "GAP_LW");
+    }
+
+  WritePixRow(Current, OutFile->FilePtr, &Row, Format);
   
   /* store SWE */
   Snow->OldSwq = Snow->Swq;
@@ -11,6 +11,8 @@
  * FUNCTIONS:    CreateMapFileBin()
  *               Read2DMatrixBin()
  *               Read2DMatrixByteSwapBin()
+ *               Read2DSubMatrixBin()
+ *               Read2DSubMatrixByteSwapBin()
  *               Write2DMatrixBin()
  *		 Write2DMatrixByteSwapBin()
  *               SizeOfNumberType()
@@ -137,6 +139,95 @@ int Read2DMatrixByteSwapBin(char *FileName, void *Matrix, int NumberType,
   return NElements;
 }
 
+/*****************************************************************************
+  Function name: Read2DSubMatrixBin()
+
+  Purpose      : Function to read a window of a 2D array from a file.
+
+  Required     :
+    FileName   - name of input file
+    Matrix     - address of array data into
+    NumberType - code for number type (see comments at the beginning of
+                 InitFileIO.c for more detail)
+    NY         - Number of rows of the arrays in the file
+    NX         - Number of columns of the arrays in the file
+    NDataSet   - number of the dataset to read, i.e. the first matrix in a 
+                 file is number 0, etc.
+    VarName    - not used in straight binary
+    index      - not used in straight binary
+    Y0, X0     - First row and column of the window
+    SubNY      - Number of rows of the window
+    SubNX      - Number of columns of the window
+
+  Returns      : Number of elements read
+
+  Modifies     : Matrix
+
+  Comments     : Each row of the window is read with a seek and a single
+                 fread(), or all rows at once if the window spans the full
+                 width of the map
+*****************************************************************************/
+int Read2DSubMatrixBin(char *FileName, void *Matrix, int NumberType, int NY,
+		       int NX, int NDataSet, char *VarName, int index, int Y0,
+		       int X0, int SubNY, int SubNX)
+{
+  FILE *InFile;
+  int NElements = 0;		/* number of elements read */
+  size_t ElemSize;
+  unsigned long OffSet;		/* number of bytes to the start of a row */
+  int Rows;			/* number of rows read at once */
+  int y;
+
+  if (Y0 < 0 || X0 < 0 || Y0 + SubNY > NY || X0 + SubNX > NX)
+    ReportError(FileName, 39);
+
+  OpenFile(&InFile, FileName, "rb", FALSE);
+  ElemSize = SizeOfNumberType(NumberType);
+
+  Rows = (SubNX == NX) ? SubNY : 1;
+  for (y = 0; y < SubNY; y += Rows) {
+    OffSet = ((unsigned long) NY * NX * NDataSet +
+	      (unsigned long) (Y0 + y) * NX + X0) * ElemSize;
+    if (fseek(InFile, OffSet, SEEK_SET))
+      ReportError(FileName, 39);
+    if (fread((char *) Matrix + (size_t) y * SubNX * ElemSize, ElemSize,
+	      (size_t) Rows * SubNX, InFile) != (size_t) Rows * SubNX)
+      ReportError(FileName, 2);
+    NElements += Rows * SubNX;
+  }
+
+  fclose(InFile);
+
+  return NElements;
+}
+
+/******************************************************************************/
+int Read2DSubMatrixByteSwapBin(char *FileName, void *Matrix, int NumberType,
+			       int NY, int NX, int NDataSet, char *VarName,
+			       int index, int Y0, int X0, int SubNY,
+			       int SubNX)
+{
+  int NElements;
+  size_t ElemSize;
+
+  NElements = Read2DSubMatrixBin(FileName, Matrix, NumberType, NY, NX,
+				 NDataSet, VarName, index, Y0, X0, SubNY,
+				 SubNX);
+
+  ElemSize = SizeOfNumberType(NumberType);
+  if (ElemSize == 4) {
+    byte_swap_long(Matrix, NElements);
+  }
+  else if (ElemSize == 2) {
+    byte_swap_short(Matrix, NElements);
+  }
+  else if (ElemSize != 1) {
+    ReportError(FileName, 61);
+  }
+
+  return NElements;
+}
+
 /*****************************************************************************
   Function name: Write2DMatrixBin()
 
@@ -10,9 +10,21 @@
  * DESCRIP-END.
  * FUNCTIONS:    CreateMapFileNetCDF()
  *               Read2DMatrixNetCDF()
+ *               Read2DSubMatrixNetCDF()
+ *               Read2DRowsNetCDF()
  *               Write2DMatrixNetCDF()
+ *               CloseMapFilesNetCDF()
  *               SizeOfNumberType()
  *
+ * COMMENTS:     Each file is opened the first time it is used and stays
+                 open, together with the IDs and lengths of its dimensions,
+                 the IDs, types and dimensions of its variables and the
+                 checks of their sizes, until CloseMapFilesNetCDF() is called
+                 at the end of the run.  A file that was opened for reading
+                 is reopened for writing when needed.  The headers and data
+                 of the output files are brought up to date on disk when the
+                 files are closed.
+ *
  * Modified was made to Read2DMatrix by Ning (2013)
 
    Comment     :First, make sure that the input NETCDF file to Read2DMatrix
@@ -69,8 +81,50 @@
 #define TIME_DIM      "time"
 #define X_DIM         "x"
 #define Y_DIM         "y"
+#define MAXOPENNCFILES 256	/* Most files kept open at the same time */
+
+/* Variable of an open file */
+typedef struct {
+  char Name[NC_MAX_NAME + 1];
+  int varid;
+  nc_type Type;
+  int dimids[3];		/* time, y and x dimensions of the variable */
+  int NY;			/* Size checked for reading, 0 if not checked */
+  int NX;
+  int flag;			/* Returned by Read2DMatrixNetCDF() */
+} NCVAR;
+
+/* Open file */
+typedef struct {
+  char FileName[BUFSIZE + 1];
+  int ncid;
+  int Mode;			/* NC_NOWRITE or NC_WRITE */
+  unsigned long LastUse;	/* When the file was last used */
+  int dimids[3];		/* TIME_DIM, Y_DIM and X_DIM, or -1 if the file
+				   has no such dimension */
+  int timid;			/* Variable TIME_DIM, or -1 */
+  size_t TimeLen;		/* Length of TIME_DIM */
+  int NVars;
+  NCVAR *Var;
+} NCFILE;
+
+static NCFILE **NCFiles = NULL;	/* Files kept open */
+static int NNCFiles = 0;
+static unsigned long NCUses = 0;	/* Number of times a file was used */
 
 static void nc_check_err(const int ncstatus, const int line, const char *file);
+static NCFILE *AddNCFile(char *FileName, int ncid, int Mode);
+static void InqNCFile(NCFILE *File);
+static NCFILE *GetNCFile(char *FileName, int Mode);
+static NCVAR *FindNCVar(NCFILE *File, char *VarName);
+static NCVAR *GetNCVar(NCFILE *File, char *VarName);
+static void ForgetNCFile(char *FileName);
+static void CloseNCFile(int i);
+static void CheckNCVar(NCFILE *File, NCVAR *Var, nc_type TempNumberType,
+		       int *dimids, int NumberType, int NY, int NX);
+static int ReadNCWindow(char *FileName, void *Matrix, int NumberType, int NY,
+			int NX, char *VarName, int index, int Y0, int X0,
+			int SubNY, int SubNX, int ModelRows);
 static int GenerateHistory(int argc, char **argv, char *History);
 static int ncUpdateGlobalHistory(int argc, char **argv, int ncid);
 
@@ -129,6 +183,7 @@ void CreateMapFileNetCDF(char *FileName, ...)
   Map = va_arg(ap, MAPSIZE *);
 
   /* Go ahead and clobber any existing file */
+  ForgetNCFile(FileName);
   ncstatus = nc_create(FileName, NC_CLOBBER | NC_NOFILL, &ncid);
   nc_check_err(ncstatus, __LINE__, __FILE__);
 
@@ -226,84 +281,35 @@ void CreateMapFileNetCDF(char *FileName, ...)
   nc_check_err(ncstatus, __LINE__, __FILE__);
   free(Array);
 
-  ncstatus = nc_close(ncid);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
+  /* keep the file open for the maps that are written to it */
+  AddNCFile(FileName, ncid, NC_WRITE);
 }
 
 /*******************************************************************************
-  Function name: Read2DMatrixNetCDF()
-
-  Purpose      : Function to read a 2D array from a file.
-
-  Required     :
-    FileName   - name of input file
-    Matrix     - address of array data into
-    NumberType - code for number type (taken from HDF, see comments at the
-                 beginning of InitFileIO.c for more detail)
-    NY         - Number of rows
-    NX         - Number of columns
-    NDataSet   - number of the dataset to read, i.e. the first matrix in a 
-                 file is number 0, etc. (this is not used for the NetCDF file,
-		 since we can retrieve the variable by name).
-    VarName    - Name of variable to retrieve
+  Function name: CheckNCVar()
 
-  Returns      : Number of elements read
+  Purpose      : Check the type and the x and y dimensions of a variable that
+                 is read, and find out whether its rows have to be reversed
 
-  Modifies     : Matrix
-
-  Comments     : NOTE that we cannot modify anything other than the returned
-                 Matrix, because we have to stay compatible with Read2DMatrixBin 
+  Comments     : The result is kept with the variable, since it does not
+                 change while the file is open
 *******************************************************************************/
- int Read2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
-		       int NX, int NDataSet, ...) 
+static void CheckNCVar(NCFILE *File, NCVAR *Var, nc_type TempNumberType,
+		       int *dimids, int NumberType, int NY, int NX)
 {
   const char *Routine = "Read2DMatrixNetCDF";
   char Str[BUFSIZE + 1];
   char dimname[NC_MAX_NAME + 1];
-  char *VarName;
-  int dimids[3];
-  int ndims;
-  int ncid;
+  char *FileName = File->FileName;
+  char *VarName = Var->Name;
+  int ncid = File->ncid;
   int ncstatus;
-  nc_type TempNumberType;
-  int varid;
-  size_t index;	
-  double time;
-  int timid;
-  size_t count[3];
-  size_t start[3] = { 0, 0, 0 };
   size_t dimlen;
-  size_t timelen;
-  va_list ap;
   double *Ycoord;
   double *Xcoord;  /* lat, lon variables */
-  int	LatisAsc, LonisAsc, flag;    /* flag */
+  int	LatisAsc, LonisAsc, flag = 0;    /* flag */
   int lon_varid, lat_varid;
-  count[0] = 1;
-  count[1] = NY;
-  count[2] = NX;
 
-  /****************************************************************************/
-  /*                   GO THROUGH VARIABLE ARGUMENT LIST                      */
-  /****************************************************************************/
-  va_start(ap, NDataSet);
-  VarName = va_arg(ap, char *);
-  index = va_arg(ap, int);
-  /****************************************************************************/
-  /*                           QUERY NETDCF FILE                              */
-  /****************************************************************************/
-
-  ncstatus = nc_open(FileName, NC_NOWRITE, &ncid);
-  /* debugging if any file fails to be opened */
-  //printf("Trying to open %s\n", FileName);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-
-  /* check whether the variable exists and get its parameters */
-  ncstatus = nc_inq_varid(ncid, VarName, &varid);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-
-  ncstatus = nc_inq_var(ncid, varid, 0, &TempNumberType, &ndims, dimids, NULL);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
   if (TempNumberType != NumberType) {
     sprintf(Str, "%s: nc_type for %s is different than expected.\n",
 	    FileName, VarName);
@@ -330,6 +336,7 @@ void CreateMapFileNetCDF(char *FileName, ...)
   LatisAsc = 1;
   if( Ycoord[0] > Ycoord[NY - 1] ) 
 	  LatisAsc = 0;
+  free(Ycoord);
 
   ncstatus = nc_inq_dim(ncid, dimids[2], dimname, &dimlen);
   nc_check_err(ncstatus, __LINE__, __FILE__);
@@ -346,6 +353,7 @@ void CreateMapFileNetCDF(char *FileName, ...)
   LonisAsc = 1;
   if( Xcoord[0] > Xcoord[NX - 1] ) 
 	  LonisAsc = 0;
+  free(Xcoord);
 
   if (LonisAsc == 0){
 	  printf("The current program does not handle the cases when longitude or X \
@@ -358,20 +366,186 @@ fit your needs. \n");
 	  flag = 0;
   if ((LatisAsc == 1) & (LonisAsc == 1))
 	  flag = 1;
+
+  Var->NY = NY;
+  Var->NX = NX;
+  Var->flag = flag;
+}
+
+/*******************************************************************************
+  Function name: Read2DMatrixNetCDF()
+
+  Purpose      : Function to read a 2D array from a file.
+
+  Required     :
+    FileName   - name of input file
+    Matrix     - address of array data into
+    NumberType - code for number type (taken from HDF, see comments at the
+                 beginning of InitFileIO.c for more detail)
+    NY         - Number of rows
+    NX         - Number of columns
+    NDataSet   - number of the dataset to read, i.e. the first matrix in a 
+                 file is number 0, etc. (this is not used for the NetCDF file,
+		 since we can retrieve the variable by name).
+    VarName    - Name of variable to retrieve
+
+  Returns      : Number of elements read
+
+  Modifies     : Matrix
+
+  Comments     : NOTE that we cannot modify anything other than the returned
+                 Matrix, because we have to stay compatible with Read2DMatrixBin 
+*******************************************************************************/
+ int Read2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
+		       int NX, int NDataSet, ...) 
+{
+  char *VarName;
+  int index;
+  va_list ap;
+
+  /****************************************************************************/
+  /*                   GO THROUGH VARIABLE ARGUMENT LIST                      */
+  /****************************************************************************/
+  va_start(ap, NDataSet);
+  VarName = va_arg(ap, char *);
+  index = va_arg(ap, int);
+  va_end(ap);
+
+  return ReadNCWindow(FileName, Matrix, NumberType, NY, NX, VarName, index,
+		      0, 0, NY, NX, FALSE);
+}
+
+/*******************************************************************************
+  Function name: Read2DSubMatrixNetCDF()
+
+  Purpose      : Function to read a window of a 2D array from a file.
+
+  Required     : As Read2DMatrixNetCDF(), and
+    Y0, X0     - First row and column of the window, as stored in the file
+    SubNY      - Number of rows of the window
+    SubNX      - Number of columns of the window
+
+  Returns      : As Read2DMatrixNetCDF()
+
+  Modifies     : Matrix
+*******************************************************************************/
+int Read2DSubMatrixNetCDF(char *FileName, void *Matrix, int NumberType,
+			  int NY, int NX, int NDataSet, char *VarName,
+			  int index, int Y0, int X0, int SubNY, int SubNX)
+{
+  if (Y0 < 0 || X0 < 0 || Y0 + SubNY > NY || X0 + SubNX > NX)
+    ReportError(FileName, 39);
+
+  return ReadNCWindow(FileName, Matrix, NumberType, NY, NX, VarName, index,
+		      Y0, X0, SubNY, SubNX, FALSE);
+}
+
+/*******************************************************************************
+  Function name: Read2DRowsNetCDF()
+
+  Purpose      : Function to read a window of a 2D array from a file, with
+                 the rows counted from the north edge of the map whatever
+                 the order in which they are stored.
+
+  Required     : As Read2DSubMatrixNetCDF(), except that Y0 is the first row
+                 from the north
+
+  Returns      : As Read2DMatrixNetCDF()
+
+  Modifies     : Matrix
+
+  Comments     : If the returned flag is 1 the rows of the window are in the
+                 order of the file, from south to north, and the caller
+                 reverses them in the same way as those of a whole map.
+                 Used to read the rows of the model area of an MPI process.
+*******************************************************************************/
+int Read2DRowsNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
+		     int NX, int NDataSet, char *VarName, int index, int Y0,
+		     int X0, int SubNY, int SubNX)
+{
+  if (Y0 < 0 || X0 < 0 || Y0 + SubNY > NY || X0 + SubNX > NX)
+    ReportError(FileName, 39);
+
+  return ReadNCWindow(FileName, Matrix, NumberType, NY, NX, VarName, index,
+		      Y0, X0, SubNY, SubNX, TRUE);
+}
+
+/*******************************************************************************
+  Function name: ReadNCWindow()
+
+  Purpose      : Read the hyperslab (index, Y0:Y0+SubNY, X0:X0+SubNX) of a
+                 variable with (time, y, x) dimensions of size (*, NY, NX).
+                 The whole map is checked the first time the variable is read.
+                 With ModelRows TRUE, Y0 counts from the north edge of the
+                 map, also if the variable is stored from south to north.
+
+  Returns      : The orientation flag of the variable (see CheckNCVar())
+*******************************************************************************/
+static int ReadNCWindow(char *FileName, void *Matrix, int NumberType, int NY,
+			int NX, char *VarName, int index, int Y0, int X0,
+			int SubNY, int SubNX, int ModelRows)
+{
+  const char *Routine = "Read2DMatrixNetCDF";
+  int ncid;
+  int ncstatus;
+  int varid;
+  double time;
+  int timid;
+  size_t count[3];
+  size_t start[3];
+  size_t timeindex;
+  size_t timelen;
+  int flag;
+  NCFILE *File;
+  NCVAR *Var;
+  start[0] = index;
+  start[1] = Y0;
+  start[2] = X0;
+  count[0] = 1;
+  count[1] = SubNY;
+  count[2] = SubNX;
+
+  /****************************************************************************/
+  /*                           QUERY NETDCF FILE                              */
+  /****************************************************************************/
+
+  File = GetNCFile(FileName, NC_NOWRITE);
+  ncid = File->ncid;
+
+  /* check whether the variable exists and get its parameters */
+  Var = GetNCVar(File, VarName);
+  varid = Var->varid;
+
+  /* the type and the x and y dimensions only have to be checked the first
+     time the variable is read */
+  if (Var->NY != NY || Var->NX != NX)
+    CheckNCVar(File, Var, Var->Type, Var->dimids, NumberType, NY, NX);
+  flag = Var->flag;
+  if (ModelRows && flag == 1)
+    start[1] = NY - Y0 - SubNY;
   
   /* see whether the time dimension needs to be updated (the assumption is that
      the same index value refers to the same moment in time.  Since currently we
-     make separate files for separate variables this is OK) */
-  ncstatus = nc_inq_dimlen(ncid, dimids[0], &timelen);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-  if (timelen < index + 1) {	/* need to add one to time */
-    ncstatus = nc_inq_varid(ncid, TIME_DIM, &timid);
+     make separate files for separate variables this is OK).  Only the
+     length of TIME_DIM is kept with the file */
+  if (Var->dimids[0] == File->dimids[0])
+    timelen = File->TimeLen;
+  else {
+    ncstatus = nc_inq_dimlen(ncid, Var->dimids[0], &timelen);
     nc_check_err(ncstatus, __LINE__, __FILE__);
+  }
+  timeindex = index;
+  if (timelen < timeindex + 1) {	/* need to add one to time */
+    if ((timid = File->timid) < 0) {
+      ncstatus = nc_inq_varid(ncid, TIME_DIM, &timid);
+      nc_check_err(ncstatus, __LINE__, __FILE__);
+    }
     time = (double) index;
-    ncstatus = nc_put_var1_double(ncid, timid, &index, &time);
+    ncstatus = nc_put_var1_double(ncid, timid, &timeindex, &time);
     nc_check_err(ncstatus, __LINE__, __FILE__);
+    if (Var->dimids[0] == File->dimids[0])
+      File->TimeLen = timeindex + 1;
   }
-  start[0] = index;
   /****************************************************************************/
   /*                             READ VARIABLE                                */
   /****************************************************************************/
@@ -406,13 +580,6 @@ fit your needs. \n");
   }
   nc_check_err(ncstatus, __LINE__, __FILE__);
 
-  /****************************************************************************/
-  /*                                CLEAN UP                                  */
-  /****************************************************************************/
-
-  ncstatus = nc_close(ncid);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-
   return flag;
 }
 
@@ -441,17 +608,17 @@ int Write2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
 {
   const char *Routine = "Write2DMatrixNetCDF";
   double time;
-  int dimids[3];		/* time, north, east */
+  int *dimids;			/* time, north, east */
   size_t index;			/* index of the time slice being dumped */
   int ncid;
   int ncstatus;
-  int timid;
   int varid;
   size_t count[3];
   size_t start[3] = { 0, 0, 0 };
-  size_t timelen;
   va_list ap;
   MAPDUMP *DMap;
+  NCFILE *File;
+  NCVAR *Var;
 
   count[0] = 1;
   count[1] = NY;
@@ -468,20 +635,20 @@ int Write2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
   /*                           QUERY NETDCF FILE                              */
   /****************************************************************************/
 
-  ncstatus = nc_open(FileName, NC_WRITE, &ncid);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
+  File = GetNCFile(FileName, NC_WRITE);
+  ncid = File->ncid;
 
-  /* get dimension ID's */
-  nc_inq_dimid(ncid, TIME_DIM, &(dimids[0]));
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-  nc_inq_dimid(ncid, Y_DIM, &(dimids[1]));
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-  nc_inq_dimid(ncid, X_DIM, &(dimids[2]));
-  nc_check_err(ncstatus, __LINE__, __FILE__);
+  /* the dimension ID's were looked up when the file was opened */
+  dimids = File->dimids;
+  if (dimids[0] < 0 || dimids[1] < 0 || dimids[2] < 0 || File->timid < 0)
+    nc_check_err(NC_EBADDIM, __LINE__, __FILE__);
 
-  /* see whether variable has been defined; if not defined, define it now */
-  ncstatus = nc_inq_varid(ncid, DMap->Name, &varid);
-  if (ncstatus == NC_ENOTVAR) {	/* Variable not defined */
+  /* see whether variable has been defined; if not defined, define it now.
+     Variables already written during this run are known. */
+  if ((Var = FindNCVar(File, DMap->Name)) != NULL)
+    varid = Var->varid;
+  else if ((ncstatus = nc_inq_varid(ncid, DMap->Name, &varid)) == NC_ENOTVAR) {
+    /* Variable not defined */
 
     ncstatus = nc_redef(ncid);
     nc_check_err(ncstatus, __LINE__, __FILE__);
@@ -505,21 +672,21 @@ int Write2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
 
     ncstatus = nc_enddef(ncid);
     nc_check_err(ncstatus, __LINE__, __FILE__);
+    GetNCVar(File, DMap->Name);
   }
-  else				/* Variable defined */
+  else {			/* Variable defined */
     nc_check_err(ncstatus, __LINE__, __FILE__);
+    GetNCVar(File, DMap->Name);
+  }
 
   /* see whether the time dimension needs to be updated (the assumption is that
      the same index value refers to the same moment in time.  Since currently we
      make separate files for separate variables this is OK) */
-  ncstatus = nc_inq_dimlen(ncid, dimids[0], &timelen);
-  nc_check_err(ncstatus, __LINE__, __FILE__);
-  if (timelen < index + 1) {	/* need to add one to time */
-    ncstatus = nc_inq_varid(ncid, TIME_DIM, &timid);
-    nc_check_err(ncstatus, __LINE__, __FILE__);
+  if (File->TimeLen < index + 1) {	/* need to add one to time */
     time = (double) index;
-    ncstatus = nc_put_var1_double(ncid, timid, &index, &time);
+    ncstatus = nc_put_var1_double(ncid, File->timid, &index, &time);
     nc_check_err(ncstatus, __LINE__, __FILE__);
+    File->TimeLen = index + 1;
   }
   start[0] = index;
 
@@ -557,14 +724,230 @@ int Write2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
   }
   nc_check_err(ncstatus, __LINE__, __FILE__);
 
-  /****************************************************************************/
-  /*                                CLEAN UP                                  */
-  /****************************************************************************/
+  return NY * NX;
+}
+
+/*******************************************************************************
+  Function name: CloseMapFilesNetCDF()
+
+  Purpose      : Close all the files kept open by the functions above
+
+  Required     : 
+
+  Returns      : void
+
+  Modifies     : 
+
+  Comments     : To be called at the end of the run.  nc_close() writes the
+                 header and the data of each output file to disk.
+*******************************************************************************/
+void CloseMapFilesNetCDF(void)
+{
+  while (NNCFiles > 0)
+    CloseNCFile(NNCFiles - 1);
+  free(NCFiles);
+  NCFiles = NULL;
+  NNCFiles = 0;
+}
+
+/*******************************************************************************
+  Function name: AddNCFile()
+
+  Purpose      : Keep a file that has just been opened or created
+
+  Returns      : The file kept
+*******************************************************************************/
+static NCFILE *AddNCFile(char *FileName, int ncid, int Mode)
+{
+  const char *Routine = "AddNCFile";
+  NCFILE *File;
+  int Oldest;
+  int i;
+
+  /* close the file that has not been used for the longest time if too many
+     are open (e.g. when a model state is saved many times) */
+  if (NNCFiles >= MAXOPENNCFILES) {
+    for (i = 1, Oldest = 0; i < NNCFiles; i++)
+      if (NCFiles[i]->LastUse < NCFiles[Oldest]->LastUse)
+	Oldest = i;
+    CloseNCFile(Oldest);
+  }
+
+  if (!(NCFiles = (NCFILE **) realloc(NCFiles, (NNCFiles + 1) *
+				      sizeof(NCFILE *))))
+    ReportError((char *) Routine, 1);
+  if (!(File = (NCFILE *) calloc(1, sizeof(NCFILE))))
+    ReportError((char *) Routine, 1);
+  strncpy(File->FileName, FileName, BUFSIZE);
+  File->ncid = ncid;
+  File->Mode = Mode;
+  File->LastUse = ++NCUses;
+  File->NVars = 0;
+  File->Var = NULL;
+  InqNCFile(File);
+  NCFiles[NNCFiles++] = File;
+
+  return File;
+}
+
+/*******************************************************************************
+  Function name: InqNCFile()
+
+  Purpose      : Look up the dimensions TIME_DIM, Y_DIM and X_DIM of a file
+                 that has just been opened, the variable TIME_DIM and the
+                 length of TIME_DIM
+
+  Comments     : Input files may name their dimensions otherwise; those that
+                 are not found are set to -1
+*******************************************************************************/
+static void InqNCFile(NCFILE *File)
+{
+  const char *DimName[3] = { TIME_DIM, Y_DIM, X_DIM };
+  int ncstatus;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    if (nc_inq_dimid(File->ncid, DimName[i], &(File->dimids[i])) != NC_NOERR)
+      File->dimids[i] = -1;
+  }
+  if (nc_inq_varid(File->ncid, TIME_DIM, &(File->timid)) != NC_NOERR)
+    File->timid = -1;
+  File->TimeLen = 0;
+  if (File->dimids[0] >= 0) {
+    ncstatus = nc_inq_dimlen(File->ncid, File->dimids[0], &(File->TimeLen));
+    nc_check_err(ncstatus, __LINE__, __FILE__);
+  }
+}
+
+/*******************************************************************************
+  Function name: GetNCFile()
 
-  ncstatus = nc_close(ncid);
+  Purpose      : Find an open file, or open it
+
+  Required     : 
+    FileName - Name of the file
+    Mode     - NC_NOWRITE or NC_WRITE
+
+  Returns      : The open file
+
+  Comments     : A file open for reading only is reopened if Mode is
+                 NC_WRITE.  The IDs of its variables stay the same.
+*******************************************************************************/
+static NCFILE *GetNCFile(char *FileName, int Mode)
+{
+  NCFILE *File;
+  int ncstatus;
+  int ncid;
+  int i;
+
+  for (i = 0; i < NNCFiles; i++) {
+    File = NCFiles[i];
+    if (strcmp(File->FileName, FileName) == 0) {
+      if (Mode == NC_WRITE && File->Mode != NC_WRITE) {
+	ncstatus = nc_close(File->ncid);
+	nc_check_err(ncstatus, __LINE__, __FILE__);
+	ncstatus = nc_open(FileName, NC_WRITE, &(File->ncid));
+	nc_check_err(ncstatus, __LINE__, __FILE__);
+	File->Mode = NC_WRITE;
+      }
+      File->LastUse = ++NCUses;
+      return File;
+    }
+  }
+
+  ncstatus = nc_open(FileName, Mode, &ncid);
+  /* debugging if any file fails to be opened */
+  //printf("Trying to open %s\n", FileName);
   nc_check_err(ncstatus, __LINE__, __FILE__);
 
-  return NY * NX;
+  return AddNCFile(FileName, ncid, Mode);
+}
+
+/*******************************************************************************
+  Function name: FindNCVar()
+
+  Purpose      : Find a variable of an open file
+
+  Returns      : The variable, or NULL if its ID has not been looked up yet
+*******************************************************************************/
+static NCVAR *FindNCVar(NCFILE *File, char *VarName)
+{
+  int i;
+
+  for (i = 0; i < File->NVars; i++)
+    if (strcmp(File->Var[i].Name, VarName) == 0)
+      return &(File->Var[i]);
+
+  return NULL;
+}
+
+/*******************************************************************************
+  Function name: GetNCVar()
+
+  Purpose      : Find a variable of an open file, looking up its ID, type and
+                 dimensions the first time
+
+  Returns      : The variable
+*******************************************************************************/
+static NCVAR *GetNCVar(NCFILE *File, char *VarName)
+{
+  const char *Routine = "GetNCVar";
+  NCVAR *Var;
+  int ncstatus;
+
+  if ((Var = FindNCVar(File, VarName)) != NULL)
+    return Var;
+
+  if (!(File->Var = (NCVAR *) realloc(File->Var, (File->NVars + 1) *
+				      sizeof(NCVAR))))
+    ReportError((char *) Routine, 1);
+  Var = &(File->Var[File->NVars]);
+  ncstatus = nc_inq_varid(File->ncid, VarName, &(Var->varid));
+  nc_check_err(ncstatus, __LINE__, __FILE__);
+  ncstatus = nc_inq_var(File->ncid, Var->varid, NULL, &(Var->Type), NULL,
+			Var->dimids, NULL);
+  nc_check_err(ncstatus, __LINE__, __FILE__);
+  strncpy(Var->Name, VarName, NC_MAX_NAME);
+  Var->Name[NC_MAX_NAME] = '\0';
+  Var->NY = 0;
+  Var->NX = 0;
+  Var->flag = 0;
+  File->NVars++;
+
+  return Var;
+}
+
+/*******************************************************************************
+  Function name: ForgetNCFile()
+
+  Purpose      : Close a file if it is open, before it is created anew
+*******************************************************************************/
+static void ForgetNCFile(char *FileName)
+{
+  int i;
+
+  for (i = 0; i < NNCFiles; i++) {
+    if (strcmp(NCFiles[i]->FileName, FileName) == 0) {
+      CloseNCFile(i);
+      return;
+    }
+  }
+}
+
+/*******************************************************************************
+  Function name: CloseNCFile()
+
+  Purpose      : Close the i-th open file and forget it
+*******************************************************************************/
+static void CloseNCFile(int i)
+{
+  int ncstatus;
+
+  ncstatus = nc_close(NCFiles[i]->ncid);
+  nc_check_err(ncstatus, __LINE__, __FILE__);
+  free(NCFiles[i]->Var);
+  free(NCFiles[i]);
+  NCFiles[i] = NCFiles[--NNCFiles];
 }
 
 /*******************************************************************************
@@ -740,6 +1123,8 @@ int main(void)
   Map.Y = 0;
   Map.NX = 4;
   Map.NY = 6;
+  Map.GlobalNY = 6;
+  Map.GlobalY0 = 0;
   Map.DX = 5.;
   Map.DY = 5.;
   Map.DXY = 7.07;
@@ -858,6 +1243,8 @@ int main(void)
 	    cWriteArray[i], cReadArray[i]);
   }
 
+  CloseMapFilesNetCDF();
+
   if (eflag == 0)
     printf("Test successful\n");
 
@@ -29,23 +29,22 @@
   
   Calculate the average values for the different fluxes and state variables
   over the basin.  Only the runoff is calculated as a total volume instead
-  of an average.  In the current implementation the local radiation
-  elements are not stored for the entire area.  Therefore these components
-  are aggregated in AggregateRadiation() inside MassEnergyBalance().
+  of an average.  The components of the radiation balance of each cell are added by
+  AggregateRadiation(), which is called from Aggregate().
 
   The aggregated values are set to zero in the function RestAggregate,
   which is executed at the beginning of each time step.
 *****************************************************************************/
 void FinalMassBalance(FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass)
 {
-  float NewWaterStorage;	/* water storage at the end of the time step */
-  float Output;			/* total water flux leaving the basin;  */
-  float MassError;		/* mass balance error m  */
-  float Input;
+  double NewWaterStorage;	/* water storage at the end of the time step */
+  double Output;		/* total water flux leaving the basin;  */
+  double MassError;		/* mass balance error m  */
+  double Input;
 
-  NewWaterStorage = Total->Soil.IExcess + Total->Road.IExcess + 
+  NewWaterStorage = (double) Total->IExcess + Total->Road.IExcess + 
     Total->CanopyWater + Total->SoilWater +
-    Total->Snow.Swq + Total->Soil.SatFlow + Total->Soil.DetentionStorage;
+    Total->Snow.Swq + Total->SatFlow + Total->Soil.DetentionStorage;
 
   Output = Mass->CumChannelInt + ( Mass->CumRoadInt  -
     Mass->CumCulvertReturnFlow ) + Mass->CumET;
@@ -72,8 +71,8 @@ void FinalMassBalance(FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass)
   fprintf(stderr, "\n      Initial Storage ............        %.3f", Mass->StartWaterStorage*1000);
   fprintf(stderr, "\n      Final Storage ..............        %.3f", NewWaterStorage*1000);
   fprintf(stderr, "\n          Final SWQ ..............        %.3f", Total->Snow.Swq*1000);
-  fprintf(stderr, "\n          Final Soil Moisture ....        %.3f", (Total->SoilWater + Total->Soil.SatFlow)*1000);
-  fprintf(stderr, "\n          Final Surface ..........        %.3f", (Total->Soil.IExcess  + 
+  fprintf(stderr, "\n          Final Soil Moisture ....        %.3f", (Total->SoilWater + Total->SatFlow)*1000);
+  fprintf(stderr, "\n          Final Surface ..........        %.3f", (Total->IExcess  + 
 						                               Total->CanopyWater + Total->Soil.DetentionStorage)*1000);
   fprintf(stderr, "\n          Final Road Surface .....        %.3f\n", Total->Road.IExcess*1000);
   fprintf(stderr, "\n  Mass added to glacier ..........        %.3f\n", Total->Snow.Glacier*1000);
@@ -96,8 +95,8 @@ void FinalMassBalance(FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass)
   fprintf(Out->FilePtr, "\n      Initial Storage ............        %.3f", Mass->StartWaterStorage*1000);
   fprintf(Out->FilePtr, "\n      Final Storage ..............        %.3f", NewWaterStorage*1000);
   fprintf(Out->FilePtr, "\n          Final SWQ ..............        %.3f", Total->Snow.Swq*1000);
-  fprintf(Out->FilePtr, "\n          Final Soil Moisture ....        %.3f", (Total->SoilWater + Total->Soil.SatFlow)*1000);
-  fprintf(Out->FilePtr, "\n          Final Surface ..........        %.3f", (Total->Soil.IExcess  + 
+  fprintf(Out->FilePtr, "\n          Final Soil Moisture ....        %.3f", (Total->SoilWater + Total->SatFlow)*1000);
+  fprintf(Out->FilePtr, "\n          Final Surface ..........        %.3f", (Total->IExcess  + 
 						                               Total->CanopyWater + Total->Soil.DetentionStorage)*1000);
   fprintf(Out->FilePtr, "\n          Final Road Surface .....        %.3f\n", Total->Road.IExcess*1000);
   fprintf(Out->FilePtr, "\n  Mass added to glacier ..........        %.3f\n", Total->Snow.Glacier*1000);
@@ -105,17 +104,17 @@ void FinalMassBalance(FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass)
   fprintf(Out->FilePtr, "\n  Mass Error (mm).................        %.3f\n", MassError*1000);
   
      /* error check: negative soil moisture and surface ponding */
-  if (Total->SoilWater + Total->Soil.SatFlow < 0) {
+  if (Total->SoilWater + Total->SatFlow < 0) {
     fprintf(stderr,
-      "FINAL MASS BALANCE ERROR:  Negative soil moisture %.3f\n", (Total->SoilWater + Total->Soil.SatFlow) * 1000);
+      "FINAL MASS BALANCE ERROR:  Negative soil moisture %.3f\n", (Total->SoilWater + Total->SatFlow) * 1000);
     fprintf(Out->FilePtr,
-      "FINAL MASS BALANCE ERROR:  Negative soil moisture %.3f\n", (Total->SoilWater + Total->Soil.SatFlow) * 1000);
+      "FINAL MASS BALANCE ERROR:  Negative soil moisture %.3f\n", (Total->SoilWater + Total->SatFlow) * 1000);
   }
-  if ((Total->Soil.IExcess + Total->CanopyWater + Total->Soil.DetentionStorage)/ Input > 0.1) {
+  if ((Total->IExcess + Total->CanopyWater + Total->Soil.DetentionStorage)/ Input > 0.1) {
     fprintf(stderr, "FINAL MASS BALANCE ERROR:  TOO MUCH SURFACE WATER PONDING %.3f\n", 
-      (Total->Soil.IExcess + Total->CanopyWater + Total->Soil.DetentionStorage) * 1000);
+      (Total->IExcess + Total->CanopyWater + Total->Soil.DetentionStorage) * 1000);
     fprintf(Out->FilePtr, "FINAL MASS BALANCE ERROR:  TOO MUCH SURFACE WATER PONDING %.3f\n",
-      (Total->Soil.IExcess + Total->CanopyWater + Total->Soil.DetentionStorage) * 1000);
+      (Total->IExcess + Total->CanopyWater + Total->Soil.DetentionStorage) * 1000);
   }
 	  	 
 }
@@ -1,12 +1,12 @@
 /*
- * SUMMARY:      GetMetData.c - Read new station meteorological data
+ * SUMMARY:      GetMetData.c - Store new station meteorological data
  * USAGE:        Part of DHSVM
  *
  * AUTHOR:       Bart Nijssen
  * ORG:          University of Washington, Department of Civil Engineering
  * E-MAIL:       nijssen@u.washington.edu
  * ORIG-DATE:    Apr-96
- * DESCRIPTION:  Read new station meteorological data
+ * DESCRIPTION:  Store new station meteorological data
  * DESCRIP-END.
  * FUNCTIONS:    GetMetData()
  * COMMENTS:
@@ -25,23 +25,32 @@
 
  /*****************************************************************************
    GetMetData()
+
+   Store the station and radar data of the current timestep, which have been
+   read into Forcing (see Prefetch.c)
  *****************************************************************************/
-void GetMetData(OPTIONSTRUCT *Options, TIMESTRUCT *Time, int NSoilLayers,
-  int NStats, float SunMax, METLOCATION *Stat, MAPSIZE *Radar,
-  RADARPIX **RadarMap, char *RadarFileName)
+void GetMetData(OPTIONSTRUCT *Options, int NSoilLayers, int NStats,
+  float SunMax, METLOCATION *Stat, MAPSIZE *Radar, RADARPIX **RadarMap,
+  FORCING *Forcing)
 {
   int i;			/* counter */
+  int x;			/* counter */
+  int y;			/* counter */
 
   if (DEBUG)
-    printf("Reading all met data for current timestep\n");
+    printf("Storing all met data for current timestep\n");
 
   for (i = 0; i < NStats; i++)
-    ReadMetRecord(Options, &(Time->Current), NSoilLayers, &(Stat[i].MetFile),
-      Stat[i].IsWindModelLocation, &(Stat[i].Data));
+    StoreMetRecord(Options, NSoilLayers, Stat[i].MetBin != NULL ?
+      Stat[i].MetBin->File.FileName : Stat[i].MetFile.FileName,
+      Stat[i].IsWindModelLocation,
+      &(Forcing->Station[Forcing->StationOffset[i]]), &(Stat[i].Data));
 
-  if (Options->PrecipType == RADAR)
-    ReadRadarMap(&(Time->Current), &(Time->StartRadar), Time->Dt, Radar,
-      RadarMap, RadarFileName);
+  if (Options->PrecipType == RADAR) {
+    for (y = 0, i = 0; y < Radar->NY; y++)
+      for (x = 0; x < Radar->NX; x++, i++)
+        RadarMap[y][x].Precip = Forcing->Radar[i];
+  }
 
   for (i = 0; i < NStats; i++) {
     if (SunMax > 0.0) {
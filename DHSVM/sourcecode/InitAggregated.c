@@ -9,6 +9,7 @@
 * DESCRIPTION:  Initialize basin-wide values
 * DESCRIP-END.
 * FUNCTIONS:    InitAggregated()
+*               FreeAggregated()
 * COMMENTS:
 * $Id: InitAggregated.c,v 1.4 2003/07/01 21:26:15 olivier Exp $
 */
@@ -79,3 +80,38 @@ void InitAggregated(OPTIONSTRUCT *Options, int MaxVegLayers, int MaxSoilLayers,
     }
   }
 }
+
+/*****************************************************************************
+FreeAggregated()
+
+Frees the memory allocated by InitAggregated()
+*****************************************************************************/
+void FreeAggregated(OPTIONSTRUCT *Options, int MaxVegLayers, AGGREGATED *Total)
+{
+  int i;			/* counter */
+
+  free(Total->Evap.EPot);
+  free(Total->Evap.EAct);
+  free(Total->Evap.EInt);
+  for (i = 0; i < MaxVegLayers; i++)
+    free(Total->Evap.ESoil[i]);
+  free(Total->Evap.ESoil);
+  free(Total->Precip.IntRain);
+  free(Total->Precip.IntSnow);
+  free(Total->Soil.Moist);
+  free(Total->Soil.Perc);
+  free(Total->Soil.Temp);
+
+  if (Options->CanopyGapping) {
+    for (i = 0; i < CELL_PARTITION; i++) {
+      free(Total->Veg.Type[i].EPot);
+      free(Total->Veg.Type[i].EAct);
+      free(Total->Veg.Type[i].EInt);
+      free(Total->Veg.Type[i].ESoil);
+      free(Total->Veg.Type[i].IntRain);
+      free(Total->Veg.Type[i].IntSnow);
+      free(Total->Veg.Type[i].Moist);
+    }
+    free(Total->Veg.Type);
+  }
+}
@@ -100,6 +100,12 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
     {"OPTIONS", "PRECIPITATION SEPARATION", "", "FALSE" },
     {"OPTIONS", "SNOW STATISTICS", "", "FALSE" },
     {"OPTIONS", "ROUTING NEIGHBORS", "", "4"},
+    {"OPTIONS", "FORCING PREFETCH DEPTH", "", "1"},
+    {"OPTIONS", "OUTPUT QUEUE SIZE", "", "64"},
+    {"OPTIONS", "STATE FORMAT", "", "MAPS"},
+    {"OPTIONS", "STATE COMPRESSION", "", "FALSE"},
+    {"OPTIONS", "ENSEMBLE MEMBERS", "", "1"},
+    {"OPTIONS", "TIMING TRACE FILE", "", ""},
     {"AREA", "COORDINATE SYSTEM", "", ""},
     {"AREA", "EXTREME NORTH", "", ""},
     {"AREA", "EXTREME WEST", "", ""},
@@ -177,6 +183,39 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   }
   printf("Using %d neighbors for surface/subsurface routing\n", NDIRS);
 
+  /* Determine how many time steps of forcing are read ahead */
+  if (!CopyInt(&(Options->PrefetchDepth), StrEnv[prefetch_depth].VarStr, 1) ||
+      Options->PrefetchDepth < 0)
+    ReportError(StrEnv[prefetch_depth].KeyName, 51);
+
+  /* Determine how much output can wait for the writer thread */
+  if (!CopyInt(&(Options->OutputQueueSize), StrEnv[output_queue_size].VarStr, 1) ||
+      Options->OutputQueueSize < 0)
+    ReportError(StrEnv[output_queue_size].KeyName, 51);
+
+  /* Determine how the model state is stored and restored */
+  if (strncmp(StrEnv[state_format].VarStr, "MAPS", 4) == 0)
+    Options->StateFormat = MAP_STATE;
+  else if (strncmp(StrEnv[state_format].VarStr, "CHECKPOINT", 10) == 0)
+    Options->StateFormat = CHECKPOINT_STATE;
+  else
+    ReportError(StrEnv[state_format].KeyName, 51);
+
+  if (strncmp(StrEnv[state_compression].VarStr, "TRUE", 4) == 0)
+    Options->StateCompression = TRUE;
+  else if (strncmp(StrEnv[state_compression].VarStr, "FALSE", 5) == 0)
+    Options->StateCompression = FALSE;
+  else
+    ReportError(StrEnv[state_compression].KeyName, 51);
+
+  /* Determine how many ensemble members are run */
+  if (!CopyInt(&(Options->EnsembleMembers), StrEnv[ensemble_members].VarStr, 1) ||
+      Options->EnsembleMembers < 1)
+    ReportError(StrEnv[ensemble_members].KeyName, 51);
+
+  /* Determine whether the time spent in each phase is traced */
+  strcpy(Options->TraceFile, StrEnv[timing_trace_file].VarStr);
+
   /* Determine how the flow gradient should be calculated */
   if (Options->Extent != POINT) {
     if (strncmp(StrEnv[gradient].VarStr, "TOPO", 4) == 0)
@@ -492,6 +531,13 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   Map->OffsetX = 0;
   Map->OffsetY = 0;
   Map->NumCells = 0;
+  Map->NumRuns = 0;
+  Map->Runs = NULL;
+  Map->RowRuns = NULL;
+  Map->FirstRow = 0;
+  Map->NRows = Map->NY;
+  Map->GlobalNY = Map->NY;
+  Map->GlobalY0 = 0;
 
   if (Options->Extent == POINT) {
     if (!CopyDouble(&PointModelY, StrEnv[point_north].VarStr, 1))
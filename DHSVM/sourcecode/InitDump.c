@@ -46,6 +46,8 @@
      int Dt                - Time step in seconds
      TOPOPIX **TopoMap     - Information about terrain characteristics
      DUMPSTRUCT *Dump      - Information on what to output when
+     char *Path            - Output directory, or NULL for the output
+                             directory in the input file
 
    Returns      : void
 
@@ -55,7 +57,7 @@
  *****************************************************************************/
 void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLayers, 
   int MaxVegLayers, int Dt, TOPOPIX **TopoMap, DUMPSTRUCT *Dump, int *NGraphics,
-  int **which_graphics)
+  int **which_graphics, char *Path)
 {
   char *Routine = "InitDump";
   int i;
@@ -66,6 +68,7 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
   int NMapVars;			/* Number of different variables for which to
                    dump maps */
   int temp_count;
+  double Accepted;		/* Dump pixels accepted by all processes */
   uchar **BasinMask;
   char sumoutfile[100];
 
@@ -78,6 +81,7 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
     {"OUTPUT", "NUMBER OF MAP VARIABLES", "", ""},
     {"OUTPUT", "NUMBER OF IMAGE VARIABLES", "", ""},
     {"OUTPUT", "NUMBER OF GRAPHICS", "", ""},
+    {"OUTPUT", "PIXEL DUMP FORMAT", "", "TEXT"},
     {NULL, NULL, "", NULL},
   };
 
@@ -89,13 +93,16 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
       StrEnv[i].VarStr, (unsigned long)BUFSIZE, Input);
 
   /* Assign the entries to the variables */
-  if (IsEmptyStr(StrEnv[output_path].VarStr))
+  if (Path != NULL)
+    strcpy(Dump->Path, Path);
+  else if (IsEmptyStr(StrEnv[output_path].VarStr))
     ReportError(StrEnv[output_path].KeyName, 51);
-  strcpy(Dump->Path, StrEnv[output_path].VarStr);
+  else
+    strcpy(Dump->Path, StrEnv[output_path].VarStr);
 
   // delete any previous failure_summary.txt file
   sprintf(sumoutfile, "%sfailure_summary.txt", Dump->Path);
-  if (remove(sumoutfile) != -1)
+  if (ParallelRank() == 0 && remove(sumoutfile) != -1)
     printf(" - removed old version of failure_summary.txt\n");
 
   if (IsEmptyStr(StrEnv[initial_state_path].VarStr))
@@ -133,17 +140,35 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
 
   Dump->NMaps = NMapVars + NImageVars;
 
+  if (strncmp(StrEnv[pixformat].VarStr, "TEXT", 4) == 0)
+    Dump->PixFormat = TEXT_PIXDUMP;
+  else if (strncmp(StrEnv[pixformat].VarStr, "BINARY", 6) == 0)
+    Dump->PixFormat = BINARY_PIXDUMP;
+  else
+    ReportError(StrEnv[pixformat].KeyName, 51);
+
+  /* only the first MPI process writes output, the files of the others
+     stay NULL */
+  Dump->Aggregate.FilePtr = NULL;
+  Dump->Balance.FilePtr = NULL;
+  Dump->FinalBalance.FilePtr = NULL;
+  Dump->Stream.FilePtr = NULL;
+
   // Open file for recording aggregated values for entire basin
   sprintf(Dump->Aggregate.FileName, "%sAggregated.Values", Dump->Path);
-  OpenFile(&(Dump->Aggregate.FilePtr), Dump->Aggregate.FileName, "w", TRUE);
+  if (ParallelRank() == 0)
+    OpenFile(&(Dump->Aggregate.FilePtr), Dump->Aggregate.FileName,
+      (Dump->PixFormat == BINARY_PIXDUMP) ? "wb" : "w", TRUE);
 
   // Open file for recording mass balance for entire basin
   sprintf(Dump->Balance.FileName, "%sMass.Balance", Dump->Path);
-  OpenFile(&(Dump->Balance.FilePtr), Dump->Balance.FileName, "w", TRUE);
+  if (ParallelRank() == 0)
+    OpenFile(&(Dump->Balance.FilePtr), Dump->Balance.FileName, "w", TRUE);
 
 #ifndef SNOW_ONLY
   sprintf(Dump->FinalBalance.FileName, "%sMass.Final.Balance", Dump->Path);
-  OpenFile(&(Dump->FinalBalance.FilePtr), Dump->FinalBalance.FileName, "w", TRUE);
+  if (ParallelRank() == 0)
+    OpenFile(&(Dump->FinalBalance.FilePtr), Dump->FinalBalance.FileName, "w", TRUE);
 #endif
 
   if (Options->Extent != POINT) {
@@ -164,17 +189,17 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
         BasinMask[y][x] = TopoMap[y][x].Mask;
 
     if (Dump->NPix > 0) {
+      /* each process keeps the dump pixels that it computes */
       temp_count = InitPixDump(Input, Map, BasinMask, Dump->Path, Dump->NPix,
-        &(Dump->Pix), Options);
+        &(Dump->Pix), Dump->PixFormat, Options);
+      Dump->NPix = temp_count;
+      Accepted = temp_count;
+      ParallelSum(&Accepted, 1);
 
-      if (temp_count == 0) {
-        Dump->NPix = 0;
+      if (Accepted == 0)
         printf("no candidate dump pixels accepted \n");
-      }
-      else {
-        Dump->NPix = temp_count;
-        printf("total number of accepted dump pixels %d \n", Dump->NPix);
-      }
+      else
+        printf("total number of accepted dump pixels %d \n", (int) Accepted);
     }
     for (y = 0; y < Map->NY; y++)
       free(BasinMask[y]);
@@ -193,7 +218,8 @@ void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map, int MaxSoilLay
     /* if no network open unit hydrograph file */
     if (!(Options->HasNetwork)) {
       sprintf(Dump->Stream.FileName, "%sStream.Flow", Dump->Path);
-      OpenFile(&(Dump->Stream.FilePtr), Dump->Stream.FileName, "w", TRUE);
+      if (ParallelRank() == 0)
+        OpenFile(&(Dump->Stream.FilePtr), Dump->Stream.FileName, "w", TRUE);
     }
   }
 }
@@ -506,15 +532,17 @@ void InitMapDump(LISTPTR Input, MAPSIZE * Map, int MaxSoilLayers,
     char *Path            - Directory to write output to
     int NPix              - Number of pixels to dump
     PIXDUMP **Pix         - Array of pixels to dump
+    int PixFormat         - TEXT_PIXDUMP or BINARY_PIXDUMP
 
   Returns      : number of accepted dump pixels (i.e. in the mask, etc)
 
   Modifies     : NPix and its members
 
-  Comments     :
+  Comments     : Returns the number of accepted pixels that are computed by
+                 this MPI process, which writes their dumps
 *******************************************************************************/
 int InitPixDump(LISTPTR Input, MAPSIZE *Map, uchar **BasinMask, char *Path,
-  int NPix, PIXDUMP **Pix, OPTIONSTRUCT *Options)
+  int NPix, PIXDUMP **Pix, int PixFormat, OPTIONSTRUCT *Options)
 {
   char *Routine = "InitPixDump";
   char Str[BUFSIZE + 1];
@@ -523,6 +551,7 @@ int InitPixDump(LISTPTR Input, MAPSIZE *Map, uchar **BasinMask, char *Path,
   int i;			/* counter */
   int j;
   int ok;
+  int Owned;			/* The pixel is computed by this process */
   char temp_name[BUFSIZE + 1];
   char KeyName[name + 1][BUFSIZE + 1];
   char *KeyStr[] = {
@@ -558,22 +587,30 @@ int InitPixDump(LISTPTR Input, MAPSIZE *Map, uchar **BasinMask, char *Path,
       ReportError(KeyName[name], 51);
     strcpy(temp_name, VarStr[name]);
 
-    /* Convert map coordinates to matrix coordinates */
-    (*Pix)[i].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY);
+    /* Convert map coordinates to matrix coordinates, in the rows held by
+       this process */
+    (*Pix)[i].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY) -
+      Map->GlobalY0;
     (*Pix)[i].Loc.E = Round((East - (Map->Xorig + 0.5 * Map->DX)) / Map->DX);
 
-    if (!InArea(Map, &((*Pix)[i].Loc)) ||
-      !INBASIN(BasinMask[(*Pix)[i].Loc.N][(*Pix)[i].Loc.E])) {
+    Owned = OwnsCell(Map, (*Pix)[i].Loc.N, (*Pix)[i].Loc.E) &&
+      INBASIN(BasinMask[(*Pix)[i].Loc.N][(*Pix)[i].Loc.E]);
+    if (ShareCellValue(Map, (*Pix)[i].Loc.N, (*Pix)[i].Loc.E,
+      (float) Owned) == 0) {
       printf("Ignoring dump command for pixel named %s \n", temp_name);
     }
     else {
       printf("Accepting dump command for pixel named %s \n", temp_name);
-      sprintf(Str, "%s", temp_name);
-      sprintf((*Pix)[ok].OutFile.FileName, "%sPixel.%s", Path, Str);
-      (*Pix)[ok].Loc.N = (*Pix)[i].Loc.N;
-      (*Pix)[ok].Loc.E = (*Pix)[i].Loc.E;
-      OpenFile(&((*Pix)[ok].OutFile.FilePtr), (*Pix)[ok].OutFile.FileName, "w", TRUE);
-      ok++;
+      if (Owned) {
+        sprintf(Str, "%s", temp_name);
+        sprintf((*Pix)[ok].OutFile.FileName, "%sPixel.%s", Path, Str);
+        (*Pix)[ok].Loc.N = (*Pix)[i].Loc.N;
+        (*Pix)[ok].Loc.E = (*Pix)[i].Loc.E;
+        (*Pix)[ok].OutFile.FilePtr = NULL;
+        OpenFile(&((*Pix)[ok].OutFile.FilePtr), (*Pix)[ok].OutFile.FileName,
+          (PixFormat == BINARY_PIXDUMP) ? "wb" : "w", TRUE);
+        ok++;
+      }
     }
   }
   return ok;
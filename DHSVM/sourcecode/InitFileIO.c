@@ -22,11 +22,31 @@
 #include "fifobin.h"
 #include "fifoNetCDF.h"
 #include "DHSVMerror.h"
+#include "functions.h"
+#include "sizeofnt.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 /* global function pointers */
 void (*CreateMapFileFmt) (char *FileName, ...);
 int (*Read2DMatrixFmt) (char *FileName, void *Matrix, int NumberType, int NY, int NX, int NDataSet, ...);
 int (*Write2DMatrixFmt) (char *FileName, void *Matrix, int NumberType, int NY, int NX, ...);
+int (*Read2DSubMatrixFmt) (char *FileName, void *Matrix, int NumberType, int NY, int NX, int NDataSet, char *VarName, int index, int Y0, int X0, int SubNY, int SubNX);
+int (*Read2DRowsFmt) (char *FileName, void *Matrix, int NumberType, int NY, int NX, int NDataSet, char *VarName, int index, int Y0, int X0, int SubNY, int SubNX);
+void (*CloseMapFilesFmt) (void);
+
+/* The forcing reader thread (see Prefetch.c) reads maps while the model
+   writes its output; the NetCDF library is not thread safe, so all map
+   files are accessed under a lock */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t FileIOLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCKFILEIO()   pthread_mutex_lock(&FileIOLock)
+#define UNLOCKFILEIO() pthread_mutex_unlock(&FileIOLock)
+#else
+#define LOCKFILEIO()
+#define UNLOCKFILEIO()
+#endif
 
 /*******************************************************************************
   Function name: InitFileIO()
@@ -95,13 +115,19 @@ void InitFileIO(int FileFormat)
     strcpy(fileext, ".bin");
     CreateMapFileFmt = CreateMapFileBin;
     Read2DMatrixFmt = Read2DMatrixBin;
+    Read2DSubMatrixFmt = Read2DSubMatrixBin;
+    Read2DRowsFmt = Read2DSubMatrixBin;
     Write2DMatrixFmt = Write2DMatrixBin;
+    CloseMapFilesFmt = NULL;
   }
   else if (FileFormat == BYTESWAP) {
     strcpy(fileext, ".bin");
     CreateMapFileFmt = CreateMapFileBin;
     Read2DMatrixFmt = Read2DMatrixByteSwapBin;
+    Read2DSubMatrixFmt = Read2DSubMatrixByteSwapBin;
+    Read2DRowsFmt = Read2DSubMatrixByteSwapBin;
     Write2DMatrixFmt = Write2DMatrixByteSwapBin;
+    CloseMapFilesFmt = NULL;
   }
   /************* NetCDF File Format (version 3.4) ****************/
   else if (FileFormat == NETCDF) {
@@ -109,7 +135,10 @@ void InitFileIO(int FileFormat)
     strcpy(fileext, ".nc");
     CreateMapFileFmt = CreateMapFileNetCDF;
     Read2DMatrixFmt = Read2DMatrixNetCDF;
+    Read2DSubMatrixFmt = Read2DSubMatrixNetCDF;
+    Read2DRowsFmt = Read2DRowsNetCDF;
     Write2DMatrixFmt = Write2DMatrixNetCDF;
+    CloseMapFilesFmt = CloseMapFilesNetCDF;
 #else
     ReportError((char *) Routine, 56);
 #endif
@@ -121,10 +150,18 @@ void InitFileIO(int FileFormat)
 /******************************************************************************/
 /*                            CreateMapFile                                   */
 /******************************************************************************/
+/** 
+ * Create a map file for the whole model area.  With MPI only the first
+ * process creates the file, which it writes the maps of all processes to.
+ */
 void
 CreateMapFile(char *FileName, char *FileLabel, MAPSIZE *Map)
 {
+  if ((Map = WholeMap(Map)) == NULL)
+    return;
+  LOCKFILEIO();
   CreateMapFileFmt(FileName, FileLabel, Map);
+  UNLOCKFILEIO();
 }
 
 
@@ -138,8 +175,8 @@ CreateMapFile(char *FileName, char *FileLabel, MAPSIZE *Map)
  * @param FileName name of file to read
  * @param Matrix  @e local 2D array (NX, NY) to be filled
  * @param NumberType 
- * @param NY 
- * @param NX 
+ * @param Map model area, of which only the rows held by this MPI process
+ *            are read from the map of the whole area in the file
  * @param NDataSet 
  * @param VarName 
  * @param index 
@@ -153,21 +190,109 @@ Read2DMatrix(char *FileName, void *Matrix, int NumberType, MAPSIZE *Map,
   const char Routine[] = "Read2DMatrix";
   int result;
 
-  result = Read2DMatrixFmt(FileName, Matrix, NumberType,
-                           Map->NY, Map->NX, NDataSet, VarName, index);
+  LOCKFILEIO();
+  if (Map->NY == Map->GlobalNY)
+    result = Read2DMatrixFmt(FileName, Matrix, NumberType,
+                             Map->NY, Map->NX, NDataSet, VarName, index);
+  else
+    result = Read2DRowsFmt(FileName, Matrix, NumberType, Map->GlobalNY,
+                           Map->NX, NDataSet, VarName, index, Map->GlobalY0,
+                           0, Map->NY, Map->NX);
+  UNLOCKFILEIO();
+  return result;
+}
+
+/******************************************************************************/
+/*                             Read2DSubMatrix                                */
+/******************************************************************************/
+/** 
+ * Read the window of rows Y0 to Y0 + NY - 1 and columns X0 to X0 + NX - 1
+ * of a map, without reading the rest of it
+ * 
+ * @param FileName name of file to read
+ * @param Matrix  array (NY, NX) to be filled
+ * @param NumberType 
+ * @param Map size of the maps in the file, which cover the whole model
+ *            area also if the grid is split over MPI processes
+ * @param Y0 first row of the window
+ * @param X0 first column of the window
+ * @param NY number of rows of the window
+ * @param NX number of columns of the window
+ * @param NDataSet 
+ * @param VarName 
+ * @param index 
+ * 
+ * @return as Read2DMatrix
+ */
+int 
+Read2DSubMatrix(char *FileName, void *Matrix, int NumberType, MAPSIZE *Map,
+                int Y0, int X0, int NY, int NX, int NDataSet, char *VarName,
+                int index)
+{
+  int result;
+
+  LOCKFILEIO();
+  result = Read2DSubMatrixFmt(FileName, Matrix, NumberType, Map->GlobalNY,
+                              Map->NX, NDataSet, VarName, index, Y0, X0, NY,
+                              NX);
+  UNLOCKFILEIO();
   return result;
 }
 
 /******************************************************************************/
 /*                              Write2DMatrix                                  */
 /******************************************************************************/
+/** 
+ * Write a map of the model area.  With MPI the bands of all processes are
+ * collected on the first process, which writes the map of the whole area,
+ * so all processes have to call it.
+ * 
+ * @param Map model area of this process
+ * 
+ * @return as the file format, and 0 on the processes that do not write
+ */
 int
 Write2DMatrix(char *FileName, void *Matrix, int NumberType, MAPSIZE *Map,
               MAPDUMP *DMap, int index)
 {
   const char Routine[] = "Write2DMatrix";
+  MAPSIZE *Whole;
+  void *WholeMatrix = NULL;
   int result;
+
+  Whole = WholeMap(Map);
+  if (Whole != Map) {
+    if (Whole != NULL &&
+        !(WholeMatrix = malloc((size_t) Whole->NY * Whole->NX *
+                               SizeOfNumberType(NumberType))))
+      ReportError((char *) Routine, 1);
+    GatherMap(Matrix, WholeMatrix, SizeOfNumberType(NumberType), Map);
+    if (Whole == NULL)
+      return 0;
+    Matrix = WholeMatrix;
+    Map = Whole;
+  }
+
+  LOCKFILEIO();
   result = Write2DMatrixFmt(FileName, Matrix, NumberType, 
                             Map->NY, Map->NX, DMap, index);
+  UNLOCKFILEIO();
+  free(WholeMatrix);
   return result;
 }
+
+/******************************************************************************/
+/*                              CloseMapFiles                                 */
+/******************************************************************************/
+/** 
+ * Close the map files that the file format keeps open (binary files are
+ * opened for each map and need nothing)
+ */
+void
+CloseMapFiles(void)
+{
+  LOCKFILEIO();
+  if (CloseMapFilesFmt != NULL)
+    CloseMapFilesFmt();
+  UNLOCKFILEIO();
+}
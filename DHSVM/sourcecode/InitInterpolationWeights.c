@@ -25,29 +25,31 @@
    InitInterpolationWeights()
  *****************************************************************************/
 void InitInterpolationWeights(MAPSIZE *Map, OPTIONSTRUCT *Options,
-  TOPOPIX **TopoMap, uchar ****MetWeights, METLOCATION *Stats, int NStats)
+  TOPOPIX **TopoMap, METWEIGHTS *MetWeights, METLOCATION *Stats, int NStats)
 {
   const char *Routine = "InitInterpolationWeights";
   uchar **BasinMask;
   int x;			/* counter */
   int y;			/* counter */
   int i;
+  int Owned;			/* The station cell is held by this process */
+  float Mask;
+  float Dem;
 
+  /* the station rows are those held by this process, so the cell of a
+     station is looked up on the process that computes it */
   if (Options->GRIDMET)
     for (i = 0; i < NStats; i++)
-      Stats[i].Elev = TopoMap[Stats[i].Loc.N][Stats[i].Loc.E].Dem;
+      Stats[i].Elev = ShareCellValue(Map, Stats[i].Loc.N, Stats[i].Loc.E,
+        OwnsCell(Map, Stats[i].Loc.N, Stats[i].Loc.E) ?
+        TopoMap[Stats[i].Loc.N][Stats[i].Loc.E].Dem : 0);
 
   if (Options->MM5 == TRUE && Options->QPF == FALSE) {
-    if (!((*MetWeights) = (uchar ***)calloc(Map->NY, sizeof(uchar **))))
+    /* no stations are used, so every pixel has an empty list */
+    if (!(MetWeights->Start = (int *)calloc(Map->NY * Map->NX + 1, sizeof(int))))
       ReportError("CalcWeights()", 1);
-
-    for (y = 0; y < Map->NY; y++)
-      if (!((*MetWeights)[y] = (uchar **)calloc(Map->NX, sizeof(uchar *))))
-        ReportError("CalcWeights()", 1);
-
-    for (y = 0; y < Map->NY; y++)
-      for (x = 0; x < Map->NX; x++)
-        (*MetWeights)[y][x] = NULL;
+    MetWeights->Station = NULL;
+    MetWeights->Weight = NULL;
   }
   else {
     if (!(BasinMask = (uchar **)calloc(Map->NY, sizeof(uchar *))))
@@ -67,16 +69,21 @@ void InitInterpolationWeights(MAPSIZE *Map, OPTIONSTRUCT *Options,
     printf("\nSummary info on met stations used for current model run \n");
     printf("        Name\t\tY\tX\tIn Mask\tDefined Elev\tActual Elev\n");
     for (i = 0; i < NStats; i++) {
-      if ((Stats[i].Loc.N > Map->NY || Stats[i].Loc.N < 0 ||
+      Owned = OwnsCell(Map, Stats[i].Loc.N, Stats[i].Loc.E);
+      Mask = ShareCellValue(Map, Stats[i].Loc.N, Stats[i].Loc.E,
+        Owned ? BasinMask[Stats[i].Loc.N][Stats[i].Loc.E] : 0);
+      Dem = ShareCellValue(Map, Stats[i].Loc.N, Stats[i].Loc.E,
+        Owned ? TopoMap[Stats[i].Loc.N][Stats[i].Loc.E].Dem : 0);
+      if ((Stats[i].Loc.N + Map->GlobalY0 > Map->GlobalNY ||
+        Stats[i].Loc.N + Map->GlobalY0 < 0 ||
         Stats[i].Loc.E > Map->NX || Stats[i].Loc.E < 0))
         printf("%20s\t%d\t%d\t%5s\t%5.1f\t\t%5s\n",
-          Stats[i].Name, Stats[i].Loc.N, Stats[i].Loc.E,
+          Stats[i].Name, Stats[i].Loc.N + Map->GlobalY0, Stats[i].Loc.E,
           "NA", Stats[i].Elev, "NA");
       else
         printf("%20s\t%d\t%d\t%d\t%5.1f\t\t%5.1f\n",
-          Stats[i].Name, Stats[i].Loc.N, Stats[i].Loc.E,
-          BasinMask[Stats[i].Loc.N][Stats[i].Loc.E], Stats[i].Elev,
-          TopoMap[Stats[i].Loc.N][Stats[i].Loc.E].Dem);
+          Stats[i].Name, Stats[i].Loc.N + Map->GlobalY0, Stats[i].Loc.E,
+          (int) Mask, Stats[i].Elev, Dem);
     }
     printf("\n");
 
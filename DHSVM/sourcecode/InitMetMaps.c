@@ -43,14 +43,14 @@ void InitMetMaps(LISTPTR Input, int NDaySteps, MAPSIZE *Map, MAPSIZE *Radar,
   RADARPIX ***RadarMap, PIXRAD ***RadMap,
   SOILPIX **SoilMap, LAYER *Soil, VEGPIX **VegMap,
   LAYER *Veg, TOPOPIX **TopoMap, float ****MM5Input,
-  float ****WindModel)
+  float ****WindModel, SLAB *Slab)
 {
   int y, x;
 
   printf("Initializing meteorological maps\n");
 
-  InitEvapMap(Map, EvapMap, SoilMap, Soil, VegMap, Veg, TopoMap);
-  InitPrecipMap(Map, PrecipMap, VegMap, Veg, TopoMap);
+  InitEvapMap(Map, EvapMap, SoilMap, Soil, VegMap, Veg, TopoMap, Slab);
+  InitPrecipMap(Map, PrecipMap, VegMap, Veg, TopoMap, Slab);
   InitPptMultiplierMap(Options, Map, PptMultiplierMap);                                                            
 
   if (Options->MM5 == TRUE) {
@@ -96,10 +96,13 @@ void InitMetMaps(LISTPTR Input, int NDaySteps, MAPSIZE *Map, MAPSIZE *Radar,
 
 /*****************************************************************************
   InitEvapMap()
+
+  The layer arrays of the basin cells are handed out from one block of the
+  slab, cell by cell.
 *****************************************************************************/
 void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
   LAYER *Soil, VEGPIX **VegMap, LAYER *Veg,
-  TOPOPIX **TopoMap)
+  TOPOPIX **TopoMap, SLAB *Slab)
 {
   const char *Routine = "InitEvapMap";
   int i;			/* counter */
@@ -107,6 +110,7 @@ void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
   int y;			/* counter */
   int NSoil;			/* Number of soil layers for current pixel */
   int NVeg;			/* Number of veg layers for current pixel */
+  size_t Bytes;			/* Room taken by the layer arrays */
 
   if (DEBUG)
     printf("Initializing evaporation map\n");
@@ -119,33 +123,35 @@ void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
       ReportError((char *)Routine, 1);
   }
 
+  Bytes = 0;
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
         NSoil = Soil->NLayers[(SoilMap[y][x].Soil - 1)];
-        assert(VegMap[y][x].Veg > 0 && SoilMap[y][x].Soil > 0);
-
-        if (!((*EvapMap)[y][x].EPot =
-          (float *)calloc(NVeg + 1, sizeof(float))))
-          ReportError((char *)Routine, 1);
-
-        if (!((*EvapMap)[y][x].EAct =
-          (float *)calloc(NVeg + 1, sizeof(float))))
-          ReportError((char *)Routine, 1);
-
-        if (!((*EvapMap)[y][x].EInt = (float *)calloc(NVeg, sizeof(float))))
-          ReportError((char *)Routine, 1);
+        Bytes += 2 * SlabBytes(NVeg + 1, sizeof(float)) +
+          SlabBytes(NVeg, sizeof(float)) + SlabBytes(NVeg, sizeof(float *)) +
+          NVeg * SlabBytes(NSoil, sizeof(float));
+      }
+    }
+  }
+  ReserveSlab(Slab, Bytes);
 
-        if (!((*EvapMap)[y][x].ESoil =
-          (float **)calloc(NVeg, sizeof(float *))))
-          ReportError((char *)Routine, 1);
+  for (y = 0; y < Map->NY; y++) {
+    for (x = 0; x < Map->NX; x++) {
+      if (INBASIN(TopoMap[y][x].Mask)) {
+        NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
+        NSoil = Soil->NLayers[(SoilMap[y][x].Soil - 1)];
+        assert(VegMap[y][x].Veg > 0 && SoilMap[y][x].Soil > 0);
 
-        for (i = 0; i < NVeg; i++) {
-          if (!((*EvapMap)[y][x].ESoil[i] =
-            (float *)calloc(NSoil, sizeof(float))))
-            ReportError((char *)Routine, 1);
-        }
+        (*EvapMap)[y][x].EPot = (float *)SlabAlloc(Slab, NVeg + 1, sizeof(float));
+        (*EvapMap)[y][x].EAct = (float *)SlabAlloc(Slab, NVeg + 1, sizeof(float));
+        (*EvapMap)[y][x].EInt = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
+        (*EvapMap)[y][x].ESoil =
+          (float **)SlabAlloc(Slab, NVeg, sizeof(float *));
+        for (i = 0; i < NVeg; i++)
+          (*EvapMap)[y][x].ESoil[i] =
+            (float *)SlabAlloc(Slab, NSoil, sizeof(float));
       }
     }
   }
@@ -153,14 +159,18 @@ void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
 
 /*****************************************************************************
   InitPrecipMap()
+
+  The interception arrays of the basin cells are handed out from one block
+  of the slab, cell by cell.
 *****************************************************************************/
 void InitPrecipMap(MAPSIZE * Map, PRECIPPIX *** PrecipMap, VEGPIX ** VegMap,
-  LAYER * Veg, TOPOPIX ** TopoMap)
+  LAYER * Veg, TOPOPIX ** TopoMap, SLAB *Slab)
 {
   const char *Routine = "InitPrecipMap";
   int x;			/* counter */
   int y;			/* counter */
   int NVeg;			/* Number of veg layers at current pixel */
+  size_t Bytes;			/* Room taken by the interception arrays */
 
   if (DEBUG)
     printf("Initializing precipitation map\n");
@@ -173,24 +183,23 @@ void InitPrecipMap(MAPSIZE * Map, PRECIPPIX *** PrecipMap, VEGPIX ** VegMap,
       ReportError((char *)Routine, 1);
   }
 
+  Bytes = 0;
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
-        if (!((*PrecipMap)[y][x].IntRain =
-          (float *)calloc(NVeg, sizeof(float))))
-          ReportError((char *)Routine, 1);
+        Bytes += 2 * SlabBytes(NVeg, sizeof(float));
       }
     }
   }
+  ReserveSlab(Slab, Bytes);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         NVeg = Veg->NLayers[(VegMap[y][x].Veg - 1)];
-        if (!((*PrecipMap)[y][x].IntSnow =
-          (float *)calloc(NVeg, sizeof(float))))
-          ReportError((char *)Routine, 1);
+        (*PrecipMap)[y][x].IntRain = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
+        (*PrecipMap)[y][x].IntSnow = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
       }
     }
   }
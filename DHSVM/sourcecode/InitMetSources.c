@@ -138,6 +138,7 @@ void InitStations(LISTPTR Input, MAPSIZE *Map, int NDaySteps,
   float East;
   float North;
   FILE *PrismStatFile;
+  METBIN *MetBin;
 
   /* Get the number of different stations */
   GetInitString(SectionName, "NUMBER OF STATIONS", "", VarStr[0],
@@ -148,6 +149,19 @@ void InitStations(LISTPTR Input, MAPSIZE *Map, int NDaySteps,
   if (*NStats <= 0)
     ReportError("Input Options File", 6);
 
+  /* The records of all stations can come from a single binary met file,
+     made by MakeMetBin from the station files in the order of the station
+     numbers.  In that case the station files are not opened. */
+  MetBin = NULL;
+  GetInitString(SectionName, "STATION BINARY FILE", "", VarStr[0],
+    (unsigned long)BUFSIZE, Input);
+  if (!IsEmptyStr(VarStr[0])) {
+    if (!(MetBin = (METBIN *)calloc(1, sizeof(METBIN))))
+      ReportError(Routine, 1);
+    OpenMetBin(VarStr[0], *NStats, MetBin);
+    printf("Reading the records of all stations from %s\n", VarStr[0]);
+  }
+
   printf("\nEvaluating %d Met stations for inclusion\n", *NStats);
 
   /* Allocate memory for the stations */
@@ -179,20 +193,32 @@ void InitStations(LISTPTR Input, MAPSIZE *Map, int NDaySteps,
     if (!CopyFloat(&East, VarStr[station_east], 1))
       ReportError(KeyName[station_east], 51);
 
-    (*Stat)[k].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY);
+    /* the row is that in the rows held by this process */
+    (*Stat)[k].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY) -
+      Map->GlobalY0;
     (*Stat)[k].Loc.E = Round((East - (Map->Xorig + 0.5 * Map->DX)) / Map->DX);
 
     if (!CopyFloat(&((*Stat)[k].Elev), VarStr[station_elev], 1))
       ReportError(KeyName[station_elev], 51);
 
-    if (IsEmptyStr(VarStr[station_file]))
-      ReportError(KeyName[station_file], 51);
-    strcpy((*Stat)[k].MetFile.FileName, VarStr[station_file]);
+    if (MetBin != NULL) {
+      strcpy((*Stat)[k].MetFile.FileName, VarStr[station_file]);
+      (*Stat)[k].MetFile.FilePtr = NULL;
+      (*Stat)[k].MetBin = MetBin;
+      (*Stat)[k].MetBinStation = i;
+    }
+    else {
+      if (IsEmptyStr(VarStr[station_file]))
+        ReportError(KeyName[station_file], 51);
+      strcpy((*Stat)[k].MetFile.FileName, VarStr[station_file]);
 
-    OpenFile(&((*Stat)[k].MetFile.FilePtr), (*Stat)[k].MetFile.FileName, "r", FALSE);
+      OpenFile(&((*Stat)[k].MetFile.FilePtr), (*Stat)[k].MetFile.FileName, "r", FALSE);
+      (*Stat)[k].MetBin = NULL;
+    }
 
     /* check to see if the stations are inside the bounding box */
-    if (((*Stat)[k].Loc.N >= Map->NY || (*Stat)[k].Loc.N < 0 ||
+    if (((*Stat)[k].Loc.N + Map->GlobalY0 >= Map->GlobalNY ||
+      (*Stat)[k].Loc.N + Map->GlobalY0 < 0 ||
       (*Stat)[k].Loc.E >= Map->NX || (*Stat)[k].Loc.E < 0)
       && Options->Outside == FALSE){
       k = k;
@@ -331,12 +357,14 @@ void InitGridMet(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
 		sprintf((*Stat)[k].Name, "data_%f_%f\n", lat, lon);
     printf("%f, %f, %f, %f\n", lat, lon, East, North);
 		
-		(*Stat)[k].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY);
+		(*Stat)[k].Loc.N = Round(((Map->Yorig - 0.5 * Map->DY) - North) / Map->DY) -
+          Map->GlobalY0;
         (*Stat)[k].Loc.E = Round((East - (Map->Xorig + 0.5 * Map->DX)) / Map->DX);
         m += 1;
 
         /* met grids must be with the bounding box of the basin */
-		if (((*Stat)[k].Loc.N >= Map->NY || (*Stat)[k].Loc.N < 0 ||
+		if (((*Stat)[k].Loc.N + Map->GlobalY0 >= Map->GlobalNY ||
+          (*Stat)[k].Loc.N + Map->GlobalY0 < 0 ||
           (*Stat)[k].Loc.E >= Map->NX || (*Stat)[k].Loc.E < 0)) {                                   
           //printf("..... Station %d outside the basin bounding box: %s ignored\n", m, (*Stat)[k].Name);           
 		  k = k;
@@ -344,7 +372,10 @@ void InitGridMet(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
         else {
           /* only include grids within the mask */
           if (Options->Outside == FALSE) {
-            if (INBASIN(TopoMap[(*Stat)[k].Loc.N][(*Stat)[k].Loc.E].Mask)) {
+            /* the mask is that of the process that holds the cell */
+            if (ShareCellValue(Map, (*Stat)[k].Loc.N, (*Stat)[k].Loc.E,
+                  OwnsCell(Map, (*Stat)[k].Loc.N, (*Stat)[k].Loc.E) &&
+                  INBASIN(TopoMap[(*Stat)[k].Loc.N][(*Stat)[k].Loc.E].Mask))) {
                                                                          
 			  /* open met data file */
               sprintf((*Stat)[k].MetFile.FileName, infileformat, Grid->filepath, Grid->fileprefix, lat, lon);
@@ -563,6 +594,14 @@ void InitMM5(LISTPTR Input, int NSoilLayers, TIMESTRUCT *Time,
 
   if (!CopyFloat(&(MM5Map->DY), StrEnv[MM5_dy].VarStr, 1))
     ReportError(StrEnv[MM5_dy].KeyName, 51);
+  /* MM5 cells are square */
+  MM5Map->DX = MM5Map->DY;
+
+  /* the MM5 maps are read whole, or by rows through Read2DSubMatrix() */
+  MM5Map->GlobalNY = MM5Map->NY;
+  MM5Map->GlobalY0 = 0;
+  MM5Map->FirstRow = 0;
+  MM5Map->NRows = MM5Map->NY;
 
   MM5Map->OffsetX = Round(((float)(MM5Map->Xorig - Map->Xorig)) /
     ((float)Map->DX));
@@ -575,7 +614,7 @@ void InitMM5(LISTPTR Input, int NSoilLayers, TIMESTRUCT *Time,
   printf("MM5 extreme north / south is %f %f \n", MM5Map->Yorig,
     MM5Map->Yorig - MM5Map->NY * MM5Map->DY);
   printf("MM5 extreme west / east is %f %f\n", MM5Map->Xorig,
-    MM5Map->Xorig + MM5Map->NX * MM5Map->DY);
+    MM5Map->Xorig + MM5Map->NX * MM5Map->DX);
   printf("MM5 rows is %d \n", MM5Map->NY);
   printf("MM5 cols is %d \n", MM5Map->NX);
   printf("MM5 dy is %f \n", MM5Map->DY);
@@ -613,21 +652,24 @@ void InitMM5(LISTPTR Input, int NSoilLayers, TIMESTRUCT *Time,
   printf("MM5 offset x is %d \n", MM5Map->OffsetX);
   printf("MM5 offset y is %d \n", MM5Map->OffsetY);
   printf("dhsvm extreme north / south is %f %f \n", Map->Yorig,
-    Map->Yorig - Map->NY * Map->DY);
+    Map->Yorig - Map->GlobalNY * Map->DY);
   printf("dhsvm extreme west / east is %f %f \n", Map->Xorig,
     Map->Xorig + Map->NX * Map->DY);
   printf("fail if %d > %d\n",
-    (int)((Map->NY + MM5Map->OffsetY) * Map->DY / MM5Map->DY),
+    (int)((Map->GlobalNY + MM5Map->OffsetY) * Map->DY / MM5Map->DY),
     MM5Map->NY);
   printf("fail if %d > %d\n",
-    (int)((Map->NX - MM5Map->OffsetX) * Map->DX / MM5Map->DY),
+    (int)((Map->NX - MM5Map->OffsetX) * Map->DX / MM5Map->DX),
     MM5Map->NX);
   
-  if ((int)((Map->NY + MM5Map->OffsetY) * Map->DY / MM5Map->DY) > MM5Map->NY
-    || (int)((Map->NX - MM5Map->OffsetX) * Map->DX / MM5Map->DY) >
+  if ((int)((Map->GlobalNY + MM5Map->OffsetY) * Map->DY / MM5Map->DY) > MM5Map->NY
+    || (int)((Map->NX - MM5Map->OffsetX) * Map->DX / MM5Map->DX) >
     MM5Map->NX)
     ReportError("Input Options File", 31);
 
+  /* from here on the offset is that of the rows held by this process */
+  MM5Map->OffsetY += Map->GlobalY0;
+
 }
 
 /*******************************************************************************
@@ -702,6 +744,10 @@ void InitRadar(LISTPTR Input, MAPSIZE * Map, TIMESTRUCT * Time,
   Radar->DXY = sqrt(Radar->DX * Radar->DX + Radar->DY * Radar->DY);     
   Radar->X = 0;
   Radar->Y = 0;
+  Radar->GlobalNY = Radar->NY;
+  Radar->GlobalY0 = 0;
+  Radar->FirstRow = 0;
+  Radar->NRows = Radar->NY;
   Radar->OffsetX = Round(((float)(Radar->Xorig - Map->Xorig)) /
     ((float)Map->DX));
   Radar->OffsetY = Round(((float)(Radar->Yorig - Map->Yorig)) /
@@ -709,6 +755,9 @@ void InitRadar(LISTPTR Input, MAPSIZE * Map, TIMESTRUCT * Time,
 
   if (Radar->OffsetX > 0 || Radar->OffsetY < 0)
     ReportError("Input Options File", 31);
+
+  /* the offset of the rows held by this process */
+  Radar->OffsetY += Map->GlobalY0;
 }
 
 /*******************************************************************************
@@ -9,7 +9,8 @@
  * DESCRIPTION:  Initialize the model state variables using initial conditions
  *               or a saved state from an earlier model run
  * DESCRIP-END.
- * FUNCTIONS:    InitModelState()
+ * FUNCTIONS:    ReadStateMap()
+ *               InitModelState()
  *
  * $Id: InitModelState.c, v 3.1.1  2013/1/4   Ning Exp $
  ******************************************************************************/
@@ -26,6 +27,21 @@
 #include "soilmoisture.h"
 #include "varid.h"
 
+/*****************************************************************************
+  ReadStateMap()
+
+  Read a state map from its map file, or from the checkpoint if there is one
+*****************************************************************************/
+static void ReadStateMap(CHECKPOINT *Checkpoint, char *FileName, void *Array,
+  MAPSIZE *Map, MAPDUMP *DMap, int NSet)
+{
+  if (Checkpoint != NULL)
+    GetCheckpointMap(Checkpoint, DMap->ID,
+      IsMultiLayer(DMap->ID) ? DMap->Layer : 0, Array, Map);
+  else
+    Read2DMatrix(FileName, Array, DMap->NumberType, Map, NSet, DMap->Name, 0);
+}
+
  /*****************************************************************************
    Function name: InitModelState()
 
@@ -43,14 +59,15 @@
      of files.  This allows restarts of the model from any timestep for which
      the model state is known.  These model states can be stored using the
      routine StoreModelState().  Timesteps at which to dump the model state
-     can be specified in the file with dump information.
+     can be specified in the file with dump information.  With Checkpoint
+     not NULL the state is read from that checkpoint instead.
 
  *****************************************************************************/
 void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Options, PRECIPPIX **PrecipMap,
-  SNOWPIX **SnowMap, SOILPIX **SoilMap, LAYER Soil, SOILTABLE *SType,
-  VEGPIX **VegMap, LAYER Veg, VEGTABLE *VType, char *Path, 
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, LAYER Soil,
+  SOILTABLE *SType, VEGPIX **VegMap, LAYER Veg, VEGTABLE *VType, char *Path, 
   TOPOPIX **TopoMap, ROADSTRUCT **Network, UNITHYDRINFO *HydrographInfo,
-  float *Hydrograph)
+  float *Hydrograph, CHECKPOINT *Checkpoint)
 {
   const char *Routine = "InitModelState";
   char Str[NAMESIZE + 1];
@@ -58,6 +75,8 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   FILE *HydroStateFile;
   int i, j;		         /* counter */
   int CountGap, Count;
+  int InBand;			/* The cell is in the band of this process */
+  double Counts[2];
   int x;				 /* counter */
   int y;				 /* counter */
   int NSet;				 /* Number of dataset to be read */
@@ -92,7 +111,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -118,7 +137,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -142,7 +161,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -171,7 +190,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   GetVarAttr(&DMap);
   if (!(Array = (float *)calloc(Map->NY * Map->NX, SizeOfNumberType(DMap.NumberType))))
     ReportError((char *)Routine, 1);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -184,7 +203,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -197,7 +216,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -210,7 +229,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -223,7 +242,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -236,7 +255,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -249,7 +268,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -263,7 +282,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -311,7 +330,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -344,7 +363,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -359,7 +378,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+    ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
@@ -374,7 +393,7 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
@@ -387,11 +406,11 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Read2DMatrix(FileName, Array, DMap.NumberType, Map, NSet++, DMap.Name, 0);
+  ReadStateMap(Checkpoint, FileName, Array, Map, &DMap, NSet++);
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
-        SoilMap[y][x].IExcess = ((float *)Array)[y * Map->NX + x];
+        SoilFlow->IExcess[y * Map->NX + x] = ((float *)Array)[y * Map->NX + x];
       }
     }
   }
@@ -404,19 +423,20 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
     for (x = 0; x < Map->NX; x++) {
       /* SatFlow needs to be initialized properly in the future.
       For now it will just be set to zero here */
-      SoilMap[y][x].SatFlow = 0.0;
+      SoilFlow->SatFlow[y * Map->NX + x] = 0.0;
       if (INBASIN(TopoMap[y][x].Mask)) {
-        if ((SoilMap[y][x].TableDepth =
-          WaterTableDepth((Soil.NLayers[SoilMap[y][x].Soil - 1]), SoilMap[y][x].Depth,
+        if ((SoilFlow->TableDepth[y * Map->NX + x] =
+          WaterTableDepth((Soil.NLayers[SoilMap[y][x].Soil - 1]),
+            SoilFlow->Depth[y * Map->NX + x],
             VType[VegMap[y][x].Veg - 1].RootDepth, SoilMap[y][x].Porosity,
             SoilMap[y][x].FCap, Network[y][x].Adjust, SoilMap[y][x].Moist)) < 0.0)
           /* ReportError((char *) Routine, 35); */ {
-            remove -= SoilMap[y][x].TableDepth * Map->DX * Map->DY;
-            SoilMap[y][x].TableDepth = 0.0;
+            remove -= SoilFlow->TableDepth[y * Map->NX + x] * Map->DX * Map->DY;
+            SoilFlow->TableDepth[y * Map->NX + x] = 0.0;
         }
       }
       else {
-        SoilMap[y][x].TableDepth = 0;
+        SoilFlow->TableDepth[y * Map->NX + x] = 0;
       }
     }
   }
@@ -427,11 +447,16 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
 
   /* If the unit hydrograph is used for flow routing, initialize the unit hydrograph array */
   if (Options->Extent == BASIN && Options->HasNetwork == FALSE) {
-    sprintf(FileName, "%sHydrograph.State.%s", Path, Str);
-    OpenFile(&HydroStateFile, FileName, "r", FALSE);
-    for (i = 0; i < HydrographInfo->TotalWaveLength; i++)
-      fscanf(HydroStateFile, "%f\n", &(Hydrograph[i]));
-    fclose(HydroStateFile);
+    if (Checkpoint != NULL)
+      GetCheckpointField(Checkpoint, CKP_HYDROGRAPH, 0, Hydrograph,
+        HydrographInfo->TotalWaveLength);
+    else {
+      sprintf(FileName, "%sHydrograph.State.%s", Path, Str);
+      OpenFile(&HydroStateFile, FileName, "r", FALSE);
+      for (i = 0; i < HydrographInfo->TotalWaveLength; i++)
+        fscanf(HydroStateFile, "%f\n", &(Hydrograph[i]));
+      fclose(HydroStateFile);
+    }
   }
   // Initialize the flood detention storage in each pixel for impervious fraction > 0 situation. 
   for (y = 0; y < Map->NY; y++) {
@@ -450,9 +475,12 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
 	for (y = 0; y < Map->NY; y++) {
 	  for (x = 0; x < Map->NX; x++) {
 		if (INBASIN(TopoMap[y][x].Mask)) {
-		  Count += 1;
+		  /* the rows on either side of the band are counted by the
+		     processes that compute them */
+		  InBand = (y >= Map->FirstRow && y < Map->FirstRow + Map->NRows);
+		  Count += InBand;
 		  if (VegMap[y][x].Gapping > 0.0) {
-			CountGap += 1;
+			CountGap += InBand;
 			for (i = 0; i < CELL_PARTITION; i++) {
 			  VegMap[y][x].Type[i].TPack = SnowMap[y][x].TPack;
 			  VegMap[y][x].Type[i].SurfWater = SnowMap[y][x].SurfWater;
@@ -475,6 +503,11 @@ void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Op
 	  }
 	}
 	/* total number of grid cells with a gap structure */
+    Counts[0] = CountGap;
+    Counts[1] = Count;
+    ParallelSum(Counts, 2);
+    CountGap = (int) Counts[0];
+    Count = (int) Counts[1];
     TotNumGap = CountGap;
     printf("\n****Canopy Gap****\n%d out of %d cells have a gap structure\n\n", TotNumGap, Count);
   }
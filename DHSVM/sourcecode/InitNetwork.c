@@ -31,10 +31,11 @@
    Purpose      : Initialize road/channel work.  Memory is allocated, and the
                   necessary adjustments for the soil profile are calculated
 
-   Comments     :
+   Comments     : Map is the window of this process.  The road counts and
+                  the impervious routing file cover the whole grid
  *****************************************************************************/
-void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
-  SOILPIX **SoilMap, VEGPIX **VegMap, VEGTABLE *VType,
+void InitNetwork(MAPSIZE *Map, TOPOPIX **TopoMap,
+  SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, VEGTABLE *VType,
   ROADSTRUCT ***Network, CHANNEL *ChannelData,
   LAYER Veg, OPTIONSTRUCT *Options)
 {
@@ -49,6 +50,11 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
                 with a road and channel */
   int numroadschan;      /* Counter of number of pixels
                 with a road */
+  int NY = Map->NY;
+  int NX = Map->NX;
+  float DX = Map->DX;
+  float DY = Map->DY;
+  double Counts[2];
   FILE *inputfile;
   /* Allocate memory for network structure */
 
@@ -85,7 +91,7 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
         if (INBASIN(TopoMap[y][x].Mask)) {
           ChannelCut(y, x, ChannelData, &((*Network)[y][x]));
           AdjustStorage(VType[VegMap[y][x].Veg - 1].NSoilLayers,
-            SoilMap[y][x].Depth,
+            SoilFlow->Depth[y * NX + x],
             VType[VegMap[y][x].Veg - 1].RootDepth,
             (*Network)[y][x].Area, DX, DY,
             (*Network)[y][x].BankHeight,
@@ -94,9 +100,11 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
             &((*Network)[y][x].CutBankZone));
           (*Network)[y][x].IExcess = 0.;
           if (channel_grid_has_channel(ChannelData->road_map, x, y)) {
-            numroads++;
-            if (channel_grid_has_channel(ChannelData->stream_map, x, y)) {
-              numroadschan++;
+            if (y >= Map->FirstRow && y < Map->FirstRow + Map->NRows) {
+              numroads++;
+              if (channel_grid_has_channel(ChannelData->stream_map, x, y)) {
+                numroadschan++;
+              }
             }
             (*Network)[y][x].fraction =
               ChannelFraction(&(TopoMap[y][x]), ChannelData->road_map[x][y]);
@@ -144,6 +152,12 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
     }
   }
 
+  Counts[0] = numroads;
+  Counts[1] = numroadschan;
+  ParallelSum(Counts, 2);
+  numroads = (int) Counts[0];
+  numroadschan = (int) Counts[1];
+
   if (numroads > 0) {
     printf("There are %d pixels with a road and %d with a road and a channel.\n",
       numroads, numroadschan);
@@ -174,22 +188,24 @@ void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap,
         "The code find_nearest_channel.c will make the file\n");
       ReportError(Options->ImperviousFilePath, 3);
     }
+    /* the file lists the basin cells of the whole grid in row order; the
+       cells in the rows above the window are skipped */
     for (y = 0; y < NY; y++) {
       for (x = 0; x < NX; x++) {
         if (INBASIN(TopoMap[y][x].Mask)) {
-          if (fscanf(inputfile, "%d %d %d %d \n", &sy, &sx, &miny, &minx) !=
-            EOF) {
-            TopoMap[y][x].drains_x = minx;
-            TopoMap[y][x].drains_y = miny;
-          }
-          else {
-            ReportError(Options->ImperviousFilePath, 63);
-          }
-          if (sx != x || sy != y) {
+          do {
+            if (fscanf(inputfile, "%d %d %d %d \n", &sy, &sx, &miny, &minx) ==
+              EOF)
+              ReportError(Options->ImperviousFilePath, 63);
+          } while (sy < Map->GlobalY0);
+          TopoMap[y][x].drains_x = minx;
+          TopoMap[y][x].drains_y = miny;
+          if (sx != x || sy != y + Map->GlobalY0) {
             ReportError(Options->ImperviousFilePath, 64);
           }
         }
       }
     }
+    fclose(inputfile);
   }
 }
@@ -12,6 +12,7 @@
  * FUNCTIONS:    InitNewMonth()
  *               InitNewDay()
  *               InitNewStep()
+ *               InitNewWaterLevel()
  *               InitNewWaterYear()
  * COMMENTS:
  * $Id: InitNewMonth.c,v 3.1 2013/02/06 ning Exp $
@@ -48,7 +49,7 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
   char VarName[BUFSIZE + 1];	/* Variable name */
   int i;
   int j, jj;
-  int y, x;
+  int y, x, run;
   float a, b, l;
   int NumberType;
   float *Array = NULL;
@@ -85,6 +86,15 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
     else ReportError((char *)Routine, 57);
 
     free(Array);
+
+    /* the PRISM value of each station, from the process that holds its
+       cell */
+    if (Options->Outside == FALSE)
+      for (i = 0; i < NStats; i++)
+        Stat[i].PrismPrecip[Time->Current.Month - 1] =
+          ShareCellValue(Map, Stat[i].Loc.N, Stat[i].Loc.E,
+            OwnsCell(Map, Stat[i].Loc.N, Stat[i].Loc.E) ?
+            PrismMap[Stat[i].Loc.N][Stat[i].Loc.E] : 0);
   }
 
   if (Options->Shading == TRUE) {
@@ -116,8 +126,8 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
   printf("changing LAI, albedo and diffuse transmission parameters\n");
 
   for (y = 0; y < Map->NY; y++) {
-		for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+		for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
         for (j = 0; j < VType[(*VegMap)[y][x].Veg - 1].NVegLayers; j++) {
           (*VegMap)[y][x].LAI[j] = (*VegMap)[y][x].LAIMonthly[j][Time->Current.Month - 1];
           /*Due to LAI and FC change, have to change MaxInt to spatial as well*/
@@ -188,20 +198,20 @@ void InitNewDay(int DayOfYear, SOLARGEOMETRY * SolarGeo)
 /* UpdateMM5Field                                                              */
 /******************************************************************************/
 static void
-UpdateMM5Field(char *input, int Step, MAPSIZE *Map, MAPSIZE *MM5Map,
-               float *Array, float **MM5InputField)
+UpdateMM5Field(MAPSIZE *Map, MM5GATHER *Gather, float *Array,
+               float **MM5InputField)
 {
+  int *Cell;
   int x;
   int y;
-  const int NumberType = NC_FLOAT;
-  int MM5Y, MM5X;
+  int run;
 
-  Read2DMatrix(input, Array, NumberType, MM5Map, Step, "", 0);
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      MM5Y = (int)((y + MM5Map->OffsetY) * Map->DY / MM5Map->DY);
-      MM5X = (int)((x - MM5Map->OffsetX) * Map->DX / MM5Map->DY);
-      MM5InputField[y][x] = Array[MM5Y * MM5Map->NX + MM5X];
+    Cell = &(Gather->Cell[y * Map->NX]);
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+        MM5InputField[y][x] = Array[Cell[x]];
+      }
     }
   }
 }
@@ -223,14 +233,14 @@ UpdateMM5Field(char *input, int Step, MAPSIZE *Map, MAPSIZE *MM5Map,
     METLOCATION *Stat        - Structure with information about the
                                meteorological stations in or near the study
                                area
-    char *RadarFileName      - Name of file with radar images
+    PREFETCH *Prefetch       - Read-ahead of the station, MM5 and radar
+                               files
     MAPSIZE Radar            - Structure with information about the
                                precipitation radar coverage
     RADARPIX **RadarMap      - Structure with precipitation information for
                                each radar pixel
     SOLARGEOMETRY *SolarGeo  - structure with information about Earth-Sun
                                geometry
-    SOILPIX **SoilMap        - structure with soil information
     float ***MM5Input        - MM5 input maps
     float ***WindModel       - Wind model maps
 
@@ -242,25 +252,16 @@ UpdateMM5Field(char *input, int Step, MAPSIZE *Map, MAPSIZE *MM5Map,
 *****************************************************************************/
 void InitNewStep(INPUTFILES *InFiles, MAPSIZE *Map, TIMESTRUCT *Time,
                  int NSoilLayers, OPTIONSTRUCT *Options, int NStats,
-                 METLOCATION *Stat, char *RadarFileName, MAPSIZE *Radar,
+                 METLOCATION *Stat, PREFETCH *Prefetch, MAPSIZE *Radar,
                  RADARPIX **RadarMap, SOLARGEOMETRY *SolarGeo,
-                 TOPOPIX **TopoMap, SOILPIX **SoilMap,
                  float ***MM5Input, float **PrecipLapseMap, 
                  float ***WindModel, MAPSIZE *MM5Map)
 {
-  const char *Routine = "InitNewStep";
   int i;			/* counter */
-  int j;			/* counter */
   int x;			/* counter */
   int y;			/* counter */
-  int Step;			/* Step in the MM5 Input */
-  float *Array = NULL;
-  int MM5Y, MM5X;
-  int rdprecip, rdstep;
-  uchar first;
-  const int NumberType = NC_FLOAT;
-
-  first = IsEqualTime(&(Time->Current), &(Time->Start));
+  FORCING *Forcing;		/* Forcing read for this step */
+  MM5GATHER *Gather = &(Prefetch->MM5Gather);
 
   /*printf("current time is %4d-%2d-%2d-%2d\n", Time->Current.Year,Time->Current.Month, Time->Current.Day, Time->Current.Hour);*/
 
@@ -276,25 +277,13 @@ void InitNewStep(INPUTFILES *InFiles, MAPSIZE *Map, TIMESTRUCT *Time,
             &(SolarGeo->SolarTimeStep), &(SolarGeo->SunMax),
             &(SolarGeo->SolarAzimuth));
 
-  if (Options->MM5 == TRUE) {
-    /* Read the data from the MM5 files */
-    if (!(Array = (float *)calloc(MM5Map->NY * MM5Map->NX, sizeof(float))))
-      ReportError((char *)Routine, 1);
+  /* The files have been read, possibly ahead of time, by the forcing
+     reader; the fields read for this step are stored here */
+  Forcing = GetForcing(Prefetch, Time);
 
-    Step = NumberOfSteps(&(Time->StartMM5), &(Time->Current), Time->Dt);
-
-    UpdateMM5Field(InFiles->MM5Temp, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_temperature - 1]);
-    UpdateMM5Field(InFiles->MM5Humidity, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_humidity - 1]);
-    UpdateMM5Field(InFiles->MM5Wind, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_wind - 1]);
-    UpdateMM5Field(InFiles->MM5ShortWave, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_shortwave - 1]);
-    UpdateMM5Field(InFiles->MM5LongWave, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_longwave - 1]);
-    UpdateMM5Field(InFiles->MM5Precipitation, Step, Map, MM5Map, Array,
-                   MM5Input[MM5_precip - 1]);
+  if (Options->MM5 == TRUE) {
+    for (i = MM5_temperature - 1; i < MM5_precip; i++)
+      UpdateMM5Field(Map, Gather, Forcing->MM5[i], MM5Input[i]);
 
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
@@ -306,43 +295,18 @@ void InitNewStep(INPUTFILES *InFiles, MAPSIZE *Map, TIMESTRUCT *Time,
       }
     }
 
-    /* Terrain does not change during the simulation, so only read it
+    /* Terrain does not change during the simulation, so it is only read
        at step 0 */
-    if (first) {
-      rdstep = 0;
-      UpdateMM5Field(InFiles->MM5Terrain, rdstep, Map, MM5Map, Array,
+    if (Forcing->MM5Read[MM5_terrain - 1])
+      UpdateMM5Field(Map, Gather, Forcing->MM5[MM5_terrain - 1],
                      MM5Input[MM5_terrain - 1]);
-    }
 
     if (strlen(InFiles->MM5Lapse) > 0) {
-      rdprecip = 0;
-      rdstep = 0;
-
-      switch (InFiles->MM5LapseFreq) {
-      case (FreqSingle):
-        if (first) {
-          rdprecip = 1;
-          rdstep = 0;
-        }
-        break;
-      case (FreqMonth):
-        rdstep = Time->Current.Month - 1;
-        rdprecip = 1;
-        break;
-      case (FreqContinous):
-        /* Step unchanged */
-        rdprecip = 1;
-        rdstep = Step;
-        break;
-      default:
-        ReportError("InitNewStep", 15);
-      }
-      if (rdprecip) {
-        UpdateMM5Field(InFiles->MM5Lapse, rdstep, Map, MM5Map, Array,
+      if (Forcing->MM5Read[MM5_lapse - 1])
+        UpdateMM5Field(Map, Gather, Forcing->MM5[MM5_lapse - 1],
                        MM5Input[MM5_lapse - 1]);
-      }
       
-    } else if (first) {
+    } else if (Forcing->First) {
       
       /* If a MM5 temperature lapse map is not specified, fill the map
          with the domain-wide temperature lapse rate (which must be
@@ -356,81 +320,75 @@ void InitNewStep(INPUTFILES *InFiles, MAPSIZE *Map, TIMESTRUCT *Time,
     }
 
     if (Options->HeatFlux == TRUE) {
-
-
-      for (i = 0, j = MM5_lapse; i < NSoilLayers; i++, j++) {
-        UpdateMM5Field(InFiles->MM5SoilTemp[i], Step, Map, MM5Map, Array,
-                       MM5Input[j]);
+      for (i = MM5_lapse; i < MM5_lapse + NSoilLayers; i++) {
+        UpdateMM5Field(Map, Gather, Forcing->MM5[i], MM5Input[i]);
       }
     }
-    free(Array);
 
-    /* MM5 precip lapse rate is at the DEM resolution, so needs to be
-       read differently */
-
-    if (strlen(InFiles->PrecipLapseFile) > 0) {
-
-      rdprecip = 0;
-      
+    /* MM5 precip lapse rate is at the DEM resolution */
 
-      switch (InFiles->MM5PrecipDistFreq) {
-      case (FreqSingle):
-        if (first) {
-          rdprecip = 1;
-          rdstep = 0;
-        }
-        break;
-      case (FreqMonth):
-        rdstep = Time->Current.Month - 1;
-        rdprecip = 1;
-        break;
-      case (FreqContinous):
-        /* Step unchanged */
-        rdprecip = 1;
-        rdstep = Step;
-        break;
-      default:
-        ReportError("InitNewStep", 15);
-      }
-
-      if (rdprecip) {
-
-        if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
-          ReportError((char *)Routine, 1);
-        
-        
-        Read2DMatrix(InFiles->PrecipLapseFile, Array, NumberType, Map, rdstep, "", 0);
-        for (y = 0; y < Map->NY; y++) {
-          for (x = 0; x < Map->NX; x++) {
-            PrecipLapseMap[y][x] = Array[y * Map->NX + x];
-          }
+    if (Forcing->PrecipLapseRead) {
+      for (y = 0; y < Map->NY; y++) {
+        for (x = 0; x < Map->NX; x++) {
+          PrecipLapseMap[y][x] = Forcing->PrecipLapse[y * Map->NX + x];
         }
-        free(Array);
       }
     }
 
   }
   /*end if MM5*/
 
-    /* if the flow gradient is based on the water table, recalculate the water
-       table gradients.  Flow directions are now calculated in RouteSubSurface*/
+  if ((Options->MM5 == TRUE && Options->QPF == TRUE) || Options->MM5 == FALSE)
+    GetMetData(Options, NSoilLayers, NStats, SolarGeo->SunMax, Stat, Radar,
+      RadarMap, Forcing);
+}
+
+/*****************************************************************************
+  Function name: InitNewWaterLevel()
+
+  Purpose      : Calculate the height of the water table above the datum,
+                 from which the water table gradients are calculated
+
+  Required     :
+    OPTIONSTRUCT *Options    - structure with information on program options
+    MAPSIZE *Map             - structure with information about the model
+                               area
+    TOPOPIX **TopoMap        - structure with topographic information
+    SOILPIX **SoilMap        - structure with soil information
+    SOILFLOWMAP *SoilFlow    - water table depth of each cell
+
+  Returns      : void
+
+  Modifies     : WaterLevel in SoilMap
+
+  Comments     : To be executed at the beginning of each time step, after
+                 InitNewStep().  This used to be part of InitNewStep(), but
+                 it depends on the soil state, which is different for each
+                 ensemble member.
+*****************************************************************************/
+void InitNewWaterLevel(OPTIONSTRUCT *Options, MAPSIZE *Map,
+                       TOPOPIX **TopoMap, SOILPIX **SoilMap,
+                       SOILFLOWMAP *SoilFlow)
+{
+  int x;			/* counter */
+  int y;			/* counter */
+  int run;			/* run of basin cells */
+
+  /* if the flow gradient is based on the water table, recalculate the water
+     table gradients.  Flow directions are now calculated in RouteSubSurface*/
   if (Options->FlowGradient == WATERTABLE) {
     /* Calculate the WaterLevel, i.e. the height of the water table above
        some datum */
     for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        if (INBASIN(TopoMap[y][x].Mask)) {
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
           SoilMap[y][x].WaterLevel =
-            TopoMap[y][x].Dem - SoilMap[y][x].TableDepth;
+            TopoMap[y][x].Dem - SoilFlow->TableDepth[y * Map->NX + x];
         }
       }
     }
     /*     HeadSlopeAspect(Map, TopoMap, SoilMap); */
   }
-
-  if ((Options->MM5 == TRUE && Options->QPF == TRUE) || Options->MM5 == FALSE)
-    GetMetData(Options, Time, NSoilLayers, NStats, SolarGeo->SunMax, Stat,
-      Radar, RadarMap, RadarFileName);
 }
 
 /*****************************************************************************
@@ -441,7 +399,7 @@ void InitNewWaterYear(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
                 TOPOPIX **TopoMap, SNOWPIX **SnowMap)
 {
   const char *Routine = "InitNewYear";
-  int y, x;
+  int y, x, run;
   if (DEBUG)
     printf("Initializing new water year \n");
 
@@ -451,8 +409,8 @@ void InitNewWaterYear(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
   if (Options->SnowStats == TRUE) {
     printf("resetting SWE stats map %d \n", Time->Current.Year);
     for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        if (INBASIN(TopoMap[y][x].Mask)) {
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
           SnowMap[y][x].MaxSwe = 0.0;
           SnowMap[y][x].MaxSweDate = 0;
           SnowMap[y][x].MeltOutDate = 0;
@@ -10,6 +10,8 @@
  * DESCRIP-END.
  * FUNCTIONS:    InitTerrainMaps()
  *               InitTopoMap()
+ *               CountBasinCells()
+ *               InitActiveCells()
  *               InitSoilMap()
  *               InitVegMap()
  * COMMENTS:
@@ -30,21 +32,26 @@
 #include "slopeaspect.h"
 #include "varid.h"
 
+/* Cells of the basin mask read at once by CountBasinCells() */
+#define MASKBLOCKCELLS 1048576
+
  /*****************************************************************************
    InitTerrainMaps()
  *****************************************************************************/
 void InitTerrainMaps(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   LAYER *Soil, LAYER *Veg, TOPOPIX ***TopoMap, SOILTABLE *SType, SOILPIX ***SoilMap, 
-  VEGTABLE *VType, VEGPIX ***VegMap)
+  SOILFLOWMAP *SoilFlow, VEGTABLE *VType, VEGPIX ***VegMap, SLAB *Slab)
 
 {
   printf("\nInitializing terrain maps\n");
 
   InitTopoMap(Input, Options, Map, TopoMap);
-  InitSoilMap(Input, Options, Map, Soil, *TopoMap, SoilMap, SType);
+  InitSoilMap(Input, Options, Map, Soil, *TopoMap, SoilMap, SoilFlow, SType,
+	      Slab);
   InitVegMap(Options, Input, Map, VegMap, VType);
   if (Options->CanopyGapping)
-    InitCanopyGapMap(Options, Input, Map, Soil, Veg, VType, VegMap, SType, SoilMap);
+    InitCanopyGapMap(Options, Input, Map, Soil, Veg, VType, VegMap, SType, SoilMap,
+		     Slab);
 }
 
 /*****************************************************************************
@@ -166,13 +173,141 @@ void InitTopoMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
       }
     }
   }
+  ParallelMin(&MINELEV, 1);
+
+  /* index the cells in the basin, now that the mask is final */
+  InitActiveCells(Map, *TopoMap);
+}
+
+/*****************************************************************************
+  CountBasinCells()
+
+  Count the basin cells in each row of the model area, from the basin mask,
+  so that the rows can be split over the MPI processes before any map is
+  read.  The mask is read MASKBLOCKCELLS cells at a time, so the whole mask
+  is never held in memory.
+*****************************************************************************/
+void CountBasinCells(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+  int *RowCells)
+{
+  const char *Routine = "CountBasinCells";
+  char VarName[BUFSIZE + 1];	/* Variable name */
+  char MaskFile[BUFSIZE + 1];	/* Basin mask */
+  MAPSIZE Block;		/* Rows read at once */
+  unsigned char *Mask;
+  int BlockRows;
+  int NumberType;
+  int flag;
+  int i;
+  int x;
+  int y;
+  int y0;
+
+  GetInitString("TERRAIN", "BASIN MASK FILE", "", MaskFile,
+    (unsigned long)BUFSIZE, Input);
+  if (IsEmptyStr(MaskFile))
+    ReportError("BASIN MASK FILE", 51);
+
+  GetVarName(002, 0, VarName);
+  GetVarNumberType(002, &NumberType);
+  BlockRows = MAX(1, MIN(Map->NY, MASKBLOCKCELLS / Map->NX));
+  if (!(Mask = (unsigned char *)calloc(BlockRows * Map->NX,
+    SizeOfNumberType(NumberType))))
+    ReportError((char *)Routine, 1);
+
+  Block = *Map;
+  for (y0 = 0; y0 < Map->NY; y0 += Block.NY) {
+    Block.NY = MIN(BlockRows, Map->NY - y0);
+    Block.GlobalY0 = y0;
+    flag = Read2DMatrix(MaskFile, Mask, NumberType, &Block, 0, VarName, 0);
+
+    /* the rows are reversed if flag = 1 & netcdf option is selected */
+    if (!((Options->FileFormat == NETCDF && flag == 0) ||
+      (Options->FileFormat == BIN) ||
+      (Options->FileFormat == NETCDF && flag == 1)))
+      ReportError((char *)Routine, 57);
+    for (i = 0; i < Block.NY; i++) {
+      y = (Options->FileFormat == NETCDF && flag == 1) ?
+        y0 + Block.NY - 1 - i : y0 + i;
+      RowCells[y] = 0;
+      for (x = 0; x < Map->NX; x++)
+        if (INBASIN(Mask[i * Map->NX + x]))
+          RowCells[y]++;
+    }
+  }
+  free(Mask);
+}
+
+/*****************************************************************************
+  InitActiveCells()
+
+  Build a compact index of the cells within the basin.  The cells are
+  stored as runs of adjacent basin cells within a row, in row-major order,
+  so that a traversal of the basin visits the cells in the same order as a
+  sweep over the full NY x NX grid, without testing the mask of every cell.
+  The runs in row y are Map->Runs[Map->RowRuns[y]] up to, but not including,
+  Map->Runs[Map->RowRuns[y + 1]], which allows rows to be handed out to 
+  threads:
+
+    for (y = 0; y < Map->NY; y++)
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++)
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++)
+          ...
+*****************************************************************************/
+void InitActiveCells(MAPSIZE *Map, TOPOPIX **TopoMap)
+{
+  const char *Routine = "InitActiveCells";
+  int x;
+  int y;
+  int run;
+
+  if (!(Map->RowRuns = (int *) calloc(Map->NY + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+
+  /* count the runs first */
+  Map->NumRuns = 0;
+  for (y = 0; y < Map->NY; y++) {
+    for (x = 0; x < Map->NX; x++) {
+      if (INBASIN(TopoMap[y][x].Mask) && 
+          (x == 0 || !INBASIN(TopoMap[y][x - 1].Mask)))
+        Map->NumRuns++;
+    }
+  }
+
+  if (!(Map->Runs = (CELLRUN *) calloc(Map->NumRuns > 0 ? Map->NumRuns : 1, 
+                                       sizeof(CELLRUN))))
+    ReportError((char *) Routine, 1);
+
+  run = 0;
+  for (y = 0; y < Map->NY; y++) {
+    Map->RowRuns[y] = run;
+    x = 0;
+    while (x < Map->NX) {
+      if (INBASIN(TopoMap[y][x].Mask)) {
+        Map->Runs[run].y = y;
+        Map->Runs[run].x0 = x;
+        while (x < Map->NX && INBASIN(TopoMap[y][x].Mask))
+          x++;
+        Map->Runs[run].x1 = x;
+        run++;
+      }
+      else
+        x++;
+    }
+  }
+  Map->RowRuns[Map->NY] = run;
 }
 
 /*****************************************************************************
   InitSoilMap()
+
+  The layer arrays of the soil map are handed out from the slab, with a
+  block for the field capacity and porosity of all cells and one for the
+  moisture, percolation and temperature of the basin cells.
 *****************************************************************************/
 void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
-  LAYER * Soil, TOPOPIX ** TopoMap, SOILPIX *** SoilMap, SOILTABLE * SType)
+  LAYER * Soil, TOPOPIX ** TopoMap, SOILPIX *** SoilMap, SOILFLOWMAP * SoilFlow,
+  SOILTABLE * SType, SLAB * Slab)
 {
   const char *Routine = "InitSoilMap";
   char VarName[BUFSIZE + 1];	/* Variable name */
@@ -188,6 +323,8 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   int flag;
   int NSet;
   int sidx;
+  int NSoil;			/* Number of soil layers of a cell */
+  size_t Bytes;			/* Room taken by the layer arrays */
   
   STRINIENTRY StrEnv[] = {
     {"SOILS", "SOIL MAP FILE", "", ""},
@@ -206,6 +343,18 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
     if (!((*SoilMap)[y] = (SOILPIX *)calloc(Map->NX, sizeof(SOILPIX))))
       ReportError((char *)Routine, 1);
   }
+  if (!(SoilFlow->Depth = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(SoilFlow->KsLat = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(SoilFlow->TableDepth = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(SoilFlow->SatFlow = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(SoilFlow->IExcess = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(SoilFlow->Runoff = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
+    ReportError((char *)Routine, 1);
 
   /* Read the key-entry pairs from the input file */
   for (i = 0; StrEnv[i].SectionName; i++) {
@@ -261,14 +410,14 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   {
     for (y = 0, i = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++, i++) {
-        (*SoilMap)[y][x].Depth = Depth[i];
+        SoilFlow->Depth[y * Map->NX + x] = Depth[i];
       }
     }
   }
   else if (Options->FileFormat == NETCDF && flag == 1) {
     for (y = Map->NY - 1, i = 0; y >= 0; y--) {
       for (x = 0; x < Map->NX; x++, i++) {
-        (*SoilMap)[y][x].Depth = Depth[i];
+        SoilFlow->Depth[y * Map->NX + x] = Depth[i];
       }
     }
   }
@@ -293,9 +442,9 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
         for (y = 0, i = 0; y < Map->NY; y++) {
           for (x = 0; x < Map->NX; x++, i++) {
             if (KsLat[i] > 0.0)
-              (*SoilMap)[y][x].KsLat = KsLat[i]/1000.0;
+              SoilFlow->KsLat[y * Map->NX + x] = KsLat[i]/1000.0;
             else
-              (*SoilMap)[y][x].KsLat = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
+              SoilFlow->KsLat[y * Map->NX + x] = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
           }
         }
       }
@@ -303,9 +452,9 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
         for (y = Map->NY - 1, i = 0; y >= 0; y--) {
           for (x = 0; x < Map->NX; x++, i++) {
             if (KsLat[i] > 0.0)
-              (*SoilMap)[y][x].KsLat = KsLat[i]/1000.0;
+              SoilFlow->KsLat[y * Map->NX + x] = KsLat[i]/1000.0;
             else
-              (*SoilMap)[y][x].KsLat = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
+              SoilFlow->KsLat[y * Map->NX + x] = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
           }
         }
       }
@@ -317,7 +466,7 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
     printf("Spatial lateral conductivity map not provided, generating map\n");
     for (y = 0, i = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++, i++) {
-          (*SoilMap)[y][x].KsLat = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
+          SoilFlow->KsLat[y * Map->NX + x] = SType[(*SoilMap)[y][x].Soil - 1].KsLat;
       }
     }
   }
@@ -326,12 +475,15 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   /* Read the spatial field capacity map */
   GetVarNumberType(014, &NumberType);
 
-  /*Allocate memory*/  
+  /*Allocate memory, together with that for the porosity*/  
+  ReserveSlab(Slab, 2 * Map->NY * Map->NX *
+	      SlabBytes(Soil->MaxLayers, sizeof(float)));
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
-      if (!((*SoilMap)[y][x].FCap =
-            (float *)calloc(Soil->MaxLayers, sizeof(float *))))
-        ReportError((char *)Routine, 1);
+      (*SoilMap)[y][x].FCap =
+	(float *)SlabAlloc(Slab, Soil->MaxLayers, sizeof(float));
+      (*SoilMap)[y][x].Porosity =
+	(float *)SlabAlloc(Slab, Soil->MaxLayers, sizeof(float));
     }
   }
   /*Creating spatial layered field capacity*/
@@ -406,14 +558,6 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
   //
   /* Read the spatial porosity map */
   GetVarNumberType(013, &NumberType);
-  /*Allocate memory for porosity*/  
-  for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (!((*SoilMap)[y][x].Porosity =
-            (float *)calloc(Soil->MaxLayers, sizeof(float *))))
-        ReportError((char *)Routine, 1);
-    }
-  }
   /*Creating spatial layered porosity*/
   if (strncmp(StrEnv[porosity_file].VarStr, "none", 4)) {
     printf("Spatial soil porosity map provided, reading map\n");   
@@ -492,6 +636,18 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
    /******************************************************************/
    /******************************************************************/
 
+  Bytes = 0;
+  for (y = 0, i = 0; y < Map->NY; y++) {
+    for (x = 0; x < Map->NX; x++, i++) {
+      if (INBASIN(TopoMap[y][x].Mask)) {
+        NSoil = Soil->NLayers[Type[i] - 1];
+        Bytes += SlabBytes(NSoil + 1, sizeof(float)) +
+          2 * SlabBytes(NSoil, sizeof(float));
+      }
+    }
+  }
+  ReserveSlab(Slab, Bytes);
+
   for (y = 0, i = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++, i++) {
       if (Options->Infiltration == DYNAMIC)
@@ -501,15 +657,11 @@ void InitSoilMap(LISTPTR Input, OPTIONSTRUCT * Options, MAPSIZE * Map,
       /* allocate memory for the number of root layers, plus an additional
        layer below the deepest root layer */
       if (INBASIN(TopoMap[y][x].Mask)) {
-        if (!((*SoilMap)[y][x].Moist =
-          (float *)calloc((Soil->NLayers[Type[i] - 1] + 1), sizeof(float))))
-          ReportError((char *)Routine, 1);
-        if (!((*SoilMap)[y][x].Perc =
-          (float *)calloc(Soil->NLayers[Type[i] - 1], sizeof(float))))
-          ReportError((char *)Routine, 1);
-        if (!((*SoilMap)[y][x].Temp =
-          (float *)calloc(Soil->NLayers[Type[i] - 1], sizeof(float))))
-          ReportError((char *)Routine, 1);
+        NSoil = Soil->NLayers[Type[i] - 1];
+        (*SoilMap)[y][x].Moist =
+          (float *)SlabAlloc(Slab, NSoil + 1, sizeof(float));
+        (*SoilMap)[y][x].Perc = (float *)SlabAlloc(Slab, NSoil, sizeof(float));
+        (*SoilMap)[y][x].Temp = (float *)SlabAlloc(Slab, NSoil, sizeof(float));
       }
       else {
         (*SoilMap)[y][x].Moist = NULL;
@@ -815,10 +967,13 @@ void InitVegMap(OPTIONSTRUCT * Options, LISTPTR Input, MAPSIZE * Map, VEGPIX ***
 
 /*****************************************************************************
 InitCanopyGapMap()
+
+The gap and forest parts of each cell, and their layer arrays, are handed
+out from one block of the slab.
 *****************************************************************************/
 void InitCanopyGapMap(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
   LAYER *Soil, LAYER *Veg, VEGTABLE *VType, VEGPIX ***VegMap, 
-  SOILTABLE *SType, SOILPIX ***SoilMap)
+  SOILTABLE *SType, SOILPIX ***SoilMap, SLAB *Slab)
 {
   const char *Routine = "InitCanopyGapMap";
   char VarName[BUFSIZE + 1];
@@ -831,6 +986,7 @@ void InitCanopyGapMap(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
   int NSoil;
   int NumberType;		/* number type */
   float *Gap;		/* gap diameter */
+  size_t Bytes;			/* Room taken by the parts of a cell */
 
   /* Get the canopy gap map filename from the [VEGETATION] section */
   GetInitString("VEGETATION", "CANOPY GAP MAP FILE", "", CanopyMapFileName,
@@ -874,33 +1030,30 @@ void InitCanopyGapMap(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
   }
   else ReportError((char *)Routine, 57);
 
+  NVeg = Veg->MaxLayers;
+  NSoil = Soil->MaxLayers;
+  Bytes = SlabBytes(2, sizeof(CanopyGapStruct)) + CELL_PARTITION *
+    (3 * SlabBytes(NVeg, sizeof(float)) + SlabBytes(NSoil + 1, sizeof(float)) +
+     2 * SlabBytes(NVeg + 1, sizeof(float)) + SlabBytes(NVeg, sizeof(float *)) +
+     NVeg * SlabBytes(NSoil, sizeof(float)));
+  if (Options->CanopyGapping)
+    ReserveSlab(Slab, Map->NY * Map->NX * Bytes);
+
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
-      NVeg = Veg->MaxLayers;
-      NSoil = Soil->MaxLayers;
       if (Options->CanopyGapping) {
-        if (!((*VegMap)[y][x].Type = (CanopyGapStruct *)calloc(2, sizeof(CanopyGapStruct))))
-          ReportError((char *)Routine, 1);
+        (*VegMap)[y][x].Type =
+          (CanopyGapStruct *)SlabAlloc(Slab, 2, sizeof(CanopyGapStruct));
         for (i = 0; i < CELL_PARTITION; i++) {
-          if (!((*VegMap)[y][x].Type[i].IntRain = (float *)calloc(NVeg, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].IntSnow = (float *)calloc(NVeg, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].Moist = (float *)calloc(NSoil+1, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EPot = (float *)calloc(NVeg+1, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EAct = (float *)calloc(NVeg+1, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].EInt = (float *)calloc(NVeg, sizeof(float))))
-            ReportError((char *)Routine, 1);
-          if (!((*VegMap)[y][x].Type[i].ESoil = (float **)calloc(NVeg, sizeof(float *))))
-            ReportError((char *)Routine, 1);
-
-          for (j = 0; j < NVeg; j++) {
-            if (!((*VegMap)[y][x].Type[i].ESoil[j] = (float *)calloc(NSoil, sizeof(float))))
-              ReportError((char *)Routine, 1);
-          }
+          (*VegMap)[y][x].Type[i].IntRain = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
+          (*VegMap)[y][x].Type[i].IntSnow = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
+          (*VegMap)[y][x].Type[i].Moist = (float *)SlabAlloc(Slab, NSoil+1, sizeof(float));
+          (*VegMap)[y][x].Type[i].EPot = (float *)SlabAlloc(Slab, NVeg+1, sizeof(float));
+          (*VegMap)[y][x].Type[i].EAct = (float *)SlabAlloc(Slab, NVeg+1, sizeof(float));
+          (*VegMap)[y][x].Type[i].EInt = (float *)SlabAlloc(Slab, NVeg, sizeof(float));
+          (*VegMap)[y][x].Type[i].ESoil = (float **)SlabAlloc(Slab, NVeg, sizeof(float *));
+          for (j = 0; j < NVeg; j++)
+            (*VegMap)[y][x].Type[i].ESoil[j] = (float *)SlabAlloc(Slab, NSoil, sizeof(float));
         }
       }
     }
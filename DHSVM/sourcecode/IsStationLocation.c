@@ -23,7 +23,8 @@
 
 /*****************************************************************************
 function  : IsStationLocation()
-input     : Current Location, address of structure with station data, and
+input     : Current Location, grid of the station locations (see
+            InitStationGrid()), address of structure with station data, and
             pointer to int indicating which station is at current location 
 	    (if any)
 output    : TRUE if the current location coincides with a station
@@ -31,17 +32,30 @@ output    : TRUE if the current location coincides with a station
 modifies  : integer indicating which station is at current location
 programmer: Bart Nijssen
 
-This routine determines whether there is a station at the current location
+This routine determines whether there is a station at the current location.
+Only the stations in the bucket that contains the location are checked.  They
+are listed by increasing index, so if several stations share the location the
+first one is returned, as before.
 *****************************************************************************/
-uchar IsStationLocation(COORD * Loc, int NStats, METLOCATION * Station,
+uchar IsStationLocation(COORD * Loc, STATIONGRID * Grid, METLOCATION * Station,
 			int *WhichStation)
 {
   int i;			/* Station Counter */
+  int n, e;			/* Bucket of the location */
 
-  for (i = 0, *WhichStation = NOTSAME; i < NStats &&
-       *WhichStation == NOTSAME; i++) {
-    if (Loc->N == Station[i].Loc.N && Loc->E == Station[i].Loc.E) {
-      *WhichStation = i;
+  *WhichStation = NOTSAME;
+  if (Loc->N < Grid->N0 || Loc->E < Grid->E0)
+    return FALSE;
+  n = (Loc->N - Grid->N0) / Grid->Size;
+  e = (Loc->E - Grid->E0) / Grid->Size;
+  if (n >= Grid->NN || e >= Grid->NE)
+    return FALSE;
+
+  for (i = Grid->Start[n * Grid->NE + e];
+       i < Grid->Start[n * Grid->NE + e + 1]; i++) {
+    if (Loc->N == Station[Grid->Station[i]].Loc.N &&
+        Loc->E == Station[Grid->Station[i]].Loc.E) {
+      *WhichStation = Grid->Station[i];
       return TRUE;
     }
   }
@@ -9,6 +9,8 @@
  * DESCRIPTION:  Lapse temperature with elevation
  * DESCRIP-END.
  * FUNCTIONS:    LapseT()
+ *               LapsePrecip()
+ *               AirPressure()
  * COMMENTS:
  * $Id: LapseT.c,v 1.4 2003/07/01 21:26:19 olivier Exp $     
  */
@@ -37,13 +39,13 @@
 
   Modifies     : None
 
-  Comments     :
+  Comments     : Calls LapseTRun() for a run of one cell
 *****************************************************************************/
 float LapseT(float Temp, float FromElev, float ToElev, float LapseRate)
 {
   float LapsedTemp;
 
-  LapsedTemp = Temp + (ToElev - FromElev) * LapseRate;
+  LapseTRun(1, Temp, FromElev, &ToElev, LapseRate, &LapsedTemp);
 
   return LapsedTemp;
 }
@@ -63,20 +65,46 @@ float LapseT(float Temp, float FromElev, float ToElev, float LapseRate)
 
   Modifies     : None
 
-  Comments     : Used to lapse precip with elevation.
+  Comments     : Used to lapse precip with elevation.  Calls
+                 LapsePrecipRun() for a run of one cell
 *****************************************************************************/
 float LapsePrecip(float Precip, float FromElev, float ToElev, 
   float PrecipLapse, float precipMultiplier)
 {
   float LapsedPrecip;		/* Precipitation at ToElev (m/timestep) */
 
-  LapsedPrecip = Precip * (1.0 + PrecipLapse * (ToElev - FromElev))
-	  * (1 + precipMultiplier * (ToElev - MINELEV));
-
-  if (LapsedPrecip < 0.0)
-    LapsedPrecip = 0.0;
+  LapsePrecipRun(1, Precip, FromElev, &ToElev, PrecipLapse,
+		 &precipMultiplier, &LapsedPrecip);
 
   return LapsedPrecip;
+}
+
+/*****************************************************************************
+  Function name: AirPressure()
+
+  Purpose      : Air pressure at an elevation
+
+  Required     :
+    float LapseRate - Temperature lapse rate (C/m)
+    float Elev      - Elevation (m)
+
+  Returns      :
+    float Press     - Air pressure (Pa)
+
+  Modifies     : None
+
+  Comments     : Pressure of a standard atmosphere of 288 K at sea level,
+                 with the temperature changing linearly with elevation.
+                 In rare cases - i.e. when the lapse rate has a different
+                 sign for different met stations - the interpolated lapse
+                 rate can be 0.0, in which case the pressure at sea level is
+                 returned.  Calls AirPressureRun() for a run of one cell
+*****************************************************************************/
+float AirPressure(float LapseRate, float Elev)
+{
+  float Press;
 
+  AirPressureRun(1, &LapseRate, &Elev, &Press);
 
+  return Press;
 }
@@ -21,6 +21,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "settings.h"
 #include "constants.h"
 #include "data.h"
@@ -30,6 +33,7 @@
 #include "getinit.h"
 #include "DHSVMChannel.h"
 #include "channel.h"
+#include "slopeaspect.h"
 
 /******************************************************************************/
 /*				GLOBAL VARIABLES                              */
@@ -40,6 +44,9 @@ char *version = "Version 3.2";        /* store version string */
 char commandline[BUFSIZE + 1] = "";		/* store command line */
 char fileext[BUFSIZ + 1] = "";			/* file extension */
 char errorstr[BUFSIZ + 1] = "";			/* error message */
+
+void cleanup(DUMPSTRUCT *Dump, CHANNEL *ChannelData, OPTIONSTRUCT *Options);
+
 /******************************************************************************/
 /*				      MAIN                                    */
 /******************************************************************************/
@@ -54,8 +61,8 @@ int main(int argc, char **argv)
   float ***WindModel = NULL;
   float **PptMultiplierMap = NULL;                                  
   int MaxStreamID, MaxRoadID;
-  clock_t start, finish1;
   double runtime = 0.0;
+  double NumCells;				/* Number of basin cells of all processes */
   int t = 0;
   float roadarea;
   int i;
@@ -63,8 +70,13 @@ int main(int argc, char **argv)
   int x;						/* row counter */
   int y;						/* column counter */
   int shade_offset;				/* a fast way of handling arraay position given the number of mm5 input options */
+  int pass;						/* pixel loop pass: 0 no stream channel, 1 stream channel */
+  int tile;						/* tile counter */
+  int NTiles;					/* number of tiles of TILEROWS rows */
+  int run;						/* run of basin cells in Map.Runs */
+  int m;						/* ensemble member */
   int NStats;					/* Number of meteorological stations */
-  uchar ***MetWeights = NULL;	/* 3D array with weights for interpolating meteorological variables between the stations */
+  METWEIGHTS MetWeights = { NULL, NULL, NULL };	/* Sparse table with weights for interpolating meteorological variables between the stations */
 
   int NGraphics;				/* number of graphics for X11 */
   int *which_graphics;			/* which graphics for X11 */
@@ -77,26 +89,30 @@ int main(int argc, char **argv)
     {0.0, 0.0, 0, NULL, NULL, 0.0, 0, 0.0, 0.0, 0.0, 0.0, NULL, NULL},				  /* ROADSTRUCT*/
 	  {0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
 	  0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0},     /* SNOWPIX */ 
-    {0, 0.0, NULL, NULL, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, NULL, NULL},			                /* SOILPIX */
+    {0, NULL, NULL, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, NULL, NULL},			                /* SOILPIX */
     {0, 0, 0.0, 0.0, 0.0, NULL, NULL, NULL, NULL, 0.0},                             /* VEGPIX */
-    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0l, 0.0, 0.0
+    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0l, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
   };
   CHANNEL ChannelData = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, 
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+  CHECKPOINT *Checkpoint = NULL;	/* Model state to restart from, if in a single file */
   DUMPSTRUCT Dump;
+  ENSEMBLEMEMBER *Members = NULL;	/* Members of an ensemble run */
   EVAPPIX **EvapMap = NULL;
   INPUTFILES InFiles;
   LAYER Soil;
   LAYER Veg;
   LISTPTR Input = NULL;			/* Linked list with input strings */
-  MAPSIZE Map;					/* Size and location of model area */
+  MAPSIZE Map;					/* Size and location of model area held by this MPI process */
+  MAPSIZE LocalMap;				/* Part of the model area computed by this MPI process */
   MAPSIZE Radar;				/* Size and location of area covered by precipitation radar */
   MAPSIZE MM5Map;				/* Size and location of area covered by MM5 input files */
   GRID Grid;
   METLOCATION *Stat = NULL;
   OPTIONSTRUCT Options;			/* Structure with information which program options to follow */
   PIXMET LocalMet;				/* Meteorological conditions for current pixel */
+  PREFETCH Prefetch;			/* Read-ahead of the forcing files */
   PRECIPPIX **PrecipMap = NULL;
   RADARPIX **RadarMap	= NULL;
   PIXRAD **RadiationMap = NULL;
@@ -104,10 +120,15 @@ int main(int argc, char **argv)
   SNOWPIX **SnowMap		= NULL;
   MET_MAP_PIX **MetMap	= NULL;
   SOILPIX **SoilMap		= NULL;
+  SOILFLOWMAP SoilFlow = { NULL, NULL, NULL, NULL, NULL, NULL };	/* Soil fields used in the routing */
+  SLAB Slab = { NULL, 0, 0, 0 };	/* Memory for the layer arrays of the cells */
   SOILTABLE *SType	    = NULL;
   SOLARGEOMETRY SolarGeo;		/* Geometry of Sun-Earth system (needed for INLINE radiation calculations */
   TIMESTRUCT Time;
   TOPOPIX **TopoMap = NULL;
+  FLOWDIRMAP FlowDir = { NULL, NULL, NULL };	/* Work space for water table and snow surface flow directions */
+  SUBFLOWPIX *SubFlowMap = NULL;	/* Work space for subsurface routing */
+  DRAINMAP DrainMap = { NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, NULL };	/* Cells that drain to each cell */
   UNITHYDR **UnitHydrograph = NULL;
   UNITHYDRINFO HydrographInfo;	/* Information about unit hydrograph */
   VEGPIX **VegMap = NULL;
@@ -119,6 +140,8 @@ int main(int argc, char **argv)
 /*****************************************************************************
   Initialization Procedures 
 *****************************************************************************/
+  InitParallel(&argc, &argv);
+
   if (argc != 2) {
     fprintf(stderr, "\nUsage: %s inputfile\n\n", argv[0]);
     fprintf(stderr, "DHSVM uses two output streams: \n");
@@ -132,7 +155,8 @@ int main(int argc, char **argv)
 
   sprintf(commandline, "%s %s", argv[0], argv[1]);
   printf("%s \n", commandline);
-  fprintf(stderr, "%s \n", commandline);
+  if (ParallelRank() == 0)
+    fprintf(stderr, "%s \n", commandline);
   strcpy(InFiles.Const, argv[1]);
 
   printf("\nRunning DHSVM %s\n", version);
@@ -141,40 +165,62 @@ int main(int argc, char **argv)
   printf("WARNING: USING SNOW ONLY MODULES (prescribed in makefile)!\n");
   printf("----------------------------------\n");
 #endif
+#ifdef _OPENMP
+  printf("Using %d threads for the pixel calculations\n", omp_get_max_threads());
+#endif
+  if (ParallelSize() > 1)
+    printf("Using %d MPI processes\n", ParallelSize());
   printf("\nSTARTING INITIALIZATION PROCEDURES\n\n");
 
   /* Start recording time */
-  start = clock();
+  InitTiming();
 
   /* initiate input/output format */
 
+  StartTimer(TIMER_INITTABLES);
   ReadInitFile(InFiles.Const, &Input);
   InitConstants(Input, &Options, &Map, &SolarGeo, &Time);
+  OpenTrace(Options.TraceFile);
 
   InitFileIO(Options.FileFormat);
   InitTables(Time.NDaySteps, Input, &Options, &Map, &SType, &Soil, &VType, &Veg); 
+  StopTimer(TIMER_INITTABLES);
+
+  /* split the model area over the MPI processes; from here on Map is the
+     window of rows that this process holds */
+  DecomposeDomain(Input, &Options, &Map);
+
+  StartTimer(TIMER_INITTERRAIN);
+  InitTerrainMaps(Input, &Options, &Map, &Soil, &Veg, &TopoMap, SType, &SoilMap, &SoilFlow, VType, &VegMap,
+		  &Slab);
 
-  InitTerrainMaps(Input, &Options, &Map, &Soil, &Veg, &TopoMap, SType, &SoilMap, VType, &VegMap);
+  if (Options.FlowGradient == WATERTABLE || Options.SnowSlide)
+    InitFlowDirMap(&Map, &FlowDir);
+  InitSubFlowMap(&Map, &SubFlowMap);
 
   InitSnowMap(&Map, &SnowMap, &Time);
 
   InitMappedConstants(Input, &Options, &Map, &SnowMap);
 
-  CheckOut(&Options, Veg, Soil, VType, SType, &Map, TopoMap, VegMap, SoilMap);
+  CheckOut(&Options, Veg, Soil, VType, SType, &Map, TopoMap, VegMap, SoilMap, &SoilFlow);
+  StopTimer(TIMER_INITTERRAIN);
 
 #ifdef TOPO_DUMP
   DumpTopo(&Map, TopoMap);
 #endif
   
+  StartTimer(TIMER_INITCHANNEL);
   if (Options.HasNetwork)
-    InitChannel(Input, &Map, Time.Dt, &ChannelData, SoilMap, &MaxStreamID, &MaxRoadID, &Options);
+    InitChannel(Input, &Map, Time.Dt, &ChannelData, &SoilFlow, &MaxStreamID, &MaxRoadID, &Options);
   else if (Options.Extent != POINT)
     InitUnitHydrograph(Input, &Map, TopoMap, &UnitHydrograph,
 		       &Hydrograph, &HydrographInfo);
  
-  InitNetwork(Map.NY, Map.NX, Map.DX, Map.DY, TopoMap, SoilMap, 
+  InitNetwork(&Map, TopoMap, &SoilFlow, 
 	      VegMap, VType, &Network, &ChannelData, Veg, &Options);
+  StopTimer(TIMER_INITCHANNEL);
 
+  StartTimer(TIMER_INITMET);
   InitMetSources(Input, &Options, &Map, TopoMap, Soil.MaxLayers, &Time,
 		 &InFiles, &NStats, &Stat, &Radar, &MM5Map, &Grid);
 
@@ -190,10 +236,13 @@ int main(int argc, char **argv)
     printf("To disable this feature set Snotel OPTION to FALSE\n");
     for (i = 0; i < NStats; i++) {
       printf("veg type for station %d is %d ", i,
-	     VegMap[Stat[i].Loc.N][Stat[i].Loc.E].Veg);
+	     (int) ShareCellValue(&Map, Stat[i].Loc.N, Stat[i].Loc.E,
+	       OwnsCell(&Map, Stat[i].Loc.N, Stat[i].Loc.E) ?
+	       VegMap[Stat[i].Loc.N][Stat[i].Loc.E].Veg : 0));
       for (j = 0; j < Veg.NTypes; j++) {
 	    if (VType[j].Index == GLACIER) {
-	      VegMap[Stat[i].Loc.N][Stat[i].Loc.E].Veg = j;
+	      if (Stat[i].Loc.N >= 0 && Stat[i].Loc.N < Map.NY)
+	        VegMap[Stat[i].Loc.N][Stat[i].Loc.E].Veg = j;
 		  break;
 		}
       }
@@ -208,17 +257,32 @@ int main(int argc, char **argv)
 	      InFiles.PrecipLapseFile, &PrecipLapseMap, &PrismMap,
 	      &ShadowMap, &SkyViewMap, &EvapMap, &PrecipMap, &PptMultiplierMap,
 	      &RadarMap, &RadiationMap, SoilMap, &Soil, VegMap, &Veg, TopoMap,
-	      &MM5Input, &WindModel);
+	      &MM5Input, &WindModel, &Slab);
 
   InitInterpolationWeights(&Map, &Options, TopoMap, &MetWeights, Stat, NStats);
+  StopTimer(TIMER_INITMET);
 
+  StartTimer(TIMER_INITDUMP);
+  /* the ensemble keys are checked before any output file is opened */
+  ReadEnsemble(Input, &Options, &Members);
   InitDump(Input, &Options, &Map, Soil.MaxLayers, Veg.MaxLayers, Time.Dt,
-	   TopoMap, &Dump, &NGraphics, &which_graphics);
+	   TopoMap, &Dump, &NGraphics, &which_graphics, NULL);
+
+  Checkpoint = NULL;
+  if (Options.StateFormat == CHECKPOINT_STATE) {
+    Checkpoint = OpenCheckpoint(Dump.InitStatePath, &(Time.Start), &Map);
+    if (Checkpoint == NULL)
+      printf("No checkpoint at the start of the run, reading the state files\n");
+  }
+  StopTimer(TIMER_INITDUMP);
+
+  StartTimer(TIMER_INITSTATE);
 
 #ifndef SNOW_ONLY
   if (Options.HasNetwork == TRUE) {
     InitChannelDump(&Options, &ChannelData, Dump.Path);
-    ReadChannelState(Dump.InitStatePath, &(Time.Start), ChannelData.streams);
+    ReadChannelState(Dump.InitStatePath, &(Time.Start), ChannelData.streams,
+                     ChannelData.stream_index, Checkpoint);
 	if (Options.StreamTemp && Options.CanopyShading)
 	  InitChannelRVeg(&Time, ChannelData.streams);
   }
@@ -227,14 +291,19 @@ int main(int argc, char **argv)
   InitAggregated(&Options, Veg.MaxLayers, Soil.MaxLayers, &Total);
 
   InitModelState(&(Time.Start), Time.NDaySteps, &Map, &Options, PrecipMap, SnowMap, SoilMap,
+		 &SoilFlow,
 		 Soil, SType, VegMap, Veg, VType, Dump.InitStatePath,
-		 TopoMap, Network, &HydrographInfo, Hydrograph);
+		 TopoMap, Network, &HydrographInfo, Hydrograph, Checkpoint);
+  CloseCheckpoint(Checkpoint);
 
   InitNewMonth(&Time, &Options, &Map, TopoMap, PrismMap, ShadowMap,
 	       &InFiles, Veg.NTypes, VType, NStats, Stat, Dump.InitStatePath, &VegMap);
 
   InitNewDay(Time.Current.JDay, &SolarGeo);
+  StopTimer(TIMER_INITSTATE);
 
+  if (NGraphics > 0 && ParallelSize() > 1)
+    ReportError("MainDHSVM", 76);
   if (NGraphics > 0) {
     printf("Initialzing X11 display and graphics \n");
     InitXGraphics(argc, argv, Map.NY, Map.NX, NGraphics, &MetMap);
@@ -244,38 +313,55 @@ int main(int argc, char **argv)
   if (Options.Shading == TRUE)
     shade_offset = TRUE;
 
-  /* Done with initialization, delete the list with input strings */
-  DeleteList(Input);
+  /* from here on each process computes the cells of its band, in LocalMap */
+  InitLocalMap(&Map, &LocalMap);
+  if (Options.HasNetwork)
+    InitChannelRouting(&LocalMap, &ChannelData);
+  if (Options.HasNetwork)
+    InitDrainMap(&LocalMap, TopoMap, VegMap, VType, &ChannelData, &DrainMap);
 
   /* setup for mass balance calculations */
-  Aggregate(&Map, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
-	      RadiationMap, SnowMap, SoilMap, &Total, VType, Network, &ChannelData, &roadarea, Time.Dt);
+  Aggregate(&LocalMap, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
+	      RadiationMap, SnowMap, SoilMap, &SoilFlow, &Total, VType, Network, &ChannelData, &roadarea, Time.Dt);
 
   Mass.StartWaterStorage =
-    Total.Soil.IExcess + Total.CanopyWater + Total.SoilWater + Total.Snow.Swq +
-    Total.Soil.SatFlow;
+    (double) Total.IExcess + Total.CanopyWater + Total.SoilWater + Total.Snow.Swq +
+    Total.SatFlow;
   Mass.OldWaterStorage = Mass.StartWaterStorage;
 
+  /* all ensemble members start from the state that has been read */
+  InitEnsemble(Input, &Options, &Map, Soil.MaxLayers, Veg.MaxLayers, Time.Dt,
+	       TopoMap, &Dump, &ChannelData, &Total, Members);
+  if (Options.EnsembleMembers > 1) {
+    for (m = 0; m < Options.EnsembleMembers; m++)
+      Members[m].State = TakeSnapshot(&Map, &Options, &Time, &Soil, &Veg,
+        EvapMap, RadiationMap, PrecipMap, SnowMap, SoilMap, &SoilFlow, VegMap, Network,
+        &ChannelData, &HydrographInfo, Hydrograph, &Mass);
+  }
+
+  /* Done with initialization, delete the list with input strings */
+  DeleteList(Input);
+
   /* computes the number of grid cell contributing to one segment */
   if (Options.StreamTemp) 
-	Init_segment_ncell(TopoMap, ChannelData.stream_map, Map.NY, Map.NX, ChannelData.streams);
+	Init_segment_ncell(TopoMap, ChannelData.stream_map, &LocalMap, ChannelData.streams);
 
 /*****************************************************************************
   Perform Calculations 
 *****************************************************************************/
+  InitPrefetch(&Prefetch, Options.PrefetchDepth, &Time, &Options, &InFiles,
+	       Soil.MaxLayers, NStats, Stat, &Map, &MM5Map, &Radar,
+	       InFiles.RadarFile);
+  InitOutput(Options.OutputQueueSize);
+
   while (Before(&(Time.Current), &(Time.End)) ||
 	 IsEqualTime(&(Time.Current), &(Time.End))) {
 
-    /* reset aggregated variables */
-    ResetAggregate(&Soil, &Veg, &Total, &Options);
-    
-    /* redistribute snow based on snow surface slope etc */
-    if (Options.SnowSlide)
-	    Avalanche(&Map, TopoMap, &Time, &Options, SnowMap);
-    
-    if (IsNewWaterYear(&(Time.Current)))
-      InitNewWaterYear(&Time, &Options, &Map, TopoMap, SnowMap);
+    StartStepTimer(&(Time.Current));
 
+    /* The forcing, and the maps and tables that change with the date, are
+       the same for all ensemble members */
+    StartTimer(TIMER_NEWSTEP);
     if (IsNewMonth(&(Time.Current), Time.Dt))
       InitNewMonth(&Time, &Options, &Map, TopoMap, PrismMap, ShadowMap,
 		   &InFiles, Veg.NTypes, VType, NStats, Stat, Dump.InitStatePath, &VegMap);
@@ -287,136 +373,226 @@ int main(int argc, char **argv)
     }
 
     InitNewStep(&InFiles, &Map, &Time, Soil.MaxLayers, &Options, NStats, Stat,
-		InFiles.RadarFile, &Radar, RadarMap, &SolarGeo, TopoMap, 
-                SoilMap, MM5Input, PrecipLapseMap, WindModel, &MM5Map);
+		&Prefetch, &Radar, RadarMap, &SolarGeo, MM5Input, PrecipLapseMap,
+		WindModel, &MM5Map);
+    StopTimer(TIMER_NEWSTEP);
+
+    for (m = 0; m < Options.EnsembleMembers; m++) {
+      LoadMember(&(Members[m]), &Dump, &Total, &Map, &Options, &Time, &Soil,
+		 &Veg, EvapMap, RadiationMap, PrecipMap, SnowMap, SoilMap,
+		 &SoilFlow, VegMap, Network, &ChannelData, &HydrographInfo, Hydrograph,
+		 &Mass);
+
+      /* reset aggregated variables */
+      ResetAggregate(&Soil, &Veg, &Total, &Options);
+    
+      /* redistribute snow based on snow surface slope etc */
+      if (Options.SnowSlide) {
+        StartTimer(TIMER_AVALANCHE);
+	      Avalanche(&LocalMap, TopoMap, &Time, &Options, SnowMap, &FlowDir);
+        StopTimer(TIMER_AVALANCHE);
+      }
+    
+      if (IsNewWaterYear(&(Time.Current)))
+        InitNewWaterYear(&Time, &Options, &LocalMap, TopoMap, SnowMap);
 
-    /* initialize channel/road networks for time step */
-    if (Options.HasNetwork) {
-      channel_step_initialize_network(ChannelData.streams);
-      channel_step_initialize_network(ChannelData.roads);
-    }
+      InitNewWaterLevel(&Options, &LocalMap, TopoMap, SoilMap, &SoilFlow);
 
+      /* initialize channel/road networks for time step */
+      if (Options.HasNetwork) {
+        channel_step_initialize_network(ChannelData.stream_schedule);
+        channel_step_initialize_network(ChannelData.road_schedule);
+      }
 
-    for (y = 0; y < Map.NY; y++) {
-      for (x = 0; x < Map.NX; x++) {
-	    if (INBASIN(TopoMap[y][x].Mask)) {
-		  if (Options.Shading)
-	        LocalMet =
-	        MakeLocalMetData(y, x, &Map, Time.DayStep, Time.NDaySteps, &Options, NStats,
-			       Stat, MetWeights[y][x], TopoMap[y][x].Dem,
-			       &(RadiationMap[y][x]), &(PrecipMap[y][x]), &Radar,
-			       RadarMap, PrismMap, &(SnowMap[y][x]),
-			       &(VegMap[y][x].Type), &(VegMap[y][x]), 
-             MM5Input, WindModel, PrecipLapseMap,
-			       &MetMap, PptMultiplierMap[y][x], NGraphics, Time.Current.Month,
-			       SkyViewMap[y][x], ShadowMap[Time.DayStep][y][x],
-			       SolarGeo.SunMax, SolarGeo.SineSolarAltitude);
-		  else
-	        LocalMet =
-	        MakeLocalMetData(y, x, &Map, Time.DayStep, Time.NDaySteps, &Options, NStats,
-			       Stat, MetWeights[y][x], TopoMap[y][x].Dem,
-			       &(RadiationMap[y][x]), &(PrecipMap[y][x]), &Radar,
-			       RadarMap, PrismMap, &(SnowMap[y][x]),
-			       &(VegMap[y][x].Type), &(VegMap[y][x]), 
-             MM5Input, WindModel, PrecipLapseMap,
-			       &MetMap, PptMultiplierMap[y][x],NGraphics, Time.Current.Month, 0.0,
-			       0.0, SolarGeo.SunMax,
-			       SolarGeo.SineSolarAltitude);
-
-		  /* get surface tempeature of each soil layer */
-		  for (i = 0; i < Soil.MaxLayers; i++) {
-	        if (Options.HeatFlux == TRUE) {
-	          if (Options.MM5 == TRUE)
-		        SoilMap[y][x].Temp[i] =
-				MM5Input[shade_offset + i + N_MM5_MAPS][y][x];
-
-              /* read tempeature of each soil layer from met station input */
-			  else
-		        SoilMap[y][x].Temp[i] = Stat[0].Data.Tsoil[i];
-			}
-            /* if heat flux option is turned off, soil temperature of all 3 layers 
-            is taken equal to air tempeature */
-	        else
-	          SoilMap[y][x].Temp[i] = LocalMet.Tair;
-		  }
-		  
-          MassEnergyBalance(&Options, y, x, SolarGeo.SineSolarAltitude, Map.DX, Map.DY,
-            Time.Dt, Options.HeatFlux, Options.CanopyRadAtt, Options.Infiltration, Soil.MaxLayers,
-            Veg.MaxLayers, &LocalMet, &(Network[y][x]), &(PrecipMap[y][x]),
-            &(VType[VegMap[y][x].Veg - 1]), &(VegMap[y][x]), &(SType[SoilMap[y][x].Soil - 1]),
-            &(SoilMap[y][x]), &(SnowMap[y][x]), &(RadiationMap[y][x]), &(EvapMap[y][x]),
-            &(Total.Rad), &ChannelData, SkyViewMap);
-	 
-		  PrecipMap[y][x].SumPrecip += PrecipMap[y][x].Precip;
-		}
-	  }
-    }
 
-	/* Average all RBM inputs over each segment */
-	if (Options.StreamTemp) {
-	  channel_grid_avg(ChannelData.streams);
-      if (Options.CanopyShading)
-	    CalcCanopyShading(&Time, ChannelData.streams, &SolarGeo);
-	}
+      /* Pixel met data and mass/energy balance.  Rows are handed out to
+         threads in tiles of TILEROWS rows, and only the runs of basin cells
+         in LocalMap.Runs are visited.  Pixels that contain a stream
+         channel add to totals that are shared by all pixels of a channel
+         segment, so those are done in a second, serial pass in row-major
+         order.  This keeps the results independent of the number of threads.
+         With MPI, the additions to the channels of each pass are collected
+         from all processes in row order at the end of the pass */
+      StartTimer(TIMER_PIXELS);
+      NTiles = (Map.NY + TILEROWS - 1) / TILEROWS;
+      for (pass = 0; pass < 2; pass++) {
+#pragma omp parallel for schedule(dynamic, 1) private(y, x, i, run, LocalMet) if (pass == 0)
+        for (tile = 0; tile < NTiles; tile++) {
+          for (run = LocalMap.RowRuns[tile * TILEROWS];
+               run < LocalMap.RowRuns[MIN((tile + 1) * TILEROWS, Map.NY)]; run++) {
+            y = LocalMap.Runs[run].y;
+            for (x = LocalMap.Runs[run].x0; x < LocalMap.Runs[run].x1; x++) {
+              if (channel_grid_has_channel(ChannelData.stream_map, x, y) != pass)
+                continue;
+
+              if (Options.Shading)
+                LocalMet =
+                MakeLocalMetData(y, x, &Map, Time.DayStep, Time.NDaySteps, &Options, NStats,
+                  Stat, &MetWeights, TopoMap[y][x].Dem,
+                  &(RadiationMap[y][x]), &(PrecipMap[y][x]), &Radar,
+                  RadarMap, PrismMap, &(SnowMap[y][x]),
+                  &(VegMap[y][x].Type), &(VegMap[y][x]), 
+                  MM5Input, WindModel, PrecipLapseMap,
+                  &MetMap, PptMultiplierMap[y][x], Members[m].PrecipFactor,
+                  NGraphics, Time.Current.Month,
+                  SkyViewMap[y][x], ShadowMap[Time.DayStep][y][x],
+                  SolarGeo.SunMax, SolarGeo.SineSolarAltitude);
+              else
+                LocalMet =
+                MakeLocalMetData(y, x, &Map, Time.DayStep, Time.NDaySteps, &Options, NStats,
+                  Stat, &MetWeights, TopoMap[y][x].Dem,
+                  &(RadiationMap[y][x]), &(PrecipMap[y][x]), &Radar,
+                  RadarMap, PrismMap, &(SnowMap[y][x]),
+                  &(VegMap[y][x].Type), &(VegMap[y][x]), 
+                  MM5Input, WindModel, PrecipLapseMap,
+                  &MetMap, PptMultiplierMap[y][x], Members[m].PrecipFactor,
+                  NGraphics, Time.Current.Month, 0.0,
+                  0.0, SolarGeo.SunMax,
+                  SolarGeo.SineSolarAltitude);
+
+              /* get surface tempeature of each soil layer */
+              for (i = 0; i < Soil.MaxLayers; i++) {
+                if (Options.HeatFlux == TRUE) {
+                  if (Options.MM5 == TRUE)
+                    SoilMap[y][x].Temp[i] =
+                    MM5Input[shade_offset + i + N_MM5_MAPS][y][x];
+
+                  /* read tempeature of each soil layer from met station input */
+                  else
+                    SoilMap[y][x].Temp[i] = Stat[0].Data.Tsoil[i];
+                }
+                /* if heat flux option is turned off, soil temperature of all 3 layers 
+                is taken equal to air tempeature */
+                else
+                  SoilMap[y][x].Temp[i] = LocalMet.Tair;
+              }
+
+              MassEnergyBalance(&Options, y, x, SolarGeo.SineSolarAltitude, Map.DX, Map.DY,
+                Time.Dt, Options.HeatFlux, Options.CanopyRadAtt, Options.Infiltration, Soil.MaxLayers,
+                Veg.MaxLayers, &LocalMet, &(Network[y][x]), &(PrecipMap[y][x]),
+                &(VType[VegMap[y][x].Veg - 1]), &(VegMap[y][x]), &(SType[SoilMap[y][x].Soil - 1]),
+                &(SoilMap[y][x]), &SoilFlow, y * Map.NX + x, &(SnowMap[y][x]),
+                &(RadiationMap[y][x]), &(EvapMap[y][x]),
+                &ChannelData, SkyViewMap);
+
+              PrecipMap[y][x].SumPrecip += PrecipMap[y][x].Precip;
+            }
+          }
+        }
+        ForwardChannelIncrements(&ChannelData);
+      }
+      StopTimer(TIMER_PIXELS);
+
+      /* Average all RBM inputs over each segment */
+      if (Options.StreamTemp) {
+        channel_grid_avg(ChannelData.streams);
+        if (Options.CanopyShading)
+          CalcCanopyShading(&Time, ChannelData.streams, &SolarGeo);
+      }
 
  #ifndef SNOW_ONLY
     
-    RouteSubSurface(Time.Dt, &Map, TopoMap, VType, VegMap, Network,
-		    SType, SoilMap, &ChannelData, &Time, &Options, Dump.Path,
-		    MaxStreamID, SnowMap);
-
-    if (Options.HasNetwork)
-      RouteChannel(&ChannelData, &Time, &Map, TopoMap, SoilMap, &Total, 
-		   &Options, Network, SType, PrecipMap, LocalMet.Tair, LocalMet.Rh, SnowMap);
+      StartTimer(TIMER_SUBSURFACE);
+      RouteSubSurface(Time.Dt, &LocalMap, TopoMap, VType, VegMap, Network,
+                      SType, SoilMap, &SoilFlow, &ChannelData, &Time, &Options, Dump.Path,
+                      MaxStreamID, SnowMap, &FlowDir, SubFlowMap);
+      StopTimer(TIMER_SUBSURFACE);
+
+      if (Options.HasNetwork) {
+        StartTimer(TIMER_CHANNEL);
+        RouteChannel(&ChannelData, &Time, &LocalMap, TopoMap, SoilMap, &SoilFlow, &Total, 
+                     &Options, Network, SType, PrecipMap, SnowMap);
+        StopTimer(TIMER_CHANNEL);
+      }
 
-    if (Options.Extent == BASIN)
-      RouteSurface(&Map, &Time, TopoMap, SoilMap, &Options,
-        UnitHydrograph, &HydrographInfo, Hydrograph,
-        &Dump, VegMap, VType, &ChannelData);
+      if (Options.Extent == BASIN) {
+        StartTimer(TIMER_SURFACE);
+        RouteSurface(&LocalMap, &Time, TopoMap, SoilMap, &SoilFlow, &Options,
+          UnitHydrograph, &HydrographInfo, Hydrograph,
+          &Dump, VegMap, VType, &ChannelData, &DrainMap);
+        StopTimer(TIMER_SURFACE);
+      }
 
 
 #endif
 
-    if (NGraphics > 0)
-      draw(&(Time.Current), IsEqualTime(&(Time.Current), &(Time.Start)),
-	   Time.DayStep, &Map, NGraphics, which_graphics, VType,
-	   SType, SnowMap, SoilMap, VegMap, TopoMap, PrecipMap,
-	   PrismMap, SkyViewMap, ShadowMap, EvapMap, RadiationMap, 
-	   MetMap, Network, &Options);
+      if (NGraphics > 0 && m == 0)
+        draw(&(Time.Current), IsEqualTime(&(Time.Current), &(Time.Start)),
+             Time.DayStep, &Map, NGraphics, which_graphics, VType,
+             SType, SnowMap, SoilMap, &SoilFlow, VegMap, TopoMap, PrecipMap,
+             PrismMap, SkyViewMap, ShadowMap, EvapMap, RadiationMap, 
+             MetMap, Network, &Options);
     
-    Aggregate(&Map, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
-	      RadiationMap, SnowMap, SoilMap, &Total, VType, Network, &ChannelData, &roadarea, Time.Dt);
+      StartTimer(TIMER_AGGREGATE);
+      Aggregate(&LocalMap, &Options, TopoMap, &Soil, &Veg, VegMap, EvapMap, PrecipMap,
+                RadiationMap, SnowMap, SoilMap, &SoilFlow, &Total, VType, Network, &ChannelData, &roadarea, Time.Dt);
+      StopTimer(TIMER_AGGREGATE);
     
-    if (Options.SnowStats)
-      SnowStats(&(Time.Current), &Map, &Options, TopoMap, SnowMap, Time.Dt);
+      if (Options.SnowStats)
+        SnowStats(&(Time.Current), &LocalMap, &Options, TopoMap, SnowMap, Time.Dt);
     
-    MassBalance(&(Time.Current), &(Time.Start), &(Dump.Balance), &Total, &Mass);
-
-    ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
-	     EvapMap, RadiationMap, PrecipMap, SnowMap, MetMap, VegMap, &Veg, 
-		 SoilMap, Network, &ChannelData, &Soil, &Total, &HydrographInfo,Hydrograph);
+      StartTimer(TIMER_MASSBALANCE);
+      MassBalance(&(Time.Current), &(Time.Start), &(Dump.Balance), &Total, &Mass);
+      StopTimer(TIMER_MASSBALANCE);
+
+      StartTimer(TIMER_DUMP);
+      ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
+               EvapMap, RadiationMap, PrecipMap, SnowMap, MetMap, VegMap, &Veg, 
+                   SoilMap, &SoilFlow, Network, &ChannelData, &Soil, &Total, &HydrographInfo,Hydrograph);
+      StopTimer(TIMER_DUMP);
 	
-    IncreaseTime(&Time);
+      IncreaseTime(&Time);
+
+      SaveMember(&(Members[m]), &Dump, &Total, &Map, &Options, &Time, &Soil,
+		 &Veg, EvapMap, RadiationMap, PrecipMap, SnowMap, SoilMap,
+		 &SoilFlow, VegMap, Network, &ChannelData, &HydrographInfo, Hydrograph,
+		 &Mass);
+    }
+    StopStepTimer();
 	t += 1;
   }
 
-  ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
-	   EvapMap, RadiationMap, PrecipMap, SnowMap, MetMap, VegMap, &Veg, SoilMap,
-	   Network, &ChannelData, &Soil, &Total, &HydrographInfo, Hydrograph);
+  EndPrefetch(&Prefetch);
+
+  for (m = 0; m < Options.EnsembleMembers; m++) {
+    LoadMember(&(Members[m]), &Dump, &Total, &Map, &Options, &Time, &Soil,
+	       &Veg, EvapMap, RadiationMap, PrecipMap, SnowMap, SoilMap,
+	       &SoilFlow, VegMap, Network, &ChannelData, &HydrographInfo, Hydrograph, &Mass);
+
+    StartTimer(TIMER_DUMP);
+    ExecDump(&Map, &(Time.Current), &(Time.Start), &Options, &Dump, TopoMap,
+	     EvapMap, RadiationMap, PrecipMap, SnowMap, MetMap, VegMap, &Veg, SoilMap,
+	     &SoilFlow, Network, &ChannelData, &Soil, &Total, &HydrographInfo, Hydrograph);
+    StopTimer(TIMER_DUMP);
 
 #ifndef SNOW_ONLY
-  FinalMassBalance(&(Dump.FinalBalance), &Total, &Mass);
+    if (ParallelRank() == 0)
+      FinalMassBalance(&(Dump.FinalBalance), &Total, &Mass);
 #endif
+  }
 
   printf("\nEND OF MODEL RUN\n\n");
 
-  /* record the run time at the end of each time loop */
-  finish1 = clock ();
-  runtime = (finish1-start)/CLOCKS_PER_SEC;
+  /* the writer thread has to finish before the files are closed, and
+     before the time is taken */
+  EndOutput();
+
+  /* record the wall clock time of the run */
+  runtime = ElapsedTime();
   printf("***********************************************************************************");
   printf("\nRuntime Summary:\n");
   printf("%6.2f hours elapsed for the simulation period of %d hours (%.1f days) \n", 
 	  runtime/3600, t*Time.Dt/3600, (float)t*Time.Dt/3600/24);
+  NumCells = LocalMap.NumCells;
+  ParallelSum(&NumCells, 1);
+  EndTiming(stdout, (int) NumCells * Options.EnsembleMembers);
+
+  for (m = 0; m < Options.EnsembleMembers; m++)
+    cleanup(&(Members[m].Dump), &(Members[m].ChannelData), &Options);
+
+  EndParallel();
+
+  FreeSlab(&Slab);
 
   return EXIT_SUCCESS;
 }
@@ -458,4 +634,8 @@ void cleanup(DUMPSTRUCT *Dump, CHANNEL *ChannelData, OPTIONSTRUCT *Options)
 	  if (ChannelData->streamATP!= NULL) 
       fclose(ChannelData->streamATP);
 	}
+
+	/* the map files of all the members are kept open together; the first
+	   call closes them and the others find none left */
+	CloseMapFiles();
 }
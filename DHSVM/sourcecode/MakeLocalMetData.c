@@ -38,12 +38,14 @@ int DayStep
 unsigned char PrecipType
 int NStats
 METLOCATION *Stat
-uchar *MetWeights
+METWEIGHTS *MetWeights
 float LocalElev
 RADCLASSPIX *RadMap 
 PRECIPPIX *PrecipMap
 MAPSIZE Radar
 RADARPIX **RadarMap
+float PrecipFactor - factor by which the precipitation of an ensemble
+                     member is scaled
 
 Returns      :
 PIXMET LocalMet
@@ -56,23 +58,25 @@ Handbook of hydrology,  1993, McGraw-Hill, New York, etc..
 *****************************************************************************/
 PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
                         OPTIONSTRUCT *Options, int NStats,
-                        METLOCATION *Stat, uchar *MetWeights,
+                        METLOCATION *Stat, METWEIGHTS *MetWeights,
                         float LocalElev, PIXRAD *RadMap,
                         PRECIPPIX *PrecipMap, MAPSIZE *Radar,
                         RADARPIX **RadarMap, float **PrismMap,
                         SNOWPIX *LocalSnow, CanopyGapStruct **Gap, VEGPIX *VegMap,
                         float ***MM5Input, float ***WindModel,
                         float **PrecipLapseMap, MET_MAP_PIX ***MetMap,
-                        float precipMultiplier, int NGraphics, int Month, float skyview,
+                        float precipMultiplier, float PrecipFactor,
+                        int NGraphics, int Month, float skyview,
                         unsigned char shadow, float SunMax,
                         float SineSolarAltitude)
 {
   float CurrentWeight;		/* weight for current station */
   float ScaleWind = 1;		/* Wind to be scaled by model factors if 
                             WindSource == MODEL */
-  float Temp;			/* Temporary variable */
-  float WeightSum;		/* sum of the weights */
   int i,j;			/* counter */
+  int k;			/* weight table entry */
+  int FirstWeight;		/* first weight table entry of the pixel */
+  int EndWeight;		/* one past the last weight table entry */
   int RadarX;			/* X coordinate of radar map coordinate */
   int RadarY;			/* Y coordinate of radar map coordinate */
   float TempLapseRate;
@@ -88,11 +92,9 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
   LocalMet.Lin = 0.0;
   TempLapseRate = 0.0;
 
-  if (Options->MM5 == TRUE && Options->QPF == TRUE) {
-    WeightSum = 0.0;
-    for (i = 0; i < NStats; i++)
-      WeightSum += (float) MetWeights[i];
-  }
+  /* only the stations with a non-zero weight are listed for the pixel */
+  FirstWeight = MetWeights->Start[y * Map->NX + x];
+  EndWeight = MetWeights->Start[y * Map->NX + x + 1];
 
   if (Options->MM5 == TRUE) {
     LocalMet.Tair = MM5Input[MM5_temperature - 1][y][x] +
@@ -122,16 +124,17 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
     }
   }
   else {			/* MM5 is false and we need to interpolate the basic met records */
-    WeightSum = 0.0;
-    for (i = 0; i < NStats; i++) {
-      WeightSum += (float) MetWeights[i];
-      if (Options->WindSource == MODEL && Stat[i].IsWindModelLocation) {
-        ScaleWind = Stat[i].Data.Wind;
-        WindDirection = Stat[i].Data.WindDirection;
+    if (Options->WindSource == MODEL) {
+      for (i = 0; i < NStats; i++) {
+        if (Stat[i].IsWindModelLocation) {
+          ScaleWind = Stat[i].Data.Wind;
+          WindDirection = Stat[i].Data.WindDirection;
+        }
       }
     }
-    for (i = 0; i < NStats; i++) {
-      CurrentWeight = ((float) MetWeights[i]) / WeightSum;
+    for (k = FirstWeight; k < EndWeight; k++) {
+      i = MetWeights->Station[k];
+      CurrentWeight = MetWeights->Weight[k];
       LocalMet.Tair += CurrentWeight *
         LapseT(Stat[i].Data.Tair, Stat[i].Elev, LocalElev,
         Stat[i].Data.TempLapse);
@@ -161,12 +164,7 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
     This will result in a crash, so a check was put in (Jul 28, 1997 - Bart
     Nijssen).  It is somewhat awkward to interpolate lapse rates anyway, so
     a better way of doing this would be welcome */
-    if (TempLapseRate != 0.0) {
-      Temp = 9.8067 / (TempLapseRate * 287.0);
-      LocalMet.Press = 101300. * pow(((288.0 - TempLapseRate * LocalElev) / 288.0), Temp);
-    }
-    else
-      LocalMet.Press = 101300.;
+    LocalMet.Press = AirPressure(TempLapseRate, LocalElev);
 
   }				/* end of else MM5==TRUE, i.e. all basic met, except for precip */
   /* has been interpolated */
@@ -232,8 +230,9 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
       PrecipMap->Precip = 0.0;
       PrecipMap->SnowFall = 0.0;
 	  PrecipMap->RainFall = 0.0;
-      for (i = 0; i < NStats; i++) {
-        CurrentWeight = ((float) MetWeights[i]) / WeightSum;
+      for (k = FirstWeight; k < EndWeight; k++) {
+        i = MetWeights->Station[k];
+        CurrentWeight = MetWeights->Weight[k];
         if (Options->PrecipLapse == MAP)
           PrecipMap->Precip += CurrentWeight *
           LapsePrecip(Stat[i].Data.Precip, 0, 1, PrecipLapseMap[y][x], precipMultiplier);
@@ -252,16 +251,15 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
     }
     else if (Options->PrecipType == STATION && Options->Prism == TRUE) {
       PrecipMap->Precip = 0.0;
-      for (i = 0; i < NStats; i++) {
-        CurrentWeight = ((float) MetWeights[i]) / WeightSum;
+      for (k = FirstWeight; k < EndWeight; k++) {
+        i = MetWeights->Station[k];
+        CurrentWeight = MetWeights->Weight[k];
         /* this is the real prism interpolation */
         /* note that X = position from left  boundary, ie # of columns */
         /* note that Y = position from upper boundary, ie # of rows   */
-        if (Options->Outside == FALSE)
-          PrecipMap->Precip += CurrentWeight * Stat[i].Data.Precip /
-          PrismMap[Stat[i].Loc.N][Stat[i].Loc.E] * PrismMap[y][x];
-        else
-          PrecipMap->Precip += CurrentWeight * Stat[i].Data.Precip /
+        /* the station value is that of the PRISM map if outside=FALSE,
+           see InitNewMonth() */
+        PrecipMap->Precip += CurrentWeight * Stat[i].Data.Precip /
           Stat[i].PrismPrecip[Month - 1] * PrismMap[y][x];
         if (PrismMap[y][x] < 0){
           printf("negative PrismMap value in MakeLocalMetData.c\n");
@@ -271,6 +269,12 @@ PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
     }
   }
 
+  if (PrecipFactor != 1.0) {
+    PrecipMap->Precip *= PrecipFactor;
+    PrecipMap->SnowFall *= PrecipFactor;
+    PrecipMap->RainFall *= PrecipFactor;
+  }
+
   /* due to the nature of the interpolation scheme in DHSVM and the */
   /* interpolation scheme to handle the mess of different formats of met stations */
   /* in the PRISM project */
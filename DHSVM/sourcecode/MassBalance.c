@@ -30,19 +30,18 @@
   
   Calculate the average values for the different fluxes and state variables
   over the basin.  
-  In the current implementation the local radiation
-  elements are not stored for the entire area.  Therefore these components
-  are aggregated in AggregateRadiation() inside MassEnergyBalance().
+  The components of the radiation balance of each cell are added by
+  AggregateRadiation(), which is called from Aggregate().
 
   The aggregated values are set to zero in the function RestAggregate,
   which is executed at the beginning of each time step.
 *****************************************************************************/
 void MassBalance(DATE *Current, DATE *Start, FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass)
 {
-  float NewWaterStorage;	/* water storage at the end of the time step */
-  float Output;			/* total water flux leaving the basin;  */
-  float Input;
-  float MassError;		/* mass balance error m  */
+  double NewWaterStorage;	/* water storage at the end of the time step */
+  double Output;		/* total water flux leaving the basin;  */
+  double Input;
+  double MassError;		/* mass balance error m  */
 
   float deltaSWE;       /* change of SWE from last time step */
   float NetWaterIn1;    /* incoming water to the soil (precip-deltaSWE+SnowVaporFlux) */
@@ -64,12 +63,12 @@ void MassBalance(DATE *Current, DATE *Start, FILES *Out, AGGREGATED *Total, WATE
   else
      NetWaterIn2 = Total->Precip.Precip - Total->Precip.SnowFall;
  
-  NewWaterStorage = Total->Soil.IExcess + Total->Road.IExcess + 
+  NewWaterStorage = (double) Total->IExcess + Total->Road.IExcess + 
     Total->CanopyWater + Total->SoilWater +
-    Total->Snow.Swq + Total->Soil.SatFlow + Total->Soil.DetentionStorage;
+    Total->Snow.Swq + Total->SatFlow + Total->Soil.DetentionStorage;
 
-  Output = Total->ChannelInt + Total->RoadInt + Total->Evap.ETot;
-  Input = Total->Precip.Precip + Total->Snow.VaporMassFlux +
+  Output = (double) Total->ChannelInt + Total->RoadInt + Total->Evap.ETot;
+  Input = (double) Total->Precip.Precip + Total->Snow.VaporMassFlux +
     Total->Snow.CanopyVaporMassFlux + Total->CulvertReturnFlow;
 
   MassError = (NewWaterStorage - Mass->OldWaterStorage) + Output -
@@ -79,14 +78,19 @@ void MassBalance(DATE *Current, DATE *Start, FILES *Out, AGGREGATED *Total, WATE
   /* update */
   Mass->OldWaterStorage = NewWaterStorage;
   Mass->CumPrecipIn += Total->Precip.Precip;
-  Mass->CumIExcess += Total->Soil.IExcess;
+  Mass->CumIExcess += Total->IExcess;
   Mass->CumChannelInt += Total->ChannelInt;
   Mass->CumRoadInt += Total->RoadInt;
   Mass->CumET += Total->Evap.ETot;
-  Mass->CumSnowVaporFlux += Total->Snow.VaporMassFlux +
+  Mass->CumSnowVaporFlux += (double) Total->Snow.VaporMassFlux +
     Total->Snow.CanopyVaporMassFlux;
   Mass->CumCulvertReturnFlow += Total->CulvertReturnFlow;
   Mass->CumCulvertToChannel += Total->CulvertToChannel;
+  Total->Snow.OldSwq = Total->Snow.Swq;
+
+  /* the totals are the same on all MPI processes, the first writes them */
+  if (ParallelRank() != 0)
+    return;
   
   if (IsEqualTime(Current, Start)) {
     fprintf(Out->FilePtr, "Date");
@@ -108,11 +112,10 @@ void MassBalance(DATE *Current, DATE *Start, FILES *Out, AGGREGATED *Total, WATE
   PrintDate(Current, Out->FilePtr);
   fprintf(Out->FilePtr, " %g %g %g %g %g %g %g %g %g %g %g %g \
       %g %g %g %g %g %g %g %g %g %g %g\n", NetWaterIn1*1000, NetWaterIn2*1000, 
-      Total->Precip.Precip, Total->Precip.SnowFall, Total->Soil.IExcess,
+      Total->Precip.Precip, Total->Precip.SnowFall, Total->IExcess,
       Total->Snow.Swq, Total->Snow.Melt, Total->Evap.ETot, 
-      Total->CanopyWater, Total->SoilWater, Total->Soil.SatFlow, Total->Snow.VaporMassFlux,
+      Total->CanopyWater, Total->SoilWater, Total->SatFlow, Total->Snow.VaporMassFlux,
       Total->Snow.CanopyVaporMassFlux, Total->ChannelInt,  Total->RoadInt, Total->CulvertToChannel, 
       Total->Rad.BeamIn+Total->Rad.DiffuseIn, Total->Rad.PixelNetShort, 
       Total->Rad.NetShort[0], Total->Rad.NetShort[1], Total->NetRad, Total->Rad.Tair, MassError);
-  Total->Snow.OldSwq = Total->Snow.Swq;
 }
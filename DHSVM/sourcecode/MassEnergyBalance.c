@@ -58,10 +58,14 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
   int InfiltOption, int MaxSoilLayers, int MaxVegLayers, PIXMET *LocalMet,
   ROADSTRUCT *LocalNetwork, PRECIPPIX *LocalPrecip,
   VEGTABLE *VType, VEGPIX *LocalVeg, SOILTABLE *SType,
-  SOILPIX *LocalSoil, SNOWPIX *LocalSnow, PIXRAD *LocalRad,
-  EVAPPIX *LocalEvap, PIXRAD *TotalRad, CHANNEL *ChannelData,
-  float **skyview)
+  SOILPIX *LocalSoil, SOILFLOWMAP *SoilFlow, int Cell, SNOWPIX *LocalSnow,
+  PIXRAD *LocalRad, EVAPPIX *LocalEvap, CHANNEL *ChannelData, float **skyview)
 {
+  float SoilDepth = SoilFlow->Depth[Cell];	/* Soil depth of the pixel (m) */
+  float SatFlow = SoilFlow->SatFlow[Cell];	/* Saturated flow into the pixel
+						   during the last time step (m) */
+  float *TableDepth = &(SoilFlow->TableDepth[Cell]);	/* Water table depth (m) */
+  float *IExcess = &(SoilFlow->IExcess[Cell]);	/* Infiltration excess (m) */
   float SurfaceWater;		/* Pixel average depth of water before infiltration is calculated (m) */
   float RoadWater;          /* Average depth of water on the road surface
                                (normalized by grid cell area)
@@ -102,13 +106,13 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
 
   /* Edited by Zhuoran Duan zhuoran.duan@pnnl.gov 06/21/2006*/
   /*Add a function to modify soil moisture by add/extract SatFlow from previous time step*/
-  DistributeSatflow(Dt, DX, DY, LocalSoil->SatFlow, SType->NLayers,
-    LocalSoil->Depth, LocalNetwork->Area, VType->RootDepth,
+  DistributeSatflow(Dt, DX, DY, SatFlow, SType->NLayers,
+    SoilDepth, LocalNetwork->Area, VType->RootDepth,
     SType->Ks, SType->PoreDist, LocalSoil->Porosity, LocalSoil->FCap,
     LocalSoil->Perc, LocalNetwork->PercArea,
     LocalNetwork->Adjust, LocalNetwork->CutBankZone,
-    LocalNetwork->BankHeight, &(LocalSoil->TableDepth),
-    &(LocalSoil->IExcess), LocalSoil->Moist, InfiltOption);
+    LocalNetwork->BankHeight, TableDepth,
+    IExcess, LocalSoil->Moist, InfiltOption);
 
   /* Calculate the number of vegetation layers above the snow.
   Note that veg cells with gap must have both over- and under-story as stipulated
@@ -480,7 +484,7 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
      existing IExcess */
   SurfaceWater = (PercArea * LocalPrecip->RainFall) +
     ((1. - (LocalNetwork->RoadArea) / (DX*DY)) * LocalSnow->Outflow) +
-    LocalSoil->IExcess;
+    *IExcess;
 
   /* RoadWater is rain falling on the road surface +
      snowmelt on the road surface + existing Road IExcess
@@ -526,12 +530,12 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
   RoadbedInfiltration = RoadWater;
   if (RoadbedInfiltration > MaxRoadbedInfiltration)
     RoadbedInfiltration = MaxRoadbedInfiltration;
-  LocalSoil->IExcess = SurfaceWater - Infiltration +
+  *IExcess = SurfaceWater - Infiltration +
     RoadWater - RoadbedInfiltration;
 
-  if (LocalSoil->IExcess < 0.) {
-    printf("MEB: SoilIExcess(%f), reset to 0\n", LocalSoil->IExcess);
-    LocalSoil->IExcess = 0.;
+  if (*IExcess < 0.) {
+    printf("MEB: SoilIExcess(%f), reset to 0\n", *IExcess);
+    *IExcess = 0.;
   }
 
   /*Add water that hits the channel network to the channel network */
@@ -542,11 +546,11 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
 
   /* Calculate unsaturated soil water movement, and adjust soil water table depth */
   UnsaturatedFlow(Dt, DX, DY, Infiltration, RoadbedInfiltration,
-    LocalSoil->SatFlow, SType->NLayers, LocalSoil->Depth,
+    SatFlow, SType->NLayers, SoilDepth,
     LocalNetwork->Area, VType->RootDepth, SType->Ks,
     SType->PoreDist, LocalSoil->Porosity, LocalSoil->FCap, LocalSoil->Perc,
     LocalNetwork->PercArea, LocalNetwork->Adjust, LocalNetwork->CutBankZone,
-    LocalNetwork->BankHeight, &(LocalSoil->TableDepth), &(LocalSoil->IExcess),
+    LocalNetwork->BankHeight, TableDepth, IExcess,
     LocalSoil->Moist, InfiltOption);
 
   /* Infiltration is updated in UnsaturatedFlow and accumulated
@@ -577,10 +581,6 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x,
     NoSensibleHeatFlux(Dt, LocalMet, LocalVeg->MoistureFlux, LocalSoil);
 
 
-  /* add the components of the radiation balance for the current pixel to
-     the total */
-  AggregateRadiation(MaxVegLayers, VType->NVegLayers, LocalRad, TotalRad);
-
   /* For RBM model, save the energy fluxes for outputs */
   if (Options->StreamTemp) {
     if (channel_grid_has_channel(ChannelData->stream_map, x, y))
@@ -0,0 +1,563 @@
+/*
+ * SUMMARY:      Output.c - Write the model output in a separate thread
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Queue for the map and text output that is written during
+ *               the run.  The model hands the maps over in buffers taken
+ *               from a pool, and the text (or binary records) is
+ *               collected per file in blocks.  A writer thread takes the
+ *               maps and blocks from the queue in order, and does the
+ *               byte swapping and file writes, so that the model can go on
+ *               with the next time step.  The queue holds at most a given
+ *               number of bytes: when it is full the model waits for the
+ *               writer.
+ * DESCRIP-END.
+ * FUNCTIONS:    InitOutput()
+ *               GetMapBuffer()
+ *               WriteMapOutput()
+ *               OutPrintf()
+ *               OutWrite()
+ *               OutPrintDate()
+ *               FlushOutput()
+ *               EndOutput()
+ * COMMENTS:
+ *   With a queue size of 0, or if DHSVM is built without threads, every
+ *   map and line is written right away.  The output is the same either
+ *   way.
+ *
+ *   A file that is written through OutPrintf() or OutWrite() must not be
+ *   written directly while the writer may still hold a block for it.  The
+ *   standard output and standard error streams are always written
+ *   directly, so that they stay in order with printf().
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "functions.h"
+#include "sizeofnt.h"
+
+#define TEXTBLOCKSIZE  65536	/* Bytes of text collected for a file before
+				   it is queued */
+#define MAXTEXTFILES   256	/* Most files with text being collected */
+
+/* Map, or block of text or binary records, to write */
+typedef struct OUTJOB {
+  char *Buffer;			/* Map values or text */
+  size_t Size;			/* Bytes allocated for Buffer */
+  size_t Length;		/* Bytes of the block in Buffer */
+  FILE *File;			/* File the block is written to, NULL for a map */
+  char *FileName;		/* Map file */
+  int NumberType;
+  MAPSIZE *Map;
+  MAPDUMP *DMap;
+  int Index;
+  struct OUTJOB *Next;
+} OUTJOB;
+
+static int Threaded = FALSE;	/* TRUE if the writer thread is running */
+static size_t MaxBytes = 0;	/* Most bytes of maps and text queued */
+static size_t QueuedBytes = 0;	/* Bytes of maps and text queued */
+static OUTJOB *Head = NULL;	/* Queue, written from the head */
+static OUTJOB *Tail = NULL;
+static OUTJOB *FreeMaps = NULL;	/* Written maps, for reuse */
+static OUTJOB *FreeText = NULL;	/* Written text blocks, for reuse */
+static OUTJOB *MapJob = NULL;	/* Map handed out by GetMapBuffer() */
+static OUTJOB *Text[MAXTEXTFILES];	/* Blocks being collected */
+static int NText = 0;
+static int Ending = FALSE;	/* TRUE when the writer can stop */
+
+#ifdef HAVE_PTHREAD
+static pthread_t Thread;	/* Writer thread */
+static pthread_mutex_t Lock;	/* Protects the queue and the free lists */
+static pthread_cond_t Changed;	/* Signaled when the queue changes */
+#endif
+
+static OUTJOB *GetJob(OUTJOB **FreeList, size_t Size);
+static void WriteJob(OUTJOB *Job);
+static void ReleaseJob(OUTJOB *Job);
+static void QueueJob(OUTJOB *Job);
+static OUTJOB *GetTextJob(FILE *File, size_t Room);
+
+/*****************************************************************************
+  GetJob()
+
+  Take a job with a buffer of at least Size bytes from a free list, or
+  allocate a new one
+*****************************************************************************/
+static OUTJOB *GetJob(OUTJOB **FreeList, size_t Size)
+{
+  const char *Routine = "GetJob";
+  OUTJOB **Prev;
+  OUTJOB *Job = NULL;
+
+#ifdef HAVE_PTHREAD
+  if (Threaded)
+    pthread_mutex_lock(&Lock);
+#endif
+  for (Prev = FreeList; *Prev != NULL; Prev = &((*Prev)->Next)) {
+    if ((*Prev)->Size >= Size) {
+      Job = *Prev;
+      *Prev = Job->Next;
+      break;
+    }
+  }
+#ifdef HAVE_PTHREAD
+  if (Threaded)
+    pthread_mutex_unlock(&Lock);
+#endif
+
+  if (Job == NULL) {
+    if (!(Job = (OUTJOB *) calloc(1, sizeof(OUTJOB))))
+      ReportError((char *) Routine, 1);
+    if (!(Job->Buffer = (char *) malloc(Size)))
+      ReportError((char *) Routine, 1);
+    Job->Size = Size;
+  }
+  Job->Length = 0;
+  Job->File = NULL;
+  Job->Next = NULL;
+
+  return Job;
+}
+
+/*****************************************************************************
+  WriteJob()
+*****************************************************************************/
+static void WriteJob(OUTJOB *Job)
+{
+  if (Job->File != NULL) {
+    if (fwrite(Job->Buffer, 1, Job->Length, Job->File) != Job->Length)
+      ReportError("WriteOutput", 41);
+  }
+  else
+    Write2DMatrix(Job->FileName, Job->Buffer, Job->NumberType, Job->Map,
+		  Job->DMap, Job->Index);
+}
+
+/*****************************************************************************
+  ReleaseJob()
+
+  Put a written job back on its free list.  Text blocks that were grown
+  for a long line are freed.  Must be called with the lock held.
+*****************************************************************************/
+static void ReleaseJob(OUTJOB *Job)
+{
+  if (Job->File == NULL) {
+    Job->Next = FreeMaps;
+    FreeMaps = Job;
+  }
+  else if (Job->Size == TEXTBLOCKSIZE) {
+    Job->Next = FreeText;
+    FreeText = Job;
+  }
+  else {
+    free(Job->Buffer);
+    free(Job);
+  }
+}
+
+/*****************************************************************************
+  QueueJob()
+
+  Hand a job to the writer, waiting while the queue is full, or write it
+  right away if there is no writer
+*****************************************************************************/
+static void QueueJob(OUTJOB *Job)
+{
+  if (!Threaded) {
+    WriteJob(Job);
+    ReleaseJob(Job);
+    return;
+  }
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&Lock);
+  while (QueuedBytes > 0 && QueuedBytes + Job->Size > MaxBytes)
+    pthread_cond_wait(&Changed, &Lock);
+  QueuedBytes += Job->Size;
+  if (Tail == NULL)
+    Head = Job;
+  else
+    Tail->Next = Job;
+  Tail = Job;
+  pthread_cond_broadcast(&Changed);
+  pthread_mutex_unlock(&Lock);
+#endif
+}
+
+#ifdef HAVE_PTHREAD
+/*****************************************************************************
+  WriteQueue()
+
+  Writer thread: write the jobs in the order in which they were queued
+*****************************************************************************/
+static void *WriteQueue(void *Arg)
+{
+  OUTJOB *Job;
+
+  for (;;) {
+    pthread_mutex_lock(&Lock);
+    while (Head == NULL && !Ending)
+      pthread_cond_wait(&Changed, &Lock);
+    Job = Head;
+    pthread_mutex_unlock(&Lock);
+    if (Job == NULL)
+      break;
+
+    WriteJob(Job);
+
+    pthread_mutex_lock(&Lock);
+    Head = Job->Next;
+    if (Head == NULL)
+      Tail = NULL;
+    QueuedBytes -= Job->Size;
+    ReleaseJob(Job);
+    pthread_cond_broadcast(&Changed);
+    pthread_mutex_unlock(&Lock);
+  }
+
+  return NULL;
+}
+#endif
+
+/*****************************************************************************
+  Function name: InitOutput()
+
+  Purpose      : Start the writer thread
+
+  Required     :
+    int QueueSize - Most megabytes of output waiting to be written, 0 to
+                    write all output right away
+
+  Returns      : void
+
+  Comments     : Must be called after InitFileIO()
+*****************************************************************************/
+void InitOutput(int QueueSize)
+{
+#ifndef HAVE_PTHREAD
+  if (QueueSize > 0)
+    printf("Output is written right away: DHSVM was built without threads\n");
+  QueueSize = 0;
+#endif
+  if (QueueSize < 0)
+    QueueSize = 0;
+
+  MaxBytes = (size_t) QueueSize * 1024 * 1024;
+  Threaded = FALSE;
+  Ending = FALSE;
+
+#ifdef HAVE_PTHREAD
+  if (MaxBytes > 0) {
+    pthread_mutex_init(&Lock, NULL);
+    pthread_cond_init(&Changed, NULL);
+    if (pthread_create(&Thread, NULL, WriteQueue, NULL) != 0)
+      printf("Cannot start the output writer thread, writing output right away\n");
+    else {
+      Threaded = TRUE;
+      printf("Writing output in a separate thread, queuing up to %d MB\n",
+	     QueueSize);
+    }
+  }
+#endif
+}
+
+/*****************************************************************************
+  Function name: GetMapBuffer()
+
+  Purpose      : Get a buffer to fill with a map for WriteMapOutput()
+
+  Required     :
+    size_t Size - Bytes needed
+
+  Returns      : Buffer of Size bytes, set to zero
+
+  Comments     : The buffer belongs to the caller until it is passed to
+                 WriteMapOutput().  Only one buffer is handed out at a
+                 time: a buffer that was not passed on is reused.
+*****************************************************************************/
+void *GetMapBuffer(size_t Size)
+{
+  if (MapJob != NULL && MapJob->Size < Size) {
+    free(MapJob->Buffer);
+    free(MapJob);
+    MapJob = NULL;
+  }
+  if (MapJob == NULL)
+    MapJob = GetJob(&FreeMaps, Size);
+  memset(MapJob->Buffer, 0, Size);
+
+  return MapJob->Buffer;
+}
+
+/*****************************************************************************
+  Function name: WriteMapOutput()
+
+  Purpose      : Write a map to a file through the queue
+
+  Required     : As Write2DMatrix()
+
+  Returns      : void
+
+  Comments     : A buffer from GetMapBuffer() is handed over to the writer
+                 and must not be used afterwards.  Any other Matrix is
+                 copied.  With MPI the bands of all processes are collected
+                 on the first process, which queues the map of the whole
+                 area, so all processes have to call it.
+*****************************************************************************/
+void WriteMapOutput(char *FileName, void *Matrix, int NumberType,
+		    MAPSIZE *Map, MAPDUMP *DMap, int Index)
+{
+  OUTJOB *Job;
+  MAPSIZE *Whole;
+  size_t Size;
+
+  /* the text that is collected so far comes first */
+  FlushOutput();
+
+  Whole = WholeMap(Map);
+  if (Whole != Map) {
+    Job = NULL;
+    if (Whole != NULL)
+      Job = GetJob(&FreeMaps, Whole->NY * Whole->NX *
+		   SizeOfNumberType(NumberType));
+    GatherMap(Matrix, (Job != NULL) ? Job->Buffer : NULL,
+	      SizeOfNumberType(NumberType), Map);
+    if (Whole == NULL)
+      return;
+    Map = Whole;
+  }
+  else if (MapJob != NULL && Matrix == MapJob->Buffer) {
+    Job = MapJob;
+    MapJob = NULL;
+  }
+  else {
+    Size = Map->NY * Map->NX * SizeOfNumberType(NumberType);
+    Job = GetJob(&FreeMaps, Size);
+    memcpy(Job->Buffer, Matrix, Size);
+  }
+
+  Job->FileName = FileName;
+  Job->NumberType = NumberType;
+  Job->Map = Map;
+  Job->DMap = DMap;
+  Job->Index = Index;
+  QueueJob(Job);
+}
+
+/*****************************************************************************
+  GetTextJob()
+
+  Get the block that is collected for File, with room for at least Room
+  more bytes
+*****************************************************************************/
+static OUTJOB *GetTextJob(FILE *File, size_t Room)
+{
+  const char *Routine = "GetTextJob";
+  OUTJOB *Job;
+  int i;
+
+  for (i = 0; i < NText; i++)
+    if (Text[i]->File == File)
+      break;
+  if (i == NText) {
+    if (NText == MAXTEXTFILES)
+      FlushOutput();
+    i = NText++;
+    Text[i] = GetJob(&FreeText, TEXTBLOCKSIZE);
+    Text[i]->File = File;
+  }
+  Job = Text[i];
+
+  if (Job->Size - Job->Length < Room) {
+    /* queue the full block and start a new one, large enough for Room */
+    if (Job->Length > 0) {
+      QueueJob(Job);
+      Job = Text[i] = GetJob(&FreeText, TEXTBLOCKSIZE);
+      Job->File = File;
+    }
+    if (Job->Size < Room) {
+      if (!(Job->Buffer = (char *) realloc(Job->Buffer, Room)))
+	ReportError((char *) Routine, 1);
+      Job->Size = Room;
+    }
+  }
+
+  return Job;
+}
+
+/*****************************************************************************
+  Function name: OutPrintf()
+
+  Purpose      : fprintf() through the queue
+
+  Required     :
+    FILE *File         - Output file
+    const char *Format - As fprintf()
+
+  Returns      : Number of characters written, or a negative value on error
+
+  Comments     : Nothing is written to a NULL file, which is what the
+                 output files are on all but the first MPI process
+*****************************************************************************/
+int OutPrintf(FILE *File, const char *Format, ...)
+{
+  va_list ap;
+  OUTJOB *Job;
+  int Length;
+
+  if (File == NULL)
+    return 0;
+
+  va_start(ap, Format);
+  if (!Threaded || File == stdout || File == stderr) {
+    Length = vfprintf(File, Format, ap);
+    va_end(ap);
+    return Length;
+  }
+  va_end(ap);
+
+  Job = GetTextJob(File, 1);
+  va_start(ap, Format);
+  Length = vsnprintf(Job->Buffer + Job->Length, Job->Size - Job->Length,
+		     Format, ap);
+  va_end(ap);
+  if (Length < 0)
+    return Length;
+
+  if (Job->Length + Length >= Job->Size) {
+    Job = GetTextJob(File, Length + 1);
+    va_start(ap, Format);
+    vsnprintf(Job->Buffer + Job->Length, Job->Size - Job->Length, Format, ap);
+    va_end(ap);
+  }
+  Job->Length += Length;
+
+  return Length;
+}
+
+/*****************************************************************************
+  Function name: OutWrite()
+
+  Purpose      : fwrite() through the queue
+
+  Required     :
+    const void *Data - Bytes to write
+    size_t Size      - Number of bytes
+    FILE *File       - Output file
+
+  Returns      : void
+
+  Comments     : Nothing is written to a NULL file, see OutPrintf()
+*****************************************************************************/
+void OutWrite(const void *Data, size_t Size, FILE *File)
+{
+  OUTJOB *Job;
+
+  if (File == NULL)
+    return;
+
+  if (!Threaded) {
+    if (fwrite(Data, 1, Size, File) != Size)
+      ReportError("OutWrite", 41);
+    return;
+  }
+
+  Job = GetTextJob(File, Size);
+  memcpy(Job->Buffer + Job->Length, Data, Size);
+  Job->Length += Size;
+}
+
+/*****************************************************************************
+  Function name: OutPrintDate()
+
+  Purpose      : PrintDate() through the queue
+*****************************************************************************/
+void OutPrintDate(DATE *Day, FILE *OutFile)
+{
+  OutPrintf(OutFile, "%02d/%02d/%4d-%02d:%02d:%02d", Day->Month, Day->Day,
+	    Day->Year, Day->Hour, Day->Min, Day->Sec);
+}
+
+/*****************************************************************************
+  Function name: FlushOutput()
+
+  Purpose      : Queue the text that has been collected
+
+  Comments     : Called at the end of each time step, so that the text of
+                 a step does not wait for the next one
+*****************************************************************************/
+void FlushOutput(void)
+{
+  int i;
+
+  for (i = 0; i < NText; i++) {
+    if (Text[i]->Length > 0) {
+      QueueJob(Text[i]);
+    }
+    else {
+#ifdef HAVE_PTHREAD
+      if (Threaded)
+	pthread_mutex_lock(&Lock);
+#endif
+      ReleaseJob(Text[i]);
+#ifdef HAVE_PTHREAD
+      if (Threaded)
+	pthread_mutex_unlock(&Lock);
+#endif
+    }
+  }
+  NText = 0;
+}
+
+/*****************************************************************************
+  Function name: EndOutput()
+
+  Purpose      : Write all output that is queued, stop the writer thread
+                 and free the buffers
+
+  Comments     : Must be called before the output files are closed
+*****************************************************************************/
+void EndOutput(void)
+{
+  OUTJOB *Job;
+
+  FlushOutput();
+
+#ifdef HAVE_PTHREAD
+  if (Threaded) {
+    pthread_mutex_lock(&Lock);
+    Ending = TRUE;
+    pthread_cond_broadcast(&Changed);
+    pthread_mutex_unlock(&Lock);
+    pthread_join(Thread, NULL);
+    pthread_mutex_destroy(&Lock);
+    pthread_cond_destroy(&Changed);
+    Threaded = FALSE;
+  }
+#endif
+
+  if (MapJob != NULL) {
+    MapJob->Next = FreeMaps;
+    FreeMaps = MapJob;
+    MapJob = NULL;
+  }
+  while (FreeMaps != NULL) {
+    Job = FreeMaps;
+    FreeMaps = Job->Next;
+    free(Job->Buffer);
+    free(Job);
+  }
+  while (FreeText != NULL) {
+    Job = FreeText;
+    FreeText = Job->Next;
+    free(Job->Buffer);
+    free(Job);
+  }
+}
@@ -0,0 +1,1430 @@
+/*
+ * SUMMARY:      Parallel.c - Split the model grid over MPI processes
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  With MPI, each process computes a band of rows of the
+ *               grid.  The bands hold about the same number of basin cells.
+ *               Each process only allocates and reads its own band and
+ *               HALOROWS rows on either side of it: in the MAPSIZE of a
+ *               process, NY is the number of rows held, GlobalY0 is the
+ *               row of the whole grid that is row 0 there, and FirstRow
+ *               and NRows give the band within the rows held.  Before a
+ *               routine reads the neighbors of the cells in the band, the
+ *               row on either side of the band (the halo) is brought up to
+ *               date by the neighboring processes.  Each channel segment
+ *               is routed by the process that has most of its cells: the
+ *               inflow that the other processes add to the segment is sent
+ *               to that process, and the outflow of a segment is sent to
+ *               the process that routes its outlet.  Basin totals are summed
+ *               over the processes.  Maps and model state are collected on
+ *               the first process, which writes them, and each pixel is
+ *               written by the process that computes it.
+ * DESCRIP-END.
+ * FUNCTIONS:    InitParallel()
+ *               EndParallel()
+ *               ParallelRank()
+ *               ParallelSize()
+ *               DecomposeDomain()
+ *               InitLocalMap()
+ *               RowOwner()
+ *               OwnsCell()
+ *               WholeMap()
+ *               GatherMap()
+ *               ShareCellValue()
+ *               ExchangeMapHalo()
+ *               ExchangeArrayHalo()
+ *               BeginOrderedSweep()
+ *               EndOrderedSweep()
+ *               BeginOrderedPass()
+ *               EndOrderedPass()
+ *               ParallelSum()
+ *               SumRows()
+ *               ParallelMin()
+ *               ExchangeCounts()
+ *               ExchangeItems()
+ *               InitChannelRouting()
+ *               RouteChannelNetwork()
+ *               ForwardChannelIncrements()
+ * COMMENTS:
+ *   Without HAVE_MPI, or with a single process, there is one band with all
+ *   the rows and these functions do nothing, so the model runs as before.
+ *
+ *   The results of a run on several processes are the same as those of a
+ *   run on one process.  The basin totals are added up by SumRows() in an
+ *   order that does not depend on the number of processes.
+ *
+ *   An error on one process stops that process, after which mpirun stops
+ *   the others.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "DHSVMChannel.h"
+#include "functions.h"
+
+/* Rows held on either side of the band.  The row next to the band is
+   exchanged during the run; the row beyond it is only read at the start,
+   so that the slopes and flow directions of the halo cells are those of
+   the whole grid */
+#define HALOROWS 2
+
+static int Rank = 0;		/* This process */
+static int NProcs = 1;		/* Number of processes */
+static int *BandRow = NULL;	/* First row of the band of each process;
+				   NProcs + 1 in size */
+static MAPSIZE Whole;		/* Whole model area, for output */
+
+#ifdef HAVE_MPI
+
+#define TAG_HALO_DOWN  1
+#define TAG_HALO_UP    2
+#define TAG_SWEEP_DOWN 3
+#define TAG_SWEEP_UP   4
+#define TAG_PASS       5
+#define TAG_CHANNEL    6
+
+#define NSEGFIELDS 11		/* Fields of a segment shared after routing */
+
+/* Channel increment, with the segment it was made to */
+typedef struct {
+  int Network;			/* 0 for the streams, 1 for the roads */
+  int Segment;			/* Index of the segment in the schedule */
+  int Kind;
+  float Value[CHANNEL_INC_VALUES];
+} FORWARDINC;
+
+/* Outflows of the segments of a level sent to, or received from, one
+   process */
+typedef struct {
+  int Peer;			/* Other process */
+  int N;			/* Number of segments */
+  int First;			/* First segment in the list and buffer */
+} SEGMENTMSG;
+
+/* How a channel network is routed over the processes */
+typedef struct {
+  ChannelSchedule *Schedule;
+  int *Index;			/* Schedule index of each segment id */
+  int *Owner;			/* Process that routes each segment */
+  int *SendStart;		/* First message sent in each level;
+				   nlevel + 1 in size */
+  int *ReceiveStart;		/* First message received in each level */
+  SEGMENTMSG *Send;
+  SEGMENTMSG *Receive;
+  int *SendSeg;			/* Segments of the messages, in level order */
+  int *ReceiveSeg;
+  float *SendBuffer;
+  float *ReceiveBuffer;
+  MPI_Request *Requests;
+  int NOwned;			/* Number of segments routed here */
+  int *Owned;			/* Segments routed here */
+  int *AllOwned;		/* Segments routed by each process, grouped by
+				   process */
+  int *FieldCounts;		/* Fields of the segments of each process */
+  int *FieldOffsets;
+  float *Fields;		/* Fields of the segments routed here */
+  float *AllFields;		/* Fields of all segments, grouped by process */
+} CHANNELPLAN;
+
+static CHANNELPLAN Plans[2];	/* Streams and roads */
+
+static char *RowBuffer = NULL;	/* Rows sent and received */
+static size_t RowBufferSize = 0;
+static int *ItemOffsets = NULL;	/* Offsets for ExchangeItems() */
+
+static char *GetRowBuffer(MAPSIZE *Map, int NRows, size_t Size);
+static void CopyRows(char *Buffer, int ToBuffer, int y, int NRows,
+		     MAPSIZE *Map, void **Rows, void *Array, size_t Stride,
+		     size_t Offset, size_t Size);
+static void ExchangeHalo(MAPSIZE *Map, void **Rows, void *Array,
+			 size_t Stride, size_t Offset, size_t Size);
+static void InitPlan(CHANNELPLAN *Plan, ChannelSchedule *Schedule,
+		     ChannelMapPtr **ChannelMap, MAPSIZE *Map);
+static void SegmentFields(Channel *Segment, float **Field);
+static void AddPairs(double *Partial, int NBlocks, int N);
+static void AddNode(double *Nodes, int NNodes, int First, int Level,
+		    int NBlocks, int N, double *Sum, double *Scratch);
+static void ShareSegments(CHANNELPLAN *Plan, int AllProcesses);
+
+/*****************************************************************************
+  GetRowBuffer()
+
+  Buffer for NRows rows of a field of Size bytes per cell
+*****************************************************************************/
+static char *GetRowBuffer(MAPSIZE *Map, int NRows, size_t Size)
+{
+  const char *Routine = "GetRowBuffer";
+  size_t Bytes = (size_t) NRows * Map->NX * Size;
+
+  if (Bytes > RowBufferSize) {
+    if (!(RowBuffer = (char *) realloc(RowBuffer, Bytes)))
+      ReportError((char *) Routine, 1);
+    RowBufferSize = Bytes;
+  }
+  return RowBuffer;
+}
+
+/*****************************************************************************
+  CopyRows()
+
+  Copy a field of Size bytes, at Offset in each cell, of NRows rows starting
+  at row y to (ToBuffer is TRUE) or from a buffer.  The cells are either
+  Rows[y] + x * Stride, for a map, or Array + (y * NX + x) * Stride, for an
+  array in row-major order.
+*****************************************************************************/
+static void CopyRows(char *Buffer, int ToBuffer, int y, int NRows,
+		     MAPSIZE *Map, void **Rows, void *Array, size_t Stride,
+		     size_t Offset, size_t Size)
+{
+  char *Cell;
+  int i;
+  int x;
+
+  for (i = 0; i < NRows; i++) {
+    if (Rows != NULL)
+      Cell = (char *) Rows[y + i] + Offset;
+    else
+      Cell = (char *) Array + (size_t) (y + i) * Map->NX * Stride + Offset;
+    for (x = 0; x < Map->NX; x++, Cell += Stride, Buffer += Size) {
+      if (ToBuffer)
+	memcpy(Buffer, Cell, Size);
+      else
+	memcpy(Cell, Buffer, Size);
+    }
+  }
+}
+
+/*****************************************************************************
+  ExchangeHalo()
+
+  Send the first and last row of the band to the processes above and below,
+  and receive the rows on either side of the band from them
+*****************************************************************************/
+static void ExchangeHalo(MAPSIZE *Map, void **Rows, void *Array,
+			 size_t Stride, size_t Offset, size_t Size)
+{
+  int Up = (Rank > 0) ? Rank - 1 : MPI_PROC_NULL;
+  int Down = (Rank < NProcs - 1) ? Rank + 1 : MPI_PROC_NULL;
+  int Bytes = Map->NX * (int) Size;
+  int y0 = Map->FirstRow;
+  int y1 = Map->FirstRow + Map->NRows;
+  char *Send;
+  char *Receive;
+
+  Send = GetRowBuffer(Map, 2, Size);
+  Receive = Send + Bytes;
+
+  CopyRows(Send, TRUE, y1 - 1, 1, Map, Rows, Array, Stride, Offset, Size);
+  MPI_Sendrecv(Send, Bytes, MPI_BYTE, Down, TAG_HALO_DOWN,
+	       Receive, Bytes, MPI_BYTE, Up, TAG_HALO_DOWN,
+	       MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  if (Up != MPI_PROC_NULL)
+    CopyRows(Receive, FALSE, y0 - 1, 1, Map, Rows, Array, Stride, Offset,
+	     Size);
+
+  CopyRows(Send, TRUE, y0, 1, Map, Rows, Array, Stride, Offset, Size);
+  MPI_Sendrecv(Send, Bytes, MPI_BYTE, Up, TAG_HALO_UP,
+	       Receive, Bytes, MPI_BYTE, Down, TAG_HALO_UP,
+	       MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  if (Down != MPI_PROC_NULL)
+    CopyRows(Receive, FALSE, y1, 1, Map, Rows, Array, Stride, Offset, Size);
+}
+
+/*****************************************************************************
+  InitPlan()
+
+  Decide which process routes each segment of a network, and list the
+  outflows that have to be sent and received in each level of the schedule
+*****************************************************************************/
+static void InitPlan(CHANNELPLAN *Plan, ChannelSchedule *Schedule,
+		     ChannelMapPtr **ChannelMap, MAPSIZE *Map)
+{
+  const char *Routine = "InitChannelRouting";
+  struct {
+    int Count;
+    int Rank;
+  } *Cells;			/* Cells of each segment, with the process */
+  ChannelMapPtr Cell;
+  SEGMENTMSG *Msg;
+  int *Counts;
+  int *Offsets;
+  int MaxID;
+  int NSeg;
+  int NMsg;
+  int Total;
+  int i;
+  int k;
+  int l;
+  int n;
+  int o;
+  int p;
+  int x;
+  int y;
+
+  Plan->Schedule = Schedule;
+  if (Schedule == NULL)
+    return;
+  NSeg = Schedule->nseg;
+
+  MaxID = 0;
+  for (i = 0; i < NSeg; i++)
+    if (Schedule->seg[i]->id > MaxID)
+      MaxID = Schedule->seg[i]->id;
+  if (!(Plan->Index = (int *) calloc(MaxID + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  for (i = NSeg - 1; i >= 0; i--)
+    Plan->Index[Schedule->seg[i]->id] = i;
+
+  /* a segment is routed by the process with most of its cells, or by the
+     first of those processes */
+  if (!(Cells = calloc(NSeg + 1, sizeof(*Cells))))
+    ReportError((char *) Routine, 1);
+  for (i = 0; i < NSeg; i++) {
+    Cells[i].Count = 0;
+    Cells[i].Rank = Rank;
+  }
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++)
+    for (x = 0; x < Map->NX; x++)
+      for (Cell = ChannelMap[x][y]; Cell != NULL; Cell = Cell->next)
+	Cells[Plan->Index[Cell->channel->id]].Count++;
+  MPI_Allreduce(MPI_IN_PLACE, Cells, NSeg, MPI_2INT, MPI_MAXLOC,
+		MPI_COMM_WORLD);
+
+  if (!(Plan->Owner = (int *) calloc(NSeg + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Schedule->routed = (char *) calloc(NSeg + 1, sizeof(char))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->Owned = (int *) calloc(NSeg + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  Plan->NOwned = 0;
+  for (i = 0; i < NSeg; i++) {
+    Plan->Owner[i] = Cells[i].Rank;
+    Schedule->routed[i] = (Plan->Owner[i] == Rank);
+    if (Schedule->routed[i])
+      Plan->Owned[Plan->NOwned++] = i;
+  }
+  free(Cells);
+
+  /* the segments routed by each process, for ShareSegments() */
+  if (!(Counts = (int *) calloc(NProcs, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Offsets = (int *) calloc(NProcs, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  MPI_Allgather(&(Plan->NOwned), 1, MPI_INT, Counts, 1, MPI_INT,
+		MPI_COMM_WORLD);
+  for (Total = 0, p = 0; p < NProcs; p++) {
+    Offsets[p] = Total;
+    Total += Counts[p];
+  }
+  if (!(Plan->AllOwned = (int *) calloc(Total + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  MPI_Allgatherv(Plan->Owned, Plan->NOwned, MPI_INT, Plan->AllOwned, Counts,
+		 Offsets, MPI_INT, MPI_COMM_WORLD);
+  for (p = 0; p < NProcs; p++) {
+    Counts[p] *= NSEGFIELDS;
+    Offsets[p] *= NSEGFIELDS;
+  }
+  Plan->FieldCounts = Counts;
+  Plan->FieldOffsets = Offsets;
+  if (!(Plan->Fields = (float *) calloc((Plan->NOwned + 1) * NSEGFIELDS,
+					sizeof(float))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->AllFields = (float *) calloc((Total + 1) * NSEGFIELDS,
+					   sizeof(float))))
+    ReportError((char *) Routine, 1);
+
+  /* the outflow of a segment goes to the process that routes its outlet.
+     The messages of a level hold the segments in level order, which is
+     the order in which the outflows are added to the outlets */
+  if (!(Plan->SendStart = (int *) calloc(Schedule->nlevel + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->ReceiveStart = (int *) calloc(Schedule->nlevel + 1,
+					    sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->Send = (SEGMENTMSG *) calloc(NSeg + 1, sizeof(SEGMENTMSG))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->Receive = (SEGMENTMSG *) calloc(NSeg + 1, sizeof(SEGMENTMSG))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->SendSeg = (int *) calloc(NSeg + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->ReceiveSeg = (int *) calloc(NSeg + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->SendBuffer = (float *) calloc(NSeg + 1, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->ReceiveBuffer = (float *) calloc(NSeg + 1, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  if (!(Plan->Requests = (MPI_Request *) calloc(2 * NProcs,
+						sizeof(MPI_Request))))
+    ReportError((char *) Routine, 1);
+
+  for (NMsg = 0, k = 0, l = 0; l < Schedule->nlevel; l++) {
+    Plan->SendStart[l] = NMsg;
+    for (p = 0; p < NProcs; p++) {
+      Msg = &(Plan->Send[NMsg]);
+      Msg->Peer = p;
+      Msg->First = k;
+      Msg->N = 0;
+      for (i = Schedule->level_start[l]; i < Schedule->level_start[l + 1]; i++) {
+	n = Schedule->level_seg[i];
+	o = Schedule->outlet[n];
+	if (o >= 0 && p != Rank && Plan->Owner[n] == Rank &&
+	    Plan->Owner[o] == p)
+	  Plan->SendSeg[Msg->First + Msg->N++] = n;
+      }
+      if (Msg->N > 0) {
+	k += Msg->N;
+	NMsg++;
+      }
+    }
+  }
+  Plan->SendStart[Schedule->nlevel] = NMsg;
+
+  for (NMsg = 0, k = 0, l = 0; l < Schedule->nlevel; l++) {
+    Plan->ReceiveStart[l] = NMsg;
+    for (p = 0; p < NProcs; p++) {
+      Msg = &(Plan->Receive[NMsg]);
+      Msg->Peer = p;
+      Msg->First = k;
+      Msg->N = 0;
+      for (i = Schedule->level_start[l]; i < Schedule->level_start[l + 1]; i++) {
+	n = Schedule->level_seg[i];
+	o = Schedule->outlet[n];
+	if (o >= 0 && p != Rank && Plan->Owner[n] == p &&
+	    Plan->Owner[o] == Rank)
+	  Plan->ReceiveSeg[Msg->First + Msg->N++] = n;
+      }
+      if (Msg->N > 0) {
+	k += Msg->N;
+	NMsg++;
+      }
+    }
+  }
+  Plan->ReceiveStart[Schedule->nlevel] = NMsg;
+}
+
+/*****************************************************************************
+  SegmentFields()
+
+  Fields of a segment that the other processes read after it is routed
+*****************************************************************************/
+static void SegmentFields(Channel *Segment, float **Field)
+{
+  Field[0] = &(Segment->inflow);
+  Field[1] = &(Segment->lateral_inflow);
+  Field[2] = &(Segment->outflow);
+  Field[3] = &(Segment->storage);
+  Field[4] = &(Segment->last_storage);
+  Field[5] = &(Segment->melt);
+  Field[6] = &(Segment->NSW);
+  Field[7] = &(Segment->NLW);
+  Field[8] = &(Segment->VP);
+  Field[9] = &(Segment->WND);
+  Field[10] = &(Segment->ATP);
+}
+
+/*****************************************************************************
+  ShareSegments()
+
+  Give the state of the segments routed here to the first process, which
+  writes the channel output, or to all processes (AllProcesses is TRUE)
+*****************************************************************************/
+static void ShareSegments(CHANNELPLAN *Plan, int AllProcesses)
+{
+  ChannelSchedule *Schedule = Plan->Schedule;
+  float *Field[NSEGFIELDS];
+  float *Value;
+  int i;
+  int j;
+
+  for (Value = Plan->Fields, i = 0; i < Plan->NOwned; i++) {
+    SegmentFields(Schedule->seg[Plan->Owned[i]], Field);
+    for (j = 0; j < NSEGFIELDS; j++)
+      *Value++ = *(Field[j]);
+  }
+
+  if (AllProcesses)
+    MPI_Allgatherv(Plan->Fields, Plan->NOwned * NSEGFIELDS, MPI_FLOAT,
+		   Plan->AllFields, Plan->FieldCounts, Plan->FieldOffsets,
+		   MPI_FLOAT, MPI_COMM_WORLD);
+  else
+    MPI_Gatherv(Plan->Fields, Plan->NOwned * NSEGFIELDS, MPI_FLOAT,
+		Plan->AllFields, Plan->FieldCounts, Plan->FieldOffsets,
+		MPI_FLOAT, 0, MPI_COMM_WORLD);
+  if (!AllProcesses && Rank != 0)
+    return;
+
+  for (Value = Plan->AllFields, i = 0; i < Schedule->nseg; i++) {
+    SegmentFields(Schedule->seg[Plan->AllOwned[i]], Field);
+    for (j = 0; j < NSEGFIELDS; j++)
+      *(Field[j]) = *Value++;
+  }
+}
+
+#endif /* HAVE_MPI */
+
+/*****************************************************************************
+  Function name: InitParallel()
+
+  Purpose      : Start MPI
+
+  Required     :
+    int *argc   - Number of command line arguments
+    char ***argv - Command line arguments
+
+  Returns      : void
+
+  Modifies     : argc and argv, if MPI takes arguments out
+
+  Comments     : Has to be called before anything else in main().  Only the
+                 first process writes to the standard output.
+*****************************************************************************/
+void InitParallel(int *argc, char ***argv)
+{
+#ifdef HAVE_MPI
+  MPI_Init(argc, argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &Rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &NProcs);
+  if (Rank > 0 && freopen("/dev/null", "w", stdout) == NULL)
+    fprintf(stderr, "Process %d could not close the standard output\n", Rank);
+#endif
+}
+
+/*****************************************************************************
+  Function name: EndParallel()
+
+  Purpose      : Stop MPI at the end of the run
+
+  Returns      : void
+*****************************************************************************/
+void EndParallel(void)
+{
+#ifdef HAVE_MPI
+  MPI_Finalize();
+#endif
+}
+
+/*****************************************************************************
+  Function name: ParallelRank()
+
+  Returns      : int - number of this process, 0 for the first process
+*****************************************************************************/
+int ParallelRank(void)
+{
+  return Rank;
+}
+
+/*****************************************************************************
+  Function name: ParallelSize()
+
+  Returns      : int - number of processes
+*****************************************************************************/
+int ParallelSize(void)
+{
+  return NProcs;
+}
+
+/*****************************************************************************
+  Function name: DecomposeDomain()
+
+  Purpose      : Split the rows of the grid over the processes
+
+  Required     :
+    LISTPTR Input         - Input file, for the basin mask
+    OPTIONSTRUCT *Options - Options
+    MAPSIZE *Map          - Model area
+
+  Returns      : void
+
+  Modifies     : Map
+
+  Comments     : Has to be called before any map is allocated or read.  The
+                 rows are split into bands with about the same number of
+                 basin cells, counted in the basin mask.  Map is then
+                 reduced to the band of this process and HALOROWS rows on
+                 either side of it (see data.h), so that all maps that are
+                 allocated and read with Map only hold those rows.
+*****************************************************************************/
+void DecomposeDomain(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map)
+{
+  const char *Routine = "DecomposeDomain";
+
+  Map->GlobalNY = Map->NY;
+  Map->GlobalY0 = 0;
+  Map->FirstRow = 0;
+  Map->NRows = Map->NY;
+  Whole = *Map;
+
+  if (!(BandRow = (int *) calloc(NProcs + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  BandRow[0] = 0;
+  BandRow[NProcs] = Map->NY;
+
+  if (NProcs == 1)
+    return;
+
+#ifdef HAVE_MPI
+  {
+    int *RowCells;		/* Basin cells in each row */
+    long long NCells;		/* Basin cells in the model area */
+    long long Count;		/* Basin cells in the rows so far */
+    int p;
+    int y;
+
+    if (Options->Extent == POINT)
+      ReportError((char *) Routine, 78);
+    if (Map->NY < NProcs)
+      ReportError((char *) Routine, 77);
+
+    if (!(RowCells = (int *) calloc(Map->NY, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    if (Rank == 0)
+      CountBasinCells(Input, Options, Map, RowCells);
+    MPI_Bcast(RowCells, Map->NY, MPI_INT, 0, MPI_COMM_WORLD);
+
+    NCells = 0;
+    for (y = 0; y < Map->NY; y++)
+      NCells += RowCells[y];
+
+    /* a band ends at the row where the count of basin cells passes its
+       share, or where there are just enough rows left for the other
+       bands */
+    Count = 0;
+    p = 1;
+    for (y = 0; y < Map->NY && p < NProcs; y++) {
+      Count += RowCells[y];
+      if (Count * NProcs >= NCells * p || Map->NY - (y + 1) == NProcs - p) {
+	BandRow[p] = y + 1;
+	p++;
+      }
+    }
+
+    printf("Splitting the model area over %d processes\n", NProcs);
+    for (p = 0; p < NProcs; p++) {
+      Count = 0;
+      for (y = BandRow[p]; y < BandRow[p + 1]; y++)
+	Count += RowCells[y];
+      printf("Process %d: rows %d to %d, %lld basin cells\n", p, BandRow[p],
+	     BandRow[p + 1] - 1, Count);
+    }
+    free(RowCells);
+
+    Map->GlobalY0 = MAX(BandRow[Rank] - HALOROWS, 0);
+    Map->NY = MIN(BandRow[Rank + 1] + HALOROWS, Whole.NY) - Map->GlobalY0;
+    Map->FirstRow = BandRow[Rank] - Map->GlobalY0;
+    Map->NRows = BandRow[Rank + 1] - BandRow[Rank];
+  }
+#endif
+}
+
+/*****************************************************************************
+  Function name: InitLocalMap()
+
+  Purpose      : Set up the model area of the cells computed here
+
+  Required     :
+    MAPSIZE *Map      - Rows held by this process
+    MAPSIZE *LocalMap - Model area of this process
+
+  Returns      : void
+
+  Modifies     : LocalMap
+
+  Comments     : LocalMap is a copy of Map, except that its runs are only
+                 those in the band of this process, and NumCells is the
+                 number of basin cells in the band.  Routines that loop over
+                 the runs of LocalMap only compute the band.  With more than
+                 one process the channel increments are deferred until
+                 ForwardChannelIncrements().
+*****************************************************************************/
+void InitLocalMap(MAPSIZE *Map, MAPSIZE *LocalMap)
+{
+  const char *Routine = "InitLocalMap";
+  int First;			/* First run of the band */
+  int Last;			/* One past the last run of the band */
+  int r;
+  int y;
+
+  *LocalMap = *Map;
+
+  First = Map->RowRuns[Map->FirstRow];
+  Last = Map->RowRuns[Map->FirstRow + Map->NRows];
+  LocalMap->Runs = Map->Runs + First;
+  LocalMap->NumRuns = Last - First;
+  if (!(LocalMap->RowRuns = (int *) calloc(Map->NY + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  for (y = 0; y <= Map->NY; y++) {
+    r = Map->RowRuns[y];
+    if (r < First)
+      r = First;
+    if (r > Last)
+      r = Last;
+    LocalMap->RowRuns[y] = r - First;
+  }
+
+  LocalMap->NumCells = 0;
+  for (r = 0; r < LocalMap->NumRuns; r++)
+    LocalMap->NumCells += LocalMap->Runs[r].x1 - LocalMap->Runs[r].x0;
+
+  if (NProcs > 1)
+    channel_grid_defer(TRUE);
+}
+
+/*****************************************************************************
+  Function name: RowOwner()
+
+  Returns      : int - process that computes row y of the whole grid
+*****************************************************************************/
+int RowOwner(int y)
+{
+  int p;
+
+  for (p = 0; p < NProcs - 1; p++)
+    if (y < BandRow[p + 1])
+      break;
+  return p;
+}
+
+/*****************************************************************************
+  Function name: OwnsCell()
+
+  Returns      : int - TRUE if cell (y, x) of Map is computed here
+*****************************************************************************/
+int OwnsCell(MAPSIZE *Map, int y, int x)
+{
+  return (y >= Map->FirstRow && y < Map->FirstRow + Map->NRows &&
+	  x >= 0 && x < Map->NX);
+}
+
+/*****************************************************************************
+  Function name: WholeMap()
+
+  Purpose      : Model area of the output files
+
+  Required     :
+    MAPSIZE *Map - Model area
+
+  Returns      : MAPSIZE * - Map itself if it is not split over the
+                 processes; otherwise the whole model area on the first
+                 process, and NULL on the others, which do not write maps
+*****************************************************************************/
+MAPSIZE *WholeMap(MAPSIZE *Map)
+{
+  if (NProcs == 1 || Map->NRows >= Map->GlobalNY)
+    return Map;
+  return (Rank == 0) ? &Whole : NULL;
+}
+
+/*****************************************************************************
+  Function name: GatherMap()
+
+  Purpose      : Collect the bands of a map on the first process
+
+  Required     :
+    void *Matrix      - Map of this process, NY * NX values of Size bytes
+    void *WholeMatrix - Whole map, on the first process
+    size_t Size       - Size of a value
+    MAPSIZE *Map      - Model area of this process
+
+  Returns      : void
+
+  Modifies     : WholeMatrix
+*****************************************************************************/
+void GatherMap(void *Matrix, void *WholeMatrix, size_t Size, MAPSIZE *Map)
+{
+#ifdef HAVE_MPI
+  const char *Routine = "GatherMap";
+  MPI_Datatype Row;
+  int *Counts = NULL;
+  int *Offsets = NULL;
+  int p;
+
+  if (Rank == 0) {
+    if (!(Counts = (int *) calloc(NProcs, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    if (!(Offsets = (int *) calloc(NProcs, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    for (p = 0; p < NProcs; p++) {
+      Counts[p] = BandRow[p + 1] - BandRow[p];
+      Offsets[p] = BandRow[p];
+    }
+  }
+  MPI_Type_contiguous(Map->NX * (int) Size, MPI_BYTE, &Row);
+  MPI_Type_commit(&Row);
+  MPI_Gatherv((char *) Matrix + (size_t) Map->FirstRow * Map->NX * Size,
+	      Map->NRows, Row, WholeMatrix, Counts, Offsets, Row, 0,
+	      MPI_COMM_WORLD);
+  MPI_Type_free(&Row);
+  if (Rank == 0) {
+    free(Counts);
+    free(Offsets);
+  }
+#else
+  memcpy(WholeMatrix, Matrix, (size_t) Map->NY * Map->NX * Size);
+#endif
+}
+
+/*****************************************************************************
+  Function name: ShareCellValue()
+
+  Purpose      : Give the value of one cell to all processes
+
+  Required     :
+    MAPSIZE *Map - Model area
+    int y        - Row of the cell in Map
+    int x        - Column of the cell
+    float Value  - Value of the cell, only used if the cell is computed
+                   here
+
+  Returns      : float - value of the cell, or 0 if no process computes it
+
+  Comments     : Has to be called by all processes.  The caller does not
+                 hold the cell if OwnsCell() is FALSE, so it is usually
+                 called as
+                   ShareCellValue(Map, y, x,
+                                  OwnsCell(Map, y, x) ? Field[y][x] : 0);
+*****************************************************************************/
+float ShareCellValue(MAPSIZE *Map, int y, int x, float Value)
+{
+  double Sum = OwnsCell(Map, y, x) ? Value : 0.0;
+
+  ParallelSum(&Sum, 1);
+  return (float) Sum;
+}
+
+/*****************************************************************************
+  Function name: ExchangeMapHalo()
+
+  Purpose      : Bring the rows on either side of the band up to date
+
+  Required     :
+    MAPSIZE *Map  - Model area of this process
+    void **Rows   - Map, as an array of rows of cells
+    size_t Stride - Size of a cell
+    size_t Offset - Offset of the field in a cell
+    size_t Size   - Size of the field
+
+  Returns      : void
+
+  Modifies     : The field in the rows next to the band
+
+  Comments     : For example, the water level of the soil map is exchanged
+                 with
+                   ExchangeMapHalo(Map, (void **) SoilMap, sizeof(SOILPIX),
+                                   offsetof(SOILPIX, WaterLevel),
+                                   sizeof(float));
+*****************************************************************************/
+void ExchangeMapHalo(MAPSIZE *Map, void **Rows, size_t Stride, size_t Offset,
+		     size_t Size)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1)
+    ExchangeHalo(Map, Rows, NULL, Stride, Offset, Size);
+#endif
+}
+
+/*****************************************************************************
+  Function name: ExchangeArrayHalo()
+
+  Purpose      : Same as ExchangeMapHalo(), for an array with the cells in
+                 row-major order
+*****************************************************************************/
+void ExchangeArrayHalo(MAPSIZE *Map, void *Array, size_t Stride,
+		       size_t Offset, size_t Size)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1)
+    ExchangeHalo(Map, NULL, Array, Stride, Offset, Size);
+#endif
+}
+
+/*****************************************************************************
+  Function name: BeginOrderedSweep()
+
+  Purpose      : Wait for the processes above to finish a sweep over the
+                 rows that moves a field between neighboring cells
+
+  Required     : See ExchangeMapHalo()
+
+  Returns      : void
+
+  Modifies     : The field in the row above the band and the first row of
+                 the band
+
+  Comments     : Some sweeps (the avalanches) move mass from a cell to a
+                 neighbor that is visited later, and so have to be done in
+                 row order over the whole area to get the same result as on
+                 one process.  The process above hands over its last row
+                 and the halo row below it, as they are at the end of its
+                 sweep.  EndOrderedSweep() hands them over to the process
+                 below, and gets the last row back.
+*****************************************************************************/
+void BeginOrderedSweep(MAPSIZE *Map, void **Rows, size_t Stride,
+		       size_t Offset, size_t Size)
+{
+#ifdef HAVE_MPI
+  char *Buffer;
+  int Bytes = Map->NX * (int) Size;
+
+  if (NProcs == 1 || Rank == 0)
+    return;
+
+  Buffer = GetRowBuffer(Map, 2, Size);
+  MPI_Recv(Buffer, 2 * Bytes, MPI_BYTE, Rank - 1, TAG_SWEEP_DOWN,
+	   MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  CopyRows(Buffer, FALSE, Map->FirstRow - 1, 2, Map, Rows, NULL, Stride,
+	   Offset, Size);
+#endif
+}
+
+/*****************************************************************************
+  Function name: EndOrderedSweep()
+
+  Purpose      : Hand over the rows at the ends of the band after a sweep
+
+  Required     : See ExchangeMapHalo()
+
+  Returns      : void
+
+  Comments     : See BeginOrderedSweep()
+*****************************************************************************/
+void EndOrderedSweep(MAPSIZE *Map, void **Rows, size_t Stride,
+		     size_t Offset, size_t Size)
+{
+#ifdef HAVE_MPI
+  char *Buffer;
+  int Bytes = Map->NX * (int) Size;
+  int y1 = Map->FirstRow + Map->NRows;
+
+  if (NProcs == 1)
+    return;
+
+  Buffer = GetRowBuffer(Map, 2, Size);
+  if (Rank > 0) {
+    CopyRows(Buffer, TRUE, Map->FirstRow - 1, 1, Map, Rows, NULL, Stride,
+	     Offset, Size);
+    MPI_Send(Buffer, Bytes, MPI_BYTE, Rank - 1, TAG_SWEEP_UP, MPI_COMM_WORLD);
+  }
+  if (Rank < NProcs - 1) {
+    CopyRows(Buffer, TRUE, y1 - 1, 2, Map, Rows, NULL, Stride, Offset, Size);
+    MPI_Send(Buffer, 2 * Bytes, MPI_BYTE, Rank + 1, TAG_SWEEP_DOWN,
+	     MPI_COMM_WORLD);
+    MPI_Recv(Buffer, Bytes, MPI_BYTE, Rank + 1, TAG_SWEEP_UP, MPI_COMM_WORLD,
+	     MPI_STATUS_IGNORE);
+    CopyRows(Buffer, FALSE, y1 - 1, 1, Map, Rows, NULL, Stride, Offset, Size);
+  }
+#endif
+}
+
+/*****************************************************************************
+  Function name: BeginOrderedPass()
+
+  Purpose      : Wait for the processes above to finish adding to an array
+                 that is shared by all cells
+
+  Required     :
+    void *Data  - Array
+    size_t Size - Size of the array in bytes
+
+  Returns      : void
+
+  Modifies     : Data
+
+  Comments     : Used for the unit hydrograph, which all cells add to.  Each
+                 process in turn adds the cells of its band to the array as
+                 handed over by the process above, so that the sums are the
+                 same as on one process.  EndOrderedPass() hands the array
+                 over to the process below, and gives the final array to all
+                 processes.
+*****************************************************************************/
+void BeginOrderedPass(void *Data, size_t Size)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1 && Rank > 0)
+    MPI_Recv(Data, (int) Size, MPI_BYTE, Rank - 1, TAG_PASS, MPI_COMM_WORLD,
+	     MPI_STATUS_IGNORE);
+#endif
+}
+
+/*****************************************************************************
+  Function name: EndOrderedPass()
+
+  Purpose      : Hand over an array after adding the cells of the band
+
+  Comments     : See BeginOrderedPass()
+*****************************************************************************/
+void EndOrderedPass(void *Data, size_t Size)
+{
+#ifdef HAVE_MPI
+  if (NProcs == 1)
+    return;
+  if (Rank < NProcs - 1)
+    MPI_Send(Data, (int) Size, MPI_BYTE, Rank + 1, TAG_PASS, MPI_COMM_WORLD);
+  MPI_Bcast(Data, (int) Size, MPI_BYTE, NProcs - 1, MPI_COMM_WORLD);
+#endif
+}
+
+/*****************************************************************************
+  Function name: ParallelSum()
+
+  Purpose      : Sum values over all processes
+
+  Required     :
+    double *Values - Values of this process
+    int N          - Number of values
+
+  Returns      : void
+
+  Modifies     : Values, to the sums over all processes
+*****************************************************************************/
+void ParallelSum(double *Values, int N)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1)
+    MPI_Allreduce(MPI_IN_PLACE, Values, N, MPI_DOUBLE, MPI_SUM,
+		  MPI_COMM_WORLD);
+#endif
+}
+
+/*****************************************************************************
+  AddPairs()
+
+  Add up the sums of NBlocks blocks, each holding N values, into the first
+  block.  The blocks are added in pairs, then the pairs in pairs, and so on.
+*****************************************************************************/
+static void AddPairs(double *Partial, int NBlocks, int N)
+{
+  int Step;
+  int Block;
+  int i;
+
+  for (Step = 1; Step < NBlocks; Step *= 2) {
+    for (Block = 0; Block + Step < NBlocks; Block += 2 * Step) {
+      for (i = 0; i < N; i++)
+	Partial[Block * N + i] += Partial[(Block + Step) * N + i];
+    }
+  }
+}
+
+/*****************************************************************************
+  AddNode()
+
+  Set Sum to the sum that AddPairs() makes of the 2^Level blocks from First
+  on, out of NBlocks blocks, from the partial sums in Nodes.  Each of the
+  NNodes nodes holds its first block, its level and its N sums.  Scratch
+  holds N values for each level.
+*****************************************************************************/
+static void AddNode(double *Nodes, int NNodes, int First, int Level,
+		    int NBlocks, int N, double *Sum, double *Scratch)
+{
+  double *Node;
+  int i;
+
+  for (i = 0; i < NNodes; i++) {
+    Node = Nodes + (size_t) i * (N + 2);
+    if ((int) Node[0] == First && (int) Node[1] == Level) {
+      memcpy(Sum, Node + 2, N * sizeof(double));
+      return;
+    }
+  }
+  if (Level == 0)
+    ReportError("SumRows", 79);
+
+  AddNode(Nodes, NNodes, First, Level - 1, NBlocks, N, Sum, Scratch + N);
+  if (First + (1 << (Level - 1)) < NBlocks) {
+    AddNode(Nodes, NNodes, First + (1 << (Level - 1)), Level - 1, NBlocks, N,
+	    Scratch, Scratch + N);
+    for (i = 0; i < N; i++)
+      Sum[i] += Scratch[i];
+  }
+}
+
+/*****************************************************************************
+  Function name: SumRows()
+
+  Purpose      : Add up the sums of the rows of the whole grid
+
+  Required     :
+    double *Partial - N sums for each row of the band of this process
+    MAPSIZE *Map    - Rows held by this process
+    int N           - Number of sums of a row
+
+  Returns      : void
+
+  Modifies     : The first N values of Partial, to the sums over all the
+                 rows of the grid
+
+  Comments     : The rows are added in pairs, then the pairs in pairs, and
+                 so on, over the rows of the whole grid.  Each process adds
+                 up the largest groups of rows that lie in its band, and
+                 the groups are then added up in the same way on every
+                 process.  The sums therefore only depend on the grid, and
+                 not on the number of processes.
+*****************************************************************************/
+void SumRows(double *Partial, MAPSIZE *Map, int N)
+{
+  if (NProcs == 1) {
+    AddPairs(Partial, Map->NRows, N);
+    return;
+  }
+
+#ifdef HAVE_MPI
+  {
+    const char *Routine = "SumRows";
+    double *Nodes;		/* first row, level and sums of each group */
+    double *AllNodes;
+    double *Scratch;
+    int *Counts;
+    int *Offsets;
+    int NNodes;
+    int Total;
+    int First;			/* first row of the band in the whole grid */
+    int End;
+    int Row;
+    int Level;
+    int Top;			/* level of the group of all rows */
+    int Length;
+    int p;
+
+    First = Map->GlobalY0 + Map->FirstRow;
+    End = First + Map->NRows;
+    for (Top = 0; (1 << Top) < Map->GlobalNY; Top++)
+      ;
+
+    /* a group of 2^Level rows starts at a multiple of 2^Level */
+    if (!(Nodes = (double *) calloc((size_t) (2 * Top + 2) * (N + 2),
+				    sizeof(double))))
+      ReportError((char *) Routine, 1);
+    for (NNodes = 0, Row = First; Row < End; Row += Length, NNodes++) {
+      for (Level = 0; Level < Top && Row % (2 << Level) == 0 &&
+	   MIN(Row + (2 << Level), Map->GlobalNY) <= End; Level++)
+	;
+      Length = MIN(1 << Level, Map->GlobalNY - Row);
+      AddPairs(Partial + (size_t) (Row - First) * N, Length, N);
+      Nodes[NNodes * (N + 2)] = Row;
+      Nodes[NNodes * (N + 2) + 1] = Level;
+      memcpy(Nodes + NNodes * (N + 2) + 2, Partial + (size_t) (Row - First) * N,
+	     N * sizeof(double));
+    }
+
+    if (!(Counts = (int *) calloc(NProcs, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    if (!(Offsets = (int *) calloc(NProcs, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    p = NNodes * (N + 2);
+    MPI_Allgather(&p, 1, MPI_INT, Counts, 1, MPI_INT, MPI_COMM_WORLD);
+    for (Total = 0, p = 0; p < NProcs; p++) {
+      Offsets[p] = Total;
+      Total += Counts[p];
+    }
+    if (!(AllNodes = (double *) calloc(Total, sizeof(double))))
+      ReportError((char *) Routine, 1);
+    MPI_Allgatherv(Nodes, NNodes * (N + 2), MPI_DOUBLE, AllNodes, Counts,
+		   Offsets, MPI_DOUBLE, MPI_COMM_WORLD);
+
+    if (!(Scratch = (double *) calloc((size_t) (Top + 1) * N, sizeof(double))))
+      ReportError((char *) Routine, 1);
+    AddNode(AllNodes, Total / (N + 2), 0, Top, Map->GlobalNY, N, Partial,
+	    Scratch);
+
+    free(Nodes);
+    free(AllNodes);
+    free(Scratch);
+    free(Counts);
+    free(Offsets);
+  }
+#endif
+}
+
+/*****************************************************************************
+  Function name: ParallelMin()
+
+  Purpose      : Smallest values over all processes
+
+  Required     :
+    float *Values - Values of this process
+    int N         - Number of values
+
+  Returns      : void
+
+  Modifies     : Values, to the smallest over all processes
+*****************************************************************************/
+void ParallelMin(float *Values, int N)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1)
+    MPI_Allreduce(MPI_IN_PLACE, Values, N, MPI_FLOAT, MPI_MIN,
+		  MPI_COMM_WORLD);
+#endif
+}
+
+/*****************************************************************************
+  Function name: ExchangeCounts()
+
+  Purpose      : Tell each process how many items it gets from this one
+
+  Required     :
+    int *SendCounts    - Number of items for each process
+    int *ReceiveCounts - Number of items from each process
+
+  Returns      : void
+
+  Modifies     : ReceiveCounts
+*****************************************************************************/
+void ExchangeCounts(int *SendCounts, int *ReceiveCounts)
+{
+#ifdef HAVE_MPI
+  if (NProcs > 1) {
+    MPI_Alltoall(SendCounts, 1, MPI_INT, ReceiveCounts, 1, MPI_INT,
+		 MPI_COMM_WORLD);
+    return;
+  }
+#endif
+  ReceiveCounts[0] = SendCounts[0];
+}
+
+/*****************************************************************************
+  Function name: ExchangeItems()
+
+  Purpose      : Send items of Size bytes to each process
+
+  Required     :
+    void *Send         - Items to send, grouped by process
+    int *SendCounts    - Number of items for each process
+    void *Receive      - Items received, grouped by process
+    int *ReceiveCounts - Number of items from each process, see
+                         ExchangeCounts()
+    size_t Size        - Size of an item
+
+  Returns      : void
+
+  Modifies     : Receive
+*****************************************************************************/
+void ExchangeItems(void *Send, int *SendCounts, void *Receive,
+		   int *ReceiveCounts, size_t Size)
+{
+#ifdef HAVE_MPI
+  const char *Routine = "ExchangeItems";
+  MPI_Datatype Item;
+  int p;
+
+  if (NProcs > 1) {
+    if (ItemOffsets == NULL &&
+	!(ItemOffsets = (int *) calloc(2 * NProcs, sizeof(int))))
+      ReportError((char *) Routine, 1);
+    for (p = 1; p < NProcs; p++) {
+      ItemOffsets[p] = ItemOffsets[p - 1] + SendCounts[p - 1];
+      ItemOffsets[NProcs + p] = ItemOffsets[NProcs + p - 1] +
+	ReceiveCounts[p - 1];
+    }
+    MPI_Type_contiguous((int) Size, MPI_BYTE, &Item);
+    MPI_Type_commit(&Item);
+    MPI_Alltoallv(Send, SendCounts, ItemOffsets, Item, Receive, ReceiveCounts,
+		  ItemOffsets + NProcs, Item, MPI_COMM_WORLD);
+    MPI_Type_free(&Item);
+    return;
+  }
+#endif
+  memcpy(Receive, Send, SendCounts[0] * Size);
+}
+
+/*****************************************************************************
+  Function name: InitChannelRouting()
+
+  Purpose      : Decide which process routes each channel segment
+
+  Required     :
+    MAPSIZE *Map         - Model area of this process
+    CHANNEL *ChannelData - Channel networks
+
+  Returns      : void
+
+  Modifies     : The schedules of the networks, which only route the
+                 segments of this process from now on
+
+  Comments     : A segment is routed by the process that has most of its
+                 cells, so that most of the inflow to the segment does not
+                 have to be sent to another process.  Has to be called after
+                 InitLocalMap().
+*****************************************************************************/
+void InitChannelRouting(MAPSIZE *Map, CHANNEL *ChannelData)
+{
+#ifdef HAVE_MPI
+  if (NProcs == 1)
+    return;
+  InitPlan(&(Plans[0]), ChannelData->stream_schedule, ChannelData->stream_map,
+	   Map);
+  InitPlan(&(Plans[1]), ChannelData->road_schedule, ChannelData->road_map,
+	   Map);
+#endif
+}
+
+/*****************************************************************************
+  Function name: RouteChannelNetwork()
+
+  Purpose      : Route a channel network
+
+  Required     :
+    ChannelSchedule *Schedule - Schedule of the network
+    int Dt                    - Time step
+    int AllProcesses          - TRUE if all processes need the state of all
+                                segments afterwards, FALSE if only the first
+                                process does, to write it
+
+  Returns      : void
+
+  Comments     : Each process routes its own segments, level by level.
+                 After a level is routed, the outflow of a segment that
+                 drains to a segment of another process is sent to that
+                 process, which then adds the outflows of the level to its
+                 segments in the same order as channel_route_network(), so
+                 the results do not depend on the number of processes.
+*****************************************************************************/
+void RouteChannelNetwork(ChannelSchedule *Schedule, int Dt, int AllProcesses)
+{
+#ifdef HAVE_MPI
+  CHANNELPLAN *Plan;
+  SEGMENTMSG *Msg;
+  int NRequests;
+  int i;
+  int l;
+  int m;
+
+  if (NProcs > 1 && Schedule != NULL) {
+    Plan = (Plans[0].Schedule == Schedule) ? &(Plans[0]) : &(Plans[1]);
+    for (l = 0; l < Schedule->nlevel; l++) {
+      (void) channel_route_level(Schedule, l, Dt);
+
+      NRequests = 0;
+      for (m = Plan->ReceiveStart[l]; m < Plan->ReceiveStart[l + 1]; m++) {
+	Msg = &(Plan->Receive[m]);
+	MPI_Irecv(Plan->ReceiveBuffer + Msg->First, Msg->N, MPI_FLOAT,
+		  Msg->Peer, TAG_CHANNEL, MPI_COMM_WORLD,
+		  &(Plan->Requests[NRequests++]));
+      }
+      for (m = Plan->SendStart[l]; m < Plan->SendStart[l + 1]; m++) {
+	Msg = &(Plan->Send[m]);
+	for (i = Msg->First; i < Msg->First + Msg->N; i++)
+	  Plan->SendBuffer[i] = Schedule->seg[Plan->SendSeg[i]]->outflow;
+	MPI_Isend(Plan->SendBuffer + Msg->First, Msg->N, MPI_FLOAT, Msg->Peer,
+		  TAG_CHANNEL, MPI_COMM_WORLD, &(Plan->Requests[NRequests++]));
+      }
+      MPI_Waitall(NRequests, Plan->Requests, MPI_STATUSES_IGNORE);
+      for (m = Plan->ReceiveStart[l]; m < Plan->ReceiveStart[l + 1]; m++) {
+	Msg = &(Plan->Receive[m]);
+	for (i = Msg->First; i < Msg->First + Msg->N; i++)
+	  Schedule->seg[Plan->ReceiveSeg[i]]->outflow = Plan->ReceiveBuffer[i];
+      }
+
+      channel_pass_outflow(Schedule, l);
+    }
+    ShareSegments(Plan, AllProcesses);
+    return;
+  }
+#endif
+  (void) channel_route_network(Schedule, Dt);
+}
+
+/*****************************************************************************
+  Function name: ForwardChannelIncrements()
+
+  Purpose      : Send the inflow to the channels to the processes that
+                 route them
+
+  Required     :
+    CHANNEL *ChannelData - Channel networks
+
+  Returns      : void
+
+  Modifies     : The lateral inflow, melt and RBM inputs of the segments
+                 routed here
+
+  Comments     : With more than one process, the increments to the channels
+                 made by the cells of a band are recorded instead of added
+                 (see channel_grid_defer()).  Each increment is sent to the
+                 process that routes its segment, which adds the increments
+                 in the order of the bands, and so in the order in which the
+                 cells add to the channels on one process.  Has to be called
+                 before the channels are routed, and before
+                 channel_grid_avg().
+*****************************************************************************/
+void ForwardChannelIncrements(CHANNEL *ChannelData)
+{
+#ifdef HAVE_MPI
+  const char *Routine = "ForwardChannelIncrements";
+  ChannelIncrement *Inc;
+  ChannelIncrement Apply;
+  CHANNELPLAN *Plan;
+  FORWARDINC *Send;
+  FORWARDINC *Receive;
+  int *SendCounts;
+  int *ReceiveCounts;
+  int *Next;
+  int Network;
+  int Segment;
+  int Total;
+  int N;
+  int i;
+  int p;
+
+  if (NProcs == 1)
+    return;
+
+  if (!(SendCounts = (int *) calloc(NProcs, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(ReceiveCounts = (int *) calloc(NProcs, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  if (!(Next = (int *) calloc(NProcs, sizeof(int))))
+    ReportError((char *) Routine, 1);
+
+  /* the increments are grouped by the process they go to, in the order
+     in which they were made */
+  Inc = channel_grid_deferred(&N);
+  for (i = 0; i < N; i++) {
+    Plan = &(Plans[(Inc[i].map == ChannelData->road_map) ? 1 : 0]);
+    SendCounts[Plan->Owner[Plan->Index[Inc[i].channel->id]]]++;
+  }
+  for (p = 1; p < NProcs; p++)
+    Next[p] = Next[p - 1] + SendCounts[p - 1];
+  if (!(Send = (FORWARDINC *) calloc(N + 1, sizeof(FORWARDINC))))
+    ReportError((char *) Routine, 1);
+  for (i = 0; i < N; i++) {
+    Network = (Inc[i].map == ChannelData->road_map) ? 1 : 0;
+    Segment = Plans[Network].Index[Inc[i].channel->id];
+    p = Next[Plans[Network].Owner[Segment]]++;
+    Send[p].Network = Network;
+    Send[p].Segment = Segment;
+    Send[p].Kind = Inc[i].kind;
+    memcpy(Send[p].Value, Inc[i].value, sizeof(Send[p].Value));
+  }
+  channel_grid_clear_deferred();
+
+  ExchangeCounts(SendCounts, ReceiveCounts);
+  for (Total = 0, p = 0; p < NProcs; p++)
+    Total += ReceiveCounts[p];
+  if (!(Receive = (FORWARDINC *) calloc(Total + 1, sizeof(FORWARDINC))))
+    ReportError((char *) Routine, 1);
+  ExchangeItems(Send, SendCounts, Receive, ReceiveCounts, sizeof(FORWARDINC));
+
+  for (i = 0; i < Total; i++) {
+    Network = Receive[i].Network;
+    Apply.map = Network ? ChannelData->road_map : ChannelData->stream_map;
+    Apply.channel = Plans[Network].Schedule->seg[Receive[i].Segment];
+    Apply.kind = Receive[i].Kind;
+    memcpy(Apply.value, Receive[i].Value, sizeof(Apply.value));
+    channel_grid_apply(&Apply);
+  }
+
+  free(Send);
+  free(Receive);
+  free(SendCounts);
+  free(ReceiveCounts);
+  free(Next);
+#endif
+}
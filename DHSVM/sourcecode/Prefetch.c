@@ -0,0 +1,463 @@
+/*
+ * SUMMARY:      Prefetch.c - Read the forcing of coming time steps ahead
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Reads the station, MM5 and radar forcing of each time step
+ *               into a FORCING buffer.  With a read-ahead depth larger than
+ *               zero a separate thread fills the buffers of the next steps
+ *               while the model works on the current one, and
+ *               InitNewStep() takes the buffer of its step when it is
+ *               ready.  The same files are read in the same order either
+ *               way, so the results do not depend on the depth.
+ * DESCRIP-END.
+ * FUNCTIONS:    InitPrefetch()
+ *               GetForcing()
+ *               EndPrefetch()
+ * COMMENTS:
+ *   The reader thread owns the station files once it is started.  Only
+ *   the reading is done in the thread: the values are checked (with their
+ *   warnings) and stored when the step is modeled.
+ *
+ *   Of the MM5 fields only the window that covers the basin is read (see
+ *   InitMM5Gather()).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "fileio.h"
+#include "functions.h"
+#include "sizeofnt.h"
+
+/*****************************************************************************
+  ReadMM5Map()
+
+  Decide whether an MM5 map with the given update frequency has to be read
+  for this step, and which map in the file that is
+*****************************************************************************/
+static uchar ReadMM5Map(MM5FREQ Freq, uchar First, DATE *Current, int Step,
+			int *ReadStep)
+{
+  switch (Freq) {
+  case (FreqSingle):
+    *ReadStep = 0;
+    return First;
+  case (FreqMonth):
+    *ReadStep = Current->Month - 1;
+    return TRUE;
+  case (FreqContinous):
+    *ReadStep = Step;
+    return TRUE;
+  default:
+    ReportError("InitNewStep", 15);
+  }
+  return FALSE;
+}
+
+/*****************************************************************************
+  InitMM5Gather()
+
+  Find the MM5 cell of each basin cell, and the smallest window of the MM5
+  grid that holds them
+*****************************************************************************/
+static void InitMM5Gather(MAPSIZE *Map, MAPSIZE *MM5Map, MM5GATHER *Gather)
+{
+  const char *Routine = "InitMM5Gather";
+  int MaxY, MaxX;
+  int MM5Y, MM5X;
+  int run;
+  int y, x;
+
+  if (!(Gather->Cell = (int *) malloc(Map->NY * Map->NX * sizeof(int))))
+    ReportError((char *) Routine, 1);
+  for (y = 0; y < Map->NY * Map->NX; y++)
+    Gather->Cell[y] = -1;
+
+  Gather->Y0 = MM5Map->NY;
+  Gather->X0 = MM5Map->NX;
+  MaxY = -1;
+  MaxX = -1;
+  for (y = 0; y < Map->NY; y++) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+	MM5Y = (int) ((y + MM5Map->OffsetY) * Map->DY / MM5Map->DY);
+	MM5X = (int) ((x - MM5Map->OffsetX) * Map->DX / MM5Map->DX);
+	if (MM5Y < 0 || MM5Y >= MM5Map->NY || MM5X < 0 || MM5X >= MM5Map->NX)
+	  ReportError("Input Options File", 31);
+	if (MM5Y < Gather->Y0)
+	  Gather->Y0 = MM5Y;
+	if (MM5Y > MaxY)
+	  MaxY = MM5Y;
+	if (MM5X < Gather->X0)
+	  Gather->X0 = MM5X;
+	if (MM5X > MaxX)
+	  MaxX = MM5X;
+	/* row and column for now, the window is not known yet */
+	Gather->Cell[y * Map->NX + x] = MM5Y * MM5Map->NX + MM5X;
+      }
+    }
+  }
+
+  if (MaxY < 0) {
+    /* no basin cells, read a single MM5 cell */
+    Gather->Y0 = 0;
+    Gather->X0 = 0;
+    MaxY = 0;
+    MaxX = 0;
+  }
+  Gather->NY = MaxY - Gather->Y0 + 1;
+  Gather->NX = MaxX - Gather->X0 + 1;
+
+  for (y = 0; y < Map->NY * Map->NX; y++) {
+    if (Gather->Cell[y] >= 0) {
+      MM5Y = Gather->Cell[y] / MM5Map->NX;
+      MM5X = Gather->Cell[y] % MM5Map->NX;
+      Gather->Cell[y] = (MM5Y - Gather->Y0) * Gather->NX + MM5X - Gather->X0;
+    }
+  }
+
+  printf("Reading MM5 rows %d to %d and columns %d to %d\n", Gather->Y0,
+	 Gather->Y0 + Gather->NY - 1, Gather->X0, Gather->X0 + Gather->NX - 1);
+}
+
+/*****************************************************************************
+  ReadMM5Field()
+
+  Read the window of an MM5 field that covers the basin
+*****************************************************************************/
+static void ReadMM5Field(PREFETCH *P, char *FileName, int Step, float *Array)
+{
+  MM5GATHER *Gather = &(P->MM5Gather);
+
+  Read2DSubMatrix(FileName, Array, NC_FLOAT, P->MM5Map, Gather->Y0,
+		  Gather->X0, Gather->NY, Gather->NX, Step, "", 0);
+}
+
+/*****************************************************************************
+  ReadForcing()
+
+  Read the forcing of the step at P->Time.Current into Forcing
+*****************************************************************************/
+static void ReadForcing(PREFETCH *P, FORCING *Forcing)
+{
+  const int NumberType = NC_FLOAT;
+  OPTIONSTRUCT *Options = P->Options;
+  INPUTFILES *InFiles = P->InFiles;
+  TIMESTRUCT *Time = &(P->Time);
+  char *MM5File[MM5_terrain];
+  int Step;			/* Step in the MM5 Input */
+  int rdstep;
+  int i;
+
+  CopyDate(&(Forcing->Current), &(Time->Current));
+  Forcing->First = IsEqualTime(&(Time->Current), &(Time->Start));
+  for (i = 0; i < Forcing->NMM5; i++)
+    Forcing->MM5Read[i] = FALSE;
+  Forcing->PrecipLapseRead = FALSE;
+
+  if (Options->MM5 == TRUE) {
+    MM5File[MM5_temperature - 1] = InFiles->MM5Temp;
+    MM5File[MM5_humidity - 1] = InFiles->MM5Humidity;
+    MM5File[MM5_wind - 1] = InFiles->MM5Wind;
+    MM5File[MM5_shortwave - 1] = InFiles->MM5ShortWave;
+    MM5File[MM5_longwave - 1] = InFiles->MM5LongWave;
+    MM5File[MM5_precip - 1] = InFiles->MM5Precipitation;
+
+    Step = NumberOfSteps(&(Time->StartMM5), &(Time->Current), Time->Dt);
+
+    for (i = MM5_temperature - 1; i < MM5_precip; i++) {
+      ReadMM5Field(P, MM5File[i], Step, Forcing->MM5[i]);
+      Forcing->MM5Read[i] = TRUE;
+    }
+
+    /* Terrain does not change during the simulation, so only read it
+       at step 0 */
+    if (Forcing->First) {
+      ReadMM5Field(P, InFiles->MM5Terrain, 0, Forcing->MM5[MM5_terrain - 1]);
+      Forcing->MM5Read[MM5_terrain - 1] = TRUE;
+    }
+
+    if (strlen(InFiles->MM5Lapse) > 0 &&
+	ReadMM5Map(InFiles->MM5LapseFreq, Forcing->First, &(Time->Current),
+		   Step, &rdstep)) {
+      ReadMM5Field(P, InFiles->MM5Lapse, rdstep, Forcing->MM5[MM5_lapse - 1]);
+      Forcing->MM5Read[MM5_lapse - 1] = TRUE;
+    }
+
+    if (Options->HeatFlux == TRUE) {
+      for (i = 0; i < P->NSoilLayers; i++) {
+	ReadMM5Field(P, InFiles->MM5SoilTemp[i], Step,
+		     Forcing->MM5[MM5_lapse + i]);
+	Forcing->MM5Read[MM5_lapse + i] = TRUE;
+      }
+    }
+
+    /* MM5 precip lapse rate is at the DEM resolution */
+    if (strlen(InFiles->PrecipLapseFile) > 0 &&
+	ReadMM5Map(InFiles->MM5PrecipDistFreq, Forcing->First,
+		   &(Time->Current), Step, &rdstep)) {
+      Read2DMatrix(InFiles->PrecipLapseFile, Forcing->PrecipLapse,
+		   NumberType, P->Map, rdstep, "", 0);
+      Forcing->PrecipLapseRead = TRUE;
+    }
+  }
+
+  if ((Options->MM5 == TRUE && Options->QPF == TRUE) || Options->MM5 == FALSE) {
+    for (i = 0; i < P->NStats; i++) {
+      if (P->Stat[i].MetBin != NULL)
+	ReadMetBinRecord(Options, &(Time->Current), P->NSoilLayers,
+			 P->Stat[i].MetBin, P->Stat[i].MetBinStation,
+			 P->Stat[i].IsWindModelLocation,
+			 &(Forcing->Station[Forcing->StationOffset[i]]));
+      else
+	ReadMetRecord(Options, &(Time->Current), P->NSoilLayers,
+		      &(P->Stat[i].MetFile), P->Stat[i].IsWindModelLocation,
+		      &(Forcing->Station[Forcing->StationOffset[i]]));
+    }
+
+    if (Options->PrecipType == RADAR)
+      Read2DMatrix(P->RadarFileName, Forcing->Radar, NumberType, P->Radar,
+		   NumberOfSteps(&(Time->StartRadar), &(Time->Current),
+				 Time->Dt), "", 0);
+  }
+}
+
+#ifdef HAVE_PTHREAD
+/*****************************************************************************
+  ReadAhead()
+
+  Reader thread: read the forcing of all steps of the run, staying at most
+  Depth steps ahead of the step that is modeled
+*****************************************************************************/
+static void *ReadAhead(void *Arg)
+{
+  PREFETCH *P = (PREFETCH *) Arg;
+  int Step;
+
+  for (Step = 0; Before(&(P->Time.Current), &(P->Time.End)) ||
+       IsEqualTime(&(P->Time.Current), &(P->Time.End)); Step++) {
+    pthread_mutex_lock(&(P->Lock));
+    while (Step >= P->NUsed + P->NSlots)
+      pthread_cond_wait(&(P->Changed), &(P->Lock));
+    pthread_mutex_unlock(&(P->Lock));
+
+    ReadForcing(P, &(P->Slot[Step % P->NSlots]));
+    IncreaseTime(&(P->Time));
+
+    pthread_mutex_lock(&(P->Lock));
+    P->NRead = Step + 1;
+    pthread_cond_broadcast(&(P->Changed));
+    pthread_mutex_unlock(&(P->Lock));
+  }
+
+  return NULL;
+}
+#endif
+
+/*****************************************************************************
+  Function name: InitPrefetch()
+
+  Purpose      : Allocate the forcing buffers and start the reader thread
+
+  Required     :
+    PREFETCH *P              - Read-ahead to initialize
+    int Depth                - Number of steps to read ahead
+    TIMESTRUCT *Time         - Time of the run, at its first step
+    OPTIONSTRUCT *Options    - Model options
+    INPUTFILES *InFiles      - MM5 file names
+    int NSoilLayers          - Number of soil layers
+    int NStats               - Number of met stations
+    METLOCATION *Stat        - Met stations
+    MAPSIZE *Map             - Model area
+    MAPSIZE *MM5Map          - MM5 area
+    MAPSIZE *Radar           - Radar area
+    char *RadarFileName      - File with radar precipitation
+
+  Returns      : void
+
+  Modifies     : P
+
+  Comments     : Depth is reduced to 0 if DHSVM is built without threads
+*****************************************************************************/
+void InitPrefetch(PREFETCH *P, int Depth, TIMESTRUCT *Time,
+		  OPTIONSTRUCT *Options, INPUTFILES *InFiles, int NSoilLayers,
+		  int NStats, METLOCATION *Stat, MAPSIZE *Map, MAPSIZE *MM5Map,
+		  MAPSIZE *Radar, char *RadarFileName)
+{
+  const char *Routine = "InitPrefetch";
+  FORCING *Forcing;
+  int *StationOffset;
+  int NValues;
+  int s, i;
+
+#ifndef HAVE_PTHREAD
+  if (Depth > 0)
+    printf("Forcing is not read ahead: DHSVM was built without threads\n");
+  Depth = 0;
+#endif
+  if (Depth < 0)
+    Depth = 0;
+
+  P->Depth = Depth;
+  P->NSlots = Depth + 1;
+  P->NRead = 0;
+  P->NUsed = 0;
+  P->Time = *Time;
+  P->Options = Options;
+  P->InFiles = InFiles;
+  P->NSoilLayers = NSoilLayers;
+  P->NStats = NStats;
+  P->Stat = Stat;
+  P->Map = Map;
+  P->MM5Map = MM5Map;
+  P->MM5Gather.Cell = NULL;
+  if (Options->MM5 == TRUE)
+    InitMM5Gather(Map, MM5Map, &(P->MM5Gather));
+  P->Radar = Radar;
+  P->RadarFileName = RadarFileName;
+
+  if (!(StationOffset = (int *) calloc(NStats + 1, sizeof(int))))
+    ReportError((char *) Routine, 1);
+  for (i = 0, NValues = 0; i < NStats; i++) {
+    StationOffset[i] = NValues;
+    NValues += NumberOfMetVars(Options, NSoilLayers,
+			       Stat[i].IsWindModelLocation);
+  }
+  StationOffset[NStats] = NValues;
+
+  if (!(P->Slot = (FORCING *) calloc(P->NSlots, sizeof(FORCING))))
+    ReportError((char *) Routine, 1);
+
+  for (s = 0; s < P->NSlots; s++) {
+    Forcing = &(P->Slot[s]);
+    Forcing->StationOffset = StationOffset;
+    if (!(Forcing->Station = (float *) calloc(NValues + 1, sizeof(float))))
+      ReportError((char *) Routine, 1);
+
+    Forcing->NMM5 = 0;
+    if (Options->MM5 == TRUE)
+      Forcing->NMM5 = N_MM5_MAPS +
+	(Options->HeatFlux == TRUE ? NSoilLayers : 0);
+    if (!(Forcing->MM5 = (float **) calloc(Forcing->NMM5 + 1,
+					   sizeof(float *))))
+      ReportError((char *) Routine, 1);
+    if (!(Forcing->MM5Read = (uchar *) calloc(Forcing->NMM5 + 1,
+					      sizeof(uchar))))
+      ReportError((char *) Routine, 1);
+    for (i = 0; i < Forcing->NMM5; i++)
+      if (!(Forcing->MM5[i] = (float *) calloc(P->MM5Gather.NY *
+					       P->MM5Gather.NX, sizeof(float))))
+	ReportError((char *) Routine, 1);
+
+    if (Options->MM5 == TRUE && strlen(InFiles->PrecipLapseFile) > 0)
+      if (!(Forcing->PrecipLapse = (float *) calloc(Map->NY * Map->NX,
+						    sizeof(float))))
+	ReportError((char *) Routine, 1);
+
+    if (Options->PrecipType == RADAR)
+      if (!(Forcing->Radar = (float *) calloc(Radar->NY * Radar->NX,
+					      sizeof(float))))
+	ReportError((char *) Routine, 1);
+  }
+
+#ifdef HAVE_PTHREAD
+  if (P->Depth > 0) {
+    pthread_mutex_init(&(P->Lock), NULL);
+    pthread_cond_init(&(P->Changed), NULL);
+    if (pthread_create(&(P->Thread), NULL, ReadAhead, P) != 0) {
+      printf("Cannot start the forcing reader thread, reading each step when it is needed\n");
+      P->Depth = 0;
+    }
+    else
+      printf("Reading the forcing %d time step(s) ahead\n", P->Depth);
+  }
+#endif
+}
+
+/*****************************************************************************
+  Function name: GetForcing()
+
+  Purpose      : Get the forcing of the current time step
+
+  Required     :
+    PREFETCH *P              - Read-ahead
+    TIMESTRUCT *Time         - Time of the run
+
+  Returns      : Forcing of the current time step
+
+  Modifies     : P
+
+  Comments     : Must be called once for each time step, in order.  The
+                 forcing returned stays valid until the next call.
+*****************************************************************************/
+FORCING *GetForcing(PREFETCH *P, TIMESTRUCT *Time)
+{
+  FORCING *Forcing;
+
+  if (P->Depth == 0) {
+    Forcing = &(P->Slot[0]);
+    ReadForcing(P, Forcing);
+    IncreaseTime(&(P->Time));
+    P->NRead++;
+  }
+  else {
+#ifdef HAVE_PTHREAD
+    /* the buffers of the earlier steps can be refilled */
+    pthread_mutex_lock(&(P->Lock));
+    P->NUsed = Time->Step;
+    pthread_cond_broadcast(&(P->Changed));
+    while (P->NRead <= Time->Step)
+      pthread_cond_wait(&(P->Changed), &(P->Lock));
+    pthread_mutex_unlock(&(P->Lock));
+#endif
+    Forcing = &(P->Slot[Time->Step % P->NSlots]);
+  }
+
+  if (!IsEqualTime(&(Forcing->Current), &(Time->Current)))
+    ReportError("GetForcing", 14);
+
+  return Forcing;
+}
+
+/*****************************************************************************
+  Function name: EndPrefetch()
+
+  Purpose      : Wait for the reader thread and free the forcing buffers
+
+  Required     :
+    PREFETCH *P              - Read-ahead
+
+  Returns      : void
+
+  Modifies     : P
+*****************************************************************************/
+void EndPrefetch(PREFETCH *P)
+{
+  int s, i;
+
+#ifdef HAVE_PTHREAD
+  if (P->Depth > 0) {
+    pthread_join(P->Thread, NULL);
+    pthread_mutex_destroy(&(P->Lock));
+    pthread_cond_destroy(&(P->Changed));
+  }
+#endif
+
+  free(P->Slot[0].StationOffset);
+  for (s = 0; s < P->NSlots; s++) {
+    free(P->Slot[s].Station);
+    for (i = 0; i < P->Slot[s].NMM5; i++)
+      free(P->Slot[s].MM5[i]);
+    free(P->Slot[s].MM5);
+    free(P->Slot[s].MM5Read);
+    free(P->Slot[s].PrecipLapse);
+    free(P->Slot[s].Radar);
+  }
+  free(P->Slot);
+  P->Slot = NULL;
+  free(P->MM5Gather.Cell);
+  P->MM5Gather.Cell = NULL;
+}
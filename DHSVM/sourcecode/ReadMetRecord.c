@@ -7,34 +7,58 @@
  * ORIG-DATE:    Apr-96
  * DESCRIPTION:  Read station meteorological data
  * DESCRIP-END.
- * FUNCTIONS:    ReadMetRecord()
+ * FUNCTIONS:    NumberOfMetVars()
+ *               StoreMetRecord()
+ *               ReadMetRecord()
+ *               OpenMetBin()
+ *               ReadMetBinRecord()
  * COMMENTS:
+ *   Besides the text file of each station, the station data can be read
+ *   from a single binary met file made by MakeMetBin (see DHSVM/program).
+ *   The file starts with a header of 4-byte ints in native byte order:
+ *
+ *     "DHSVMMET"            8 characters
+ *     version               currently 1
+ *     number of stations
+ *     number of records
+ *     time step             in seconds
+ *     year, month, day, hour, minute, second of the first record
+ *     number of variables   for each station
+ *
+ *   followed by the records.  Each record holds the 4-byte floats of all
+ *   stations in station order, and the variables of a station in the order
+ *   of its text file, so the data of a time step are read with a single
+ *   fread() and the first record needed is found without reading the
+ *   records before it.
  * $Id: ReadMetRecord.c,v 1.4 2003/07/01 21:26:22 olivier Exp $     
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "settings.h"
 #include "data.h"
 #include "DHSVMerror.h"
+#include "fileio.h"
 #include "functions.h"
 #include "constants.h"
 
 #define MAXMETVARS    21	/* Maximum Number of meteorological variables 
  to read.  Hack to be replaced by something better */
 
+#define METBINVERSION 1	/* Version of the binary met file format */
+
 /*****************************************************************************
-  ReadMetRecord()
+  NumberOfMetVars()
+
+  Number of met variables expected for a station with the current options
 *****************************************************************************/
-void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
-		   FILES *InFile, unsigned char IsWindModelLocation,
-		   MET *MetRecord)
+int NumberOfMetVars(OPTIONSTRUCT *Options, int NSoilLayers,
+			   unsigned char IsWindModelLocation)
 {
-  DATE MetDate;			/* Date of meteorological record */
-  float Array[MAXMETVARS];	/* Temporary storage of met variables */
-  int i;
   int NMetVars;			/* Number of meteorological variables to read */
+
   NMetVars = 5;
   /* these are - in order: 
      air temp,
@@ -58,34 +82,26 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   if (IsWindModelLocation)
     NMetVars++;
 
-  if (!ScanDate(InFile->FilePtr, &MetDate))
-    ReportError(InFile->FileName, 23);
-
-  while (!IsEqualTime(&MetDate, Current) && !feof(InFile->FilePtr)) {
-    if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
-      ReportError(InFile->FileName, 5);
-    if (!ScanDate(InFile->FilePtr, &MetDate))
-      ReportError(InFile->FileName, 23);
-  }
+  return NMetVars;
+}
 
-  if (!IsEqualTime(&MetDate, Current)) {
-    if (DEBUG) {
-      printf("Metfile: ");
-      PrintDate(&MetDate, stdout);
-      printf("Current: ");
-      PrintDate(Current, stdout);
-    }
-    ReportError(InFile->FileName, 28);
-  }
+/*****************************************************************************
+  StoreMetRecord()
 
-  if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
-    ReportError(InFile->FileName, 5);
+  Copy the met variables of a station record into MetRecord, checking
+  their bounds
+*****************************************************************************/
+void StoreMetRecord(OPTIONSTRUCT *Options, int NSoilLayers,
+			   char *FileName, unsigned char IsWindModelLocation,
+			   float *Array, MET *MetRecord)
+{
+  int i;
 
   MetRecord->Tair = Array[0];
   MetRecord->Wind = Array[1];
   MetRecord->Rh = Array[2];
   if (MetRecord->Rh < 0.0 || MetRecord->Rh > 100.0) {
-    printf("warning: RH out of bounds: %s\n", InFile->FileName);
+    printf("warning: RH out of bounds: %s\n", FileName);
     if (MetRecord->Rh < 0.0)
       MetRecord->Rh = 0.0;
     if (MetRecord->Rh > 100.0)
@@ -93,17 +109,17 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   }
   MetRecord->Sin = Array[3];
   if (MetRecord->Sin > 1380.0) {
-    printf("warning: Shortwave out of bounds: %s\n", InFile->FileName);
+    printf("warning: Shortwave out of bounds: %s\n", FileName);
     MetRecord->Sin = 1380.0;
   }
   if (MetRecord->Sin < 0.0) {
     printf("Warning: Negative Shortwave, setting to zero: %s\n",
-	   InFile->FileName);
+	   FileName);
     MetRecord->Sin = 0.0;
   }
   MetRecord->Lin = Array[4];
   if (MetRecord->Lin < 0.0 || MetRecord->Lin > 1800.0) {
-    printf("warning: Longwave out of bounds: %s\n", InFile->FileName);
+    printf("warning: Longwave out of bounds: %s\n", FileName);
   }
 
   i = 0;
@@ -114,7 +130,7 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   if (Options->PrecipType == STATION) {
     MetRecord->Precip = Array[5 + i];
     if (MetRecord->Precip < 0) {
-      printf("Warning: negative precip %s \n", InFile->FileName);
+      printf("Warning: negative precip %s \n", FileName);
       MetRecord->Precip = 0.0;
     }
     i++;
@@ -148,5 +164,151 @@ void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
   }
   else
     MetRecord->WindDirection = NOT_APPLICABLE;
+}
+
+/*****************************************************************************
+  ReadMetRecord()
+
+  Read the met variables of a station for the current time from its text
+  file into Array, which must hold NumberOfMetVars() values.  The values are
+  checked and stored by StoreMetRecord().
+*****************************************************************************/
+void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
+		   FILES *InFile, unsigned char IsWindModelLocation,
+		   float *Array)
+{
+  DATE MetDate;			/* Date of meteorological record */
+  int NMetVars;			/* Number of meteorological variables to read */
+
+  NMetVars = NumberOfMetVars(Options, NSoilLayers, IsWindModelLocation);
+
+  if (!ScanDate(InFile->FilePtr, &MetDate))
+    ReportError(InFile->FileName, 23);
+
+  while (!IsEqualTime(&MetDate, Current) && !feof(InFile->FilePtr)) {
+    if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
+      ReportError(InFile->FileName, 5);
+    if (!ScanDate(InFile->FilePtr, &MetDate))
+      ReportError(InFile->FileName, 23);
+  }
+
+  if (!IsEqualTime(&MetDate, Current)) {
+    if (DEBUG) {
+      printf("Metfile: ");
+      PrintDate(&MetDate, stdout);
+      printf("Current: ");
+      PrintDate(Current, stdout);
+    }
+    ReportError(InFile->FileName, 28);
+  }
+
+  if (ScanFloats(InFile->FilePtr, Array, NMetVars) != NMetVars)
+    ReportError(InFile->FileName, 5);
+}
+
+/*****************************************************************************
+  OpenMetBin()
+
+  Open a binary met file and read its header.  The number of stations in the
+  file has to be NStats.
+*****************************************************************************/
+void OpenMetBin(char *FileName, int NStats, METBIN *MetBin)
+{
+  char Magic[8];
+  int Header[10];
+  int i;
+
+  strcpy(MetBin->File.FileName, FileName);
+  OpenFile(&(MetBin->File.FilePtr), MetBin->File.FileName, "rb", FALSE);
+
+  if (fread(Magic, sizeof(char), 8, MetBin->File.FilePtr) != 8 ||
+      strncmp(Magic, "DHSVMMET", 8) != 0 ||
+      fread(Header, sizeof(int), 10, MetBin->File.FilePtr) != 10 ||
+      Header[0] != METBINVERSION)
+    ReportError(FileName, 71);
+
+  MetBin->NStats = Header[1];
+  MetBin->NRecords = Header[2];
+  MetBin->Dt = Header[3];
+  if (MetBin->NStats != NStats || MetBin->NRecords <= 0 || MetBin->Dt <= 0)
+    ReportError(FileName, 71);
+
+  MetBin->Start.Year = Header[4];
+  MetBin->Start.Month = Header[5];
+  MetBin->Start.Day = Header[6];
+  MetBin->Start.Hour = Header[7];
+  MetBin->Start.Min = Header[8];
+  MetBin->Start.Sec = Header[9];
+  MetBin->Start.JDay = DayOfYear(MetBin->Start.Year, MetBin->Start.Month,
+				 MetBin->Start.Day);
+  MetBin->Start.Julian =
+    GregorianToJulianDay(MetBin->Start.Year, MetBin->Start.Month,
+			 MetBin->Start.Day, MetBin->Start.Hour,
+			 MetBin->Start.Min, MetBin->Start.Sec);
+
+  if (!(MetBin->NVars = (int *) calloc(NStats, sizeof(int))))
+    ReportError("OpenMetBin()", 1);
+  if (!(MetBin->Offset = (int *) calloc(NStats, sizeof(int))))
+    ReportError("OpenMetBin()", 1);
+  if (fread(MetBin->NVars, sizeof(int), NStats, MetBin->File.FilePtr) !=
+      (size_t) NStats)
+    ReportError(FileName, 71);
+
+  for (i = 0, MetBin->RecordSize = 0; i < NStats; i++) {
+    if (MetBin->NVars[i] <= 0 || MetBin->NVars[i] > MAXMETVARS)
+      ReportError(FileName, 71);
+    MetBin->Offset[i] = MetBin->RecordSize;
+    MetBin->RecordSize += MetBin->NVars[i];
+  }
+
+  if (!(MetBin->Buffer = (float *) calloc(MetBin->RecordSize, sizeof(float))))
+    ReportError("OpenMetBin()", 1);
+  MetBin->DataStart = ftell(MetBin->File.FilePtr);
+  MetBin->Record = -1;
+}
+
+/*****************************************************************************
+  ReadMetBinRecord()
+
+  Get the met variables of a station for the current time from a binary met
+  file into Array, like ReadMetRecord().  The record for the current time is
+  read for all stations at once, the first time it is needed.
+*****************************************************************************/
+void ReadMetBinRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
+		      METBIN *MetBin, int Station,
+		      unsigned char IsWindModelLocation, float *Array)
+{
+  double Seconds;		/* Time since the first record */
+  int Record;			/* Record for the current time */
+
+  if (MetBin->NVars[Station] !=
+      NumberOfMetVars(Options, NSoilLayers, IsWindModelLocation))
+    ReportError(MetBin->File.FileName, 5);
+
+  Seconds = (Current->Julian - MetBin->Start.Julian) * SECPDAY;
+  Record = (int) floor(Seconds / MetBin->Dt + 0.5);
+  if (Record < 0 || Record >= MetBin->NRecords ||
+      fabs(Seconds - (double) Record * MetBin->Dt) > 1.0) {
+    if (DEBUG) {
+      printf("Metfile starts: ");
+      PrintDate(&(MetBin->Start), stdout);
+      printf("Current: ");
+      PrintDate(Current, stdout);
+    }
+    ReportError(MetBin->File.FileName, 28);
+  }
+
+  if (Record != MetBin->Record) {
+    if (Record != MetBin->Record + 1 &&
+	fseek(MetBin->File.FilePtr, MetBin->DataStart + (long) Record *
+	      MetBin->RecordSize * (long) sizeof(float), SEEK_SET))
+      ReportError(MetBin->File.FileName, 39);
+    if (fread(MetBin->Buffer, sizeof(float), MetBin->RecordSize,
+	      MetBin->File.FilePtr) != (size_t) MetBin->RecordSize)
+      ReportError(MetBin->File.FileName, 2);
+    MetBin->Record = Record;
+  }
 
+  memcpy(Array, &(MetBin->Buffer[MetBin->Offset[Station]]),
+	 MetBin->NVars[Station] * sizeof(float));
 }
@@ -91,6 +91,15 @@ static char *ErrorMessage[] = {
   "Riparian parameter < 0:", /* 68 */
   "No gridded met file is found within the basin boundary", /* 69 */
   "Unknown keyword: ",                                      /* 70 */
+  "Not a binary met file for these stations:",              /* 71 */
+  "Too many values in pixel dump record:",                  /* 72 */
+  "Not a valid checkpoint for this model domain:",          /* 73 */
+  "Field not found in checkpoint:",                         /* 74 */
+  "Snapshot does not match the model state:",               /* 75 */
+  "X11 graphics are not possible with more than one MPI process:", /* 76 */
+  "More MPI processes than rows in the model area:",         /* 77 */
+  "A POINT model extent cannot be run on more than one MPI process:", /* 78 */
+  "Rows missing from the basin totals of the MPI processes:", /* 79 */
   NULL
 };
 
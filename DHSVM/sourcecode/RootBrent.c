@@ -15,7 +15,6 @@
  */
 
 #include <math.h>
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -53,6 +52,11 @@
   If this is not the case the program will abort.  In addition the program
   will perform not more than a certain number of iterations, as specified
   in brent.h, and will abort if more iterations are needed.
+
+  The terms of the energy balance other than the surface temperature are
+  passed in a structure (SURFACEBALANCE or SNOWBALANCE), which is handed
+  on unchanged to the Function, so that nothing has to be unpacked or
+  allocated for each evaluation.
 ******************************************************************************/
 
 /*****************************************************************************
@@ -65,29 +69,26 @@
     int x                 - Column number of current pixel 
     float LowerBound      - Lower bound for root
     float UpperBound      - Upper bound for root
-    float (*Function)(float Estimate, va_list ap)
-    ...                   - Variable arguments 
-                            The number and order of arguments has to be
-                            appropriate for the Function pointed to, since
-                            the list of arguments after Nargs will be passed
-                            on to Function.
-                            See the appropriate Function for the correct
-                            arguments. 
+    float current         - Value returned if no root is found
+    float (*Function)(float Estimate, void *Params)
+    void *Params          - Parameters of the Function, passed on to each
+                            evaluation.  See the appropriate Function for
+                            the type of the structure.
 
   Returns      :
     float b               - Effective surface temperature (C)
 
   Modifies     : none
 
-  Comments     :
+  Comments     : The location of the pixel is only formatted into the
+                 message if a warning is given
 *****************************************************************************/
 float RootBrent(int y, int x, float LowerBound, float UpperBound,
-		float current, float (*Function) (float Estimate, va_list ap), ...)
+		float current, float (*Function) (float Estimate, void *Params),
+		void *Params)
 {
   const char *Routine = "RootBrent";
   char ErrorString[MAXSTRING + 1];
-  va_list ap;			/* Used in traversing variable argument list
-				 */
   float a;
   float b;
   float c;
@@ -106,17 +107,11 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
   int j;
   int eval = 0;
 
-  sprintf(ErrorString, "%s: y = %d, x = %d", Routine, y, x);
-
-  /* initialize variable argument list */
-
   a = LowerBound;
-  b = UpperBound;;
-  va_start(ap, Function);
-  fa = Function(a, ap);
+  b = UpperBound;
+  fa = Function(a, Params);
   eval++;
-  va_start(ap, Function);
-  fb = Function(b, ap);
+  fb = Function(b, Params);
   eval++;
 
   /*  if root not bracketed attempt to bracket the root */
@@ -125,15 +120,14 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
   while ((fa * fb) >= 0 && j < MAXTRIES) {
     a -= TSTEP;
     b += TSTEP;
-    va_start(ap, Function);
-    fa = Function(a, ap);
+    fa = Function(a, Params);
     eval++;
-    va_start(ap, Function);
-    fb = Function(b, ap);
+    fb = Function(b, Params);
     eval++;
     j++;
   }
   if ((fa * fb) >= 0) {
+    sprintf(ErrorString, "%s: y = %d, x = %d", Routine, y, x);
     ReportWarning(ErrorString, 34);
     return current;
   }
@@ -160,10 +154,8 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
     tol = 2 * MACHEPS * fabs(b) + T;
     m = 0.5 * (c - b);
 
-    if (fabs(m) <= tol || fequal(fb, 0.0)) {
-      va_end(ap);
+    if (fabs(m) <= tol || fequal(fb, 0.0))
       return b;
-    }
 
     else {
       if (fabs(e) < tol || fabs(fa) <= fabs(fb)) {
@@ -207,11 +199,11 @@ float RootBrent(int y, int x, float LowerBound, float UpperBound,
       a = b;
       fa = fb;
       b += (fabs(d) > tol) ? d : ((m > 0) ? tol : -tol);
-      va_start(ap, Function);
-      fb = Function(b, ap);
+      fb = Function(b, Params);
       eval++;
     }
   }
+  sprintf(ErrorString, "%s: y = %d, x = %d", Routine, y, x);
   ReportWarning(ErrorString, 33);
   return current;
 }
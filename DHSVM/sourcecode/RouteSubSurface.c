@@ -8,7 +8,8 @@
  * ORIG-DATE:    Apr-96
  * DESCRIPTION:  Route subsurface flow
  * DESCRIP-END.
- * FUNCTIONS:    RouteSubSurface()
+ * FUNCTIONS:    InitSubFlowMap()
+ *               RouteSubSurface()
  * COMMENTS:
  * $Id: RouteSubSurface.c,v3.1.2 2013/08/18 ning Exp $     
  */
@@ -16,6 +17,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "settings.h"
 #include "data.h"
 #include "DHSVMerror.h"
@@ -30,6 +32,21 @@
 #endif
 
 
+/*****************************************************************************
+  InitSubFlowMap()
+
+  Allocate the per-cell work space used by RouteSubSurface().  This is done
+  once at start up.
+*****************************************************************************/
+void InitSubFlowMap(MAPSIZE *Map, SUBFLOWPIX **SubFlowMap)
+{
+  const char *Routine = "InitSubFlowMap";
+
+  if (!(*SubFlowMap = (SUBFLOWPIX *) calloc(Map->NY * Map->NX,
+					      sizeof(SUBFLOWPIX))))
+    ReportError((char *) Routine, 1);
+}
+
 /*****************************************************************************
   RouteSubSurface()
 
@@ -98,226 +115,281 @@
 void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
 		     VEGTABLE *VType, VEGPIX **VegMap,
 		     ROADSTRUCT **Network, SOILTABLE *SType,
-		     SOILPIX **SoilMap, CHANNEL *ChannelData,
+		     SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+		     CHANNEL *ChannelData,
 		     TIMESTRUCT *Time, OPTIONSTRUCT *Options, 
-		     char *DumpPath, int MaxStreamID, SNOWPIX **SnowMap)
+		     char *DumpPath, int MaxStreamID, SNOWPIX **SnowMap,
+		     FLOWDIRMAP *SubFlowDir, SUBFLOWPIX *SubFlowMap)
 {
-  const char *Routine = "RouteSubSurface";
   int x;			/* counter */
   int y;			/* counter */
-  int i, j;	        /* counters */
-  float BankHeight;
-  float *Adjust;
-  float fract_used;
-  float depth;
-  float OutFlow;
-  float water_out_road;
-  float Transmissivity;
-  float AvailableWater;
-  int k;
-  float **SubFlowGrad;	        /* Magnitude of subsurface flow gradient slope * width */
-  unsigned char ***SubDir;      /* Fraction of flux moving in each direction*/ 
-  unsigned int **SubTotalDir;	/* Sum of Dir array */
+  int run;			/* run of basin cells */
+  int i;			/* cell index */
+  int k, n;			/* direction counters */
+  int order[MAXDIRS];		/* directions sorted by the row-major position
+				   of the upslope cell */
+  int nbefore;			/* number of upslope cells that come before
+				   the cell itself in row-major order */
+  int xn, yn;
+  float SatFlow;
+  unsigned char *SubDir;        /* Fraction of flux moving in each direction*/ 
 
   int count, totalcount;
+  double Counts[2];		/* count and totalcount over all processes */
   float mgrid, sat;
   char buffer[32];
   char satoutfile[100];         /* Character arrays to hold file name. */ 
   FILE *fs;                     /* File pointer. */
 
-  /*****************************************************************************
-   Allocate memory 
-  ****************************************************************************/
-  
-  if (!(SubFlowGrad = (float **)calloc(Map->NY, sizeof(float *))))
-    ReportError((char *) Routine, 1);
-  for(i=0; i<Map->NY; i++) {
-    if (!(SubFlowGrad[i] = (float *)calloc(Map->NX, sizeof(float))))
-      ReportError((char *) Routine, 1);
-  }
-  
-  if (!((SubDir) = (unsigned char ***) calloc(Map->NY, sizeof(unsigned char **))))
-    ReportError((char *) Routine, 1);
-  for (i=0; i<Map->NY; i++) {
-    if (!((SubDir)[i] = (unsigned char **) calloc(Map->NX, sizeof(unsigned char*))))
-	  ReportError((char *) Routine, 1);
-	for (j=0; j<Map->NX; j++) {
-      if (!(SubDir[i][j] = (unsigned char *)calloc(NDIRS, sizeof(unsigned char ))))
-		ReportError((char *) Routine, 1);
-    }
+  if (Options->FlowGradient == WATERTABLE) {
+    ExchangeMapHalo(Map, (void **) SoilMap, sizeof(SOILPIX),
+		    offsetof(SOILPIX, WaterLevel), sizeof(float));
+    HeadSlopeAspect(Map, TopoMap, SoilMap, SubFlowDir);
   }
 
-  if (!(SubTotalDir = (unsigned int **)calloc(Map->NY, sizeof(unsigned int *))))
-    ReportError((char *) Routine, 1);
-  for (i=0; i<Map->NY; i++) {
-    if (!(SubTotalDir[i] = (unsigned int *)calloc(Map->NX, sizeof(unsigned int))))
-      ReportError((char *) Routine, 1);
-  }
-  
-  /* reset the saturated subsurface flow to zero */
+  /* first sweep through all the grid cells, calculate the amount of
+     flow leaving each cell and the amount per unit of flow fraction.
+     Cells only write to themselves, so rows can be done in parallel.
+     The runs are done KERNELCELLS cells at a time: the transmissivity of
+     the saturated zone above bedrock (or above the stream bank) of those
+     cells is calculated at once with CalcTransmissivityRun() */
+#pragma omp parallel for private(x, run, k, SubDir)
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
-		SoilMap[y][x].SatFlow = 0;
-		SoilMap[y][x].RoadInt = 0;
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      int x0;
+      for (x0 = Map->Runs[run].x0; x0 < Map->Runs[run].x1; x0 += KERNELCELLS) {
+	float Bottom[KERNELCELLS];	/* Bottom of the saturated zone */
+	float Top[KERNELCELLS];		/* Top of the saturated zone */
+	float Ks[KERNELCELLS];
+	float KsExp[KERNELCELLS];
+	float Thresh[KERNELCELLS];
+	float Trans[KERNELCELLS];	/* Transmissivity of the saturated zone */
+	int NCells = MIN(KERNELCELLS, Map->Runs[run].x1 - x0);
+	int j;
+
+	for (j = 0; j < NCells; j++) {
+	  int Cell = y * Map->NX + x0 + j;
+	  float SoilDepth = SoilFlow->Depth[Cell];
+	  float TableDepth = SoilFlow->TableDepth[Cell];
+	  float BankHeight = (Network[y][x0 + j].BankHeight > SoilDepth) ?
+	    SoilDepth : Network[y][x0 + j].BankHeight;
+
+	  Ks[j] = SoilFlow->KsLat[Cell];
+	  KsExp[j] = SType[SoilMap[y][x0 + j].Soil - 1].KsLatExp;
+	  Thresh[j] = SType[SoilMap[y][x0 + j].Soil - 1].DepthThresh;
+	  /* cells that do not need it get an empty saturated zone */
+	  if (!channel_grid_has_channel(ChannelData->stream_map, x0 + j, y)) {
+	    Bottom[j] = SoilDepth;
+	    Top[j] = (TableDepth < SoilDepth) ?
+	      ((TableDepth > BankHeight) ? TableDepth : BankHeight) : SoilDepth;
+	  }
+	  else {
+	    Bottom[j] = BankHeight;
+	    Top[j] = (TableDepth < BankHeight) ? TableDepth : BankHeight;
+	  }
+	}
+	CalcTransmissivityRun(NCells, Bottom, Top, Ks, KsExp, Thresh, Trans);
+
+	for (x = x0; x < x0 + NCells; x++) {
+	  float BankHeight;
+	  float *Adjust;
+	  float fract_used;
+	  float OutFlow;
+	  float water_out_road;
+	  float Transmissivity;
+	  float AvailableWater;
+	  float SubFlowGrad;	/* Magnitude of subsurface flow gradient slope * width */
+	  unsigned int SubTotalDir;	/* Sum of Dir array */
+	  SUBFLOWPIX *Sub = &(SubFlowMap[y * Map->NX + x]);
+	  float SoilDepth = SoilFlow->Depth[y * Map->NX + x];
+	  float TableDepth = SoilFlow->TableDepth[y * Map->NX + x];
+	  float KsLat = SoilFlow->KsLat[y * Map->NX + x];
+
+	  /* surface flow directions are used as is, water table flow
+	     directions come from the work space */
+	  if (Options->FlowGradient == TOPOGRAPHY) {
+	    SubTotalDir = TopoMap[y][x].TotalDir;
+	    SubFlowGrad = TopoMap[y][x].FlowGrad;
+	    SubDir = TopoMap[y][x].Dir;
+	  }
+	  else {
+	    SubTotalDir = SubFlowDir->TotalDir[y * Map->NX + x];
+	    SubFlowGrad = SubFlowDir->FlowGrad[y * Map->NX + x];
+	    SubDir = &(SubFlowDir->Dir[(y * Map->NX + x) * MAXDIRS]);
+	  }
+	  BankHeight = (Network[y][x].BankHeight > SoilDepth) ?
+	    SoilDepth : Network[y][x].BankHeight;
+	  Adjust = Network[y][x].Adjust;
+	  fract_used = 0.0f;
+	  water_out_road = 0.0;
+	  Sub->SatOut = 0.0;
+	  Sub->DirOut = 0.0;
+	  Sub->Intercept = 0.0;
+	  Sub->HasIntercept = FALSE;
+	  SoilMap[y][x].RoadInt = 0;
+
+	  if (!channel_grid_has_channel(ChannelData->stream_map, x, y)) {
+	    for (k = 0; k < NDIRS; k++) {
+	      fract_used += (float) SubDir[k];
+	    }
+	    if (SubTotalDir > 0)
+	      fract_used /= (float) SubTotalDir;
+	    else
+	      fract_used = 0.;
+
+	    /* only bother calculating subsurface flow if water table is above bedrock */
+	    if (TableDepth < SoilDepth) {
+	      Transmissivity = Trans[x - x0];
+
+	      OutFlow =
+		(Transmissivity * fract_used * SubFlowGrad * Dt) / (Map->DX * Map->DY);
+
+	      /* check whether enough water is available for redistribution */
+	      AvailableWater =
+		CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
+				   SoilDepth, VType[VegMap[y][x].Veg - 1].RootDepth,
+				   SoilMap[y][x].Porosity, SoilMap[y][x].FCap,
+				   TableDepth, Adjust);
+	      OutFlow = (OutFlow > AvailableWater) ? AvailableWater : OutFlow;
+	    }
+	    else {
+	      OutFlow = 0.0f;
+	    }
+
+	    /* compute road interception if water table is above road cut */
+	    if (TableDepth < BankHeight &&
+		channel_grid_has_channel(ChannelData->road_map, x, y)) {
+	      if (SubTotalDir > 0)
+		fract_used = ((float) Network[y][x].fraction /
+			      (float) SubTotalDir);
+	      else
+		fract_used = 0.;
+	      Transmissivity =
+		CalcTransmissivity(BankHeight, TableDepth,
+				   KsLat,
+				   SType[SoilMap[y][x].Soil - 1].KsLatExp,
+				   SType[SoilMap[y][x].Soil - 1].DepthThresh);
+
+	      water_out_road = (Transmissivity * fract_used *
+				SubFlowGrad * Dt) / (Map->DX * Map->DY);
+
+	      AvailableWater =
+		CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
+				   BankHeight, VType[VegMap[y][x].Veg - 1].RootDepth,
+				   SoilMap[y][x].Porosity,
+				   SoilMap[y][x].FCap,
+				   TableDepth, Adjust);
+
+	      water_out_road =
+		(water_out_road > AvailableWater) ? AvailableWater : water_out_road;
+
+	      /* increase lateral inflow to road channel */
+	      SoilMap[y][x].RoadInt = water_out_road;
+	      Sub->Intercept = water_out_road * Map->DX * Map->DY;
+	      Sub->HasIntercept = TRUE;
+	    }
+	    /* Subsurface Component - Decrease water change by outwater */
+	    Sub->SatOut = OutFlow + water_out_road;
+
+	    /* Water for the appropriate surrounding pixels */
+	    if (SubTotalDir > 0)
+	      Sub->DirOut = OutFlow / (float) SubTotalDir;
+	    else
+	      Sub->DirOut = 0.;
+	  }
+	  else {			/* cell has a stream channel */
+	    if (TableDepth < BankHeight &&
+		channel_grid_has_channel(ChannelData->stream_map, x, y)) {
+	      float gradient = 4.0 * (BankHeight - TableDepth);
+	      if (gradient < 0.0)
+		gradient = 0.0;
+	      Transmissivity = Trans[x - x0];
+
+	      OutFlow = (Transmissivity * gradient * Dt) / (Map->DX * Map->DY);
+
+	      /* check whether enough water is available for redistribution */
+	      AvailableWater =
+		CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
+				   BankHeight, VType[VegMap[y][x].Veg - 1].RootDepth,
+				   SoilMap[y][x].Porosity,
+				   SoilMap[y][x].FCap,
+				   TableDepth, Adjust);
+
+	      OutFlow = (OutFlow > AvailableWater) ? AvailableWater : OutFlow;
+
+	      /* remove water going to channel from the grid cell */
+	      Sub->SatOut = OutFlow;
+
+	      /* contribute to channel segment lateral inflow */
+	      Sub->Intercept = OutFlow * Map->DX * Map->DY;
+	      Sub->HasIntercept = TRUE;
+
+	      SoilMap[y][x].ChannelInt += OutFlow;
+	    }
+	  }
+	}
       }
     }
   }
 
+  /* the second sweep reads the outflow of the rows next to the band */
+  ExchangeArrayHalo(Map, SubFlowMap, sizeof(SUBFLOWPIX),
+		    offsetof(SUBFLOWPIX, DirOut), sizeof(float));
   if (Options->FlowGradient == WATERTABLE)
-    HeadSlopeAspect(Map, TopoMap, SoilMap, SubFlowGrad, SubDir, SubTotalDir);
+    ExchangeArrayHalo(Map, SubFlowDir->Dir, MAXDIRS, 0, MAXDIRS);
 
-  /* next sweep through all the grid cells, calculate the amount of
-     flow in each direction, and divide the flow over the surrounding
-     pixels */
+  /* second sweep: each cell collects the water from its upslope
+     neighbors.  The terms are added in the row-major order of the cells
+     they come from, with the cell's own outflow in its place in that
+     order, so the sums are exactly those of a sweep in which each cell
+     hands its water to its neighbors */
+  nbefore = upslope_order(order);
+
+#pragma omp parallel for private(x, run, i, k, n, xn, yn, SatFlow, SubDir)
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
-		if (Options->FlowGradient == TOPOGRAPHY){
-		  SubTotalDir[y][x] = TopoMap[y][x].TotalDir;
-	      SubFlowGrad[y][x] = TopoMap[y][x].FlowGrad;
-		  for (k = 0; k < NDIRS; k++) 
-	        SubDir[y][x][k] = TopoMap[y][x].Dir[k];
-		}
-		BankHeight = (Network[y][x].BankHeight > SoilMap[y][x].Depth) ?
-	    SoilMap[y][x].Depth : Network[y][x].BankHeight;
-	    Adjust = Network[y][x].Adjust;
-	    fract_used = 0.0f;
-		water_out_road = 0.0;
-		
-		if (!channel_grid_has_channel(ChannelData->stream_map, x, y)) {
-	      for (k = 0; k < NDIRS; k++) {
-			fract_used += (float) SubDir[y][x][k];
-		  }
-		  if (SubTotalDir[y][x] > 0)
-	        fract_used /= (float) SubTotalDir[y][x];
-		  else
-	        fract_used = 0.;
-		  
-		  /* only bother calculating subsurface flow if water table is above bedrock */
-		  if (SoilMap[y][x].TableDepth < SoilMap[y][x].Depth) {
-	        depth = ((SoilMap[y][x].TableDepth > BankHeight) ?
-				SoilMap[y][x].TableDepth : BankHeight);
-			
-			Transmissivity = CalcTransmissivity(SoilMap[y][x].Depth, depth,
-				 SoilMap[y][x].KsLat,
-				 SType[SoilMap[y][x].Soil - 1].KsLatExp,
-                 SType[SoilMap[y][x].Soil - 1].DepthThresh);
-			
-			OutFlow = 
-				(Transmissivity * fract_used * SubFlowGrad[y][x] * Dt) / (Map->DX * Map->DY);
-			
-			/* check whether enough water is available for redistribution */
-			AvailableWater =
-				CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
-				 SoilMap[y][x].Depth, VType[VegMap[y][x].Veg - 1].RootDepth,
-				 SoilMap[y][x].Porosity, SoilMap[y][x].FCap,
-				 SoilMap[y][x].TableDepth, Adjust);
-			OutFlow = (OutFlow > AvailableWater) ? AvailableWater : OutFlow;
-		  }
-		  else {
-	        depth = SoilMap[y][x].Depth;
-	        OutFlow = 0.0f;
-		  }
-		  
-		  /* compute road interception if water table is above road cut */
-		  if (SoilMap[y][x].TableDepth < BankHeight &&
-			  channel_grid_has_channel(ChannelData->road_map, x, y)) {
-		    if (SubTotalDir[y][x] > 0)
-	          fract_used = ((float) Network[y][x].fraction /
-			    (float)SubTotalDir[y][x]);
-			else
-	          fract_used = 0.;
-			Transmissivity =
-				 CalcTransmissivity(BankHeight, SoilMap[y][x].TableDepth,
-				 SoilMap[y][x].KsLat,
-				 SType[SoilMap[y][x].Soil - 1].KsLatExp,
-                 SType[SoilMap[y][x].Soil - 1].DepthThresh);
-			
-			water_out_road = (Transmissivity * fract_used *
-			      SubFlowGrad[y][x] * Dt) / (Map->DX * Map->DY);
-			
-			AvailableWater =
-				CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
-				 BankHeight, VType[VegMap[y][x].Veg - 1].RootDepth,
-				 SoilMap[y][x].Porosity,
-				 SoilMap[y][x].FCap,
-				 SoilMap[y][x].TableDepth, Adjust);
-			
-			water_out_road = 
-				(water_out_road > AvailableWater) ? AvailableWater : water_out_road;
-			
-			/* increase lateral inflow to road channel */
-			SoilMap[y][x].RoadInt = water_out_road;
-			channel_grid_inc_inflow(ChannelData->road_map, x, y,
-				    water_out_road * Map->DX * Map->DY);
-		  }
-		  /* Subsurface Component - Decrease water change by outwater */
-		  SoilMap[y][x].SatFlow -= OutFlow + water_out_road;
-		  
-		  /* Assign the water to appropriate surrounding pixels */
-		  if (SubTotalDir[y][x] > 0)
-	        OutFlow /= (float) SubTotalDir[y][x];
-		  else
-	        OutFlow = 0.;
-		  
-		  for (k = 0; k < NDIRS; k++) {
-	        int nx = xdirection[k] + x;
-	        int ny = ydirection[k] + y;
-	        if (valid_cell(Map, nx, ny)) {
-	          SoilMap[ny][nx].SatFlow += OutFlow * SubDir[y][x][k];
-			}
-		  }
-		}
-	    else {			/* cell has a stream channel */
-	      if (SoilMap[y][x].TableDepth < BankHeight &&
-	        channel_grid_has_channel(ChannelData->stream_map, x, y)) {
-			float gradient = 4.0 * (BankHeight - SoilMap[y][x].TableDepth);
-			if (gradient < 0.0)
-	          gradient = 0.0;
-			Transmissivity =
-				CalcTransmissivity(BankHeight, SoilMap[y][x].TableDepth,
-				 SoilMap[y][x].KsLat,
-				 SType[SoilMap[y][x].Soil - 1].KsLatExp,
-                 SType[SoilMap[y][x].Soil - 1].DepthThresh);
-
-			OutFlow = (Transmissivity * gradient * Dt) / (Map->DX * Map->DY);
-			
-			/* check whether enough water is available for redistribution */
-			AvailableWater = 
-				 CalcAvailableWater(VType[VegMap[y][x].Veg - 1].NSoilLayers,
-				 BankHeight, VType[VegMap[y][x].Veg - 1].RootDepth,
-				 SoilMap[y][x].Porosity,
-				 SoilMap[y][x].FCap,
-				 SoilMap[y][x].TableDepth, Adjust);
-			
-			OutFlow = (OutFlow > AvailableWater) ? AvailableWater : OutFlow;
-			
-			/* remove water going to channel from the grid cell */
-			SoilMap[y][x].SatFlow -= OutFlow;
-			
-			/* contribute to channel segment lateral inflow */
-			channel_grid_inc_inflow(ChannelData->stream_map, x, y,
-				    OutFlow * Map->DX * Map->DY);
-			
-			SoilMap[y][x].ChannelInt += OutFlow;
-		  }
-		}
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+	SatFlow = 0;
+	for (n = 0; n < NDIRS; n++) {
+	  if (n == nbefore)
+	    SatFlow -= SubFlowMap[y * Map->NX + x].SatOut;
+	  k = order[n];
+	  xn = x - xdirection[k];
+	  yn = y - ydirection[k];
+	  if (valid_cell(Map, xn, yn) && INBASIN(TopoMap[yn][xn].Mask)) {
+	    i = yn * Map->NX + xn;
+	    if (Options->FlowGradient == TOPOGRAPHY)
+	      SubDir = TopoMap[yn][xn].Dir;
+	    else
+	      SubDir = &(SubFlowDir->Dir[i * MAXDIRS]);
+	    SatFlow += SubFlowMap[i].DirOut * SubDir[k];
+	  }
+	}
+	if (nbefore == NDIRS)
+	  SatFlow -= SubFlowMap[y * Map->NX + x].SatOut;
+	SoilFlow->SatFlow[y * Map->NX + x] = SatFlow;
       }
     }
   }
 
- for(i=0; i<Map->NY; i++) { 
-    free(SubTotalDir[i]);
-    free(SubFlowGrad[i]);
-    for(j=0; j<Map->NX; j++){
-      free(SubDir[i][j]);
+  /* pass intercepted water to the road and stream networks, in row-major
+     order so that segment totals do not depend on the number of threads */
+  for (y = 0; y < Map->NY; y++) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+	i = y * Map->NX + x;
+	if (!SubFlowMap[i].HasIntercept)
+	  continue;
+	if (channel_grid_has_channel(ChannelData->stream_map, x, y))
+	  channel_grid_inc_inflow(ChannelData->stream_map, x, y,
+				  SubFlowMap[i].Intercept);
+	else
+	  channel_grid_inc_inflow(ChannelData->road_map, x, y,
+				  SubFlowMap[i].Intercept);
+      }
     }
-    free(SubDir[i]);
   }
-  free(SubDir);
-  free(SubTotalDir);
-  free(SubFlowGrad);
+  ForwardChannelIncrements(ChannelData);
 
   /**********************************************************************/
   /* Dump saturation extent file to screen.
@@ -327,18 +399,28 @@ void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
   count =0;
   totalcount = 0;
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
-	     mgrid = (SoilMap[y][x].Depth - SoilMap[y][x].TableDepth)/SoilMap[y][x].Depth;
-	     if (mgrid > MTHRESH) 
-		   count += 1;
-		 totalcount += 1;
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+	i = y * Map->NX + x;
+	mgrid = (SoilFlow->Depth[i] - SoilFlow->TableDepth[i])/SoilFlow->Depth[i];
+	if (mgrid > MTHRESH) 
+	  count += 1;
+	totalcount += 1;
       }
     }
   }
  
+  Counts[0] = count;
+  Counts[1] = totalcount;
+  ParallelSum(Counts, 2);
+  count = (int) Counts[0];
+  totalcount = (int) Counts[1];
+ 
   sat = 100.*((float)count/(float)totalcount);
   
+  if (ParallelRank() != 0)
+    return;
+
   sprintf(satoutfile, "%ssaturation_extent.txt", DumpPath);
   
   if((fs = fopen(satoutfile,"a")) == NULL){
@@ -8,7 +8,8 @@
 * ORIG-DATE:    Apr-96
 * DESCRIPTION:  Route surface flow
 * DESCRIP-END.
-* FUNCTIONS:    RouteSurface()
+* FUNCTIONS:    InitDrainMap()
+*               RouteSurface()
 * Modification: Changes are made to exclude the impervious channel cell (with
 a non-zero impervious fraction) from surface routing. In the original
 code, some impervious channel cells are routed to themselves causing
@@ -20,12 +21,129 @@ overestimated runoff in those cells (Ning, 2013).
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "settings.h"
 #include "data.h"
 #include "slopeaspect.h"
 #include "DHSVMerror.h"
 #include "functions.h"
 #include "constants.h"
+/*****************************************************************************
+InitDrainMap()
+List the cells with an impervious fraction by the cell they drain to, so that
+RouteSurface() can collect their impervious runoff at the drains cell.  Map
+is the model area of this process.  The sources in its band are sent to the
+process of their drains cell, which lists the sources of its own cells.
+*****************************************************************************/
+void InitDrainMap(MAPSIZE * Map, TOPOPIX ** TopoMap, VEGPIX ** VegMap,
+  VEGTABLE * VType, CHANNEL *ChannelData, DRAINMAP *DrainMap)
+{
+  const char *Routine = "InitDrainMap";
+  int NCells = Map->NY * Map->NX;
+  int NProcs = ParallelSize();
+  int NReceive;
+  int *Next;
+  int *Pairs;			/* Source and drains cell in the whole grid */
+  int *Received;
+  double NSources;
+  int i, p, t, x, y;
+
+  DrainMap->First = NULL;
+  DrainMap->Source = NULL;
+  DrainMap->Item = NULL;
+  DrainMap->Flow = NULL;
+  DrainMap->NSend = 0;
+  DrainMap->Send = NULL;
+  DrainMap->SendCounts = NULL;
+  DrainMap->ReceiveCounts = NULL;
+  DrainMap->Out = NULL;
+  DrainMap->In = NULL;
+
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++)
+    for (x = 0; x < Map->NX; x++)
+      if (INBASIN(TopoMap[y][x].Mask) &&
+        !channel_grid_has_channel(ChannelData->stream_map, x, y) &&
+        VType[VegMap[y][x].Veg - 1].ImpervFrac > 0.0)
+        DrainMap->NSend++;
+  NSources = DrainMap->NSend;
+  ParallelSum(&NSources, 1);
+  if (NSources == 0)
+    return;
+
+  if (!(DrainMap->First = (int *)calloc(NCells + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->Flow = (float *)calloc(2 * NCells, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->Send = (int *)calloc(DrainMap->NSend + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->SendCounts = (int *)calloc(NProcs, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->ReceiveCounts = (int *)calloc(NProcs, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->Out = (float *)calloc(2 * DrainMap->NSend + 1, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  if (!(Pairs = (int *)calloc(2 * DrainMap->NSend + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(Next = (int *)calloc(NCells + NProcs, sizeof(int))))
+    ReportError((char *)Routine, 1);
+
+  /* group the sources of the band by the process of their drains cell,
+     keeping them in row-major order */
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++)
+    for (x = 0; x < Map->NX; x++)
+      if (INBASIN(TopoMap[y][x].Mask) &&
+        !channel_grid_has_channel(ChannelData->stream_map, x, y) &&
+        VType[VegMap[y][x].Veg - 1].ImpervFrac > 0.0)
+        DrainMap->SendCounts[RowOwner(TopoMap[y][x].drains_y)]++;
+  for (p = 1; p < NProcs; p++)
+    Next[p] = Next[p - 1] + DrainMap->SendCounts[p - 1];
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++) {
+    for (x = 0; x < Map->NX; x++) {
+      if (INBASIN(TopoMap[y][x].Mask) &&
+        !channel_grid_has_channel(ChannelData->stream_map, x, y) &&
+        VType[VegMap[y][x].Veg - 1].ImpervFrac > 0.0) {
+        i = Next[RowOwner(TopoMap[y][x].drains_y)]++;
+        DrainMap->Send[i] = y * Map->NX + x;
+        Pairs[2 * i] = (y + Map->GlobalY0) * Map->NX + x;
+        Pairs[2 * i + 1] = TopoMap[y][x].drains_y * Map->NX +
+          TopoMap[y][x].drains_x;
+      }
+    }
+  }
+
+  ExchangeCounts(DrainMap->SendCounts, DrainMap->ReceiveCounts);
+  for (NReceive = 0, p = 0; p < NProcs; p++)
+    NReceive += DrainMap->ReceiveCounts[p];
+  if (!(Received = (int *)calloc(2 * NReceive + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->Source = (int *)calloc(NReceive + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->Item = (int *)calloc(NReceive + 1, sizeof(int))))
+    ReportError((char *)Routine, 1);
+  if (!(DrainMap->In = (float *)calloc(2 * NReceive + 1, sizeof(float))))
+    ReportError((char *)Routine, 1);
+  ExchangeItems(Pairs, DrainMap->SendCounts, Received,
+    DrainMap->ReceiveCounts, 2 * sizeof(int));
+
+  /* the sources arrive in row-major order, since the bands are in row
+     order; count the sources of each cell, then fill them in */
+  for (i = 0; i < NReceive; i++)
+    DrainMap->First[Received[2 * i + 1] - Map->GlobalY0 * Map->NX + 1]++;
+  for (i = 0; i < NCells; i++) {
+    DrainMap->First[i + 1] += DrainMap->First[i];
+    Next[i] = DrainMap->First[i];
+  }
+  for (i = 0; i < NReceive; i++) {
+    t = Received[2 * i + 1] - Map->GlobalY0 * Map->NX;
+    DrainMap->Source[Next[t]] = Received[2 * i];
+    DrainMap->Item[Next[t]++] = i;
+  }
+
+  free(Pairs);
+  free(Received);
+  free(Next);
+}
+
 /*****************************************************************************
 RouteSurface()
 If the watertable calculated in WaterTableDepth() was negative, then water is
@@ -40,11 +158,18 @@ large rural basins with some urban development
 If Overland Routing = KINEMATIC, then "excess" water is routed to the outlet
 using a infinite difference approximation to the kinematic wave solution of
 the Saint-Venant equations.
+
+With a network, each cell collects the runoff of its upslope neighbors and
+of the cells that drain to it, rather than handing its runoff to them, so
+that a process only writes to the cells of its own band.  The terms are
+added in the row-major order of the cells they come from, so the sums are
+exactly those of a sweep in which each cell hands its runoff on.
 *****************************************************************************/
 void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
-  SOILPIX ** SoilMap, OPTIONSTRUCT *Options,
+  SOILPIX ** SoilMap, SOILFLOWMAP *SoilFlow, OPTIONSTRUCT *Options,
   UNITHYDR ** UnitHydrograph, UNITHYDRINFO * HydrographInfo, float *Hydrograph,
-  DUMPSTRUCT *Dump, VEGPIX ** VegMap, VEGTABLE * VType, CHANNEL *ChannelData)
+  DUMPSTRUCT *Dump, VEGPIX ** VegMap, VEGTABLE * VType, CHANNEL *ChannelData,
+  DRAINMAP *DrainMap)
 {
   const char *Routine = "RouteSurface";
   int Lag;			/* Lag time for hydrograph */
@@ -52,63 +177,109 @@ void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
   float StreamFlow;
   int TravelTime;
   int WaveLength;
-  int i, j, x, y, n, k;         /* Counters */
+  int i, j, x, y, n, k, run;         /* Counters */
+  int xn, yn, s, d, nbefore;
+  int order[MAXDIRS];
+  float IExcess;
+  float *Flow = DrainMap->Flow;
+  float *In = DrainMap->In;
+  int Offset = Map->GlobalY0 * Map->NX;	/* Index of the window in the
+					   whole grid */
+  float *Runoff = SoilFlow->Runoff;
+  VEGTABLE *Veg;
 
 
-  /* Allocate memory for Runon Matrix */
   if (Options->HasNetwork) {
     /* Option->Routing = false when routing = conventional */
     for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        if (INBASIN(TopoMap[y][x].Mask)) {
-          SoilMap[y][x].Runoff = SoilMap[y][x].IExcess;
-          SoilMap[y][x].IExcess = 0;
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+          i = y * Map->NX + x;
+          Runoff[i] = SoilFlow->IExcess[i];
+          SoilFlow->IExcess[i] = 0;
           SoilMap[y][x].DetentionIn = 0;
+          if (!channel_grid_has_channel(ChannelData->stream_map, x, y) &&
+            VType[VegMap[y][x].Veg - 1].ImpervFrac > 0.0) {
+            Veg = &(VType[VegMap[y][x].Veg - 1]);
+            /* Calculate the outflow from impervious portion of urban cell straight to nearest channel cell */
+            Flow[2 * i] = (1 - Veg->DetentionFrac) * Veg->ImpervFrac *
+              Runoff[i];
+            /* Retained water in detention storage */
+            SoilMap[y][x].DetentionIn = Veg->DetentionFrac *
+              Veg->ImpervFrac * Runoff[i];
+            /* Retained water in Detention storage routed to channel */
+            SoilMap[y][x].DetentionStorage += SoilMap[y][x].DetentionIn;
+            SoilMap[y][x].DetentionOut = SoilMap[y][x].DetentionStorage * Veg->DetentionDecay;
+            Flow[2 * i + 1] = SoilMap[y][x].DetentionOut;
+            SoilMap[y][x].DetentionStorage -= SoilMap[y][x].DetentionOut;
+            if (SoilMap[y][x].DetentionStorage < 0.0)
+              SoilMap[y][x].DetentionStorage = 0.0;
+          }
         }
       }
     }
+
+    ExchangeArrayHalo(Map, Runoff, sizeof(float), 0, sizeof(float));
+    if (DrainMap->First != NULL) {
+      /* send the impervious runoff to the process of the drains cell */
+      for (j = 0; j < DrainMap->NSend; j++) {
+        DrainMap->Out[2 * j] = Flow[2 * DrainMap->Send[j]];
+        DrainMap->Out[2 * j + 1] = Flow[2 * DrainMap->Send[j] + 1];
+      }
+      ExchangeItems(DrainMap->Out, DrainMap->SendCounts, DrainMap->In,
+        DrainMap->ReceiveCounts, 2 * sizeof(float));
+    }
+
+    nbefore = upslope_order(order);
+
     for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        if (INBASIN(TopoMap[y][x].Mask)) {
-          if (!channel_grid_has_channel(ChannelData->stream_map, x, y)) {
-            if (VType[VegMap[y][x].Veg - 1].ImpervFrac > 0.0) {
-              /* Calculate the outflow from impervious portion of urban cell straight to nearest channel cell */
-              SoilMap[TopoMap[y][x].drains_y][TopoMap[y][x].drains_x].IExcess +=
-                (1 - VType[VegMap[y][x].Veg - 1].DetentionFrac) *
-                VType[VegMap[y][x].Veg - 1].ImpervFrac * SoilMap[y][x].Runoff;
-              /* Retained water in detention storage */
-              SoilMap[y][x].DetentionIn = VType[VegMap[y][x].Veg - 1].DetentionFrac *
-                VType[VegMap[y][x].Veg - 1].ImpervFrac * SoilMap[y][x].Runoff;
-              /* Retained water in Detention storage routed to channel */
-              SoilMap[y][x].DetentionStorage += SoilMap[y][x].DetentionIn;
-              SoilMap[y][x].DetentionOut = SoilMap[y][x].DetentionStorage * VType[VegMap[y][x].Veg - 1].DetentionDecay;
-              SoilMap[TopoMap[y][x].drains_y][TopoMap[y][x].drains_x].IExcess += SoilMap[y][x].DetentionOut;
-              SoilMap[y][x].DetentionStorage -= SoilMap[y][x].DetentionOut;
-              if (SoilMap[y][x].DetentionStorage < 0.0)
-                SoilMap[y][x].DetentionStorage = 0.0;
-              /* Route the runoff from pervious portion of urban cell to the neighboring cell */
-              for (n = 0; n < NDIRS; n++) {
-                int xn = x + xdirection[n];
-                int yn = y + ydirection[n];
-                if (valid_cell(Map, xn, yn)) {
-                  SoilMap[yn][xn].IExcess += (1 - VType[VegMap[y][x].Veg - 1].ImpervFrac) * SoilMap[y][x].Runoff
-                    *((float)TopoMap[y][x].Dir[n] / (float)TopoMap[y][x].TotalDir);
-                }
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
+          i = y * Map->NX + x;
+          IExcess = 0;
+          d = (DrainMap->First != NULL) ? DrainMap->First[i] : 0;
+          for (n = 0; n <= NDIRS; n++) {
+            if (n == nbefore) {
+              /* the cell itself */
+              for (; DrainMap->First != NULL && d < DrainMap->First[i + 1] &&
+                DrainMap->Source[d] <= i + Offset; d++) {
+                IExcess += In[2 * DrainMap->Item[d]];
+                IExcess += In[2 * DrainMap->Item[d] + 1];
               }
+              if (channel_grid_has_channel(ChannelData->stream_map, x, y))
+                IExcess += Runoff[i];
+            }
+            if (n == NDIRS)
+              break;
+            k = order[n];
+            xn = x - xdirection[k];
+            yn = y - ydirection[k];
+            if (!valid_cell(Map, xn, yn) || !INBASIN(TopoMap[yn][xn].Mask) ||
+              channel_grid_has_channel(ChannelData->stream_map, xn, yn))
+              continue;
+            s = yn * Map->NX + xn;
+            /* the impervious runoff of cells up to the neighbor comes
+               first, since a cell sends it before its other runoff */
+            for (; DrainMap->First != NULL && d < DrainMap->First[i + 1] &&
+              DrainMap->Source[d] <= s + Offset; d++) {
+              IExcess += In[2 * DrainMap->Item[d]];
+              IExcess += In[2 * DrainMap->Item[d] + 1];
+            }
+            Veg = &(VType[VegMap[yn][xn].Veg - 1]);
+            if (Veg->ImpervFrac > 0.0) {
+              /* Route the runoff from pervious portion of urban cell to the neighboring cell */
+              IExcess += (1 - Veg->ImpervFrac) * Runoff[s]
+                *((float)TopoMap[yn][xn].Dir[k] / (float)TopoMap[yn][xn].TotalDir);
             }
             else {
-              for (n = 0; n < NDIRS; n++) {
-                int xn = x + xdirection[n];
-                int yn = y + ydirection[n];
-                if (valid_cell(Map, xn, yn)) {
-                  SoilMap[yn][xn].IExcess += SoilMap[y][x].Runoff *((float)TopoMap[y][x].Dir[n] / (float)TopoMap[y][x].TotalDir);
-                }
-              }
+              IExcess += Runoff[s] *((float)TopoMap[yn][xn].Dir[k] / (float)TopoMap[yn][xn].TotalDir);
             }
           }
-          else if (channel_grid_has_channel(ChannelData->stream_map, x, y)) {
-            SoilMap[y][x].IExcess += SoilMap[y][x].Runoff;
+          for (; DrainMap->First != NULL && d < DrainMap->First[i + 1]; d++) {
+            IExcess += In[2 * DrainMap->Item[d]];
+            IExcess += In[2 * DrainMap->Item[d] + 1];
           }
+          SoilFlow->IExcess[i] = IExcess;
         }
       }
     }
@@ -116,23 +287,29 @@ void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
 
 /* MAKE SURE THIS WORKS WITH A TIMESTEP IN SECONDS */
   else {			/* No network, so use unit hydrograph method */
+    /* the bands add to the hydrograph in turn, in row order */
+    BeginOrderedPass(Hydrograph,
+      HydrographInfo->TotalWaveLength * sizeof(float));
     for (y = 0; y < Map->NY; y++) {
-      for (x = 0; x < Map->NX; x++) {
-        if (INBASIN(TopoMap[y][x].Mask)) {
+      for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+        for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
           TravelTime = (int)TopoMap[y][x].Travel;
           if (TravelTime != 0) {
             WaveLength = HydrographInfo->WaveLength[TravelTime - 1];
             for (Step = 0; Step < WaveLength; Step++) {
               Lag = UnitHydrograph[TravelTime - 1][Step].TimeStep;
-              Hydrograph[Lag] += SoilMap[y][x].Runoff * UnitHydrograph[TravelTime - 1][Step].Fraction;
+              Hydrograph[Lag] += Runoff[y * Map->NX + x] * UnitHydrograph[TravelTime - 1][Step].Fraction;
 
             }
-            SoilMap[y][x].Runoff = 0.0;
+            Runoff[y * Map->NX + x] = 0.0;
           }
         }
       }
     }
 
+    EndOrderedPass(Hydrograph,
+      HydrographInfo->TotalWaveLength * sizeof(float));
+
     StreamFlow = 0.0;
     for (i = 0; i < Time->Dt; i++)
       StreamFlow += (Hydrograph[i] * Map->DX * Map->DY) / Time->Dt;
@@ -149,8 +326,10 @@ void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
     for (i = 0; i < Time->Dt; i++)
       Hydrograph[HydrographInfo->TotalWaveLength - (i + 1)] = 0.0;
 
-    PrintDate(&(Time->Current), Dump->Stream.FilePtr);
-    fprintf(Dump->Stream.FilePtr, " %g\n", StreamFlow);
+    if (ParallelRank() == 0) {
+      PrintDate(&(Time->Current), Dump->Stream.FilePtr);
+      fprintf(Dump->Stream.FilePtr, " %g\n", StreamFlow);
+    }
   }
 }
 
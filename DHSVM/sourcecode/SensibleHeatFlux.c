@@ -15,7 +15,6 @@
  */
 
 #include <math.h>
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "settings.h"
@@ -45,6 +44,7 @@ void SensibleHeatFlux(int y, int x, int Dt, float Ra, float ZRef,
   float TSoilLower;		/* Temperature os the soil at FluxDepth (C) */
   float TSoilUpper;		/* Temperature os the soil in top layer (C) */
   double Tmp;			/* Temporary value */
+  SURFACEBALANCE Balance;	/* Terms of the energy balance */
 
   OldTSurf = LocalSoil->TSurf;
   MaxTSurf = 0.5 * (LocalSoil->TSurf + LocalMet->Tair) + DELTAT;
@@ -70,14 +70,31 @@ void SensibleHeatFlux(int y, int x, int Dt, float Ra, float ZRef,
   /* Calculate the effective surface temperature that makes sure that the 
      sum of the terms of the energy balance equals 0 */
 
+  Balance.Dt = Dt;
+  Balance.Ra = Ra;
+  Balance.Z = ZRef;
+  Balance.Displacement = Displacement;
+  Balance.Z0 = Z0;
+  Balance.Wind = LocalMet->Wind;
+  Balance.ShortRad = NetShort;
+  Balance.LongRadIn = LongIn;
+  Balance.AirDens = LocalMet->AirDens;
+  Balance.Lv = LocalMet->Lv;
+  Balance.ETot = ETot;
+  Balance.Kt = KhEff;
+  Balance.ChSoil = SoilType->Ch[0];
+  Balance.Porosity = LocalSoil->Porosity[0];
+  Balance.MoistureContent = LocalSoil->Moist[0];
+  Balance.Depth = FluxDepth;
+  Balance.Tair = LocalMet->Tair;
+  Balance.TSoilUpper = TSoilUpper;
+  Balance.TSoilLower = TSoilLower;
+  Balance.OldTSurf = OldTSurf;
+  Balance.MeltEnergy = MeltEnergy;
+
   LocalSoil->TSurf =
     RootBrent(y, x, MinTSurf, MaxTSurf, LocalSoil->TSurf,
-              SurfaceEnergyBalance, Dt, Ra, ZRef,
-	      Displacement, Z0, LocalMet->Wind, NetShort, LongIn,
-	      LocalMet->AirDens, LocalMet->Lv, ETot, KhEff,
-	      SoilType->Ch[0], LocalSoil->Porosity[0], LocalSoil->Moist[0],
-	      FluxDepth, LocalMet->Tair, TSoilUpper,
-	      TSoilLower, OldTSurf, MeltEnergy);
+              SurfaceEnergyBalance, &Balance);
 
   /* Calculate the terms of the energy balance.  This is similar to the
      code in SurfaceEnergyBalance.c */
@@ -0,0 +1,153 @@
+/*
+ * SUMMARY:      Slab.c - Memory for the small arrays of the grid cells
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Each basin cell has a number of small arrays with a value
+ *               per soil or vegetation layer (soil moisture, interception,
+ *               transpiration, ...).  Rather than allocating each of them
+ *               on its own, they are handed out from a slab: a few large
+ *               blocks of memory that are allocated once and freed at
+ *               once.  Each family of arrays (for example all the layer
+ *               arrays of the evaporation map) is given a block of its own
+ *               with ReserveSlab(), and is then carved from that block cell
+ *               by cell, so that the arrays of a cell and of the cells next
+ *               to it are next to each other in memory.
+ * DESCRIP-END.
+ * FUNCTIONS:    SlabBytes()
+ *               ReserveSlab()
+ *               SlabAlloc()
+ *               FreeSlab()
+ * COMMENTS:
+ *   Every array starts at a multiple of sizeof(double) bytes, so that
+ *   arrays of floats and of pointers can be mixed in a block.  SlabBytes()
+ *   gives the room an array takes, so that the size of a block can be
+ *   added up exactly before it is reserved.  The memory is zeroed, as with
+ *   calloc().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "functions.h"
+
+#define SLABALIGN sizeof(double)
+
+static void NewBlock(SLAB *Slab, size_t Bytes);
+
+/*****************************************************************************
+  Function name: NewBlock()
+
+  Purpose      : Add a block to a slab, from which the next arrays are
+                 handed out
+
+  Required     :
+    SLAB *Slab   - Slab
+    size_t Bytes - Size of the block
+
+  Modifies     : Slab
+*****************************************************************************/
+static void NewBlock(SLAB *Slab, size_t Bytes)
+{
+  const char *Routine = "NewBlock";
+
+  if (!(Slab->Block = (char **) realloc(Slab->Block,
+					 (Slab->NBlocks + 1) * sizeof(char *))))
+    ReportError((char *) Routine, 1);
+  if (!(Slab->Block[Slab->NBlocks] = (char *) calloc(Bytes, 1)))
+    ReportError((char *) Routine, 1);
+  Slab->NBlocks++;
+  Slab->Size = Bytes;
+  Slab->Used = 0;
+}
+
+/*****************************************************************************
+  Function name: SlabBytes()
+
+  Purpose      : Room taken in a slab by an array
+
+  Required     :
+    size_t N    - Number of elements
+    size_t Size - Size of an element
+
+  Returns      : size_t - number of bytes, including the padding to the
+                 next array
+*****************************************************************************/
+size_t SlabBytes(size_t N, size_t Size)
+{
+  return (N * Size + SLABALIGN - 1) / SLABALIGN * SLABALIGN;
+}
+
+/*****************************************************************************
+  Function name: ReserveSlab()
+
+  Purpose      : Start a new block in a slab for a family of arrays
+
+  Required     :
+    SLAB *Slab   - Slab
+    size_t Bytes - Room taken by all the arrays of the family, as the sum
+                   of SlabBytes() of each array
+
+  Modifies     : Slab
+
+  Comments     : Nothing is reserved if Bytes is zero.  If more is taken
+                 from the block than was reserved, the rest is handed out
+                 from another block.
+*****************************************************************************/
+void ReserveSlab(SLAB *Slab, size_t Bytes)
+{
+  if (Bytes > 0)
+    NewBlock(Slab, Bytes);
+}
+
+/*****************************************************************************
+  Function name: SlabAlloc()
+
+  Purpose      : Hand out a zeroed array from a slab
+
+  Required     :
+    SLAB *Slab  - Slab
+    size_t N    - Number of elements
+    size_t Size - Size of an element
+
+  Returns      : void * - the array
+
+  Modifies     : Slab
+*****************************************************************************/
+void *SlabAlloc(SLAB *Slab, size_t N, size_t Size)
+{
+  size_t Bytes;
+  void *Array;
+
+  Bytes = SlabBytes(N, Size);
+  if (Slab->NBlocks == 0 || Slab->Used + Bytes > Slab->Size)
+    NewBlock(Slab, Bytes > SLABBLOCK ? Bytes : SLABBLOCK);
+
+  Array = Slab->Block[Slab->NBlocks - 1] + Slab->Used;
+  Slab->Used += Bytes;
+  return Array;
+}
+
+/*****************************************************************************
+  Function name: FreeSlab()
+
+  Purpose      : Free all the arrays of a slab
+
+  Required     :
+    SLAB *Slab - Slab
+
+  Modifies     : Slab
+*****************************************************************************/
+void FreeSlab(SLAB *Slab)
+{
+  int i;
+
+  for (i = 0; i < Slab->NBlocks; i++)
+    free(Slab->Block[i]);
+  free(Slab->Block);
+  Slab->Block = NULL;
+  Slab->NBlocks = 0;
+  Slab->Size = 0;
+  Slab->Used = 0;
+}
@@ -11,10 +11,12 @@
  *               elevations and another which uses water table elevations.
  * DESCRIP-END.
  * FUNCTIONS:    valid_cell()
+ *               upslope_order()
  *               valid_cell_fine()
  *               slope_aspect()
  *               flow_fractions()
  *               ElevationSlopeAspect()
+ *               InitFlowDirMap()
  *               HeadSlopeAspect()
  *               ElevationSlope()
  *               ElevationSlopeAspectfine()
@@ -64,6 +66,35 @@ int valid_cell(MAPSIZE *Map, int x, int y)
   return (x >= 0 && y >= 0 && x < Map->NX && y < Map->NY);
 }
 
+/* -------------------------------------------------------------
+   upslope_order
+   Sorts the flow directions by the row-major position of the upslope
+   cell that sends water in that direction, i.e. the cell at
+   (y - ydirection[k], x - xdirection[k]).  Returns the number of upslope
+   cells that come before the receiving cell itself.
+   ------------------------------------------------------------- */
+int upslope_order(int *order)
+{
+  int i, j, k;
+  int nbefore = 0;
+
+  for (i = 0; i < NDIRS; i++) {
+    k = i;
+    for (j = i; j > 0 && 
+	   (ydirection[order[j - 1]] < ydirection[k] ||
+	    (ydirection[order[j - 1]] == ydirection[k] &&
+	     xdirection[order[j - 1]] < xdirection[k])); j--)
+      order[j] = order[j - 1];
+    order[j] = k;
+  }
+  for (i = 0; i < NDIRS; i++) {
+    if (ydirection[order[i]] > 0 ||
+	(ydirection[order[i]] == 0 && xdirection[order[i]] > 0))
+      nbefore++;
+  }
+  return nbefore;
+}
+
 /* -------------------------------------------------------------
    slope_aspect
    Calculation of slope and aspect given elevations of cell and neighbors
@@ -73,15 +104,11 @@ static void slope_aspect(float dx, float dy, float celev, float
 {
   int n;
   float dzdx, dzdy;
-  float *dummyelev;
+  float dummyelev[NNEIGHBORS];
   /* this dummy varaible is added for calculation of elev difference,
   in which the elev of OUTSIDEBASIN cells (which is ZERO) is 
   replaced by the elev of the central cell */
 
-  /* allocate memory */
-  if (!(dummyelev = (float*) calloc(NNEIGHBORS, sizeof(float))))
-	  ReportError("slope_aspect( )", 1);
-  
   for (n = 0; n < NNEIGHBORS; n++) {
       if (nelev[n] == OUTSIDEBASIN) {
 		  dummyelev[n] = celev;
@@ -102,7 +129,6 @@ static void slope_aspect(float dx, float dy, float celev, float
 	  /* convert from radian to degree */
 	  *aspect = atan2(dzdx, dzdy) ;
   }
-  free(dummyelev);
   return;
 }
 /* -------------------------------------------------------------
@@ -119,17 +145,11 @@ static void flow_fractions(float dx, float dy, float slope, float aspect,
   float cosine = cos(aspect);
   float sine = sin(aspect);
   float total_width, effective_width;
-  float *cos, *sin;
+  float cos[MAXDIRS/2], sin[MAXDIRS/2];
   int n;
   float drop[NDIRS]; 
   float maxdrop; 
   int steepest;
- 
-  /* allocate memory */
-  if (!(cos = (float*) calloc(NDIRS/2, sizeof(float))))
-	  ReportError("slope_aspect( )", 1);
-  if (!(sin = (float*) calloc(NDIRS/2, sizeof(float))))
-	  ReportError("slope_aspect( )", 1);
 
  switch (NDIRS) {
   case 4:
@@ -183,6 +203,7 @@ static void flow_fractions(float dx, float dy, float slope, float aspect,
     maxdrop = -9999;
     /*Determine flow direction based on deepest drop */
     for (n = 0; n < NDIRS; n++) {
+      dir[n] = 0;
       /*Make sure flow is inside boundary*/
       if (nelev[n] == (float) OUTSIDEBASIN){
         dir[n] = 0;
@@ -229,8 +250,6 @@ static void flow_fractions(float dx, float dy, float slope, float aspect,
     ReportError("flow_fractions",65);
     assert(0);			/* other cases don't work either */
   }
-  free(sin);
-  free(cos);
   return;
 }
 /* -------------------------------------------------------------
@@ -374,6 +393,27 @@ void qs(ITEM *item, int left, int right)
   if(left<j) qs(item,left,j);
   if(i<right) qs(item,i,right);
 }
+/* -------------------------------------------------------------
+   InitFlowDirMap
+   Allocates the flow direction workspace used for gradients that
+   change during the run.  This is done once, the space is reused by
+   HeadSlopeAspect() and SnowSlopeAspect() every time step.
+   ------------------------------------------------------------- */
+void InitFlowDirMap(MAPSIZE * Map, FLOWDIRMAP * FlowDir)
+{
+  const char *Routine = "InitFlowDirMap";
+  int NCells = Map->NY * Map->NX;
+
+  if (!(FlowDir->FlowGrad = (float *) calloc(NCells, sizeof(float))))
+    ReportError((char *) Routine, 1);
+  if (!(FlowDir->Dir = (unsigned char *) calloc(NCells * MAXDIRS,
+						 sizeof(unsigned char))))
+    ReportError((char *) Routine, 1);
+  if (!(FlowDir->TotalDir = (unsigned int *) calloc(NCells,
+						    sizeof(unsigned int))))
+    ReportError((char *) Routine, 1);
+}
+
 /* -------------------------------------------------------------
    HeadSlopeAspect
    This computes slope and aspect using the water table elevation. 
@@ -381,18 +421,20 @@ void qs(ITEM *item, int left, int right)
    Comment: rewritten to fill the sinks (Ning, 2013)
    ------------------------------------------------------------- */
 void HeadSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SOILPIX ** SoilMap,
-		     float **FlowGrad, unsigned char ***Dir, unsigned int **TotalDir)
+		     FLOWDIRMAP * FlowDir)
 {
   int x;
   int y;
+  int run;
   int n;
+  int i;
   float neighbor_elev[NNEIGHBORS];
 
   /* let's assume for now that WaterLevel is the SOILPIX map is
      computed elsewhere */
-  for (x = 0; x < Map->NX; x++) {
-    for (y = 0; y < Map->NY; y++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+  for (y = 0; y < Map->NY; y++) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
 		  float slope, aspect;
 		  for (n = 0; n < NNEIGHBORS; n++) {
 			  int xn = x + xneighbor[n];
@@ -407,8 +449,10 @@ void HeadSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SOILPIX ** SoilMap,
 		  }
 		  slope_aspect(Map->DX, Map->DY, SoilMap[y][x].WaterLevel, neighbor_elev,
 		     &slope, &aspect);
+		  i = y * Map->NX + x;
 		  flow_fractions(Map->DX, Map->DY, slope, aspect, SoilMap[y][x].WaterLevel, neighbor_elev,
-		       &(FlowGrad[y][x]), Dir[y][x], &(TotalDir[y][x])); 
+		       &(FlowDir->FlowGrad[i]), &(FlowDir->Dir[i * MAXDIRS]),
+		       &(FlowDir->TotalDir[i]));
       }
     }
   }
@@ -422,16 +466,18 @@ SnowSlopeAspect
 This computes slope and aspect using the SnowSurface Elevation.
 ------------------------------------------------------------- */
 void SnowSlopeAspect(MAPSIZE *Map, TOPOPIX **TopoMap, SNOWPIX **Snow,
-  float **SubSnowGrad, unsigned char ***Dir, unsigned int **TotalDir)
+  FLOWDIRMAP *FlowDir)
 {
   int x;
   int y;
+  int run;
   int n;
+  int i;
   float neighbor_elev[NNEIGHBORS];
 
-  for (x = 0; x < Map->NX; x++) {
-    for (y = 0; y < Map->NY; y++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+  for (y = 0; y < Map->NY; y++) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
         float slope, aspect;
         for (n = 0; n < NNEIGHBORS; n++) {
           int xn = x + xneighbor[n];
@@ -448,11 +494,12 @@ void SnowSlopeAspect(MAPSIZE *Map, TOPOPIX **TopoMap, SNOWPIX **Snow,
 
         slope_aspect(Map->DX, Map->DY, (TopoMap[y][x].Dem + Snow[y][x].Swq), neighbor_elev,
           &slope, &aspect);
+        i = y * Map->NX + x;
         flow_fractions(Map->DX, Map->DY, slope, aspect, (TopoMap[y][x].Dem + Snow[y][x].Swq), neighbor_elev,
-          &(SubSnowGrad[y][x]), Dir[y][x], &(TotalDir[y][x]));
+          &(FlowDir->FlowGrad[i]), &(FlowDir->Dir[i * MAXDIRS]), &(FlowDir->TotalDir[i]));
 
-        /* Reset SubSnowGrad to slope, don't want width in computation */
-        SubSnowGrad[y][x] = slope;
+        /* Reset FlowGrad to slope, don't want width in computation */
+        FlowDir->FlowGrad[i] = slope;
       }
     }
   }
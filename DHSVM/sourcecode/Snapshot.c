@@ -0,0 +1,334 @@
+/*
+ * SUMMARY:      Snapshot.c - Keep a copy of the model state in memory
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  A snapshot is a copy in memory of everything that carries
+ *               the model from one time step to the next: the soil, snow,
+ *               vegetation (including the canopy gap state), interception
+ *               and road pixel state, the storage and flows of the stream
+ *               and road channel segments, the unit hydrograph, the mass
+ *               balance totals and the model time.  The radiation and
+ *               evaporation of the last time step are included, because
+ *               some of their terms carry over to the next time step.
+ *               Restoring a snapshot
+ *               puts the model back at the time step at which it was
+ *               taken, so that a run can branch from one spun-up state any
+ *               number of times without writing the state to disk or
+ *               repeating the initialization.
+ * DESCRIP-END.
+ * FUNCTIONS:    TakeSnapshot()
+ *               UpdateSnapshot()
+ *               RestoreSnapshot()
+ *               FreeSnapshot()
+ * COMMENTS:
+ *   The state is copied field by field into a single block, in the same
+ *   order when the snapshot is taken and when it is restored.  Pointers in
+ *   the model structures (the layer arrays, and the parameters) are never
+ *   copied: the arrays they point to are copied instead.
+ *
+ *   The forcing and the output files are not part of a snapshot.  The
+ *   forcing for a time step is read for the model time, so that it follows
+ *   the restored time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "constants.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "DHSVMChannel.h"
+#include "functions.h"
+
+#define SNAP_SIZE    0		/* Only count the bytes of the state */
+#define SNAP_TAKE    1		/* Copy the model state to the snapshot */
+#define SNAP_RESTORE 2		/* Copy the snapshot to the model state */
+
+struct SNAPSHOT {
+  int Mode;			/* SNAP_SIZE, SNAP_TAKE or SNAP_RESTORE */
+  size_t Size;			/* Bytes of the state */
+  size_t Used;			/* Bytes copied so far */
+  char *Data;
+};
+
+/*****************************************************************************
+  CopyBytes()
+
+  Copy Size bytes of model state to or from the snapshot
+*****************************************************************************/
+static void CopyBytes(SNAPSHOT *Snap, void *State, size_t Size)
+{
+  if (Snap->Mode != SNAP_SIZE && Snap->Used + Size > Snap->Size)
+    ReportError("CopyBytes", 75);
+  if (Snap->Mode == SNAP_TAKE)
+    memcpy(Snap->Data + Snap->Used, State, Size);
+  else if (Snap->Mode == SNAP_RESTORE)
+    memcpy(State, Snap->Data + Snap->Used, Size);
+  Snap->Used += Size;
+}
+
+/*****************************************************************************
+  CopyChannel()
+
+  Copy the segments of a channel network, except for the links between
+  them and their parameters
+*****************************************************************************/
+static void CopyChannel(SNAPSHOT *Snap, Channel *Head)
+{
+  Channel Keep;
+  Channel *Current;
+
+  for (Current = Head; Current != NULL; Current = Current->next) {
+    Keep = *Current;
+    CopyBytes(Snap, Current, sizeof(Channel));
+    Current->record_name = Keep.record_name;
+    Current->class2 = Keep.class2;
+    Current->outlet = Keep.outlet;
+    Current->next = Keep.next;
+  }
+}
+
+/*****************************************************************************
+  CopyCell()
+
+  Copy the model state of one grid cell, in the direction given by the mode
+  of the snapshot
+*****************************************************************************/
+static void CopyCell(SNAPSHOT *Snap, MAPSIZE *Map, int y, int x,
+  OPTIONSTRUCT *Options, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap,
+  ROADSTRUCT **Network)
+{
+  CanopyGapStruct KeepGap;
+  CanopyGapStruct *Gap;
+  EVAPPIX KeepEvap;
+  PRECIPPIX KeepPrecip;
+  ROADSTRUCT KeepRoad;
+  SOILPIX KeepSoil;
+  VEGPIX KeepVeg;
+  int NSoil;
+  int NVeg;
+  int i;
+  int j;
+
+  CopyBytes(Snap, &(SnowMap[y][x]), sizeof(SNOWPIX));
+
+  /* soil, with the layer arrays that are allocated in the basin */
+  KeepSoil = SoilMap[y][x];
+  CopyBytes(Snap, &(SoilMap[y][x]), sizeof(SOILPIX));
+  SoilMap[y][x].Moist = KeepSoil.Moist;
+  SoilMap[y][x].Perc = KeepSoil.Perc;
+  SoilMap[y][x].Temp = KeepSoil.Temp;
+  SoilMap[y][x].Porosity = KeepSoil.Porosity;
+  SoilMap[y][x].FCap = KeepSoil.FCap;
+  if (SoilMap[y][x].Moist != NULL) {
+    NSoil = Soil->NLayers[SoilMap[y][x].Soil - 1];
+    CopyBytes(Snap, SoilMap[y][x].Moist, (NSoil + 1) * sizeof(float));
+    CopyBytes(Snap, SoilMap[y][x].Perc, NSoil * sizeof(float));
+    CopyBytes(Snap, SoilMap[y][x].Temp, NSoil * sizeof(float));
+  }
+
+  /* the soil fields of the routing; the soil depth and lateral
+     conductivity do not change */
+  CopyBytes(Snap, &(SoilFlow->TableDepth[y * Map->NX + x]), sizeof(float));
+  CopyBytes(Snap, &(SoilFlow->SatFlow[y * Map->NX + x]), sizeof(float));
+  CopyBytes(Snap, &(SoilFlow->IExcess[y * Map->NX + x]), sizeof(float));
+  CopyBytes(Snap, &(SoilFlow->Runoff[y * Map->NX + x]), sizeof(float));
+
+  /* canopy interception */
+  KeepPrecip = PrecipMap[y][x];
+  CopyBytes(Snap, &(PrecipMap[y][x]), sizeof(PRECIPPIX));
+  PrecipMap[y][x].IntRain = KeepPrecip.IntRain;
+  PrecipMap[y][x].IntSnow = KeepPrecip.IntSnow;
+  if (PrecipMap[y][x].IntRain != NULL) {
+    NVeg = Veg->NLayers[VegMap[y][x].Veg - 1];
+    CopyBytes(Snap, PrecipMap[y][x].IntRain, NVeg * sizeof(float));
+    CopyBytes(Snap, PrecipMap[y][x].IntSnow, NVeg * sizeof(float));
+  }
+
+  /* vegetation, with the state of the gap and forest parts of the pixel
+     if canopy gapping is on */
+  KeepVeg = VegMap[y][x];
+  CopyBytes(Snap, &(VegMap[y][x]), sizeof(VEGPIX));
+  VegMap[y][x].Fract = KeepVeg.Fract;
+  VegMap[y][x].LAI = KeepVeg.LAI;
+  VegMap[y][x].LAIMonthly = KeepVeg.LAIMonthly;
+  VegMap[y][x].MaxInt = KeepVeg.MaxInt;
+  VegMap[y][x].Type = KeepVeg.Type;
+  if (Options->CanopyGapping && VegMap[y][x].Type != NULL) {
+    for (i = 0; i < CELL_PARTITION; i++) {
+      Gap = &(VegMap[y][x].Type[i]);
+      KeepGap = *Gap;
+      CopyBytes(Snap, Gap, sizeof(CanopyGapStruct));
+      Gap->IntRain = KeepGap.IntRain;
+      Gap->IntSnow = KeepGap.IntSnow;
+      Gap->Moist = KeepGap.Moist;
+      Gap->EPot = KeepGap.EPot;
+      Gap->EAct = KeepGap.EAct;
+      Gap->EInt = KeepGap.EInt;
+      Gap->ESoil = KeepGap.ESoil;
+      CopyBytes(Snap, Gap->IntRain, Veg->MaxLayers * sizeof(float));
+      CopyBytes(Snap, Gap->IntSnow, Veg->MaxLayers * sizeof(float));
+      CopyBytes(Snap, Gap->Moist, (Soil->MaxLayers + 1) * sizeof(float));
+      CopyBytes(Snap, Gap->EPot, (Veg->MaxLayers + 1) * sizeof(float));
+      CopyBytes(Snap, Gap->EAct, (Veg->MaxLayers + 1) * sizeof(float));
+      CopyBytes(Snap, Gap->EInt, Veg->MaxLayers * sizeof(float));
+      for (j = 0; j < Veg->MaxLayers; j++)
+        CopyBytes(Snap, Gap->ESoil[j], Soil->MaxLayers * sizeof(float));
+    }
+  }
+
+  /* radiation and evaporation of the last time step */
+  CopyBytes(Snap, &(RadMap[y][x]), sizeof(PIXRAD));
+  KeepEvap = EvapMap[y][x];
+  CopyBytes(Snap, &(EvapMap[y][x]), sizeof(EVAPPIX));
+  EvapMap[y][x].EPot = KeepEvap.EPot;
+  EvapMap[y][x].EAct = KeepEvap.EAct;
+  EvapMap[y][x].EInt = KeepEvap.EInt;
+  EvapMap[y][x].ESoil = KeepEvap.ESoil;
+  if (EvapMap[y][x].EPot != NULL) {
+    NVeg = Veg->NLayers[VegMap[y][x].Veg - 1];
+    NSoil = Soil->NLayers[SoilMap[y][x].Soil - 1];
+    CopyBytes(Snap, EvapMap[y][x].EPot, (NVeg + 1) * sizeof(float));
+    CopyBytes(Snap, EvapMap[y][x].EAct, (NVeg + 1) * sizeof(float));
+    CopyBytes(Snap, EvapMap[y][x].EInt, NVeg * sizeof(float));
+    for (j = 0; j < NVeg; j++)
+      CopyBytes(Snap, EvapMap[y][x].ESoil[j], NSoil * sizeof(float));
+  }
+
+  /* road surface water */
+  KeepRoad = Network[y][x];
+  CopyBytes(Snap, &(Network[y][x]), sizeof(ROADSTRUCT));
+  Network[y][x].PercArea = KeepRoad.PercArea;
+  Network[y][x].Adjust = KeepRoad.Adjust;
+  Network[y][x].RoadClass = KeepRoad.RoadClass;
+  Network[y][x].h = KeepRoad.h;
+}
+
+/*****************************************************************************
+  CopyState()
+
+  Copy all of the model state, in the direction given by the mode of the
+  snapshot
+*****************************************************************************/
+static void CopyState(SNAPSHOT *Snap, MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  int x;
+  int y;
+
+  Snap->Used = 0;
+
+  CopyBytes(Snap, Time, sizeof(TIMESTRUCT));
+  CopyBytes(Snap, Mass, sizeof(WATERBALANCE));
+
+  for (y = 0; y < Map->NY; y++)
+    for (x = 0; x < Map->NX; x++)
+      CopyCell(Snap, Map, y, x, Options, Soil, Veg, EvapMap, RadMap, PrecipMap,
+        SnowMap, SoilMap, SoilFlow, VegMap, Network);
+
+  CopyChannel(Snap, ChannelData->streams);
+  CopyChannel(Snap, ChannelData->roads);
+
+  if (Hydrograph != NULL)
+    CopyBytes(Snap, Hydrograph, HydrographInfo->TotalWaveLength * sizeof(float));
+}
+
+/*****************************************************************************
+  TakeSnapshot()
+
+  Copy the current model state to a new snapshot
+*****************************************************************************/
+SNAPSHOT *TakeSnapshot(MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  SNAPSHOT *Snap;
+
+  if (!(Snap = (SNAPSHOT *) calloc(1, sizeof(SNAPSHOT))))
+    ReportError("TakeSnapshot", 1);
+
+  Snap->Mode = SNAP_SIZE;
+  CopyState(Snap, Map, Options, Time, Soil, Veg, EvapMap, RadMap,
+    PrecipMap, SnowMap, SoilMap, SoilFlow,
+    VegMap, Network, ChannelData, HydrographInfo,
+    Hydrograph, Mass);
+  Snap->Size = Snap->Used;
+  if (!(Snap->Data = (char *) malloc(Snap->Size)))
+    ReportError("TakeSnapshot", 1);
+
+  UpdateSnapshot(Snap, Map, Options, Time, Soil, Veg, EvapMap, RadMap,
+    PrecipMap, SnowMap, SoilMap, SoilFlow,
+    VegMap, Network, ChannelData, HydrographInfo,
+    Hydrograph, Mass);
+
+  return Snap;
+}
+
+/*****************************************************************************
+  UpdateSnapshot()
+
+  Copy the current model state to an existing snapshot, in place of the
+  state it holds
+*****************************************************************************/
+void UpdateSnapshot(SNAPSHOT *Snap, MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  Snap->Mode = SNAP_TAKE;
+  CopyState(Snap, Map, Options, Time, Soil, Veg, EvapMap, RadMap,
+    PrecipMap, SnowMap, SoilMap, SoilFlow,
+    VegMap, Network, ChannelData, HydrographInfo,
+    Hydrograph, Mass);
+  if (Snap->Used != Snap->Size)
+    ReportError("UpdateSnapshot", 75);
+}
+
+/*****************************************************************************
+  RestoreSnapshot()
+
+  Put the model back in the state of a snapshot.  The snapshot is kept, so
+  that it can be restored again.
+*****************************************************************************/
+void RestoreSnapshot(SNAPSHOT *Snap, MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+  VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass)
+{
+  Snap->Mode = SNAP_RESTORE;
+  CopyState(Snap, Map, Options, Time, Soil, Veg, EvapMap, RadMap,
+    PrecipMap, SnowMap, SoilMap, SoilFlow,
+    VegMap, Network, ChannelData, HydrographInfo,
+    Hydrograph, Mass);
+  if (Snap->Used != Snap->Size)
+    ReportError("RestoreSnapshot", 75);
+}
+
+/*****************************************************************************
+  FreeSnapshot()
+*****************************************************************************/
+void FreeSnapshot(SNAPSHOT *Snap)
+{
+  if (Snap == NULL)
+    return;
+  free(Snap->Data);
+  free(Snap);
+}
@@ -16,7 +16,6 @@
 
 #include <assert.h>
 #include <math.h>
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "brent.h"
@@ -26,8 +25,6 @@
 #include "functions.h"
 #include "snow.h"
 
-static float CalcSnowPackEnergyBalance(float Tsurf, ...);
-
 /*****************************************************************************
   Function name: SnowMelt()
 
@@ -99,6 +96,7 @@ float SnowMelt(int y, int x, int Dt, float Z, float Displacement, float Z0,
   float PackSwq;		    /* Snow pack snow water equivalent (m) */
   float Qnet;			    /* Net energy exchange at the surface (W/m2) */
   float RefreezeEnergy;		/* refreeze energy (W/m2) */
+  SNOWBALANCE Balance;		/* Terms of the snow pack energy balance */
   float RefrozenWater;		/* Amount of refrozen water (m) */
   float SnowFallCC;		    /* Cold content of new snowfall (J) */
   float SnowMelt;		    /* Amount of snow melt during time interval
@@ -158,11 +156,27 @@ float SnowMelt(int y, int x, int Dt, float Z, float Displacement, float Z0,
   *SurfWater += RainFall;
 
   /* Calculate the surface energy balance for snow_temp = 0.0 */
-  Qnet = CalcSnowPackEnergyBalance((float) 0.0, Dt, BaseRa, Z, Displacement,
-    Z0, Wind, ShortRad, LongRadIn, AirDens,
-    Lv, Tair, Press, Vpd, EactAir, RainFall,
-    SurfaceSwq, *SurfWater, OldTSurf,
-    &RefreezeEnergy, VaporMassFlux);
+  Balance.Dt = Dt;
+  Balance.Ra = BaseRa;
+  Balance.Z = Z;
+  Balance.Displacement = Displacement;
+  Balance.Z0 = Z0;
+  Balance.Wind = Wind;
+  Balance.ShortRad = ShortRad;
+  Balance.LongRadIn = LongRadIn;
+  Balance.AirDens = AirDens;
+  Balance.Lv = Lv;
+  Balance.Tair = Tair;
+  Balance.Press = Press;
+  Balance.Vpd = Vpd;
+  Balance.EactAir = EactAir;
+  Balance.Rain = RainFall;
+  Balance.SweSurfaceLayer = SurfaceSwq;
+  Balance.SurfaceLiquidWater = *SurfWater;
+  Balance.OldTSurf = OldTSurf;
+  Balance.RefreezeEnergy = &RefreezeEnergy;
+  Balance.VaporMassFlux = VaporMassFlux;
+  Qnet = SnowPackEnergyBalance((float) 0.0, &Balance);
 
   /* If Qnet == 0.0, then set the surface temperature to 0.0 */
   if (fequal(Qnet, 0.0)) {
@@ -230,10 +244,7 @@ float SnowMelt(int y, int x, int Dt, float Z, float Displacement, float Z0,
     /* Calculate surface layer temperature using "Brent method" */
 
     *TSurf = RootBrent(y, x, (float)(*TSurf - DELTAT), (float) 0.0,
-      *TSurf, SnowPackEnergyBalance, Dt, BaseRa, Z, Displacement,
-      Z0, Wind, ShortRad, LongRadIn, AirDens, Lv, Tair,
-      Press, Vpd, EactAir, RainFall, SurfaceSwq, *SurfWater,
-      OldTSurf, &RefreezeEnergy, VaporMassFlux);
+      *TSurf, SnowPackEnergyBalance, &Balance);
 
     /* since we iterated, the surface layer is below freezing and no snowmelt */
     SnowMelt = 0.0;
@@ -356,32 +367,3 @@ float SnowMelt(int y, int x, int Dt, float Z, float Displacement, float Z0,
 
   return (Outflow);
 }
-
-/*****************************************************************************
-  Function name: CalcSnowPackEnergyBalance()
-
-  Purpose      : Dummy function to make a direct call to
-                 SnowEnergyBalance() possible.
-
-  Required     :
-    float TSurf - SnowPack surface temperature (C)
-    other arguments required by SnowPackEnergyBalance()
-
-  Returns      :
-    float Qnet - Net energy exchange at the SnowPack snow surface (W/m^2)
-
-  Modifies     : none
-
-  Comments     : function is local to this module
-*****************************************************************************/
-static float CalcSnowPackEnergyBalance(float Tsurf, ...)
-{
-  va_list ap;			/* Used in traversing variable argument list */
-  float Qnet;			/* Net energy exchange at the SnowPack snow surface (W/m^2) */
-
-  va_start(ap, Tsurf);
-  Qnet = SnowPackEnergyBalance(Tsurf, ap);
-  va_end(ap);
-
-  return Qnet;
-}
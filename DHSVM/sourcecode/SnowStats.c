@@ -39,6 +39,7 @@ void SnowStats(DATE *Now, MAPSIZE *Map, OPTIONSTRUCT *Options,
 {
   int x;
   int y;
+  int run;
   int DNum; 
   //printf("updating SWE stats map\n");
  
@@ -48,8 +49,8 @@ void SnowStats(DATE *Now, MAPSIZE *Map, OPTIONSTRUCT *Options,
   // printf("currnet day is %d \n", Now->Day);
   // printf("currnet DNum is %d \n", DNum);
   for (y = 0; y < Map->NY; y++) {
-    for (x = 0; x < Map->NX; x++) {
-      if (INBASIN(TopoMap[y][x].Mask)) {
+    for (run = Map->RowRuns[y]; run < Map->RowRuns[y + 1]; run++) {
+      for (x = Map->Runs[run].x0; x < Map->Runs[run].x1; x++) {
            //printf("currnet SWE is %f \n", Snow[y][x].Swq);
           // Update Peak SWE and Peak SWE date
           if ( Snow[y][x].Swq > Snow[y][x].MaxSwe){
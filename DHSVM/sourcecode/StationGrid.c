@@ -0,0 +1,229 @@
+/*
+ * SUMMARY:      StationGrid.c - Spatial index of the met station locations
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Sorts the met stations into a uniform grid of square
+ *               buckets, so that the stations at or nearest to a pixel can
+ *               be found by visiting only the buckets around that pixel
+ *               instead of every station
+ * DESCRIP-END.
+ * FUNCTIONS:    InitStationGrid()
+ *               FreeStationGrid()
+ *               NearestStations()
+ * COMMENTS:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "functions.h"
+
+/* Bucket number of a row or column, rounding down for locations before the
+   first bucket (stations and pixels can be on either side of the grid) */
+static int BucketOf(int Pos, int Pos0, int Size)
+{
+  int Offset = Pos - Pos0;
+
+  if (Offset >= 0)
+    return Offset / Size;
+  return -((-Offset + Size - 1) / Size);
+}
+
+/*****************************************************************************
+  Function name: InitStationGrid()
+
+  Purpose      : Build the bucket grid over the station locations
+
+  Required     :
+    METLOCATION *Station - Met stations
+    int NStats           - Number of met stations
+    STATIONGRID *Grid    - Grid to build
+
+  Returns      : void
+
+  Modifies     : Grid
+
+  Comments     :
+    The bucket size is chosen so that there is about one station per bucket
+    when the stations are spread evenly over their bounding box
+*****************************************************************************/
+void InitStationGrid(METLOCATION *Station, int NStats, STATIONGRID *Grid)
+{
+  int MinN, MaxN, MinE, MaxE;
+  int Bucket;
+  int *Next;
+  int i;
+
+  Grid->NStats = NStats;
+  Grid->N0 = 0;
+  Grid->E0 = 0;
+  Grid->Size = 1;
+  Grid->NN = 0;
+  Grid->NE = 0;
+
+  if (NStats > 0) {
+    MinN = MaxN = Station[0].Loc.N;
+    MinE = MaxE = Station[0].Loc.E;
+    for (i = 1; i < NStats; i++) {
+      if (Station[i].Loc.N < MinN)
+        MinN = Station[i].Loc.N;
+      if (Station[i].Loc.N > MaxN)
+        MaxN = Station[i].Loc.N;
+      if (Station[i].Loc.E < MinE)
+        MinE = Station[i].Loc.E;
+      if (Station[i].Loc.E > MaxE)
+        MaxE = Station[i].Loc.E;
+    }
+    Grid->N0 = MinN;
+    Grid->E0 = MinE;
+    Grid->Size = (int) ceil(sqrt((double) (MaxN - MinN + 1) *
+                                 (double) (MaxE - MinE + 1) / NStats));
+    if (Grid->Size < 1)
+      Grid->Size = 1;
+    Grid->NN = (MaxN - MinN) / Grid->Size + 1;
+    Grid->NE = (MaxE - MinE) / Grid->Size + 1;
+  }
+
+  if (!(Grid->Start = (int *) calloc(Grid->NN * Grid->NE + 1, sizeof(int))))
+    ReportError("InitStationGrid()", 1);
+  if (!(Grid->Station = (int *) calloc(NStats > 0 ? NStats : 1, sizeof(int))))
+    ReportError("InitStationGrid()", 1);
+  if (!(Next = (int *) calloc(Grid->NN * Grid->NE + 1, sizeof(int))))
+    ReportError("InitStationGrid()", 1);
+
+  /* count the stations in each bucket, then place them in station order so
+     that each bucket lists its stations by increasing index */
+
+  for (i = 0; i < NStats; i++) {
+    Bucket = BucketOf(Station[i].Loc.N, Grid->N0, Grid->Size) * Grid->NE +
+      BucketOf(Station[i].Loc.E, Grid->E0, Grid->Size);
+    Grid->Start[Bucket + 1]++;
+  }
+  for (Bucket = 0; Bucket < Grid->NN * Grid->NE; Bucket++) {
+    Grid->Start[Bucket + 1] += Grid->Start[Bucket];
+    Next[Bucket] = Grid->Start[Bucket];
+  }
+  for (i = 0; i < NStats; i++) {
+    Bucket = BucketOf(Station[i].Loc.N, Grid->N0, Grid->Size) * Grid->NE +
+      BucketOf(Station[i].Loc.E, Grid->E0, Grid->Size);
+    Grid->Station[Next[Bucket]++] = i;
+  }
+
+  free(Next);
+}
+
+/*****************************************************************************
+  Function name: FreeStationGrid()
+
+  Purpose      : Release the memory held by a station grid
+
+  Required     :
+    STATIONGRID *Grid - Grid to free
+
+  Returns      : void
+
+  Modifies     : Grid
+*****************************************************************************/
+void FreeStationGrid(STATIONGRID *Grid)
+{
+  free(Grid->Start);
+  free(Grid->Station);
+  Grid->Start = NULL;
+  Grid->Station = NULL;
+  Grid->NN = 0;
+  Grid->NE = 0;
+}
+
+/*****************************************************************************
+  Function name: NearestStations()
+
+  Purpose      : Find the K stations nearest to a location
+
+  Required     :
+    STATIONGRID *Grid    - Station grid
+    METLOCATION *Station - Met stations the grid was built from
+    COORD *Loc           - Location
+    int K                - Number of stations wanted
+    int *Nearest         - Array of at least K elements for the stations
+    double *Distance     - Array of at least K elements for their distances
+
+  Returns      : Number of stations found, which is K unless there are fewer
+                 stations than that
+
+  Modifies     : Nearest and Distance
+
+  Comments     :
+    The stations are returned by increasing distance (CalcDistance()), and
+    stations at the same distance by increasing index.  The buckets are
+    visited in rings around the bucket of Loc.  A station in a bucket outside
+    ring r is at least r * Size + 1 pixels away, so the search stops as soon
+    as the K-th distance found is below that, which means that stations tied
+    with the K-th one have all been seen.
+*****************************************************************************/
+int NearestStations(STATIONGRID *Grid, METLOCATION *Station, COORD *Loc,
+                    int K, int *Nearest, double *Distance)
+{
+  double d;
+  int Found;
+  int MaxRing;
+  int bn, be;
+  int n, e, dE;
+  int r;
+  int i, j, s;
+
+  if (K > Grid->NStats)
+    K = Grid->NStats;
+  if (K <= 0)
+    return 0;
+
+  bn = BucketOf(Loc->N, Grid->N0, Grid->Size);
+  be = BucketOf(Loc->E, Grid->E0, Grid->Size);
+
+  /* ring beyond which there are no buckets left */
+  MaxRing = bn;
+  if (Grid->NN - 1 - bn > MaxRing)
+    MaxRing = Grid->NN - 1 - bn;
+  if (be > MaxRing)
+    MaxRing = be;
+  if (Grid->NE - 1 - be > MaxRing)
+    MaxRing = Grid->NE - 1 - be;
+
+  Found = 0;
+  for (r = 0; r <= MaxRing; r++) {
+    for (n = bn - r; n <= bn + r; n++) {
+      if (n < 0 || n >= Grid->NN)
+        continue;
+      /* full rows at the top and bottom of the ring, only the two end
+         buckets in between */
+      dE = (n == bn - r || n == bn + r) ? 1 : 2 * r;
+      for (e = be - r; e <= be + r; e += dE) {
+        if (e < 0 || e >= Grid->NE)
+          continue;
+        for (j = Grid->Start[n * Grid->NE + e];
+             j < Grid->Start[n * Grid->NE + e + 1]; j++) {
+          s = Grid->Station[j];
+          d = CalcDistance(&(Station[s].Loc), Loc);
+          if (Found == K && (d > Distance[K - 1] ||
+                             (d == Distance[K - 1] && s > Nearest[K - 1])))
+            continue;
+          /* insert into the sorted list of the nearest stations */
+          i = (Found < K) ? Found++ : K - 1;
+          for (; i > 0 && (d < Distance[i - 1] ||
+                           (d == Distance[i - 1] && s < Nearest[i - 1])); i--) {
+            Distance[i] = Distance[i - 1];
+            Nearest[i] = Nearest[i - 1];
+          }
+          Distance[i] = d;
+          Nearest[i] = s;
+        }
+      }
+    }
+    if (Found == K && Distance[K - 1] < (double) r * Grid->Size + 1.0)
+      break;
+  }
+
+  return Found;
+}
@@ -9,7 +9,8 @@
  * DESCRIPTION:  Store the state of the model.  This allows restarts of the
  *               model with the correct initial conditions
  * DESCRIP-END.
- * FUNCTIONS:    StoreModelState()
+ * FUNCTIONS:    StoreStateMap()
+ *               StoreModelState()
  * COMMENTS:
  * $Id: StoreModelState.c,v 1.8 2004/08/16 18:26:38 colleen Exp $
  */
@@ -26,6 +27,21 @@
 #include "sizeofnt.h"
 #include "varid.h"
 
+/*****************************************************************************
+  StoreStateMap()
+
+  Write a state map to its map file, or to the checkpoint if there is one
+*****************************************************************************/
+static void StoreStateMap(CHECKPOINT *Checkpoint, char *FileName, void *Array,
+  MAPSIZE *Map, MAPDUMP *DMap)
+{
+  if (Checkpoint != NULL)
+    PutCheckpointMap(Checkpoint, DMap->ID,
+      IsMultiLayer(DMap->ID) ? DMap->Layer : 0, Array, Map);
+  else
+    Write2DMatrix(FileName, Array, DMap->NumberType, Map, DMap, 0);
+}
+
  /*****************************************************************************
    StoreModelState()
 
@@ -50,14 +66,17 @@
          - temperature
        - surface temperature
        - ground heat storage
+
+   The state is written to a set of map files, or with Checkpoint not NULL,
+   to that checkpoint.
  *****************************************************************************/
 void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   OPTIONSTRUCT * Options, TOPOPIX ** TopoMap,
   PRECIPPIX ** PrecipMap, SNOWPIX ** SnowMap,
   MET_MAP_PIX ** MetMap, VEGPIX ** VegMap, 
-  LAYER * Veg, SOILPIX ** SoilMap, LAYER * Soil, 
+  LAYER * Veg, SOILPIX ** SoilMap, SOILFLOWMAP * SoilFlow, LAYER * Soil, 
   ROADSTRUCT ** Network, UNITHYDRINFO * HydrographInfo, 
-  float *Hydrograph, CHANNEL * ChannelData)
+  float *Hydrograph, CHANNEL * ChannelData, CHECKPOINT * Checkpoint)
 {
   const char *Routine = "StoreModelState";
   char Str[NAMESIZE + 1];
@@ -86,7 +105,8 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     sprintf(FileName, "%sMet.State.%s%s", Path, Str, fileext);
     strcpy(FileLabel, "Basic Meteorology at time step");
 
-    CreateMapFile(FileName, FileLabel, Map);
+    if (Checkpoint == NULL)
+      CreateMapFile(FileName, FileLabel, Map);
 
     if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
       ReportError((char *)Routine, 1);
@@ -106,7 +126,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
@@ -121,7 +141,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
@@ -136,7 +156,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
@@ -151,7 +171,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
     for (y = 0; y < Map->NY; y++) {
       for (x = 0; x < Map->NX; x++) {
@@ -166,7 +186,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
     free(Array);
   }
@@ -177,7 +197,8 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   sprintf(FileName, "%sInterception.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Interception storage for each vegetation layer");
 
-  CreateMapFile(FileName, FileLabel, Map);
+  if (Checkpoint == NULL)
+    CreateMapFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -201,7 +222,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
   }
 
   for (i = 0; i < Veg->MaxLayers; i++) {
@@ -223,7 +244,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -240,7 +261,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   free(Array);
 
@@ -248,7 +269,8 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
 
   sprintf(FileName, "%sSnow.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Snow pack moisture and temperature state");
-  CreateMapFile(FileName, FileLabel, Map);
+  if (Checkpoint == NULL)
+    CreateMapFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -265,7 +287,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -279,7 +301,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -293,7 +315,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -307,7 +329,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -321,7 +343,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -335,7 +357,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -349,7 +371,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
@@ -363,7 +385,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   free(Array);
 
@@ -371,7 +393,8 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
 
   sprintf(FileName, "%sSoil.State.%s%s", Path, Str, fileext);
   strcpy(FileLabel, "Soil moisture and temperature state");
-  CreateMapFile(FileName, FileLabel, Map);
+  if (Checkpoint == NULL)
+    CreateMapFile(FileName, FileLabel, Map);
 
   if (!(Array = (float *)calloc(Map->NY * Map->NX, sizeof(float))))
     ReportError((char *)Routine, 1);
@@ -395,7 +418,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -410,7 +433,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (i = 0; i < Soil->MaxLayers; i++) {
     for (y = 0; y < Map->NY; y++) {
@@ -431,7 +454,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
     DMap.Resolution = MAP_OUTPUT;
     strcpy(DMap.FileName, "");
     GetVarAttr(&DMap);
-    Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+    StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
   }
 
   for (y = 0; y < Map->NY; y++) {
@@ -446,13 +469,13 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   for (y = 0; y < Map->NY; y++) {
     for (x = 0; x < Map->NX; x++) {
       if (INBASIN(TopoMap[y][x].Mask)) {
         RoadIExcess = 0.0;
-        ((float *)Array)[y * Map->NX + x] = SoilMap[y][x].IExcess + RoadIExcess;
+        ((float *)Array)[y * Map->NX + x] = SoilFlow->IExcess[y * Map->NX + x] + RoadIExcess;
       }
       else
         ((float *)Array)[y * Map->NX + x] = NA;
@@ -462,7 +485,7 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
   DMap.Resolution = MAP_OUTPUT;
   strcpy(DMap.FileName, "");
   GetVarAttr(&DMap);
-  Write2DMatrix(FileName, Array, DMap.NumberType, Map, &DMap, 0);
+  StoreStateMap(Checkpoint, FileName, Array, Map, &DMap);
 
   free(Array);
 
@@ -470,10 +493,15 @@ void StoreModelState(char *Path, DATE * Current, MAPSIZE * Map,
      hydrograph array */
 
   if (Options->Extent == BASIN && Options->HasNetwork == FALSE) {
-    sprintf(FileName, "%sHydrograph.State.%s", Path, Str);
-    OpenFile(&HydroStateFile, FileName, "w", FALSE);
-    for (i = 0; i < HydrographInfo->TotalWaveLength; i++)
-      fprintf(HydroStateFile, "%f\n", Hydrograph[i]);
-    fclose(HydroStateFile);
+    if (Checkpoint != NULL)
+      PutCheckpointField(Checkpoint, CKP_HYDROGRAPH, 0, Hydrograph,
+        HydrographInfo->TotalWaveLength);
+    else if (ParallelRank() == 0) {
+      sprintf(FileName, "%sHydrograph.State.%s", Path, Str);
+      OpenFile(&HydroStateFile, FileName, "w", FALSE);
+      for (i = 0; i < HydrographInfo->TotalWaveLength; i++)
+        fprintf(HydroStateFile, "%f\n", Hydrograph[i]);
+      fclose(HydroStateFile);
+    }
   }
 }
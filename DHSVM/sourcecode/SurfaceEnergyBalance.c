@@ -16,7 +16,6 @@
  */
 
 #include <math.h>
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "settings.h"
@@ -30,9 +29,8 @@
 
   Required     :
     float TSurf           - new estimate of effective surface temperature
-    va_list ap            - Argument list initialized by va_start().  For
-                            elements of list and order, see beginning of
-                            routine
+    void *Params          - SURFACEBALANCE with the other terms of the
+                            balance
 
   Returns      :
     float RestTerm        - Rest term in the energy balance
@@ -41,37 +39,10 @@
 
   Comments     :
 *****************************************************************************/
-float SurfaceEnergyBalance(float TSurf, va_list ap)
+float SurfaceEnergyBalance(float TSurf, void *Params)
 {
-  /* start of list of arguments in variable argument list */
-
-  int Dt;			/* Model time step (seconds) */
+  SURFACEBALANCE *P = (SURFACEBALANCE *) Params;
   float Ra;			/* Aerodynamic resistance (s/m) */
-  float Z;			/* Reference height (m) */
-  float Displacement;		/* Displacement height (m) */
-  float Z0;			/* Surface roughness (m) */
-  float Wind;			/* Wind speed (m/s) */
-  float ShortRad;		/* Net incident shortwave radiation (W/m2) */
-  float LongRadIn;		/* Incoming longwave radiation (W/m2) */
-  float AirDens;		/* Density of air (kg/m3) */
-  float Lv;			/* Latent heat of vaporization (J/kg3) */
-  float ETot;			/* Total evapotranspiration (m) */
-  float Kt;			/* Effective soil thermal conductivity 
-				   (W/(m*K)) */
-  float ChSoil;			/* Soil thermal capacity (J/(kg*K)) */
-  float Porosity;		/* Porosity of upper soil layer */
-  float MoistureContent;	/* Moisture content of upper soil layer */
-  float Depth;			/* Depth of soil heat profile (m) */
-  float Tair;			/* Air temperature (C) */
-  float TSoilUpper;		/* Soil temperature in upper layer (C) */
-  float TSoilLower;		/* Soil temperature at Depth (C) */
-  float OldTSurf;		/* Surface temperature during previous time
-				   step */
-  float MeltEnergy;		/* Energy used to melt/refreeze snow pack 
-				   (W/m2) */
-
-  /* end of list of arguments in variable argument list */
-
   float GroundHeat;		/* ground heat exchange at surface (W/m2) */
   float HeatCapacity;		/* soil heat capacity (J/(m3*C) */
   float HeatStorageChange;	/* change in ground heat storage (W/m2) */
@@ -85,50 +56,16 @@ float SurfaceEnergyBalance(float TSurf, va_list ap)
   float TMean;			/* Mean temperature during interval (C) */
   double Tmp;			/* temporary variable */
 
-  /* Assign the elements of the array to the appropriate variables.  The list
-     is traversed as if the elements are doubles, because:
-
-     In the variable-length part of variable-length argument lists, the old
-     ``default argument promotions'' apply: arguments of type float are
-     always promoted (widened) to type double, and types char and short int
-     are promoted to int. Therefore, it is never correct to invoke
-     va_arg(argp, float); instead you should always use va_arg(argp,
-     double). 
-
-     (quoted from the comp.lang.c FAQ list)
-   */
-
-  Dt = va_arg(ap, int);
-  Ra = (float) va_arg(ap, double);
-  Z = (float) va_arg(ap, double);
-  Displacement = (float) va_arg(ap, double);
-  Z0 = (float) va_arg(ap, double);
-  Wind = (float) va_arg(ap, double);
-  ShortRad = (float) va_arg(ap, double);
-  LongRadIn = (float) va_arg(ap, double);
-  AirDens = (float) va_arg(ap, double);
-  Lv = (float) va_arg(ap, double);
-  ETot = (float) va_arg(ap, double);
-  Kt = (float) va_arg(ap, double);
-  ChSoil = (float) va_arg(ap, double);
-  Porosity = (float) va_arg(ap, double);
-  MoistureContent = (float) va_arg(ap, double);
-  Depth = (float) va_arg(ap, double);
-  Tair = (float) va_arg(ap, double);
-  TSoilUpper = (float) va_arg(ap, double);
-  TSoilLower = (float) va_arg(ap, double);
-  OldTSurf = (float) va_arg(ap, double);
-  MeltEnergy = (float) va_arg(ap, double);
-
   /* In this routine transport of energy to the surface is considered 
      positive */
 
-  TMean = 0.5 * (OldTSurf + TSurf);
+  TMean = 0.5 * (P->OldTSurf + TSurf);
 
   /* Apply the stability correction to the aerodynamic resistance */
 
-  if (Wind > 0.0)
-    Ra /= StabilityCorrection(Z, Displacement, TMean, Tair, Wind, Z0);
+  if (P->Wind > 0.0)
+    Ra = P->Ra / StabilityCorrection(P->Z, P->Displacement, TMean, P->Tair,
+				     P->Wind, P->Z0);
   else
     Ra = DHSVM_HUGE;
 
@@ -136,37 +73,37 @@ float SurfaceEnergyBalance(float TSurf, va_list ap)
 
   Tmp = TMean + 273.15;
   LongRadOut = STEFAN * (Tmp * Tmp * Tmp * Tmp);
-  NetRad = ShortRad + LongRadIn - LongRadOut;
+  NetRad = P->ShortRad + P->LongRadIn - LongRadOut;
 
   /* Calculate the sensible heat flux */
 
-  SensibleHeat = AirDens * CP * (Tair - TMean) / Ra;
+  SensibleHeat = P->AirDens * CP * (P->Tair - TMean) / Ra;
 
   /* Calculate the latent heat flux */
 
-  LatentHeat = -(Lv * ETot) / Dt * WATER_DENSITY;
+  LatentHeat = -(P->Lv * P->ETot) / P->Dt * WATER_DENSITY;
 
   /* Calculate the ground heat flux */
 
-  GroundHeat = Kt * (TSoilLower - TMean) / Depth;
+  GroundHeat = P->Kt * (P->TSoilLower - TMean) / P->Depth;
 
   /* Calculate the change in the ground heat storage in the upper 
      0.1 m of the soil */
 
-  HeatCapacity = (1 - Porosity) * ChSoil;
-  if (TSoilUpper >= 0.0)
-    HeatCapacity += MoistureContent * CH_WATER;
+  HeatCapacity = (1 - P->Porosity) * P->ChSoil;
+  if (P->TSoilUpper >= 0.0)
+    HeatCapacity += P->MoistureContent * CH_WATER;
   else
-    HeatCapacity += MoistureContent * CH_ICE;
+    HeatCapacity += P->MoistureContent * CH_ICE;
 
-  HeatStorageChange = (HeatCapacity * (OldTSurf - TMean) * DZ_TOP) / Dt;
+  HeatStorageChange = (HeatCapacity * (P->OldTSurf - TMean) * DZ_TOP) / P->Dt;
 
   /* Calculate the net energy exchange at the surface.  The left hand side of 
      the equation should go to zero for the balance to close, so we want to 
      minimize the absolute value of the left hand side */
 
   RestTerm =
-    MeltEnergy + NetRad + SensibleHeat + LatentHeat +
+    P->MeltEnergy + NetRad + SensibleHeat + LatentHeat +
     GroundHeat + HeatStorageChange;
 
   return RestTerm;
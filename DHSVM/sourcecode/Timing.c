@@ -0,0 +1,305 @@
+/*
+ * SUMMARY:      Timing.c - Wall clock time spent in each part of the model
+ * USAGE:        Part of DHSVM
+ *
+ * DESCRIPTION:  Timers that add up the wall clock time spent in each phase
+ *               of the initialization and of the time step loop.  At the
+ *               end of the run a table with the time spent in each phase
+ *               is printed.  If a trace file is given, each timed phase is
+ *               also written to that file as an event in the Chrome trace
+ *               event format, which can be viewed in chrome://tracing or
+ *               in Perfetto (ui.perfetto.dev).
+ * DESCRIP-END.
+ * FUNCTIONS:    InitTiming()
+ *               OpenTrace()
+ *               StartTimer()
+ *               StopTimer()
+ *               StartStepTimer()
+ *               StopStepTimer()
+ *               ElapsedTime()
+ *               EndTiming()
+ * COMMENTS:
+ *   The timers are only used by the main thread.  The time is wall clock
+ *   time, so a phase that runs on several threads counts once.  With MPI,
+ *   each process times itself and writes its own trace file, with the
+ *   process number added to the file name; the table is printed by the
+ *   first process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "settings.h"
+#include "data.h"
+#include "DHSVMerror.h"
+#include "functions.h"
+
+/* Names of the timers, in the order of the TIMER_ constants in settings.h */
+static const char *TimerName[NTIMERS] = {
+  "InitTables",
+  "InitTerrainMaps",
+  "InitChannel",
+  "InitMetMaps",
+  "InitDump",
+  "InitModelState",
+  "InitNewStep",
+  "Avalanche",
+  "MassEnergyBalance",
+  "RouteSubSurface",
+  "RouteChannel",
+  "RouteSurface",
+  "Aggregate",
+  "MassBalance",
+  "ExecDump"
+};
+
+static double Start;		/* Time at the start of the run */
+static double TimerStart[NTIMERS];	/* Time at which each timer was started */
+static double TimerTotal[NTIMERS];	/* Time spent in each phase */
+static long TimerCalls[NTIMERS];	/* Number of times each phase was timed */
+static double StepStart;	/* Time at which the current time step started */
+static char StepDate[32];	/* Date of the current time step */
+static double StepTotal = 0.0;	/* Time spent in the time step loop */
+static long NSteps = 0;		/* Number of time steps */
+static FILE *TraceFile = NULL;	/* Chrome trace file, if any */
+static int NEvents = 0;		/* Number of events in the trace file */
+
+static double WallTime(void);
+static void TraceEvent(const char *Name, const char *Category,
+		       double Begin, double End, const char *Args);
+
+/*****************************************************************************
+  Function name: WallTime()
+
+  Purpose      : Wall clock time
+
+  Returns      : double - seconds since an arbitrary moment in the past
+*****************************************************************************/
+static double WallTime(void)
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (double) Now.tv_sec + 1.e-9 * (double) Now.tv_nsec;
+}
+
+/*****************************************************************************
+  Function name: TraceEvent()
+
+  Purpose      : Write a complete event to the trace file
+
+  Required     :
+    const char *Name     - Name of the event
+    const char *Category - Category of the event
+    double Begin         - Wall time at the start of the event
+    double End           - Wall time at the end of the event
+    const char *Args     - JSON object with the arguments of the event, or
+                           NULL
+
+  Comments     : The times in the trace are in microseconds since the start
+                 of the run
+*****************************************************************************/
+static void TraceEvent(const char *Name, const char *Category,
+		       double Begin, double End, const char *Args)
+{
+  if (TraceFile == NULL)
+    return;
+
+  fprintf(TraceFile, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+	  "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": 0",
+	  NEvents > 0 ? "," : "", Name, Category, 1.e6 * (Begin - Start),
+	  1.e6 * (End - Begin), ParallelRank());
+  if (Args != NULL)
+    fprintf(TraceFile, ", \"args\": %s", Args);
+  fprintf(TraceFile, "}");
+  NEvents++;
+}
+
+/*****************************************************************************
+  Function name: InitTiming()
+
+  Purpose      : Start the clock for the run
+
+  Comments     : Called before anything else is timed
+*****************************************************************************/
+void InitTiming(void)
+{
+  int i;
+
+  for (i = 0; i < NTIMERS; i++) {
+    TimerStart[i] = 0.0;
+    TimerTotal[i] = 0.0;
+    TimerCalls[i] = 0;
+  }
+  Start = WallTime();
+}
+
+/*****************************************************************************
+  Function name: OpenTrace()
+
+  Purpose      : Open the trace file
+
+  Required     :
+    char *Path - Name of the trace file, or an empty string for no trace
+
+  Comments     : Events of phases that end after the file is opened are
+                 written, including those of phases that started earlier
+*****************************************************************************/
+void OpenTrace(char *Path)
+{
+  char FileName[BUFSIZE + 1];
+
+  if (Path == NULL || IsEmptyStr(Path))
+    return;
+
+  if (ParallelSize() > 1)
+    sprintf(FileName, "%s.%d", Path, ParallelRank());
+  else
+    strcpy(FileName, Path);
+
+  if (!(TraceFile = fopen(FileName, "w")))
+    ReportError(FileName, 3);
+  fprintf(TraceFile, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  NEvents = 0;
+}
+
+/*****************************************************************************
+  Function name: StartTimer()
+
+  Purpose      : Start timing a phase
+
+  Required     :
+    int Timer - One of the TIMER_ constants in settings.h
+*****************************************************************************/
+void StartTimer(int Timer)
+{
+  TimerStart[Timer] = WallTime();
+}
+
+/*****************************************************************************
+  Function name: StopTimer()
+
+  Purpose      : Stop timing a phase, and add the time to its total
+
+  Required     :
+    int Timer - One of the TIMER_ constants in settings.h
+*****************************************************************************/
+void StopTimer(int Timer)
+{
+  double End;
+
+  End = WallTime();
+  TimerTotal[Timer] += End - TimerStart[Timer];
+  TimerCalls[Timer]++;
+  TraceEvent(TimerName[Timer], Timer < TIMER_NEWSTEP ? "init" : "phase",
+	     TimerStart[Timer], End, NULL);
+}
+
+/*****************************************************************************
+  Function name: StartStepTimer()
+
+  Purpose      : Start timing a time step
+
+  Required     :
+    DATE *Current - Date of the time step
+*****************************************************************************/
+void StartStepTimer(DATE *Current)
+{
+  snprintf(StepDate, sizeof(StepDate), "%02d/%02d/%04d-%02d:%02d:%02d",
+	   Current->Month, Current->Day, Current->Year, Current->Hour,
+	   Current->Min, Current->Sec);
+  StepStart = WallTime();
+}
+
+/*****************************************************************************
+  Function name: StopStepTimer()
+
+  Purpose      : Stop timing a time step
+
+  Comments     : In the trace the time step is an event that contains the
+                 events of the phases of that step
+*****************************************************************************/
+void StopStepTimer(void)
+{
+  char Args[BUFSIZE + 1];
+  double End;
+
+  End = WallTime();
+  StepTotal += End - StepStart;
+  sprintf(Args, "{\"step\": %ld, \"date\": \"%s\"}", NSteps, StepDate);
+  TraceEvent("Time step", "step", StepStart, End, Args);
+  NSteps++;
+}
+
+/*****************************************************************************
+  Function name: ElapsedTime()
+
+  Purpose      : Wall clock time since the start of the run
+
+  Returns      : double - seconds since InitTiming() was called
+*****************************************************************************/
+double ElapsedTime(void)
+{
+  return WallTime() - Start;
+}
+
+/*****************************************************************************
+  Function name: EndTiming()
+
+  Purpose      : Print the time spent in each phase, and close the trace
+                 file
+
+  Required     :
+    FILE *Out  - File to which the table is printed
+    int NCells - Number of basin cells that are updated in a time step
+
+  Comments     : The time that is not in any of the phases (reading the
+                 input file, setting up output, the ensemble members, ...)
+                 is listed as "Other".  The throughput of the phases in the
+                 time step loop is given in cells times time steps per
+                 second, so that runs of basins of different size can be
+                 compared
+*****************************************************************************/
+void EndTiming(FILE *Out, int NCells)
+{
+  double Total;
+  double Timed;
+  int i;
+
+  Total = ElapsedTime();
+
+  if (TraceFile != NULL) {
+    fprintf(TraceFile, "\n]}\n");
+    fclose(TraceFile);
+    TraceFile = NULL;
+  }
+
+  if (ParallelRank() != 0)
+    return;
+
+  if (Total <= 0.0)
+    Total = 1.e-9;
+
+  fprintf(Out, "%-20s %12s %8s %10s %12s %14s\n", "Phase", "Seconds",
+	  "Percent", "Calls", "ms/call", "cell steps/s");
+  Timed = 0.0;
+  for (i = 0; i < NTIMERS; i++) {
+    if (TimerCalls[i] == 0)
+      continue;
+    fprintf(Out, "%-20s %12.3f %8.1f %10ld %12.3f", TimerName[i],
+	    TimerTotal[i], 100. * TimerTotal[i] / Total, TimerCalls[i],
+	    1.e3 * TimerTotal[i] / TimerCalls[i]);
+    if (i >= TIMER_NEWSTEP && TimerTotal[i] > 0.0)
+      fprintf(Out, " %14.4g", (double) NCells * TimerCalls[i] / TimerTotal[i]);
+    fprintf(Out, "\n");
+    Timed += TimerTotal[i];
+  }
+  fprintf(Out, "%-20s %12.3f %8.1f\n", "Other", Total - Timed,
+	  100. * (Total - Timed) / Total);
+  fprintf(Out, "%-20s %12.3f %8.1f\n", "Total", Total, 100.);
+  if (NSteps > 0)
+    fprintf(Out, "%ld time steps, %.3f ms per time step, %d cells, "
+	    "%.4g cell steps/s\n", NSteps, 1.e3 * StepTotal / NSteps, NCells,
+	    StepTotal > 0.0 ? (double) NCells * NSteps / StepTotal : 0.0);
+}
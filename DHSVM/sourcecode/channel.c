@@ -21,11 +21,19 @@ $Id: channel.c,v3.1.2 2014/1/2 Ning Exp $
 #include "constants.h"
 #include "tableio.h"
 #include "settings.h"
+#include "fileio.h"
 
 /* for test msw */
+#ifdef TEST_CHANNEL
+#define TEST_MAIN 1
+#else
 #define TEST_MAIN 0
+#endif
 /* end test */
 
+/* smallest number of segments in a level worth routing on threads */
+#define CHANNEL_PARALLEL_MIN 64
+
 /* -------------------------------------------------------------
 -------------- ChannelClass Functions -----------------------
 ------------------------------------------------------------- */
@@ -298,6 +306,88 @@ Channel *channel_find_segment(Channel * head, SegmentID id)
   return head;
 }
 
+/* -------------------------------------------------------------
+channel_index_network
+Builds a table of the segments of a network by id.  Each id may
+be used only once; duplicates are reported and no table is built.
+------------------------------------------------------------- */
+ChannelIndex *channel_index_network(Channel *net)
+{
+  ChannelIndex *index;
+  Channel *current;
+  int err = 0;
+
+  if ((index = (ChannelIndex *) malloc(sizeof(ChannelIndex))) == NULL) {
+    error_handler(ERRHDL_ERROR, "channel_index_network: malloc failed: %s",
+      strerror(errno));
+    return NULL;
+  }
+
+  index->maxid = 0;
+  for (current = net; current != NULL; current = current->next) {
+    if (current->id > index->maxid)
+      index->maxid = current->id;
+  }
+
+  if ((index->seg = (Channel **) calloc(index->maxid + 1, sizeof(Channel *))) 
+      == NULL) {
+    error_handler(ERRHDL_ERROR, "channel_index_network: calloc failed: %s",
+      strerror(errno));
+    free(index);
+    return NULL;
+  }
+
+  for (current = net; current != NULL; current = current->next) {
+    if (index->seg[current->id] != NULL) {
+      error_handler(ERRHDL_ERROR,
+        "channel_index_network: segment id %d used more than once",
+        current->id);
+      err++;
+    }
+    else
+      index->seg[current->id] = current;
+  }
+
+  if (err) {
+    channel_free_index(index);
+    return NULL;
+  }
+
+  return index;
+}
+
+/* -------------------------------------------------------------
+channel_index_find
+Looks up a segment by id in a ChannelIndex
+------------------------------------------------------------- */
+Channel *channel_index_find(ChannelIndex *index, SegmentID id)
+{
+  Channel *seg = NULL;
+
+  if ((int) id <= index->maxid)
+    seg = index->seg[id];
+  if (seg == NULL) {
+    error_handler(ERRHDL_WARNING,
+      "channel_index_find: unable to find segment %d", id);
+  }
+  else {
+    error_handler(ERRHDL_DEBUG, "channel_index_find: found segment %d", id);
+  }
+
+  return seg;
+}
+
+/* -------------------------------------------------------------
+channel_free_index
+------------------------------------------------------------- */
+void channel_free_index(ChannelIndex *index)
+{
+  if (index == NULL)
+    return;
+  free(index->seg);
+  free(index);
+}
+
 /* -------------------------------------------------------------
 channel_routing_parameters
 ------------------------------------------------------------- */
@@ -324,6 +414,7 @@ channel_read_network
 Channel *channel_read_network(const char *file, ChannelClass *class_list, int *MaxID)
 {
   Channel *head = NULL, *current = NULL;
+  ChannelIndex *index = NULL;
   int err = 0;
   int done;
   static const int fields = 8;
@@ -455,11 +546,15 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
   /* find segment outlet segments, if
   specified */
 
-  for (current = head; current != NULL; current = current->next) {
+  if ((index = channel_index_network(head)) == NULL)
+    err++;
+
+  for (current = head; current != NULL && index != NULL; 
+       current = current->next) {
     int outid = (int) current->outlet;
 
     if (outid != 0) {
-      current->outlet = channel_find_segment(head, outid);
+      current->outlet = channel_index_find(index, outid);
       if (current->outlet == NULL) {
         error_handler(ERRHDL_ERROR,
           "%s: cannot find outlet (%d) for segment %d",
@@ -468,6 +563,7 @@ Channel *channel_read_network(const char *file, ChannelClass *class_list, int *M
       }
     }
   }
+  channel_free_index(index);
 
   table_errors += err;
 
@@ -519,34 +615,211 @@ static int channel_route_segment(Channel * segment, int deltat)
   segment->outflow = outflow * deltat;
   segment->storage = storage;
 
-  if (segment->outlet != NULL)
-    segment->outlet->inflow += segment->outflow;
+  return (err);
+}
+
+/* -------------------------------------------------------------
+channel_schedule_network
+Builds the routing schedule for a network.  Segments are routed
+in order of increasing order number, starting at 1 and stopping at
+the first order that has no segments.  Segments of one order may
+drain to a segment of the same order further down the network list,
+in which case the downstream segment goes to a later level.  Within
+a level, segments keep the order in which they appear in the network.
+------------------------------------------------------------- */
+ChannelSchedule *channel_schedule_network(Channel *net)
+{
+  ChannelSchedule *sched;
+  Channel *current;
+  int i, l, o;
+  int maxid;
+  int maxorder;
+  int norder;
+  int *index;			/* segment index by id */
+  int *wave;			/* level of each segment within its order */
+  int *nwave;			/* number of levels in each order */
+  int *next;			/* next free entry in level_seg for each level */
+
+  if ((sched = (ChannelSchedule *) malloc(sizeof(ChannelSchedule))) == NULL) {
+    error_handler(ERRHDL_ERROR, "channel_schedule_network: malloc failed: %s",
+      strerror(errno));
+    return NULL;
+  }
+
+  sched->nseg = 0;
+  sched->level_start = NULL;
+  sched->routed = NULL;
+  maxorder = 0;
+  maxid = 0;
+  for (current = net; current != NULL; current = current->next) {
+    sched->nseg++;
+    if ((int) current->order > maxorder)
+      maxorder = current->order;
+    if (current->id > maxid)
+      maxid = current->id;
+  }
+
+  sched->seg = (Channel **) calloc(sched->nseg + 1, sizeof(Channel *));
+  sched->outlet = (int *) calloc(sched->nseg + 1, sizeof(int));
+  sched->level_seg = (int *) calloc(sched->nseg + 1, sizeof(int));
+  index = (int *) calloc(maxid + 1, sizeof(int));
+  wave = (int *) calloc(sched->nseg + 1, sizeof(int));
+  nwave = (int *) calloc(maxorder + 2, sizeof(int));
+  if (sched->seg == NULL || sched->outlet == NULL || sched->level_seg == NULL ||
+      index == NULL || wave == NULL || nwave == NULL) {
+    error_handler(ERRHDL_ERROR, "channel_schedule_network: calloc failed: %s",
+      strerror(errno));
+    free(index);
+    free(wave);
+    free(nwave);
+    channel_free_schedule(sched);
+    return NULL;
+  }
+
+  for (i = 0, current = net; current != NULL; current = current->next, i++)
+    sched->seg[i] = current;
+
+  /* outlets as indices, looked up by segment id */
+  for (i = sched->nseg - 1; i >= 0; i--)
+    index[sched->seg[i]->id] = i;
+  for (i = 0; i < sched->nseg; i++) {
+    if (sched->seg[i]->outlet != NULL)
+      sched->outlet[i] = index[sched->seg[i]->outlet->id];
+    else
+      sched->outlet[i] = -1;
+  }
+  free(index);
+
+  /* a segment that drains to a segment of the same order further down
+     the list has to be routed first */
+  for (i = 0; i < sched->nseg; i++) {
+    o = sched->outlet[i];
+    if (o > i && sched->seg[o]->order == sched->seg[i]->order &&
+        wave[o] < wave[i] + 1)
+      wave[o] = wave[i] + 1;
+    if (wave[i] + 1 > nwave[sched->seg[i]->order])
+      nwave[sched->seg[i]->order] = wave[i] + 1;
+  }
+
+  /* only the orders up to the first empty one are routed */
+  for (norder = 0; norder < maxorder; norder++) {
+    if (nwave[norder + 1] == 0)
+      break;
+  }
+  if (norder < maxorder) {
+    error_handler(ERRHDL_WARNING,
+      "channel_schedule_network: no segments of order %d, "
+      "higher orders are not routed", norder + 1);
+  }
+
+  /* nwave becomes the first level of each order */
+  sched->nlevel = 0;
+  for (l = 1; l <= norder; l++) {
+    o = nwave[l];
+    nwave[l] = sched->nlevel;
+    sched->nlevel += o;
+  }
+
+  sched->level_start = (int *) calloc(sched->nlevel + 1, sizeof(int));
+  next = (int *) calloc(sched->nlevel + 1, sizeof(int));
+  if (sched->level_start == NULL || next == NULL) {
+    error_handler(ERRHDL_ERROR, "channel_schedule_network: calloc failed: %s",
+      strerror(errno));
+    free(next);
+    free(nwave);
+    free(wave);
+    channel_free_schedule(sched);
+    return NULL;
+  }
+
+  for (i = 0; i < sched->nseg; i++) {
+    if ((int) sched->seg[i]->order <= norder)
+      next[nwave[sched->seg[i]->order] + wave[i]]++;
+  }
+  sched->level_start[0] = 0;
+  for (l = 0; l < sched->nlevel; l++) {
+    sched->level_start[l + 1] = sched->level_start[l] + next[l];
+    next[l] = sched->level_start[l];
+  }
+  for (i = 0; i < sched->nseg; i++) {
+    if ((int) sched->seg[i]->order <= norder)
+      sched->level_seg[next[nwave[sched->seg[i]->order] + wave[i]]++] = i;
+  }
+
+  free(next);
+  free(nwave);
+  free(wave);
+  return sched;
+}
+
+/* -------------------------------------------------------------
+channel_free_schedule
+------------------------------------------------------------- */
+void channel_free_schedule(ChannelSchedule *sched)
+{
+  if (sched == NULL)
+    return;
+  free(sched->seg);
+  free(sched->outlet);
+  free(sched->level_seg);
+  free(sched->level_start);
+  free(sched->routed);
+  free(sched);
+}
+
+/* -------------------------------------------------------------
+channel_route_level
+Routes the segments of level l in parallel.  If the schedule has a
+list of routed segments, the other segments are left alone.
+------------------------------------------------------------- */
+int channel_route_level(ChannelSchedule *sched, int l, int deltat)
+{
+  int i, n;
+  int err = 0;
 
+#pragma omp parallel for private(n) reduction(+:err) \
+  if (sched->level_start[l + 1] - sched->level_start[l] >= CHANNEL_PARALLEL_MIN)
+  for (i = sched->level_start[l]; i < sched->level_start[l + 1]; i++) {
+    n = sched->level_seg[i];
+    if (sched->routed == NULL || sched->routed[n])
+      err += channel_route_segment(sched->seg[n], deltat);
+  }
   return (err);
 }
 
+/* -------------------------------------------------------------
+channel_pass_outflow
+Adds the outflow of the segments of level l to the inflow of their
+outlets, in network order, so the inflow of a segment does not
+depend on the number of threads.  If the schedule has a list of
+routed segments, only the inflow of those is changed.
+------------------------------------------------------------- */
+void channel_pass_outflow(ChannelSchedule *sched, int l)
+{
+  int i, n, o;
+
+  for (i = sched->level_start[l]; i < sched->level_start[l + 1]; i++) {
+    n = sched->level_seg[i];
+    o = sched->outlet[n];
+    if (o >= 0 && (sched->routed == NULL || sched->routed[o]))
+      sched->seg[o]->inflow += sched->seg[n]->outflow;
+  }
+}
+
 /* -------------------------------------------------------------
 channel_route_network
 ------------------------------------------------------------- */
-int channel_route_network(Channel * net, int deltat)
+int channel_route_network(ChannelSchedule *sched, int deltat)
 {
-  int order;
-  int order_count;
+  int l;
   int err = 0;
-  Channel *current;
 
-  for (order = 1;; order += 1) {
-    order_count = 0;
-    current = net;
-    while (current != NULL) {
-      if (current->order == order) {
-        err += channel_route_segment(current, deltat);
-        order_count += 1;
-      }
-      current = current->next;
-    }
-    if (order_count == 0)
-      break;
+  if (sched == NULL)
+    return (err);
+
+  for (l = 0; l < sched->nlevel; l++) {
+    err += channel_route_level(sched, l, deltat);
+    channel_pass_outflow(sched, l);
   }
   return (err);
 }
@@ -554,9 +827,16 @@ int channel_route_network(Channel * net, int deltat)
 /* -------------------------------------------------------------
 channel_step_initialize_network
 ------------------------------------------------------------- */
-int channel_step_initialize_network(Channel *net)
+int channel_step_initialize_network(ChannelSchedule *sched)
 {
-  if (net != NULL) {
+  Channel *net;
+  int i;
+
+  if (sched == NULL)
+    return (0);
+
+  for (i = 0; i < sched->nseg; i++) {
+    net = sched->seg[i];
     net->last_inflow = net->inflow;
     net->inflow = 0.0;
     net->lateral_inflow = 0.0;
@@ -578,8 +858,6 @@ int channel_step_initialize_network(Channel *net)
     net->azimuth = 0;
     net->skyview = 0;
     //net->Ncells = 0; /* not used for now */
-
-    channel_step_initialize_network(net->next);
   }
   return (0);
 }
@@ -611,20 +889,20 @@ int
   float total_error = 0.0;
 
   if (flag == 1) {
-    fprintf(out2, "DATE ");
+    OutPrintf(out2, "DATE ");
     for (; net != NULL; net = net->next) {
       total_lateral_inflow += net->lateral_inflow;
       if (net->outlet == NULL) {
         total_outflow += net->outflow;
       }
       if (net->record)
-        fprintf(out2, "%s ", net->record_name);
+        OutPrintf(out2, "%s ", net->record_name);
     }
-    fprintf(out2, "\n");
+    OutPrintf(out2, "\n");
   }
 
   //tsstring = date in the form of 01.01.1915-00:00:00 
-  if (fprintf(out2, "%15s ", tstring) == EOF) {
+  if (OutPrintf(out2, "%15s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,
       "channel_save_outflow: write error:%s", strerror(errno));
     err++;
@@ -639,20 +917,20 @@ int
     total_storage_change += net->storage - net->last_storage;
 
     if (net->record) {
-      if (fprintf(out, "%15s %10d %12.5g %12.5g %12.5g %12.5g",
+      if (OutPrintf(out, "%15s %10d %12.5g %12.5g %12.5g %12.5g",
         tstring, net->id, net->inflow, net->lateral_inflow,
         net->outflow, net->storage - net->last_storage) == EOF) {
           error_handler(ERRHDL_ERROR,
             "channel_save_outflow: write error:%s", strerror(errno));
           err++;
       }
-      if (fprintf(out2, "%12.5g ", net->outflow) == EOF) {
+      if (OutPrintf(out2, "%12.5g ", net->outflow) == EOF) {
         error_handler(ERRHDL_ERROR,
           "channel_save_outflow: write error:%s", strerror(errno));
         err++;
       }
       if (net->record_name != NULL) {
-        if (fprintf(out, "   \"%s\"\n", net->record_name) == EOF) {
+        if (OutPrintf(out, "   \"%s\"\n", net->record_name) == EOF) {
           error_handler(ERRHDL_ERROR,
             "channel_save_outflow: write error:%s",
             strerror(errno));
@@ -661,7 +939,7 @@ int
 
       }
       else {
-        if (fprintf(out, "\n") == EOF) {
+        if (OutPrintf(out, "\n") == EOF) {
           error_handler(ERRHDL_ERROR,
             "channel_save_outflow: write error:%s",
             strerror(errno));
@@ -671,7 +949,7 @@ int
     }
   }
   total_error = total_storage_change - total_lateral_inflow + total_outflow;
-  if (fprintf(out, "%15s %10d %12.5g %12.5g %12.5g %12.5g %12.5g \"Totals\"\n",
+  if (OutPrintf(out, "%15s %10d %12.5g %12.5g %12.5g %12.5g %12.5g \"Totals\"\n",
     tstring, 0, total_lateral_inflow,
     total_outflow, total_storage,
     total_storage_change, total_error) == EOF) {
@@ -679,7 +957,7 @@ int
         "channel_save_outflow: write error:%s", strerror(errno));
       err++;
   }
-  fprintf(out2, "\n");
+  OutPrintf(out2, "\n");
 
   return (err);
 }
@@ -715,6 +993,27 @@ void channel_done(void)
 
 #if TEST_MAIN
 
+#include <stdarg.h>
+
+/* -------------------------------------------------------------
+OutPrintf
+The output queue (Output.c) is not part of the test, so the channel
+output is written straight to the file.  Output to a NULL file, such
+as the outflow-only table the driver does not ask for, is dropped.
+------------------------------------------------------------- */
+int OutPrintf(FILE *File, const char *Format, ...)
+{
+  va_list Args;
+  int n;
+
+  if (File == NULL)
+    return 0;
+  va_start(Args, Format);
+  n = vfprintf(File, Format, Args);
+  va_end(Args);
+  return n;
+}
+
 /* -------------------------------------------------------------
 interpolate
 ------------------------------------------------------------- */
@@ -732,8 +1031,124 @@ static float interpolate(int n, float *x, float *y, float x0)
   return ((x0 - x[i - 1]) / (x[i] - x[i - 1]) * (y[i] - y[i - 1]) + y[i]);
 }
 
+/* -------------------------------------------------------------
+tree_network
+Builds a binary tree of 2^depth - 1 segments in which segment i
+drains to segment i/2.  The segments are listed from the highest id
+down, so upstream segments come first.  The order of a segment is
+half its height in the tree, rounded up, so half of the segments
+drain to a segment of the same order.
+------------------------------------------------------------- */
+static Channel *tree_network(int depth, ChannelClass *class)
+{
+  Channel *head = NULL;
+  Channel **seg;
+  int nseg = (1 << depth) - 1;
+  int i, level;
+
+  if ((seg = (Channel **) calloc(nseg + 1, sizeof(Channel *))) == NULL)
+    return NULL;
+  for (i = 1; i <= nseg; i++) {
+    for (level = 0; (2 << level) <= i; level++);
+    seg[i] = alloc_channel_segment();
+    seg[i]->id = i;
+    seg[i]->order = (depth - level + 1) / 2;
+    seg[i]->length = 100.0 + (i % 7) * 50.0;
+    seg[i]->slope = 0.01 + (i % 5) * 0.01;
+    seg[i]->class2 = class;
+    seg[i]->next = head;
+    head = seg[i];
+  }
+  for (i = 2; i <= nseg; i++)
+    seg[i]->outlet = seg[i / 2];
+  free(seg);
+  return head;
+}
+
+/* -------------------------------------------------------------
+schedule_test
+Routes a tree network with channel_route_network() and, alongside,
+with the segment by segment loop the schedule replaces: each order in
+turn, segments in network order, outflow passed on right away.  In a
+binary tree no segment has more than two inflows, so the sums do not
+depend on the order of the terms and both must agree exactly.
+Returns the number of differences.
+------------------------------------------------------------- */
+static int schedule_test(int depth, int steps, int deltat)
+{
+  ChannelClass class;
+  Channel *net, *ref, *seg, *rseg;
+  ChannelSchedule *sched, *rsched;
+  int maxorder = (depth + 1) / 2;
+  int o, t;
+  int ndiff = 0;
+
+  class.id = 1;
+  class.width = 5.0;
+  class.bank_height = 1.0;
+  class.friction = 0.05;
+  class.infiltration = 0.0;
+  class.crown = CHAN_OUTSLOPED;
+  class.next = NULL;
+
+  net = tree_network(depth, &class);
+  ref = tree_network(depth, &class);
+  if (net == NULL || ref == NULL)
+    error_handler(ERRHDL_FATAL, "schedule_test: trouble building network");
+  channel_routing_parameters(net, deltat);
+  channel_routing_parameters(ref, deltat);
+  if ((sched = channel_schedule_network(net)) == NULL ||
+      (rsched = channel_schedule_network(ref)) == NULL)
+    error_handler(ERRHDL_FATAL, "schedule_test: trouble scheduling network");
+  if (sched->nlevel != depth)
+    error_handler(ERRHDL_FATAL, "schedule_test: %d levels, expected %d",
+      sched->nlevel, depth);
+
+  srand(1);
+  for (t = 0; t < steps; t++) {
+    channel_step_initialize_network(sched);
+    channel_step_initialize_network(rsched);
+    for (seg = net, rseg = ref; seg != NULL; seg = seg->next, rseg = rseg->next) {
+      float lateral = (float) (rand() % 1000) * deltat / 1000.0;
+      seg->lateral_inflow = lateral;
+      rseg->lateral_inflow = lateral;
+    }
+
+    channel_route_network(sched, deltat);
+    for (o = 1; o <= maxorder; o++) {
+      for (rseg = ref; rseg != NULL; rseg = rseg->next) {
+        if ((int) rseg->order != o)
+          continue;
+        channel_route_segment(rseg, deltat);
+        if (rseg->outlet != NULL)
+          rseg->outlet->inflow += rseg->outflow;
+      }
+    }
+
+    for (seg = net, rseg = ref; seg != NULL; seg = seg->next, rseg = rseg->next) {
+      if (seg->outflow != rseg->outflow || seg->storage != rseg->storage) {
+        if (ndiff++ < 10)
+          printf("step %d, segment %d: outflow %.9g, expected %.9g\n",
+                 t, seg->id, seg->outflow, rseg->outflow);
+      }
+    }
+  }
+
+  printf("schedule_test: %d segments, %d levels, %d steps, %d differences\n",
+         sched->nseg, sched->nlevel, steps, ndiff);
+
+  channel_free_schedule(sched);
+  channel_free_schedule(rsched);
+  channel_free_network(net);
+  channel_free_network(ref);
+  return ndiff;
+}
+
 /* -------------------------------------------------------------
 Main Program
+Checks the routing schedule on a tree network.  Given a class file
+and a network file, it also prints the hydrograph of that network for
+a flood wave entering its first segment.
 ------------------------------------------------------------- */
 int main(int argc, char **argv)
 {
@@ -744,23 +1159,36 @@ int main(int argc, char **argv)
   static float bndflow[TIMES] = { 0.0, 0.0, 300.0, 300.0, 0.0, 0.0 };
   static float bndtime[TIMES] = { 0.0, 12.0, 36.0, 48.0, 60.0, 1000.0 };
 
-  float time;
+  int maxid;
   ChannelClass *class;
   Channel *simple = NULL, *current, *tail;
+  ChannelSchedule *sched;
 
   error_handler_init(argv[0], NULL, ERRHDL_ERROR);
   channel_init();
 
+  /* the first four levels of the tree have 64 or more segments, enough
+     to be routed on threads */
+
+  if (schedule_test(10, 48, interval) != 0)
+    exit(1);
+
+  if (argc < 3) {
+    channel_done();
+    error_handler_done();
+    exit(0);
+  }
+
   /* read classes */
 
-  if ((class = channel_read_classes("example_classes.dat")) == NULL) {
-    error_handler(ERRHDL_FATAL, "example_classes.dat: trouble reading file");
+  if ((class = channel_read_classes(argv[1], stream_class)) == NULL) {
+    error_handler(ERRHDL_FATAL, "%s: trouble reading file", argv[1]);
   }
 
   /* read a network */
 
-  if ((simple = channel_read_network("example_network.dat", class)) == NULL) {
-    error_handler(ERRHDL_FATAL, "example_network.dat: trouble reading file");
+  if ((simple = channel_read_network(argv[2], class, &maxid)) == NULL) {
+    error_handler(ERRHDL_FATAL, "%s: trouble reading file", argv[2]);
   }
 
   /* initialize flows */
@@ -771,6 +1199,13 @@ int main(int argc, char **argv)
     current->outlet = current->next;
     tail = current;
   }
+  channel_routing_parameters(simple, interval);
+
+  /* the segments drain to the next one, route them in that order */
+
+  if ((sched = channel_schedule_network(simple)) == NULL) {
+    error_handler(ERRHDL_FATAL, "%s: trouble scheduling network", argv[2]);
+  }
 
   /* time loop */
 
@@ -778,13 +1213,14 @@ int main(int argc, char **argv)
     float inflow = interpolate(TIMES, bndtime, bndflow, timestep) * interval;
     float outflow;
 
-    channel_step_initialize_network(simple);
+    channel_step_initialize_network(sched);
     simple->inflow = inflow;
-    (void) channel_route_network(simple, interval);
+    (void) channel_route_network(sched, interval);
     outflow = tail->outflow / interval;
-    channel_save_outflow(timestep * interval, simple, stdout);
+    channel_save_outflow(timestep * interval, simple, stdout, NULL);
   }
 
+  channel_free_schedule(sched);
   channel_free_network(simple);
   channel_free_classes(class);
   channel_done();
@@ -795,8 +1231,9 @@ int main(int argc, char **argv)
 
 /* -------------------------------------------------------------
 channel_read_rveg_param
+Each record is matched to the network segment with the same ID
 ------------------------------------------------------------- */
-int channel_read_rveg_param(Channel *head, const char *file, int *MaxID)
+int channel_read_rveg_param(ChannelIndex *index, const char *file, int *MaxID)
 {
   Channel *current = NULL;
   int err = 0;
@@ -847,26 +1284,22 @@ int channel_read_rveg_param(Channel *head, const char *file, int *MaxID)
         continue;
     }
 
+    current = NULL;
+    if (rveg_fields[0].read)
+      current = channel_index_find(index, rveg_fields[0].value.integer);
     if (current == NULL) {
-      current = head;
-    }
-    else {
-      current = current->next;
+      error_handler(ERRHDL_ERROR, "%s: segment %d: not in the stream network",
+        file, rveg_fields[0].value.integer);
+      err++;
+      continue;
     }
 
-
     for (i = 0; i < fields; i++) {
       if (rveg_fields[i].read) {
         switch (i) {
         case 0:
-          current->id = rveg_fields[i].value.integer;
           if (current->id > *MaxID) 
             *MaxID = current->id;
-          if (current->id <= 0) {
-            error_handler(ERRHDL_ERROR, "%s: segment %d: channel id invalid",
-              file, current->id);
-            err++;
-          }
           break;
         case 1:
           if (rveg_fields[i].value.real >= 0) {
@@ -1056,8 +1489,6 @@ int channel_read_rveg_param(Channel *head, const char *file, int *MaxID)
   if (table_errors) {
     error_handler(ERRHDL_ERROR,
       "channel_read_rveg_param: %s: too many errors", file);
-    channel_free_network(current);
-    current = NULL;
   }
 
   return (err);
@@ -99,6 +99,36 @@ struct _channel_rec_ {
 };
 typedef struct _channel_rec_ Channel, *ChannelPtr;
 
+/* -------------------------------------------------------------
+   struct ChannelIndex
+   Direct-address table of the segments of a network by SegmentID
+   ------------------------------------------------------------- */
+typedef struct {
+  int maxid;			/* largest segment id in the network */
+  Channel **seg;		/* segment by id, NULL if there is none;
+				   maxid + 1 in size */
+} ChannelIndex;
+
+/* -------------------------------------------------------------
+   struct ChannelSchedule
+   The order in which the segments of a network are routed.  This is
+   built once, after the network is read.  Segments are referred to by
+   their index in the segment list (seg).  A level holds segments of
+   one order that do not drain to each other, so they can be routed
+   independently of each other.
+   ------------------------------------------------------------- */
+typedef struct {
+  int nseg;			/* number of segments */
+  Channel **seg;		/* segments, in network order */
+  int *outlet;			/* index of outlet segment, -1 if none */
+  int nlevel;			/* number of levels */
+  int *level_start;		/* first entry in level_seg for each level;
+				   nlevel + 1 in size */
+  int *level_seg;		/* segment indices grouped by level */
+  char *routed;			/* TRUE for each segment routed here, or
+				   NULL if all segments are routed */
+} ChannelSchedule;
+
 /* -------------------------------------------------------------
    externally available routines
    ------------------------------------------------------------- */
@@ -109,12 +139,19 @@ void channel_free_classes(ChannelClass *head);
 
 /* Channel */
 Channel *channel_read_network(const char *file, ChannelClass * class_list, int *MaxID);
-int channel_read_rveg_param(Channel *net, const char *file, int *MaxID);
+int channel_read_rveg_param(ChannelIndex *index, const char *file, int *MaxID);
 void channel_routing_parameters(Channel *net, int deltat);
 Channel *channel_find_segment(Channel *net, SegmentID id);
-int channel_step_initialize_network(Channel *net);
+ChannelIndex *channel_index_network(Channel *net);
+Channel *channel_index_find(ChannelIndex *index, SegmentID id);
+void channel_free_index(ChannelIndex *index);
+ChannelSchedule *channel_schedule_network(Channel *net);
+void channel_free_schedule(ChannelSchedule *sched);
+int channel_step_initialize_network(ChannelSchedule *sched);
 int channel_incr_lat_inflow(Channel *segment, float linflow);
-int channel_route_network(Channel *net, int deltat);
+int channel_route_level(ChannelSchedule *sched, int l, int deltat);
+void channel_pass_outflow(ChannelSchedule *sched, int l);
+int channel_route_network(ChannelSchedule *sched, int deltat);
 int channel_save_outflow(double time, Channel * net, FILE *file, FILE *file2);
 int channel_save_outflow_text(char *tstring, Channel *net, FILE *out,
 			      FILE *out2, int flag);
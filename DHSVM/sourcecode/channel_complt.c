@@ -25,6 +25,7 @@
 #include "constants.h"
 #include "tableio.h"
 #include "settings.h"
+#include "fileio.h"
 
 /* -------------------------------------------------------------
    ---------------------- Channel Functions --------------------
@@ -40,6 +41,7 @@ channel_save_outflow_text_cplmt
 {
   int err = 0;
   int Dt;
+  char RBMStart[BUFSIZE + 1];
   FILE * out, *out2, *out9, *out10, *out11, *out13, *out14, *out15;
 
   Dt = Time->Dt;
@@ -56,76 +58,77 @@ channel_save_outflow_text_cplmt
   /* print the start date and end date. Note that the true start date is a time step behind the 
   user specified date when the model outputs data */
   if (flag == 1) {
-    PrintRBMStartDate(Dt, &(Time->Current), out);
-    fprintf(out, " ");
-    PrintDate(&(Time->End), out);
-    fprintf(out, " %d", Dt/3600);
-    fprintf(out, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out2);
-    fprintf(out2, " ");
-    PrintDate(&(Time->End), out2);
-    fprintf(out2, " %d", Dt/3600);
-    fprintf(out2, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out9);
-    fprintf(out9, " ");
-    PrintDate(&(Time->End), out9);
-    fprintf(out9, " %d", Dt/3600);
-    fprintf(out9, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out10);
-    fprintf(out10, " ");
-    PrintDate(&(Time->End), out10);
-    fprintf(out10, " %d", Dt/3600);
-    fprintf(out10, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out11);
-    fprintf(out11, " ");
-    PrintDate(&(Time->End), out11);
-    fprintf(out11, " %d", Dt/3600);
-    fprintf(out11, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out13);
-    fprintf(out13, " ");
-    PrintDate(&(Time->End), out13);
-    fprintf(out13, " %d", Dt/3600);
-    fprintf(out13, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out14);
-    fprintf(out14, " ");
-    PrintDate(&(Time->End), out14);
-    fprintf(out14, " %d", Dt/3600);
-    fprintf(out14, "\n");
-    PrintRBMStartDate(Dt, &(Time->Current), out15);
-    fprintf(out15, " ");
-    PrintDate(&(Time->End), out15);
-    fprintf(out15, " %d", Dt / 3600);
-    fprintf(out15, "\n");                       
+    SPrintRBMStartDate(Dt, &(Time->Current), RBMStart);
+    OutPrintf(out, "%s", RBMStart);
+    OutPrintf(out, " ");
+    OutPrintDate(&(Time->End), out);
+    OutPrintf(out, " %d", Dt/3600);
+    OutPrintf(out, "\n");
+    OutPrintf(out2, "%s", RBMStart);
+    OutPrintf(out2, " ");
+    OutPrintDate(&(Time->End), out2);
+    OutPrintf(out2, " %d", Dt/3600);
+    OutPrintf(out2, "\n");
+    OutPrintf(out9, "%s", RBMStart);
+    OutPrintf(out9, " ");
+    OutPrintDate(&(Time->End), out9);
+    OutPrintf(out9, " %d", Dt/3600);
+    OutPrintf(out9, "\n");
+    OutPrintf(out10, "%s", RBMStart);
+    OutPrintf(out10, " ");
+    OutPrintDate(&(Time->End), out10);
+    OutPrintf(out10, " %d", Dt/3600);
+    OutPrintf(out10, "\n");
+    OutPrintf(out11, "%s", RBMStart);
+    OutPrintf(out11, " ");
+    OutPrintDate(&(Time->End), out11);
+    OutPrintf(out11, " %d", Dt/3600);
+    OutPrintf(out11, "\n");
+    OutPrintf(out13, "%s", RBMStart);
+    OutPrintf(out13, " ");
+    OutPrintDate(&(Time->End), out13);
+    OutPrintf(out13, " %d", Dt/3600);
+    OutPrintf(out13, "\n");
+    OutPrintf(out14, "%s", RBMStart);
+    OutPrintf(out14, " ");
+    OutPrintDate(&(Time->End), out14);
+    OutPrintf(out14, " %d", Dt/3600);
+    OutPrintf(out14, "\n");
+    OutPrintf(out15, "%s", RBMStart);
+    OutPrintf(out15, " ");
+    OutPrintDate(&(Time->End), out15);
+    OutPrintf(out15, " %d", Dt / 3600);
+    OutPrintf(out15, "\n");                       
   }
 
   if (flag == 1) {
-    fprintf(out, "Date ");
-    fprintf(out2, "Date ");
-    fprintf(out9, "Date ");
-    fprintf(out10, "Date ");
-    fprintf(out11, "Date ");
-    fprintf(out13, "Date ");
-    fprintf(out14, "Date ");
-    fprintf(out15, "Date ");                                       
+    OutPrintf(out, "Date ");
+    OutPrintf(out2, "Date ");
+    OutPrintf(out9, "Date ");
+    OutPrintf(out10, "Date ");
+    OutPrintf(out11, "Date ");
+    OutPrintf(out13, "Date ");
+    OutPrintf(out14, "Date ");
+    OutPrintf(out15, "Date ");                                       
 
     for (; net != NULL; net = net->next) {
-	    fprintf(out, "%d ", net->id);
-      fprintf(out2, "%d ", net->id);
-      fprintf(out9, "%d ", net->id);
-      fprintf(out10, "%d ", net->id);
-      fprintf(out11, "%d ", net->id);
-      fprintf(out13, "%d ", net->id);
-      fprintf(out14, "%d ", net->id);
-      fprintf(out15, "%d ", net->id);                                  
+	    OutPrintf(out, "%d ", net->id);
+      OutPrintf(out2, "%d ", net->id);
+      OutPrintf(out9, "%d ", net->id);
+      OutPrintf(out10, "%d ", net->id);
+      OutPrintf(out11, "%d ", net->id);
+      OutPrintf(out13, "%d ", net->id);
+      OutPrintf(out14, "%d ", net->id);
+      OutPrintf(out15, "%d ", net->id);                                  
     }
-    fprintf(out, "\n");
-    fprintf(out2, "\n");
-    fprintf(out9, "\n");
-    fprintf(out10, "\n");
-    fprintf(out11, "\n");
-    fprintf(out13, "\n");
-    fprintf(out14, "\n");
-    fprintf(out15, "\n");                         
+    OutPrintf(out, "\n");
+    OutPrintf(out2, "\n");
+    OutPrintf(out9, "\n");
+    OutPrintf(out10, "\n");
+    OutPrintf(out11, "\n");
+    OutPrintf(out13, "\n");
+    OutPrintf(out14, "\n");
+    OutPrintf(out15, "\n");                         
   }
 
   Time->Current.JDay = DayOfYear(Time->Current.Year, Time->Current.Month, Time->Current.Day);
@@ -133,81 +136,81 @@ channel_save_outflow_text_cplmt
 
   if ((Time->Current.JDay>=Time->Start.JDay+1) || 
 	  (Time->Current.Year>Time->Start.Year)) {
-  if (fprintf(out, "%s ", tstring) == EOF) {
+  if (OutPrintf(out, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_outflow: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out2, "%s ", tstring) == EOF) {
+  if (OutPrintf(out2, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_inflow: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out9, "%s ", tstring) == EOF) {
+  if (OutPrintf(out9, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_ActualVaporPressure: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out10, "%s ", tstring) == EOF) {
+  if (OutPrintf(out10, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_Wind: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out11, "%s ", tstring) == EOF) {
+  if (OutPrintf(out11, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_AirTemp: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out13, "%s ", tstring) == EOF) {
+  if (OutPrintf(out13, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_NetLW: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out14, "%s ", tstring) == EOF) {
+  if (OutPrintf(out14, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR,"channel_save_NetSW: write error:%s", strerror(errno));
     err++;
   }
-  if (fprintf(out15, "%s ", tstring) == EOF) {
+  if (OutPrintf(out15, "%s ", tstring) == EOF) {
     error_handler(ERRHDL_ERROR, "channel_save_NetSW: write error:%s", strerror(errno));
     err++;
   }                                                
 
   for (; net != NULL; net = net->next) {
-    if (fprintf(out, "%.6f ", net->outflow/Dt) == EOF) {
+    if (OutPrintf(out, "%.6f ", net->outflow/Dt) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_outflow: write error:%s", strerror(errno));
       err++;
     }
-    if (fprintf(out2, "%.6f ", net->inflow/Dt) == EOF) {
+    if (OutPrintf(out2, "%.6f ", net->inflow/Dt) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_inflow: write error:%s", strerror(errno));
       err++;
     }
-    if (fprintf(out9, "%.2f ", net->VP ) == EOF) {
+    if (OutPrintf(out9, "%.2f ", net->VP ) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_ActualVaporPressure: write error:%s", strerror(errno));
       err++;
     }
-    if (fprintf(out10, "%.2f ", net->WND ) == EOF) {
+    if (OutPrintf(out10, "%.2f ", net->WND ) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_Wind: write error:%s", strerror(errno));
       err++;
     }
-    if (fprintf(out11, "%.2f ", net->ATP ) == EOF) {
+    if (OutPrintf(out11, "%.2f ", net->ATP ) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_AirTemp: write error:%s", strerror(errno));
       err++;
     }
-	  if (fprintf(out13, "%.2f ", net->NLW) == EOF) {
+	  if (OutPrintf(out13, "%.2f ", net->NLW) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_NetLW: write error:%s", strerror(errno));
       err++;
     }
-	  if (fprintf(out14, "%.2f ", net->NSW) == EOF) {
+	  if (OutPrintf(out14, "%.2f ", net->NSW) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_NetSW: write error:%s", strerror(errno));
       err++;
     }
-    if (fprintf(out15, "%.6f ", net->melt/Dt) == EOF) {
+    if (OutPrintf(out15, "%.6f ", net->melt/Dt) == EOF) {
       error_handler(ERRHDL_ERROR, "channel_save_Melt: write error:%s", strerror(errno));
       err++;
     }                                                       
   }
-  fprintf(out, "\n");
-  fprintf(out2, "\n");
-  fprintf(out9, "\n");
-  fprintf(out10, "\n");
-  fprintf(out11, "\n");
-  fprintf(out13, "\n");
-  fprintf(out14, "\n");
-  fprintf(out15, "\n");                       
+  OutPrintf(out, "\n");
+  OutPrintf(out2, "\n");
+  OutPrintf(out9, "\n");
+  OutPrintf(out10, "\n");
+  OutPrintf(out11, "\n");
+  OutPrintf(out13, "\n");
+  OutPrintf(out14, "\n");
+  OutPrintf(out15, "\n");                       
   }
 
   return (err);
@@ -26,12 +26,15 @@
 #include "data.h"
 #include "DHSVMChannel.h"
 #include "constants.h"
+#include "functions.h"
 
 /* -------------------------------------------------------------
    local function prototype
    ------------------------------------------------------------- */
 static ChannelMapRec *alloc_channel_map_record(void);
 static ChannelMapPtr **channel_grid_create_map(int cols, int rows);
+static ChannelIncrement *channel_grid_log_increment(ChannelMapPtr **map,
+						    Channel *channel, int kind);
 Channel *Find_First_Segment(ChannelMapPtr **map, int col, int row, float SlopeAspect, 
 			    char *Continue);
 char channel_grid_has_intersection(ChannelMapPtr **map, int Currid, int Nextid, int row, 
@@ -42,8 +45,16 @@ char channel_grid_has_intersection(ChannelMapPtr **map, int Currid, int Nextid,
    ------------------------------------------------------------- */
 static int channel_grid_cols = 0;
 static int channel_grid_rows = 0;
+static int channel_grid_first_row = 0;	/* first row of the map in the files */
+static int channel_grid_total_rows = 0;	/* rows in the files */
 static char channel_grid_initialized = FALSE;
 
+				/* increments kept while deferred */
+static char channel_grid_deferring = FALSE;
+static ChannelIncrement *channel_grid_log = NULL;
+static int channel_grid_nlog = 0;
+static int channel_grid_maxlog = 0;
+
 
 /* -------------------------------------------------------------
    Find_First_Segment
@@ -174,8 +185,8 @@ void channel_grid_free_map(ChannelMapPtr ** map)
 /* -------------------------------------------------------------
    channel_grid_read_map
    ------------------------------------------------------------- */
-ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
-				      SOILPIX ** SoilMap)
+ChannelMapPtr **channel_grid_read_map(ChannelIndex *index, const char *file,
+				      float *SoilDepth)
 {
   ChannelMapPtr **map;
   static const int fields = 8;
@@ -242,11 +253,11 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
     }
     if (map_fields[1].read) {
       if (map_fields[1].value.integer < 0 ||
-	  map_fields[1].value.integer >= channel_grid_rows) {
+	  map_fields[1].value.integer >= channel_grid_total_rows) {
 	rec_err++;
       }
       else {
-	row = map_fields[1].value.integer;
+	row = map_fields[1].value.integer - channel_grid_first_row;
       }
     }
     else {
@@ -260,6 +271,10 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
       continue;
     }
 
+    /* cells outside the rows of the map are left to other processes */
+    if (row < 0 || row >= channel_grid_rows)
+      continue;
+
     if (map[col][row] != NULL) {
       cell = map[col][row];
       while (cell->next != NULL)
@@ -277,8 +292,8 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 	switch (i) {
 	case 2:
 	  if ((cell->channel =
-	       channel_find_segment(net,
-				    map_fields[i].value.integer)) == NULL) {
+	       channel_index_find(index,
+				  map_fields[i].value.integer)) == NULL) {
 	    error_handler(ERRHDL_ERROR,
 			  "%s, line %d: unable to locate segment %d", file,
 			  table_lineno(), map_fields[i].value.integer);
@@ -295,12 +310,12 @@ ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
 	  break;
 	case 4:
 	  cell->cut_height = map_fields[i].value.real;
-	  if (cell->cut_height > SoilMap[row][col].Depth) {
+	  if (cell->cut_height > SoilDepth[row * channel_grid_cols + col]) {
 	    printf("warning overriding cut depths with 0.95 soil depth \n");
-	    cell->cut_height = SoilMap[row][col].Depth*0.95;
+	    cell->cut_height = SoilDepth[row * channel_grid_cols + col]*0.95;
 	  }
 	  if (cell->cut_height < 0.0
-	      || cell->cut_height > SoilMap[row][col].Depth) {
+	      || cell->cut_height > SoilDepth[row * channel_grid_cols + col]) {
 	    error_handler(ERRHDL_ERROR, "%s, line %d: bad cut_depth", file,
 			  table_lineno());
 	    err++;
@@ -510,7 +525,11 @@ void channel_grid_inc_inflow(ChannelMapPtr ** map, int col, int row, float mass)
    */
 
   while (cell != NULL) {
-    cell->channel->lateral_inflow += mass * cell->length / len;
+    if (channel_grid_deferring)
+      channel_grid_log_increment(map, cell->channel, CHANNEL_INC_INFLOW)->value[0] =
+	mass * cell->length / len;
+    else
+      cell->channel->lateral_inflow += mass * cell->length / len;
     cell = cell->next;
   }
 }
@@ -535,8 +554,12 @@ void channel_grid_inc_melt(ChannelMapPtr ** map, int col, int row, float mass)
   */
 
   while (cell != NULL) {
-	cell->channel->melt += mass * cell->length / len;
-	cell = cell->next;
+    if (channel_grid_deferring)
+      channel_grid_log_increment(map, cell->channel, CHANNEL_INC_MELT)->value[0] =
+	mass * cell->length / len;
+    else
+      cell->channel->melt += mass * cell->length / len;
+    cell = cell->next;
   }
 }
 /* -------------------------------------------------------------
@@ -649,11 +672,16 @@ ChannelClass* channel_grid_class(ChannelMapPtr ** map, int col, int row)
 
 /* -------------------------------------------------------------
    channel_grid_init
+   The map has rows first_row to first_row + rows - 1 of the
+   total_rows rows in the map files.  Records of cells in other rows
+   are skipped when the maps are read.
    ------------------------------------------------------------- */
-void channel_grid_init(int cols, int rows)
+void channel_grid_init(int cols, int rows, int first_row, int total_rows)
 {
   channel_grid_cols = cols;
   channel_grid_rows = rows;
+  channel_grid_first_row = first_row;
+  channel_grid_total_rows = total_rows;
   channel_grid_initialized = 1;
 }
 
@@ -665,6 +693,100 @@ void channel_grid_done(void)
   /* ? */
 }
 
+/* -------------------------------------------------------------
+   channel_grid_defer
+   While increments are deferred, channel_grid_inc_inflow(),
+   channel_grid_inc_melt() and channel_grid_inc_other() only record
+   the increments, in the order in which they are made, once for
+   each segment in the cell.  The recorded increments are applied
+   later with channel_grid_apply().  This is used when the grid is
+   split over several processes: the increments to a segment are
+   applied by the process that routes it, in the order in which they
+   are made on one process.
+   ------------------------------------------------------------- */
+void channel_grid_defer(int defer)
+{
+  channel_grid_deferring = defer;
+}
+
+/* -------------------------------------------------------------
+   channel_grid_log_increment
+   ------------------------------------------------------------- */
+static ChannelIncrement *channel_grid_log_increment(ChannelMapPtr ** map,
+						    Channel *channel, int kind)
+{
+  ChannelIncrement *inc;
+
+  if (channel_grid_nlog >= channel_grid_maxlog) {
+    channel_grid_maxlog = (channel_grid_maxlog > 0) ? 2 * channel_grid_maxlog : 1024;
+    channel_grid_log = (ChannelIncrement *)
+      realloc(channel_grid_log, channel_grid_maxlog * sizeof(ChannelIncrement));
+    if (channel_grid_log == NULL) {
+      error_handler(ERRHDL_FATAL, "channel_grid_log_increment: %s",
+		    strerror(errno));
+    }
+  }
+  inc = &(channel_grid_log[channel_grid_nlog++]);
+  memset(inc, 0, sizeof(ChannelIncrement));
+  inc->map = map;
+  inc->channel = channel;
+  inc->kind = kind;
+  return inc;
+}
+
+/* -------------------------------------------------------------
+   channel_grid_deferred
+   returns the increments recorded since they were last cleared
+   ------------------------------------------------------------- */
+ChannelIncrement *channel_grid_deferred(int *n)
+{
+  *n = channel_grid_nlog;
+  return channel_grid_log;
+}
+
+/* -------------------------------------------------------------
+   channel_grid_clear_deferred
+   ------------------------------------------------------------- */
+void channel_grid_clear_deferred(void)
+{
+  channel_grid_nlog = 0;
+}
+
+/* -------------------------------------------------------------
+   channel_grid_apply
+   Applies a recorded increment, whether or not increments are
+   deferred
+   ------------------------------------------------------------- */
+void channel_grid_apply(ChannelIncrement *inc)
+{
+  Channel *channel = inc->channel;
+
+  switch (inc->kind) {
+  case CHANNEL_INC_INFLOW:
+    channel->lateral_inflow += inc->value[0];
+    break;
+  case CHANNEL_INC_MELT:
+    channel->melt += inc->value[0];
+    break;
+  case CHANNEL_INC_OTHER:
+    channel->ISW += inc->value[0];
+    channel->NSW += inc->value[1];
+    channel->Beam += inc->value[2];
+    channel->Diffuse += inc->value[3];
+    channel->ILW += inc->value[4];
+    channel->NLW += inc->value[5];
+    channel->VP += inc->value[6];
+    channel->WND += inc->value[7];
+    channel->ATP += inc->value[8];
+    channel->azimuth += inc->value[9];
+    channel->skyview += inc->value[10];
+    break;
+  default:
+    error_handler(ERRHDL_FATAL, "channel_grid_apply: unknown increment %d",
+		  inc->kind);
+  }
+}
+
 #ifdef TEST_MAIN
 /* -------------------------------------------------------------
    interpolate
@@ -695,6 +817,8 @@ int main(int argc, char **argv)
 
   ChannelClass *class;
   Channel *simple = NULL, *current;
+  ChannelIndex *index = NULL;
+  ChannelSchedule *schedule = NULL;
   ChannelMapPtr **map = NULL;
 
   static int interval = 3600;	/* seconds */
@@ -709,7 +833,7 @@ int main(int argc, char **argv)
 
   error_handler_init(argv[0], NULL, ERRHDL_DEBUG);
   channel_init();
-  channel_grid_init(columns, rows);
+  channel_grid_init(columns, rows, 0, rows);
 
   /* read channel classes */
 
@@ -722,10 +846,12 @@ int main(int argc, char **argv)
   if ((simple = channel_read_network("example_network.dat", class)) == NULL) {
     error_handler(ERRHDL_FATAL, "example_network.dat: trouble reading file");
   }
+  index = channel_index_network(simple);
+  schedule = channel_schedule_network(simple);
 
   /* read channel map */
 
-  if ((map = channel_grid_read_map(simple, "example_map.dat")) == NULL) {
+  if ((map = channel_grid_read_map(index, "example_map.dat")) == NULL) {
     error_handler(ERRHDL_FATAL, "example_map.dat: trouble reading file");
   }
 
@@ -772,9 +898,9 @@ int main(int argc, char **argv)
     float inflow = interpolate(TIMES, bndtime, bndflow, time) * interval;
     float outflow;
 
-    channel_step_initialize_network(simple);
+    channel_step_initialize_network(schedule);
     channel_grid_inc_inflow(map, 2, 0, inflow);
-    (void) channel_route_network(simple, interval);
+    (void) channel_route_network(schedule, interval);
     outflow = channel_grid_outflow(map, 2, 6);
     channel_save_outflow(time * interval, simple, stdout);
     printf("outflow: %8.3g\n", outflow);
@@ -783,6 +909,8 @@ int main(int argc, char **argv)
   /* deallocate memory */
 
   channel_grid_free_map(map);
+  channel_free_schedule(schedule);
+  channel_free_index(index);
   channel_free_network(simple);
   channel_free_classes(class);
 
@@ -811,7 +939,23 @@ void channel_grid_inc_other(ChannelMapPtr ** map, int col, int row, PIXRAD * Loc
 							PIXMET * LocalMet, float skyview)
 {
   ChannelMapPtr cell = map[col][row];
-  float len = channel_grid_cell_length(map, col, row);
+  ChannelIncrement *inc;
+
+  while (cell != NULL && channel_grid_deferring) {
+    inc = channel_grid_log_increment(map, cell->channel, CHANNEL_INC_OTHER);
+    inc->value[0] = LocalRad->ObsShortIn;
+    inc->value[1] = LocalRad->RBMNetShort;
+    inc->value[2] = LocalRad->PixelBeam;
+    inc->value[3] = LocalRad->PixelDiffuse;
+    inc->value[4] = LocalRad->PixelLongIn;
+    inc->value[5] = LocalRad->RBMNetLong;
+    inc->value[6] = LocalMet->Eact;
+    inc->value[7] = LocalMet->Wind;
+    inc->value[8] = LocalMet->Tair;
+    inc->value[9] = cell->azimuth*cell->length /cell->channel->length;
+    inc->value[10] = skyview;
+    cell = cell->next;
+  }
 
   while (cell != NULL ) {
 	/* ISW is the total incoming shortwave radiation (VIC outputs) */
@@ -864,14 +1008,18 @@ void channel_grid_avg(Channel *Channel)
 /*********************************************************************************
 Init_segment_ncell : computes the number of grid cell contributing to one segment
 **********************************************************************************/
-void Init_segment_ncell(TOPOPIX **TopoMap, ChannelMapPtr ** map, int NY, 
-						int NX, Channel* net)
+void Init_segment_ncell(TOPOPIX **TopoMap, ChannelMapPtr ** map, MAPSIZE *Map,
+						Channel* net)
 {
   int y,x;
+  int i, n;
   ChannelMapPtr cell; 
+  Channel *seg;
+  double *Count;
 
-  for (y = 0; y < NY; y++) {
-    for (x = 0; x < NX; x++) {      
+  /* each MPI process counts the cells in its own rows */
+  for (y = Map->FirstRow; y < Map->FirstRow + Map->NRows; y++) {
+    for (x = 0; x < Map->NX; x++) {      
 	  if (INBASIN(TopoMap[y][x].Mask)) {
 		if (channel_grid_has_channel(map, x, y)){	
            cell = map[x][y];
@@ -884,6 +1032,18 @@ void Init_segment_ncell(TOPOPIX **TopoMap, ChannelMapPtr ** map, int NY,
     }
   }
 
+  for (n = 0, seg = net; seg != NULL; seg = seg->next)
+    n++;
+  if (!(Count = (double *) calloc(n + 1, sizeof(double))))
+    error_handler(ERRHDL_FATAL, "Init_segment_ncell: malloc failed: %s",
+		  strerror(errno));
+  for (i = 0, seg = net; seg != NULL; seg = seg->next, i++)
+    Count[i] = seg->Ncells;
+  ParallelSum(Count, n);
+  for (i = 0, seg = net; seg != NULL; seg = seg->next, i++)
+    seg->Ncells = (int) Count[i];
+  free(Count);
+
   // then check all segments
   for (; net != NULL; net = net->next) {
     if (net->Ncells == 0 ) {
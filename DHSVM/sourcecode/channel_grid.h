@@ -41,19 +41,40 @@ struct _channel_map_rec_ {
 typedef struct _channel_map_rec_ ChannelMapRec;
 typedef struct _channel_map_rec_ *ChannelMapPtr;
 
+/* -------------------------------------------------------------
+   struct ChannelIncrement
+   An increment of the lateral inflow, the melt or the RBM inputs of
+   one channel segment, recorded while increments are deferred
+   ------------------------------------------------------------- */
+#define CHANNEL_INC_INFLOW 0
+#define CHANNEL_INC_MELT   1
+#define CHANNEL_INC_OTHER  2
+#define CHANNEL_INC_VALUES 11	/* values of a channel_grid_inc_other() */
+
+typedef struct {
+  ChannelMapPtr **map;		/* network map the increment was made to */
+  Channel *channel;		/* segment */
+  int kind;			/* CHANNEL_INC_INFLOW, _MELT or _OTHER */
+  float value[CHANNEL_INC_VALUES];	/* mass, or the RBM inputs */
+} ChannelIncrement;
+
 /* -------------------------------------------------------------
    externally available routines
    ------------------------------------------------------------- */
 
 				/* Module Functions */
 
-void channel_grid_init(int cols, int rows);
+void channel_grid_init(int cols, int rows, int first_row, int total_rows);
 void channel_grid_done(void);
+void channel_grid_defer(int defer);
+ChannelIncrement *channel_grid_deferred(int *n);
+void channel_grid_clear_deferred(void);
+void channel_grid_apply(ChannelIncrement *inc);
 
 				/* Input Functions */
 
-ChannelMapPtr **channel_grid_read_map(Channel *net, const char *file,
-				      SOILPIX **SoilMap);
+ChannelMapPtr **channel_grid_read_map(ChannelIndex *index, const char *file,
+				      float *SoilDepth);
 
 				/* Query Functions */
 
@@ -76,6 +97,6 @@ void channel_grid_free_map(ChannelMapPtr **map);
 /* new functions for RBM model */
 void channel_grid_inc_other(ChannelMapPtr **map, int col, int row, PIXRAD *LocalRad , 
 							PIXMET *LocalMet, float skyview);
-void Init_segment_ncell(TOPOPIX **TopoMap, ChannelMapPtr **map, int NY, int NX, Channel *net);
+void Init_segment_ncell(TOPOPIX **TopoMap, ChannelMapPtr **map, MAPSIZE *Map, Channel *net);
 void channel_grid_avg (Channel *Channel);
 #endif
@@ -19,6 +19,15 @@
 #include "settings.h"
 #include "Calendar.h"
 #include "channel.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/* Model state checkpoint, defined in Checkpoint.c */
+typedef struct CHECKPOINT CHECKPOINT;
+
+/* Model state kept in memory, defined in Snapshot.c */
+typedef struct SNAPSHOT SNAPSHOT;
 
 typedef struct {
   int N;			/* Northing */
@@ -64,6 +73,7 @@ typedef struct {
   DATE *DState;						/* Array with dates on which to dump state */
   int NPix;							/* Number of pixels for which to output timeseries */
   PIXDUMP *Pix;						/* Array with info on pixels for which to output timeseries */
+  int PixFormat;					/* TEXT_PIXDUMP or BINARY_PIXDUMP */
   int NMaps;						/* Number of variables for which to output maps */
   MAPDUMP *DMap;					/* Array with info on each map to output */
 } DUMPSTRUCT;
@@ -148,6 +158,12 @@ typedef struct {
   int   y;
 } ITEM;
 
+typedef struct {
+  int y;			/* Row of the run */
+  int x0;			/* First column of the run */
+  int x1;			/* One past the last column of the run */
+} CELLRUN;
+
 typedef struct {
   char System[BUFSIZE + 1];		 /* Coordinate system */
   double Xorig;					 /* X coordinate of Northwest corner */
@@ -163,8 +179,27 @@ typedef struct {
   int OffsetY;					 /* Offset in y-direction compared to basemap */
   int NumCells;                  /* Number of cells within the basin */
   ITEM *OrderedCells;            /* Structure array to hold the ranked elevations; NumCells in size */
+  int NumRuns;                   /* Number of runs of adjacent basin cells in a row */
+  CELLRUN *Runs;                 /* Runs of basin cells in row-major order; NumRuns in size */
+  int *RowRuns;                  /* Index of the first run in each row; NY + 1 in size, 
+                                    so the runs in row y are RowRuns[y] to RowRuns[y+1] - 1 */
+  int FirstRow;                  /* First row computed by this MPI process */
+  int NRows;                     /* Number of rows computed by this MPI process */
+  int GlobalNY;                  /* Number of rows of the whole model area */
+  int GlobalY0;                  /* Row of the whole model area that is row 0 here.
+                                    With MPI each process only holds the rows
+                                    GlobalY0 to GlobalY0 + NY - 1 of the grid */
 } MAPSIZE;
 
+/* Blocks of memory from which the small layer arrays of the grid cells are
+   handed out, see Slab.c */
+typedef struct {
+  char **Block;			/* Blocks of memory */
+  int NBlocks;			/* Number of blocks */
+  size_t Size;			/* Size of the last block (bytes) */
+  size_t Used;			/* Bytes handed out from the last block */
+} SLAB;
+
 typedef struct {
   float Tair;					/* Air temperature (C) */
   float TempLapse;				/* Temperature lapse rate (C/m) */
@@ -187,18 +222,66 @@ typedef struct {
   float PrecipLapse;			/* Elevation Adjustment Factor for Precip */
 } MET;
 
+/* Binary met file with the records of all stations (see ReadMetRecord.c and
+   program/MakeMetBin.c).  Each record holds RecordSize floats, the
+   NVars[i] values of station i starting at Offset[i] */
+typedef struct {
+  FILES File;			/* Binary met file */
+  int NStats;			/* Number of stations in the file */
+  int NRecords;			/* Number of records in the file */
+  int Dt;			/* Time between records (in sec) */
+  DATE Start;			/* Date of the first record */
+  int *NVars;			/* Number of variables of each station */
+  int *Offset;			/* First value of each station in a record */
+  int RecordSize;		/* Number of values in a record */
+  long DataStart;		/* Byte offset of the first record */
+  int Record;			/* Record in Buffer, -1 if none */
+  float *Buffer;		/* Values of Record */
+} METBIN;
+
 typedef struct {
   char Name[BUFSIZE + 1];		  /* Station name */
   COORD Loc;					        /* Station locations */
   float Elev;					        /* Station elevations */
-  float PrismPrecip[12];		  /* MonthlyPrism Precip for each station if outside=TRUE */
+  float PrismPrecip[12];		  /* MonthlyPrism Precip for each station, from
+								     the PRISM map if outside=FALSE */
   uchar IsWindModelLocation;	/* Only used in case the wind model option is
                                  specified.  In that case this field is TRUE
                                  for one (and only one) station, and FALSE for all others */
   FILES MetFile;				      /* File with observations */
+  METBIN *MetBin;             /* Binary met file with the observations,
+                                 NULL if MetFile is read instead */
+  int MetBinStation;          /* Station number in MetBin */
   MET Data;
 } METLOCATION;
 
+/* Interpolation weights of the met stations, stored for each cell as a
+   list of the stations that have a non-zero weight (compressed sparse rows).
+   The entries of cell y * NX + x are Start[y * NX + x] up to, but not 
+   including, Start[y * NX + x + 1] and are ordered by station index. */
+typedef struct {
+  int *Start;			/* First entry of each cell; NY * NX + 1 in size */
+  int *Station;			/* Station index of each entry */
+  float *Weight;		/* Weight of each entry, normalised by the sum
+				   of the weights of the cell */
+} METWEIGHTS;
+
+/* Uniform bucket grid over the met station locations, used to find the
+   stations near a cell without visiting all of them.  Bucket (n, e) covers
+   rows N0 + n * Size up to N0 + (n + 1) * Size and the same range of columns
+   starting at E0.  Its stations are Station[Start[n * NE + e]] up to, but
+   not including, Station[Start[n * NE + e + 1]], in increasing order. */
+typedef struct {
+  int NStats;			/* Number of stations in the grid */
+  int N0;			/* Northing (row) of the first bucket */
+  int E0;			/* Easting (column) of the first bucket */
+  int Size;			/* Bucket size in pixels */
+  int NN;			/* Number of buckets in the N direction */
+  int NE;			/* Number of buckets in the E direction */
+  int *Start;			/* First entry of each bucket; NN * NE + 1 */
+  int *Station;			/* Station indices, sorted by bucket */
+} STATIONGRID;
+
 typedef struct {
   int utmzone;                  /* utm zone used as reference for all geospatial input */
   int NGrids;                   /* total met grids used for memory allocation, must >= actual grids used */
@@ -251,6 +334,18 @@ typedef struct {
   int SnowSlide;                /* if snow sliding option is true */
   int PrecipSepr;               /* if TRUE use separate input of rain and snow */
   int SnowStats;               /* if TRUE dumps snow statistics for each water year */
+  int PrefetchDepth;            /* Number of time steps for which the forcing is read
+                                   ahead by a separate thread, 0 to read it at the
+                                   start of each time step */
+  int OutputQueueSize;          /* Megabytes of output that can wait to be written
+                                   by a separate thread, 0 to write it right away */
+  int StateFormat;              /* MAP_STATE for the state map files, or
+                                   CHECKPOINT_STATE for a single checkpoint file */
+  int StateCompression;         /* if TRUE run-length encode checkpoint fields */
+  int EnsembleMembers;          /* Number of ensemble members that are run from
+                                   the same initial state and forcing */
+  char TraceFile[BUFSIZE + 1];  /* Chrome trace of the time spent in each
+                                   phase of the model, empty for none */
   char PrismDataPath[BUFSIZE + 1];
   char PrismDataExt[BUFSIZE + 1];
   char ShadingDataPath[BUFSIZE + 1];
@@ -277,6 +372,65 @@ typedef struct {
   float Precip;			        /* Radar precipitation for current bin */
 } RADARPIX;
 
+/* Forcing of one time step as it is read from the files, before it is
+   checked and stored in the station, MM5 and radar structures */
+typedef struct {
+  DATE Current;			/* Time step of the forcing */
+  uchar First;			/* TRUE for the first time step of the run */
+  float *Station;		/* Met variables of the stations, those of station
+				   i start at StationOffset[i] */
+  int *StationOffset;		/* Start of each station in Station */
+  int NMM5;			/* Number of MM5 fields, N_MM5_MAPS plus one for
+				   each soil layer with the heat flux option */
+  float **MM5;			/* MM5 fields, on the window of the MM5 grid
+				   that covers the basin (see MM5GATHER) */
+  uchar *MM5Read;		/* TRUE for the MM5 fields read for this step */
+  float *PrecipLapse;		/* MM5 precipitation lapse map */
+  uchar PrecipLapseRead;	/* TRUE if PrecipLapse was read for this step */
+  float *Radar;			/* Radar precipitation */
+} FORCING;
+
+/* Resampling of the MM5 fields to the model grid.  Only rows Y0 to
+   Y0 + NY - 1 and columns X0 to X0 + NX - 1 of the MM5 grid are needed for
+   the basin cells, so only that window is read, and basin cell (y, x) takes
+   the value of window cell Cell[y * Map->NX + x] */
+typedef struct {
+  int Y0;			/* First MM5 row of the window */
+  int X0;			/* First MM5 column of the window */
+  int NY;			/* Number of rows of the window */
+  int NX;			/* Number of columns of the window */
+  int *Cell;			/* Window cell of each model cell, -1 outside
+				   the basin */
+} MM5GATHER;
+
+/* Read-ahead of the forcing.  The forcing of step s goes into
+   Slot[s % NSlots]; the reader thread stays at most Depth steps ahead of the
+   step being modeled.  Without a reader thread (Depth == 0) each step is
+   read when it is needed. */
+typedef struct {
+  int Depth;			/* Number of steps read ahead */
+  int NSlots;			/* Depth + 1 */
+  FORCING *Slot;		/* Forcing of the steps in the pipeline */
+  int NRead;			/* Number of steps read so far */
+  int NUsed;			/* Number of steps whose slot can be reused */
+  TIMESTRUCT Time;		/* Time of the next step to read */
+  OPTIONSTRUCT *Options;
+  INPUTFILES *InFiles;
+  int NSoilLayers;
+  int NStats;
+  METLOCATION *Stat;
+  MAPSIZE *Map;
+  MAPSIZE *MM5Map;
+  MM5GATHER MM5Gather;		/* Window of the MM5 grid that is read */
+  MAPSIZE *Radar;
+  char *RadarFileName;
+#ifdef HAVE_PTHREAD
+  pthread_t Thread;		/* Reader thread */
+  pthread_mutex_t Lock;		/* Protects NRead and NUsed */
+  pthread_cond_t Changed;	/* Signaled when NRead or NUsed changes */
+#endif
+} PREFETCH;
+
 typedef struct {
   float NetShort[2];        /* Shortwave radiation for vegetation surfaces and ground/snow surface W/m2 */
   float LongIn[2];		      /* Incoming longwave radiation for vegetation surfaces and ground/snow surface W/m2 */
@@ -385,19 +539,15 @@ typedef struct {
 
 typedef struct {
   int   Soil;			/* Soil type */
-  float Depth;			/* Depth of total soil zone, including all root
-						zone layers, and the saturated zone */
   float *Moist;			/* Soil moisture content in layers (0-1) */
   float *Perc;			/* Percolation from layers */
   float *Temp;			/* Temperature in each layer (C) */
-  float TableDepth;		/* Depth of water table below ground surface (m) */
   float WaterLevel;		/* Absolute height of the watertable above datum (m), 
 						i.e. corrected for terrain elevation */
-  float SatFlow;		/* amount of saturated flow generated */
-  float IExcess;		/* amount of surface runoff (m) generated from HOF and Return flow */
-  float Runoff;         /* Surface water flux (m) from the grid cell. */
   float ChannelInt;		/* amount of subsurface flow intercepted by the channel */
   float RoadInt;		/* amount of water intercepted by the road */
+  float CulvertReturnFlow;	/* culvert outflow added to the surface water */
+  float CulvertToChannel;	/* culvert outflow added to the channel */
   float TSurf;			/* Soil surface temperature */
   float Qnet;			/* Net radiation exchange at surface */
   float Qrest;			/* Rest term for energy balance (should be 0) */
@@ -412,11 +562,24 @@ typedef struct {
   float DetentionIn;			 /* detention storage change in current time step */
   float DetentionOut;            /* water flow out of detention storage */
   
-  float KsLat;      /* Soil Lateral Conductivity */
   float *Porosity;          /* Soil Porosity */
   float *FCap;      /* soil field capacity */
 } SOILPIX;
 
+/* Soil fields that the surface and subsurface routing work on, kept out of
+   SOILPIX so that the routing streams through a few dense arrays instead of
+   whole SOILPIX structures.  Each field is allocated once, with the value
+   of cell (y, x) at y * NX + x */
+typedef struct {
+  float *Depth;			/* Depth of total soil zone, including all root
+						zone layers, and the saturated zone */
+  float *KsLat;			/* Soil Lateral Conductivity */
+  float *TableDepth;	/* Depth of water table below ground surface (m) */
+  float *SatFlow;		/* amount of saturated flow generated */
+  float *IExcess;		/* amount of surface runoff (m) generated from HOF and Return flow */
+  float *Runoff;		/* Surface water flux (m) from the grid cell. */
+} SOILFLOWMAP;
+
 typedef struct {
   char Desc[BUFSIZE + 1];	/* Soil type */
   int Index;
@@ -460,10 +623,48 @@ typedef struct {
   unsigned char Dir[MAXDIRS];		/* Fraction of surface flux moving in each direction*/
   unsigned int TotalDir;	    /* Sum of Dir array */
   int drains_x;					/* x-loc of cell to which this impervious cell drains */
-  int drains_y;					/* y-loc of cell to which this impervious cell drains */
+  int drains_y;					/* y-loc in the whole grid of cell to which this impervious cell drains */
   ITEM *OrderedTopoIndex;       /* Structure array to hold the ranked topoindex for fine pixels in a coarse pixel */
 } TOPOPIX;
 
+/* Flow directions computed during the run (water table or snow surface
+   gradients).  Allocated once and stored contiguously in row-major
+   order; Dir holds MAXDIRS entries per cell */
+typedef struct {
+  float *FlowGrad;				/* Magnitude of flow gradient slope * width */
+  unsigned char *Dir;			/* Fraction of flux moving in each direction */
+  unsigned int *TotalDir;		/* Sum of Dir array */
+} FLOWDIRMAP;
+
+/* Per-cell results of the first pass of RouteSubSurface() */
+typedef struct {
+  float SatOut;					/* Water leaving the saturated zone (m) */
+  float DirOut;					/* Outflow per unit of flow direction fraction (m) */
+  float Intercept;				/* Water intercepted by a road or stream channel (m3) */
+  uchar HasIntercept;			/* TRUE if Intercept goes to the channel network */
+} SUBFLOWPIX;
+
+/* Cells whose impervious runoff goes straight to a drains cell (see
+   TOPOPIX), listed per drains cell for RouteSurface().  The sources of
+   cell i are Source[First[i]] to Source[First[i + 1] - 1], in row-major
+   order.  The runoff of the sources is sent to the MPI process of the
+   drains cell.  First is NULL if no cell has an impervious fraction */
+typedef struct {
+  int *First;					/* First source of each cell; NY * NX + 1 in size */
+  int *Source;					/* Index y * NX + x in the whole grid of the
+								   source cells */
+  int *Item;					/* Entry of each source in In */
+  float *Flow;					/* Impervious runoff and detention outflow sent
+								   to the drains cell (m); 2 per cell */
+  int NSend;					/* Number of sources in the band of this process */
+  int *Send;					/* Index y * NX + x of those sources, grouped by
+								   the process of their drains cell */
+  int *SendCounts;				/* Number of sources sent to each process */
+  int *ReceiveCounts;			/* Number of sources received from each process */
+  float *Out;					/* Flow of the sources sent; 2 per source */
+  float *In;					/* Flow of the sources received; 2 per source */
+} DRAINMAP;
+
 typedef struct
 {
   uchar HasSnow;			    /* Snow cover flag determined by SWE */
@@ -590,17 +791,19 @@ typedef struct {
                              used in improved radiation scheme */
 } VEGTABLE;
 
-typedef struct {
-  float StartWaterStorage;
-  float OldWaterStorage;
-  float CumPrecipIn;
-  float CumET;
-  float CumIExcess;
-  float CumChannelInt;
-  float CumRoadInt;
-  float CumSnowVaporFlux;
-  float CumCulvertReturnFlow;
-  float CumCulvertToChannel;
+/* the cumulative sums run over all the time steps, so they are kept in
+   double precision */
+typedef struct {
+  double StartWaterStorage;
+  double OldWaterStorage;
+  double CumPrecipIn;
+  double CumET;
+  double CumIExcess;
+  double CumChannelInt;
+  double CumRoadInt;
+  double CumSnowVaporFlux;
+  double CumCulvertReturnFlow;
+  double CumCulvertToChannel;
 } WATERBALANCE;
 
 typedef struct {
@@ -634,6 +837,34 @@ typedef struct {
   unsigned long Saturated;
   float CulvertReturnFlow;
   float CulvertToChannel;
+  float SoilDepth;				/* the SOILFLOWMAP fields */
+  float TableDepth;
+  float SatFlow;
+  float IExcess;
 } AGGREGATED;
 
+/* Place of each basin total in the double sums of a row in Aggregate().
+   The totals by vegetation or soil layer follow AGG_NSCALARS.  The last
+   three are the number of cells, of saturated cells and of cells with
+   snow */
+typedef enum {
+  AGG_ETOT, AGG_EVAPSOIL,
+  AGG_PRECIP, AGG_SNOWFALL, AGG_CANOPYWATER,
+  AGG_TAIR, AGG_OBSSHORTIN, AGG_BEAMIN, AGG_DIFFUSEIN, AGG_PIXELNETSHORT,
+  AGG_NETSHORT, AGG_LONGIN = AGG_NETSHORT + 2, AGG_LONGOUT = AGG_LONGIN + 2,
+  AGG_PIXELLONGIN = AGG_LONGOUT + 2, AGG_PIXELLONGOUT, AGG_NETRAD,
+  AGG_SWQ, AGG_GLACIER, AGG_MELT, AGG_PACKWATER, AGG_TPACK, AGG_SURFWATER,
+  AGG_SNOWTSURF, AGG_COLDCONTENT, AGG_ALBEDO, AGG_DEPTH, AGG_SNOWQE,
+  AGG_SNOWQS, AGG_SNOWQSW, AGG_SNOWQLW, AGG_SNOWQP, AGG_MELTENERGY,
+  AGG_VAPORMASSFLUX, AGG_CANOPYVAPORMASSFLUX,
+  AGG_GAPQSW, AGG_GAPQLIN, AGG_GAPQLW, AGG_GAPQE, AGG_GAPQS, AGG_GAPQP,
+  AGG_GAPSWQ, AGG_GAPMELTENERGY,
+  AGG_SOILDEPTH, AGG_TABLEDEPTH, AGG_WATERLEVEL, AGG_SATFLOW, AGG_SOILTSURF,
+  AGG_QNET, AGG_SOILQS, AGG_SOILQE, AGG_QG, AGG_QST, AGG_IEXCESS,
+  AGG_DETENTIONSTORAGE, AGG_INFILTACC, AGG_RUNOFF, AGG_SOILWATER,
+  AGG_CHANNELINT, AGG_ROADINT, AGG_CULVERTRETURNFLOW, AGG_CULVERTTOCHANNEL,
+  AGG_CELLS, AGG_SATURATED, AGG_HASSNOW,
+  AGG_NSCALARS
+} AGGREGATEDSLOT;
+
 #endif
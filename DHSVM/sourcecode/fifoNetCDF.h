@@ -19,7 +19,14 @@
 void CreateMapFileNetCDF(char *FileName, ...);
 int Read2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
 		       int NX, int NDataSet, ...);
+int Read2DSubMatrixNetCDF(char *FileName, void *Matrix, int NumberType,
+			  int NY, int NX, int NDataSet, char *VarName,
+			  int index, int Y0, int X0, int SubNY, int SubNX);
+int Read2DRowsNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
+		     int NX, int NDataSet, char *VarName, int index, int Y0,
+		     int X0, int SubNY, int SubNX);
 int Write2DMatrixNetCDF(char *FileName, void *Matrix, int NumberType, int NY,
 			int NX, ...);
+void CloseMapFilesNetCDF(void);
 
 #endif
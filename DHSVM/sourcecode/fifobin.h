@@ -21,6 +21,13 @@ int Read2DMatrixBin(char *FileName, void *Matrix, int NumberType, int NY,
 		    int NX, int NDataSet, ...); 
 int Read2DMatrixByteSwapBin(char *FileName, void *Matrix, int NumberType,
 			    int NY, int NX, int NDataSet, ...);
+int Read2DSubMatrixBin(char *FileName, void *Matrix, int NumberType, int NY,
+		       int NX, int NDataSet, char *VarName, int index, int Y0,
+		       int X0, int SubNY, int SubNX);
+int Read2DSubMatrixByteSwapBin(char *FileName, void *Matrix, int NumberType,
+			       int NY, int NX, int NDataSet, char *VarName,
+			       int index, int Y0, int X0, int SubNY,
+			       int SubNX);
 int Write2DMatrixBin(char *FileName, void *Matrix, int NumberType, int NY,
 		     int NX, ...); 
 int Write2DMatrixByteSwapBin(char *FileName, void *Matrix, int NumberType,
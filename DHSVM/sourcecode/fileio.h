@@ -35,9 +35,44 @@ void CreateMapFile(char *FileName, char *FileLabel, MAPSIZE *Map);
 int Read2DMatrix(char *FileName, void *Matrix, int NumberType, 
                  MAPSIZE *Map, int NDataSet, char *VarName, int index);
 
+int Read2DSubMatrix(char *FileName, void *Matrix, int NumberType,
+                    MAPSIZE *Map, int Y0, int X0, int NY, int NX,
+                    int NDataSet, char *VarName, int index);
+
 int Write2DMatrix(char *FileName, void *Matrix, int NumberType, 
                   MAPSIZE *Map, MAPDUMP *DMap, int index);
 
+void CloseMapFiles(void);
+
+/* output queue, written by a separate thread (Output.c) */
+void InitOutput(int QueueSize);
+void *GetMapBuffer(size_t Size);
+void WriteMapOutput(char *FileName, void *Matrix, int NumberType,
+                    MAPSIZE *Map, MAPDUMP *DMap, int Index);
+int OutPrintf(FILE *File, const char *Format, ...);
+void OutWrite(const void *Data, size_t Size, FILE *File);
+void OutPrintDate(DATE *Day, FILE *OutFile);
+void FlushOutput(void);
+void EndOutput(void);
+
+/* model state checkpoint in a single file (Checkpoint.c) */
+#define CKP_HYDROGRAPH       1	/* Checkpoint fields other than state maps */
+#define CKP_CHANNEL_ID       2
+#define CKP_CHANNEL_STORAGE  3
+
+CHECKPOINT *CreateCheckpoint(char *Path, DATE *Now, MAPSIZE *Map,
+                             int Compress);
+void PutCheckpointField(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                        int Count);
+void PutCheckpointMap(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                      MAPSIZE *Map);
+CHECKPOINT *OpenCheckpoint(char *Path, DATE *Now, MAPSIZE *Map);
+int GetCheckpointCount(CHECKPOINT *Ckp, int ID, int Layer);
+void GetCheckpointField(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                        int Count);
+void GetCheckpointMap(CHECKPOINT *Ckp, int ID, int Layer, void *Values,
+                      MAPSIZE *Map);
+void CloseCheckpoint(CHECKPOINT *Ckp);
 
 /* generic file functions */
 void OpenFile(FILE **FilePtr, char *FileName, char *Mode,
@@ -23,11 +23,14 @@
 void Aggregate(MAPSIZE *Map, OPTIONSTRUCT *Options, TOPOPIX **TopoMap,
 	       LAYER *Soil, LAYER *Veg, VEGPIX **VegMap, EVAPPIX **Evap,
 	       PRECIPPIX **Precip, PIXRAD **RadMap, SNOWPIX **Snow,
-	       SOILPIX **SoilMap, AGGREGATED *Total, VEGTABLE *VType,
-	       ROADSTRUCT **Network, CHANNEL *ChannelData, float *roadarea, int Dt);
+	       SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, AGGREGATED *Total,
+	       VEGTABLE *VType, ROADSTRUCT **Network, CHANNEL *ChannelData,
+	       float *roadarea, int Dt);
+
+void AggregateRadiation(int MaxVegLayers, int NVegL, PIXRAD *Rad, double *Sum);
 
 void Avalanche(MAPSIZE *Map, TOPOPIX **TopoMap, TIMESTRUCT *Time, OPTIONSTRUCT *Options,
-  SNOWPIX **SnowMap);
+  SNOWPIX **SnowMap, FLOWDIRMAP *SnowFlowDir);
 
 void CalcAerodynamic(int NVegLayers, unsigned char OverStory,
 		     float n, float *Height, float Trunk, float *U,
@@ -49,14 +52,15 @@ float CalcTransmissivity(float SoilDepth, float WaterTable, float LateralKs,
 			 float KsExponent, float DepthThresh);
 
 void CalcWeights(METLOCATION *Station, int NStats, int NX, int NY,
-		 uchar **BasinMask, uchar ****WeightArray,
+		 uchar **BasinMask, METWEIGHTS *Weights,
 		 OPTIONSTRUCT *Options);
 
 double ChannelCulvertSedFlow(int y, int x, CHANNEL * ChannelData, int i);
 
 void CheckOut(OPTIONSTRUCT *Options, LAYER Veg, LAYER Soil,
 	      VEGTABLE *VType, SOILTABLE *SType, MAPSIZE *Map, 
-	      TOPOPIX **TopoMap, VEGPIX **VegMap, SOILPIX **SoilMap);
+	      TOPOPIX **TopoMap, VEGPIX **VegMap, SOILPIX **SoilMap,
+	      SOILFLOWMAP *SoilFlow);
 
 unsigned char dequal(double a, double b);
 
@@ -64,28 +68,35 @@ void deg2utm(float la, float lo, float *x, float *y, int zone);
 
 void draw(DATE *Day, int first, int DayStep, MAPSIZE *Map, int NGraphics,
 	  int *which_graphics, VEGTABLE *VType, SOILTABLE *SType, SNOWPIX **SnowMap, 
-	  SOILPIX **SoilMap, VEGPIX **VegMap, TOPOPIX **TopoMap, PRECIPPIX **PrecipMap, 
+	  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap,
+	  TOPOPIX **TopoMap, PRECIPPIX **PrecipMap, 
 	  float **PrismMap, float **SkyViewMap, unsigned char ***ShadowMap, 
 	  EVAPPIX **EvapMap, PIXRAD **RadMap, MET_MAP_PIX **MetMap,
 	  ROADSTRUCT **Network, OPTIONSTRUCT *Options);
 
 void DumpMap(MAPSIZE *Map, DATE *Current, MAPDUMP *DMap, TOPOPIX **TopoMap,
 	     EVAPPIX **EvapMap, PRECIPPIX **PrecipMap, PIXRAD **RadMap,
-	     SNOWPIX **Snowap, SOILPIX **SoilMap, LAYER *Soil, VEGPIX **VegMap, 
+	     SNOWPIX **Snowap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+	     LAYER *Soil, VEGPIX **VegMap, 
          LAYER *Veg, ROADSTRUCT **Network, OPTIONSTRUCT *Options);
 
 void DumpPix(DATE *Current, int first, FILES *OutFile, EVAPPIX *Evap,
         PRECIPPIX *Precip, PIXRAD *Rad, SNOWPIX *Snow, SOILPIX *Soil,
-        VEGPIX *Veg, int NSoil, int NVeg, OPTIONSTRUCT *Options, int flag);
+        float IExcess, float TableDepth, float SatFlow,
+        VEGPIX *Veg, int NSoil, int NVeg, OPTIONSTRUCT *Options, int flag,
+        int Format);
 
 #ifdef TOPO_DUMP
 void DumpTopo(MAPSIZE *Map, TOPOPIX **TopoMap);
 #endif
 
+void EndPrefetch(PREFETCH *P);
+
 void ExecDump(MAPSIZE *Map, DATE *Current, DATE *Start, OPTIONSTRUCT *Options,
 	      DUMPSTRUCT *Dump, TOPOPIX **TopoMap, EVAPPIX **EvapMap, PIXRAD **RadiMap,
 	      PRECIPPIX ** PrecipMap, SNOWPIX **SnowMap, MET_MAP_PIX **MetMap, 
-          VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap, ROADSTRUCT **Network, 
+          VEGPIX **VegMap, LAYER *Veg, SOILPIX **SoilMap,
+          SOILFLOWMAP *SoilFlow, ROADSTRUCT **Network, 
           CHANNEL *ChannelData, LAYER *Soil, AGGREGATED *Total, 
 	      UNITHYDRINFO *HydrographInfo, float *Hydrograph);
 
@@ -96,18 +107,30 @@ void FinalMassBalance(FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass);
 float FindDTRoad(ROADSTRUCT **Network, TIMESTRUCT *Time, int y, int x, 
 		 float dx, float beta, float alpha);
 
+void FreeStationGrid(STATIONGRID *Grid);
+
 void GenerateScales(MAPSIZE *Map, int NumberType, void **XScale,
 		    void **YScale);
 
-void GetMetData(OPTIONSTRUCT *Options, TIMESTRUCT *Time, int NSoilLayers,
-		int NStats, float SunMax, METLOCATION *Stat, MAPSIZE *Radar,
-		RADARPIX **RadarMap, char *RadarFileName);
+FORCING *GetForcing(PREFETCH *P, TIMESTRUCT *Time);
+
+void GetMetData(OPTIONSTRUCT *Options, int NSoilLayers, int NStats,
+		float SunMax, METLOCATION *Stat, MAPSIZE *Radar,
+		RADARPIX **RadarMap, FORCING *Forcing);
 
 uchar InArea(MAPSIZE *Map, COORD *Loc);
 
+void CountBasinCells(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+  int *RowCells);
+void InitActiveCells(MAPSIZE *Map, TOPOPIX **TopoMap);
+
+void InitStationGrid(METLOCATION *Station, int NStats, STATIONGRID *Grid);
+
 void InitAggregated(OPTIONSTRUCT *Options, int MaxVegLayers, int MaxSoilLayers,
   AGGREGATED *Total);
 
+void FreeAggregated(OPTIONSTRUCT *Options, int MaxVegLayers, AGGREGATED *Total);
+
 void InitChannelRVeg(TIMESTRUCT *Time, Channel *Channel); 
 
 void InitCharArray(char *Array, int Size);
@@ -118,10 +141,16 @@ void InitConstants(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 void InitDump(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 	      int MaxSoilLayers, int MaxVegLayers, int Dt,
 	      TOPOPIX **TopoMap, DUMPSTRUCT *Dump, int *NGraphics,
-	      int **which_graphics);
+	      int **which_graphics, char *Path);
+
+void InitEnsemble(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
+  int MaxSoilLayers, int MaxVegLayers, int Dt, TOPOPIX **TopoMap,
+  DUMPSTRUCT *Dump, CHANNEL *ChannelData, AGGREGATED *Total,
+  ENSEMBLEMEMBER *Members);
 
 void InitEvapMap(MAPSIZE *Map, EVAPPIX ***EvapMap, SOILPIX **SoilMap,
-		 LAYER *Soil, VEGPIX **VegMap, LAYER *Veg, TOPOPIX **TopoMap);
+		 LAYER *Soil, VEGPIX **VegMap, LAYER *Veg, TOPOPIX **TopoMap,
+		 SLAB *Slab);
 
 void InitImageDump(LISTPTR Input, int Dt, MAPSIZE *Map, int MaxSoilLayers,
 		   int MaxVegLayers, char *Path, int NMaps, int NImages, MAPDUMP **DMap);
@@ -129,7 +158,7 @@ void InitImageDump(LISTPTR Input, int Dt, MAPSIZE *Map, int MaxSoilLayers,
 void InitInFiles(INPUTFILES *InFiles);
 
 void InitInterpolationWeights(MAPSIZE *Map, OPTIONSTRUCT *Options,
-			      TOPOPIX **TopoMap, uchar ****MetWeights,
+			      TOPOPIX **TopoMap, METWEIGHTS *MetWeights,
 			      METLOCATION *Stats, int NStats);
 
 void InitMapDump(LISTPTR Input, MAPSIZE *Map, int MaxSoilLayers, int MaxVegLayers,
@@ -150,7 +179,7 @@ void InitMetMaps(LISTPTR Input, int NDaySteps, MAPSIZE *Map, MAPSIZE *Radar,
 		 EVAPPIX ***EvapMap, PRECIPPIX ***PrecipMap, float ***PptMultiplierMap,
 		 RADARPIX ***RadarMap, PIXRAD ***RadMap, SOILPIX **SoilMap, 
                  LAYER *Soil, VEGPIX **VegMap, LAYER *Veg, TOPOPIX **TopoMap, 
-                 float ****MM5Input, float ****WindModel);
+                 float ****MM5Input, float ****WindModel, SLAB *Slab);
 
 void InitMetSources(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
             TOPOPIX **TopoMap, int NSoilLayers, TIMESTRUCT *Time, 
@@ -166,14 +195,15 @@ void InitMM5Maps(int NSoilLayers, int NY, int NX, float ****MM5Input,
 
 void InitModelState(DATE *Start, int StepsPerDay, MAPSIZE *Map, OPTIONSTRUCT *Options,
 		    PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
-		    SOILPIX **SoilMap, LAYER Soil, SOILTABLE *SType,
+		    SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, LAYER Soil,
+		    SOILTABLE *SType,
 		    VEGPIX **VegMap, LAYER Veg, VEGTABLE *VType, char *Path,
 		    TOPOPIX **TopoMap,
 		    ROADSTRUCT **Network, UNITHYDRINFO *HydrographInfo,
-		    float *Hydrograph);
+		    float *Hydrograph, CHECKPOINT *Checkpoint);
 
-void InitNetwork(int NY, int NX, float DX, float DY, TOPOPIX **TopoMap, 
-		 SOILPIX **SoilMap, VEGPIX **VegMap, VEGTABLE *VType, 
+void InitNetwork(MAPSIZE *Map, TOPOPIX **TopoMap, 
+		 SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, VEGTABLE *VType, 
 		 ROADSTRUCT ***Network, CHANNEL *ChannelData, 
 		 LAYER Veg, OPTIONSTRUCT *Options);
 
@@ -186,10 +216,14 @@ void InitNewMonth(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
 
 void InitNewStep(INPUTFILES *InFiles, MAPSIZE *Map, TIMESTRUCT *Time,
 		 int NSoilLayers, OPTIONSTRUCT *Options, int NStats,
-		 METLOCATION *Stat, char *RadarFileName, MAPSIZE *Radar,
+		 METLOCATION *Stat, PREFETCH *Prefetch, MAPSIZE *Radar,
 		 RADARPIX **RadarMap, SOLARGEOMETRY *SolarGeo, 
-		 TOPOPIX **TopoMap, SOILPIX **SoilMap, float ***MM5Input, 
-                 float **PrecipLapseMap, float ***WindModel, MAPSIZE *MM5Map);
+		 float ***MM5Input, float **PrecipLapseMap, float ***WindModel,
+		 MAPSIZE *MM5Map);
+
+void InitNewWaterLevel(OPTIONSTRUCT *Options, MAPSIZE *Map,
+		       TOPOPIX **TopoMap, SOILPIX **SoilMap,
+		       SOILFLOWMAP *SoilFlow);
 
 void InitNewWaterYear(TIMESTRUCT *Time, OPTIONSTRUCT *Options, MAPSIZE *Map,
                 TOPOPIX **TopoMap, SNOWPIX **SnowMap);
@@ -198,7 +232,7 @@ void InitParameterMaps(OPTIONSTRUCT *Options, MAPSIZE *Map, int Id,
   char *FileName, SNOWPIX ***SnowMap, int ParamType, float temp);
 
 int InitPixDump(LISTPTR Input, MAPSIZE *Map, uchar **BasinMask, char *Path,
-		int NPix, PIXDUMP **Pix, OPTIONSTRUCT *Options);
+		int NPix, PIXDUMP **Pix, int PixFormat, OPTIONSTRUCT *Options);
     
 void InitPptMultiplierMap(OPTIONSTRUCT *Options, MAPSIZE *Map, float ***PptMultiplierMap);                            
 
@@ -207,13 +241,18 @@ void InitPrecipLapse(LISTPTR Input, INPUTFILES *InFiles);
 void InitPrecipLapseMap(char *PrecipLapseFile, MAPSIZE *Map,
 			float ***PrecipLapseMap);
 
+void InitPrefetch(PREFETCH *P, int Depth, TIMESTRUCT *Time,
+		  OPTIONSTRUCT *Options, INPUTFILES *InFiles, int NSoilLayers,
+		  int NStats, METLOCATION *Stat, MAPSIZE *Map, MAPSIZE *MM5Map,
+		  MAPSIZE *Radar, char *RadarFileName);
+
 void InitPrismMap(int NY, int NX, float ***PrismMap);
 
 void InitShadeMap(OPTIONSTRUCT *Options, int NDaySteps, MAPSIZE *Map,
 		  unsigned char ****ShadowMap, float ***SkyViewMap);
 
 void InitPrecipMap(MAPSIZE *Map, PRECIPPIX ***PrecipMap, VEGPIX **VegMap,
-		   LAYER *Veg, TOPOPIX **TopoMap);
+		   LAYER *Veg, TOPOPIX **TopoMap, SLAB *Slab);
 
 void InitRadar(LISTPTR Input, MAPSIZE *Map, TIMESTRUCT *Time,
 	       INPUTFILES *InFiles, MAPSIZE *Radar);
@@ -227,11 +266,17 @@ void InitSatVaporTable(void);
 void InitSnowMap(MAPSIZE *Map, SNOWPIX ***SnowMap, TIMESTRUCT *Time);
 
 void InitSoilMap(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
-		 LAYER *Soil, TOPOPIX **TopoMap, SOILPIX ***SoilMap, SOILTABLE * SType);
+		 LAYER *Soil, TOPOPIX **TopoMap, SOILPIX ***SoilMap,
+		 SOILFLOWMAP *SoilFlow, SOILTABLE * SType, SLAB *Slab);
 
 int InitSoilTable(OPTIONSTRUCT *Options, SOILTABLE **SType, 
 			LISTPTR Input, LAYER *Soil, int InfiltOption);
 
+void InitSubFlowMap(MAPSIZE *Map, SUBFLOWPIX **SubFlowMap);
+
+void InitDrainMap(MAPSIZE *Map, TOPOPIX **TopoMap, VEGPIX **VegMap,
+  VEGTABLE *VType, CHANNEL *ChannelData, DRAINMAP *DrainMap);
+
 void InitStateDump(LISTPTR Input, int NStates, DATE **DState);
 
 void InitGraphicsDump(LISTPTR Input, int NGraphics, int ***which_graphics);
@@ -245,7 +290,8 @@ void InitTables(int StepsPerDay, LISTPTR Input, OPTIONSTRUCT *Options,
     
 void InitTerrainMaps(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
   LAYER *Soil, LAYER *Veg, TOPOPIX ***TopoMap, SOILTABLE *SType,
-  SOILPIX ***SoilMap, VEGTABLE *VType, VEGPIX ***VegMap);
+  SOILPIX ***SoilMap, SOILFLOWMAP *SoilFlow, VEGTABLE *VType,
+  VEGPIX ***VegMap, SLAB *Slab);
 
 void InitTopoMap(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map,
 		 TOPOPIX ***TopoMap);
@@ -266,7 +312,7 @@ void InitWindModel(LISTPTR Input, INPUTFILES *InFiles, int NStats,
 
 void InitWindModelMaps(char *WindPath, MAPSIZE *Map, float ****WindModel);
 
-uchar IsStationLocation(COORD *Loc, int NStats, METLOCATION *Station,
+uchar IsStationLocation(COORD *Loc, STATIONGRID *Grid, METLOCATION *Station,
 			int *WhichStation);
 
 void InitXGraphics(int argc, char **argv,
@@ -275,15 +321,25 @@ void InitXGraphics(int argc, char **argv,
 float LapsePrecip(float Precip, float FromElev, float ToElev, float PrecipLapse, float precipMultiplier);
 
 float LapseT(float Temp, float FromElev, float ToElev, float LapseRate);
+
+float AirPressure(float LapseRate, float Elev);
+
+void LoadMember(ENSEMBLEMEMBER *Member, DUMPSTRUCT *Dump, AGGREGATED *Total,
+  MAPSIZE *Map, OPTIONSTRUCT *Options, TIMESTRUCT *Time, LAYER *Soil,
+  LAYER *Veg, EVAPPIX **EvapMap, PIXRAD **RadMap, PRECIPPIX **PrecipMap,
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass);
  
 PIXMET MakeLocalMetData(int y, int x, MAPSIZE *Map, int DayStep, int NDaySteps,
 			OPTIONSTRUCT *Options, int NStats, METLOCATION *Stat, 
-      uchar *MetWeights, float LocalElev, PIXRAD *RadMap,
+      METWEIGHTS *MetWeights, float LocalElev, PIXRAD *RadMap,
 			PRECIPPIX *PrecipMap, MAPSIZE *Radar, RADARPIX **RadarMap,
 			float **PrismMap, SNOWPIX *LocalSnow, 
       CanopyGapStruct **Gap, VEGPIX *VegMap,
 			float ***MM5Input, float ***WindModel, float **PrecipLapseMap,
-			MET_MAP_PIX ***MetMap, float precipMultiplier, int NGraphics, int Month, float skyview,
+			MET_MAP_PIX ***MetMap, float precipMultiplier, float PrecipFactor,
+			int NGraphics, int Month, float skyview,
 			unsigned char shadow, float SunMax, float SineSolarAltitude);
 
 void MassBalance(DATE *Current, DATE *Start, FILES *Out, AGGREGATED *Total, WATERBALANCE *Mass);
@@ -293,22 +349,39 @@ void MassEnergyBalance(OPTIONSTRUCT *Options, int y, int x, float SineSolarAltit
             int InfiltOption, int MaxSoilLayer, int MaxVegLayers, PIXMET *LocalMet,
             ROADSTRUCT *LocalNetwork, PRECIPPIX *LocalPrecip, VEGTABLE *VType,
             VEGPIX *LocalVeg, SOILTABLE *SType, SOILPIX *LocalSoil,
-            SNOWPIX *LocalSnow, PIXRAD *LocalRad, EVAPPIX *LocalEvap, PIXRAD *TotalRad,
+            SOILFLOWMAP *SoilFlow, int Cell,
+            SNOWPIX *LocalSnow, PIXRAD *LocalRad, EVAPPIX *LocalEvap,
             CHANNEL *ChannelData, float **skyview);
 
 float MaxRoadInfiltration(ChannelMapPtr **map, int col, int row);
 
+int NearestStations(STATIONGRID *Grid, METLOCATION *Station, COORD *Loc,
+		    int K, int *Nearest, double *Distance);
+
+int NumberOfMetVars(OPTIONSTRUCT *Options, int NSoilLayers,
+		    unsigned char IsWindModelLocation);
+
+void OpenMetBin(char *FileName, int NStats, METBIN *MetBin);
+
 double pow (double a, double b);
 
 void quick(ITEM *OrderedCells, int count);
 
 void qs(ITEM *OrderedCells, int left, int right);
 
-void ReadChannelState(char *Path, DATE *Current, Channel *Head);
+void ReadChannelState(char *Path, DATE *Current, Channel *Head,
+  ChannelIndex *Index, CHECKPOINT *Checkpoint);
+
+void ReadEnsemble(LISTPTR Input, OPTIONSTRUCT *Options,
+  ENSEMBLEMEMBER **Members);
 
 void ReadMetRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
 		   FILES *InFile, unsigned char IsWindModelLocation,
-		   MET *MetRecord);
+		   float *Array);
+
+void ReadMetBinRecord(OPTIONSTRUCT *Options, DATE *Current, int NSoilLayers,
+		      METBIN *MetBin, int Station,
+		      unsigned char IsWindModelLocation, float *Array);
 
 void ReadRadarMap(DATE *Current, DATE *StartRadar, int Dt, MAPSIZE *Radar,
 		  RADARPIX **RadarMap, char *HDFFileName);
@@ -326,17 +399,27 @@ int Round(double x);
 void RouteSubSurface(int Dt, MAPSIZE *Map, TOPOPIX **TopoMap,
 		     VEGTABLE *VType, VEGPIX **VegMap,
 		     ROADSTRUCT **Network, SOILTABLE *SType,
-		     SOILPIX **SoilMap, CHANNEL *ChannelData, 
+		     SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+		     CHANNEL *ChannelData, 
 		     TIMESTRUCT *Time, OPTIONSTRUCT *Options, 
-		     char *DumpPath, int MaxStreamID, SNOWPIX **SnowMap);
+		     char *DumpPath, int MaxStreamID, SNOWPIX **SnowMap,
+		     FLOWDIRMAP *SubFlowDir, SUBFLOWPIX *SubFlowMap);
 
 void RouteSurface(MAPSIZE * Map, TIMESTRUCT * Time, TOPOPIX ** TopoMap,
-  SOILPIX ** SoilMap, OPTIONSTRUCT *Options,
+  SOILPIX ** SoilMap, SOILFLOWMAP *SoilFlow, OPTIONSTRUCT *Options,
   UNITHYDR ** UnitHydrograph, UNITHYDRINFO * HydrographInfo, float *Hydrograph,
-  DUMPSTRUCT *Dump, VEGPIX ** VegMap, VEGTABLE * VType, CHANNEL *ChannelData);
+  DUMPSTRUCT *Dump, VEGPIX ** VegMap, VEGTABLE * VType, CHANNEL *ChannelData,
+  DRAINMAP *DrainMap);
 
 float SatVaporPressure(float Temperature);
 
+void SaveMember(ENSEMBLEMEMBER *Member, DUMPSTRUCT *Dump, AGGREGATED *Total,
+  MAPSIZE *Map, OPTIONSTRUCT *Options, TIMESTRUCT *Time, LAYER *Soil,
+  LAYER *Veg, EVAPPIX **EvapMap, PIXRAD **RadMap, PRECIPPIX **PrecipMap,
+  SNOWPIX **SnowMap, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass);
+
 int ScanInts(FILE *FilePtr, int *X, int N);
 
 int ScanDoubles(FILE *FilePtr, double *X, int N);
@@ -349,17 +432,102 @@ void SkipHeader(FILES *InFile, int NLines);
 
 void SkipLines(FILES *InFile, int NLines);
 
-void StoreChannelState(char *Path, DATE *Current, Channel *Head);
+void StoreChannelState(char *Path, DATE *Current, Channel *Head,
+  CHECKPOINT *Checkpoint);
+
+void StoreMetRecord(OPTIONSTRUCT *Options, int NSoilLayers, char *FileName,
+		    unsigned char IsWindModelLocation, float *Array,
+		    MET *MetRecord);
 
 void StoreModelState(char *Path, DATE *Current, MAPSIZE *Map,
 		     OPTIONSTRUCT *Options, TOPOPIX **TopoMap, PRECIPPIX **PrecipMap, 
              SNOWPIX **SnowMap, MET_MAP_PIX **MetMap, VEGPIX **VegMap, 
-             LAYER *Veg, SOILPIX **SoilMap, LAYER *Soil, ROADSTRUCT **Network, 
-		     UNITHYDRINFO *HydrographInfo, float *Hydrograph, CHANNEL *ChannelData);
+             LAYER *Veg, SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow,
+             LAYER *Soil, ROADSTRUCT **Network, 
+		     UNITHYDRINFO *HydrographInfo, float *Hydrograph, CHANNEL *ChannelData,
+		     CHECKPOINT *Checkpoint);
 
 void SnowStats(DATE *Now, MAPSIZE *Map, OPTIONSTRUCT *Options, 
         TOPOPIX **TopoMap, SNOWPIX **Snow, int Dt);
 
+SNAPSHOT *TakeSnapshot(MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass);
+
+void UpdateSnapshot(SNAPSHOT *Snap, MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass);
+
+void RestoreSnapshot(SNAPSHOT *Snap, MAPSIZE *Map, OPTIONSTRUCT *Options,
+  TIMESTRUCT *Time, LAYER *Soil, LAYER *Veg, EVAPPIX **EvapMap,
+  PIXRAD **RadMap, PRECIPPIX **PrecipMap, SNOWPIX **SnowMap,
+  SOILPIX **SoilMap, SOILFLOWMAP *SoilFlow, VEGPIX **VegMap, ROADSTRUCT **Network,
+  CHANNEL *ChannelData, UNITHYDRINFO *HydrographInfo, float *Hydrograph,
+  WATERBALANCE *Mass);
+
+void FreeSnapshot(SNAPSHOT *Snap);
+
+void InitParallel(int *argc, char ***argv);
+void EndParallel(void);
+int ParallelRank(void);
+int ParallelSize(void);
+void DecomposeDomain(LISTPTR Input, OPTIONSTRUCT *Options, MAPSIZE *Map);
+void InitLocalMap(MAPSIZE *Map, MAPSIZE *LocalMap);
+int RowOwner(int y);
+int OwnsCell(MAPSIZE *Map, int y, int x);
+MAPSIZE *WholeMap(MAPSIZE *Map);
+void GatherMap(void *Matrix, void *WholeMatrix, size_t Size, MAPSIZE *Map);
+float ShareCellValue(MAPSIZE *Map, int y, int x, float Value);
+void ExchangeMapHalo(MAPSIZE *Map, void **Rows, size_t Stride, size_t Offset,
+  size_t Size);
+void ExchangeArrayHalo(MAPSIZE *Map, void *Array, size_t Stride,
+  size_t Offset, size_t Size);
+void BeginOrderedSweep(MAPSIZE *Map, void **Rows, size_t Stride,
+  size_t Offset, size_t Size);
+void EndOrderedSweep(MAPSIZE *Map, void **Rows, size_t Stride,
+  size_t Offset, size_t Size);
+void BeginOrderedPass(void *Data, size_t Size);
+void EndOrderedPass(void *Data, size_t Size);
+void ParallelSum(double *Values, int N);
+void SumRows(double *Partial, MAPSIZE *Map, int N);
+void ParallelMin(float *Values, int N);
+void ExchangeCounts(int *SendCounts, int *ReceiveCounts);
+void ExchangeItems(void *Send, int *SendCounts, void *Receive,
+  int *ReceiveCounts, size_t Size);
+void InitChannelRouting(MAPSIZE *Map, CHANNEL *ChannelData);
+void RouteChannelNetwork(ChannelSchedule *Schedule, int Dt, int AllProcesses);
+void ForwardChannelIncrements(CHANNEL *ChannelData);
+
+void InitTiming(void);
+void OpenTrace(char *Path);
+void StartTimer(int Timer);
+void StopTimer(int Timer);
+void StartStepTimer(DATE *Current);
+void StopStepTimer(void);
+double ElapsedTime(void);
+void EndTiming(FILE *Out, int NCells);
+
+size_t SlabBytes(size_t N, size_t Size);
+void ReserveSlab(SLAB *Slab, size_t Bytes);
+void *SlabAlloc(SLAB *Slab, size_t N, size_t Size);
+void FreeSlab(SLAB *Slab);
+
+void CalcTransmissivityRun(int N, float *SoilDepth, float *WaterTable,
+			   float *LateralKs, float *KsExponent,
+			   float *DepthThresh, float *Transmissivity);
+void LapseTRun(int N, float Temp, float FromElev, float *ToElev,
+	       float LapseRate, float *LapsedTemp);
+void LapsePrecipRun(int N, float Precip, float FromElev, float *ToElev,
+		    float PrecipLapse, float *precipMultiplier,
+		    float *LapsedPrecip);
+void AirPressureRun(int N, float *LapseRate, float *Elev, float *Press);
+
 float viscosity(float Tair, float Rh);
 
 /* functions for John's RBM model */
@@ -425,7 +593,7 @@ void GapSurroundingShortRadiation(CanopyGapStruct *Forest, VEGTABLE *VType,
 
 void InitCanopyGapMap(OPTIONSTRUCT *Options, LISTPTR Input, MAPSIZE *Map,
   LAYER *Soil, LAYER *Veg, VEGTABLE *VType, VEGPIX ***VegMap, SOILTABLE *SType,
-  SOILPIX ***SoilMap);
+  SOILPIX ***SoilMap, SLAB *Slab);
 
 float NonGapShortRadiation(float Rs, float SunAngle, float SoilAlbedo,
   CanopyGapStruct *Forest, VEGTABLE *VType, SNOWPIX *LocalSnow);
@@ -17,10 +17,35 @@
 #define MASSENERGY_H
 
 #include "data.h"
-#include <stdarg.h>
 
-void AggregateRadiation(int MaxVegLayers, int NVegL, PIXRAD * Rad,
-			PIXRAD * TotalRad);
+/* Parameters of the surface energy balance in the absence of snow, see
+   SurfaceEnergyBalance() */
+typedef struct {
+  int Dt;			/* Model time step (seconds) */
+  float Ra;			/* Aerodynamic resistance (s/m) */
+  float Z;			/* Reference height (m) */
+  float Displacement;		/* Displacement height (m) */
+  float Z0;			/* Surface roughness (m) */
+  float Wind;			/* Wind speed (m/s) */
+  float ShortRad;		/* Net incident shortwave radiation (W/m2) */
+  float LongRadIn;		/* Incoming longwave radiation (W/m2) */
+  float AirDens;		/* Density of air (kg/m3) */
+  float Lv;			/* Latent heat of vaporization (J/kg3) */
+  float ETot;			/* Total evapotranspiration (m) */
+  float Kt;			/* Effective soil thermal conductivity 
+				   (W/(m*K)) */
+  float ChSoil;			/* Soil thermal capacity (J/(kg*K)) */
+  float Porosity;		/* Porosity of upper soil layer */
+  float MoistureContent;	/* Moisture content of upper soil layer */
+  float Depth;			/* Depth of soil heat profile (m) */
+  float Tair;			/* Air temperature (C) */
+  float TSoilUpper;		/* Soil temperature in upper layer (C) */
+  float TSoilLower;		/* Soil temperature at Depth (C) */
+  float OldTSurf;		/* Surface temperature during previous time
+				   step */
+  float MeltEnergy;		/* Energy used to melt/refreeze snow pack 
+				   (W/m2) */
+} SURFACEBALANCE;
 
 float CanopyResistance(float LAI, float RsMin, float RsMax, float Rpc,
 		       float VpdThres, float MoistThres, float WP,
@@ -78,6 +103,6 @@ float SoilEvaporation(int Dt, float Temp, float Slope, float Gamma,
 float StabilityCorrection(float Z, float d, float Tsurf, float Tair,
 			  float Wind, float Z0);
 
-float SurfaceEnergyBalance(float TSurf, va_list ap);
+float SurfaceEnergyBalance(float TSurf, void *Params);
 
 #endif
@@ -96,6 +96,10 @@ typedef unsigned int unint;
 #define MAXDIRS        8
 #define NNEIGHBORS     8    /* Number of directions in which water can flow based on fine grid, must equal 8 */
 
+#define TILEROWS       4    /* Number of grid rows handed to a thread as one unit of work in the pixel loop */
+#define SLABBLOCK  1048576  /* Size of the blocks of a slab (bytes) for arrays that were not reserved */
+#define KERNELCELLS   64    /* Number of cells of a run handed to the kernels in CellKernels.c at a time */
+
 
 #define NA          -9999	/* Not applicable */
 
@@ -104,6 +108,31 @@ typedef unsigned int unint;
 #define MAP_OUTPUT 1
 #define IMAGE_OUTPUT 2
 
+#define TEXT_PIXDUMP 1
+#define BINARY_PIXDUMP 2
+
+#define MAP_STATE 1
+#define CHECKPOINT_STATE 2
+
+/* Phases timed in Timing.c; TIMER_NEWSTEP is the first phase of the
+   time step loop */
+#define TIMER_INITTABLES   0
+#define TIMER_INITTERRAIN  1
+#define TIMER_INITCHANNEL  2
+#define TIMER_INITMET      3
+#define TIMER_INITDUMP     4
+#define TIMER_INITSTATE    5
+#define TIMER_NEWSTEP      6
+#define TIMER_AVALANCHE    7
+#define TIMER_PIXELS       8
+#define TIMER_SUBSURFACE   9
+#define TIMER_CHANNEL     10
+#define TIMER_SURFACE     11
+#define TIMER_AGGREGATE   12
+#define TIMER_MASSBALANCE 13
+#define TIMER_DUMP        14
+#define NTIMERS           15
+
 #define MIN_SWE 0.005 
 
 // Canopy type used in canopy gapping option
@@ -120,7 +149,8 @@ enum KEYS {
   temp_lapse, precip_lapse, cressman_radius, cressman_stations, prism_data_path, 
   prism_data_ext, shading_data_path, shading_data_ext, skyview_data_path, 
   stream_temp, canopy_shading, improv_radiation, gapping, snowslide, sepr, 
-  snowstats, routing_neighbors, 
+  snowstats, routing_neighbors, prefetch_depth, output_queue_size,
+  state_format, state_compression, ensemble_members, timing_trace_file,
   /* Area */
   coordinate_system, extreme_north, extreme_west, center_latitude,
   center_longitude, time_zone_meridian, number_of_rows,
@@ -180,6 +210,7 @@ enum KEYS {
   /* number of each type of output */
   output_path =
     0, initial_state_path, npixels, nstates, nmapvars, nimagevars, ngraphics,
+    pixformat,
   /* pixel information */
   north = 0, east, name,
   /* state information */
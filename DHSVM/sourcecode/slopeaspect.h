@@ -29,11 +29,13 @@ extern int yneighbor[NNEIGHBORS];
    available functions
    ------------------------------------------------------------- */
 void ElevationSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap);
+void InitFlowDirMap(MAPSIZE * Map, FLOWDIRMAP * FlowDir);
 void HeadSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SOILPIX ** SoilMap,
-  float **FlowGrad, unsigned char ***Dir, unsigned int **TotalDir);
+  FLOWDIRMAP * FlowDir);
 void SnowSlopeAspect(MAPSIZE * Map, TOPOPIX ** TopoMap, SNOWPIX ** Snow,
-  float **FlowGrad, unsigned char ***Dir, unsigned int **TotalDir);
+  FLOWDIRMAP * FlowDir);
 int valid_cell(MAPSIZE * Map, int x, int y);
+int upslope_order(int *order);
 void quick(ITEM *OrderedCells, int count);
 #endif
 
@@ -16,7 +16,32 @@
 #ifndef SNOW_H
 #define SNOW_H
 
-#include <stdarg.h>
+/* Parameters of the energy balance of the snow pack, see
+   SnowPackEnergyBalance() */
+typedef struct {
+  int Dt;			/* Model time step (seconds) */
+  float Ra;			/* Aerodynamic resistance (s/m) */
+  float Z;			/* Reference height (m) */
+  float Displacement;		/* Displacement height (m) */
+  float Z0;			/* Roughness length (m) */
+  float Wind;			/* Wind speed (m/s) */
+  float ShortRad;		/* Net incident shortwave radiation (W/m2) */
+  float LongRadIn;		/* Incoming longwave radiation (W/m2) */
+  float AirDens;		/* Density of air (kg/m3) */
+  float Lv;			/* Latent heat of vaporization (J/kg3) */
+  float Tair;			/* Air temperature (C) */
+  float Press;			/* Air pressure (Pa) */
+  float Vpd;			/* Vapor pressure deficit (Pa) */
+  float EactAir;		/* Actual vapor pressure of air (Pa) */
+  float Rain;			/* Rain fall (m/timestep) */
+  float SweSurfaceLayer;	/* Snow water equivalent in surface layer (m) */
+  float SurfaceLiquidWater;	/* Liquid water in the surface layer (m) */
+  float OldTSurf;		/* Surface temperature during previous time
+				   step */
+  float *RefreezeEnergy;	/* Refreeze energy (W/m2) */
+  float *VaporMassFlux;		/* Mass flux of water vapor to or from the
+				   intercepted snow */
+} SNOWBALANCE;
 
 
 void MassRelease(float *InterceptedSnow, float *TempInterceptionStorage,
@@ -39,6 +64,6 @@ float SnowMelt(int y, int x, int Dt, float Z, float Displacement, float Z0,
 	       float *VaporMassFlux, float *TPack, float *TSurf,
 	       float *MeltEnergy);
 
-float SnowPackEnergyBalance(float TSurf, va_list ap);
+float SnowPackEnergyBalance(float TSurf, void *Params);
 
 #endif